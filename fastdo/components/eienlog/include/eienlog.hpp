@@ -95,6 +95,13 @@ enum LogBgColor : winux::uint16
     lbcWhite = lbcRed | lbcGreen | lbcBlue
 };
 
+/** \brief 二进制日志的数据种类，记在二进制记录的编码位上。`logBin()`发送的记录编码位为0 */
+enum LogBinaryKind
+{
+    lbkRaw = 0,     //!< 原始二进制数据
+    lbkFields = 3,  //!< 结构化字段，见`LogFields`
+};
+
 /** \brief 日志样式旗标 */
 union LogFlag
 {
@@ -138,6 +145,59 @@ union LogFlag
         this->logEncoding = logEncoding;
         this->binary = isBinary;
     }
+
+    /** \brief 是否结构化字段记录 */
+    bool isFields() const { return this->binary && this->logEncoding == lbkFields; }
+};
+
+/** \brief 日志级别 */
+enum LogSeverity
+{
+    lsNone,     //!< 未指定
+    lsTrace,    //!< 跟踪
+    lsDebug,    //!< 调试
+    lsInfo,     //!< 信息
+    lsWarning,  //!< 警告
+    lsError,    //!< 错误
+    lsFatal,    //!< 致命错误
+    lsCount = 8
+};
+
+//! 日志类别数，类别的含义由程序自行约定，0表示未分类
+#define LOG_CATEGORY_COUNT 16
+
+/** \brief 日志元信息：级别和类别
+ *
+ *  `LogFlag`已没有空余的位，元信息随分块头部的记录ID发送：记录ID只用低24位区分记录，高8位存放元信息，最高位表示元信息有效。
+ *  旧的读取器只用记录ID重组分块，不受影响；旧的写入器发送的记录没有元信息。 */
+union LogMeta
+{
+    struct
+    {
+        winux::uint8 category:4;    //!< 类别0~15
+        winux::uint8 severity:3;    //!< 级别
+        winux::uint8 valid:1;       //!< 是否设置了元信息
+    };
+    winux::uint8 value;
+
+    LogMeta() : value(0)
+    {
+    }
+
+    LogMeta( LogSeverity severity, winux::uint8 category = 0 ) : value(0)
+    {
+        this->category = category;
+        this->severity = severity;
+        this->valid = true;
+    }
+
+    /** \brief 从分块头部的记录ID取出元信息 */
+    static LogMeta FromChunkId( winux::uint32 id )
+    {
+        LogMeta meta;
+        if ( id & 0x80000000 ) meta.value = (winux::uint8)( id >> 24 );
+        return meta;
+    }
 };
 
 /** \brief 日志分块头部 */
@@ -148,7 +208,7 @@ struct LogChunkHeader
     winux::uint16 index;        //!< 分块编号
     winux::uint16 total;        //!< 总块数
     winux::uint32 flag;         //!< 控制日志样式或颜色等信息
-    winux::uint32 id;           //!< 记录ID
+    winux::uint32 id;           //!< 记录ID，高8位为元信息，见`LogMeta`
     winux::uint64 utcTime;      //!< UTC时间戳(ms)
 };
 
@@ -164,6 +224,115 @@ struct LogRecord
     winux::Buffer data; //!< 日志数据
     time_t utcTime;     //!< UTC时间戳(ms)
     winux::uint32 flag; //!< 日志样式FLAG
+    LogMeta meta;       //!< 级别和类别
+};
+
+/** \brief 结构化日志的字段类型 */
+enum LogFieldType : winux::uint8
+{
+    lftInt,     //!< 64位有符号整数
+    lftFloat,   //!< 双精度浮点数
+    lftString,  //!< UTF-8字符串
+    lftBytes,   //!< 字节串
+    lftTime,    //!< 时间戳（UTC毫秒）
+    lftCount
+};
+
+/** \brief 结构化日志的一个字段 */
+struct LogField
+{
+    winux::AnsiString key;      //!< 字段名
+    LogFieldType type;          //!< 字段类型
+    winux::int64 i;             //!< 整数、时间戳的值
+    double f;                   //!< 浮点数的值
+    winux::AnsiString s;        //!< 字符串、字节串的值
+
+    LogField() : type(lftInt), i(0), f(0) { }
+};
+
+/** \brief 写入变长整数，每字节低7位有效，最高位表示后面还有字节 */
+inline void PutVarint( winux::AnsiString * out, winux::uint64 v )
+{
+    while ( v >= 0x80 )
+    {
+        *out += (char)( ( v & 0x7f ) | 0x80 );
+        v >>= 7;
+    }
+    *out += (char)v;
+}
+
+/** \brief 读取变长整数，p前进到整数之后，越界返回false */
+inline bool GetVarint( winux::byte const * & p, winux::byte const * end, winux::uint64 * v )
+{
+    winux::uint64 r = 0;
+    for ( int shift = 0; p < end && shift < 64; shift += 7 )
+    {
+        winux::byte b = *p++;
+        r |= (winux::uint64)( b & 0x7f ) << shift;
+        if ( !( b & 0x80 ) )
+        {
+            *v = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** \brief 有符号整数转成无符号，使小的负数也编码得短 */
+inline winux::uint64 ZigZag( winux::int64 v ) { return ( (winux::uint64)v << 1 ) ^ (winux::uint64)( v >> 63 ); }
+
+/** \brief ZigZag()的逆变换 */
+inline winux::int64 UnZigZag( winux::uint64 v ) { return (winux::int64)( v >> 1 ) ^ -(winux::int64)( v & 1 ); }
+
+/** \brief 结构化日志的字段编码
+ *
+ *  带类型的键值字段编码成紧凑的二进制，作为二进制记录发送，编码位为`lbkFields`，旧的接收端按二进制数据显示。\n
+ *  格式：魔数字节0xF1，之后逐个字段：类型（1字节）、名字长度（变长整数）、名字、值。
+ *  整数按zigzag编码成变长整数，时间戳为无符号变长整数，浮点数为8字节小端IEEE754，字符串和字节串为长度（变长整数）加内容。
+ *  变长整数每字节低7位有效，最高位表示后面还有字节。 */
+class EIENLOG_DLL LogFields
+{
+public:
+    enum { Magic = 0xF1 }; //!< 编码的首字节
+
+    LogFields();
+
+    /** \brief 添加整数字段 */
+    LogFields & addInt( winux::AnsiString const & key, winux::int64 value );
+    /** \brief 添加浮点数字段 */
+    LogFields & addFloat( winux::AnsiString const & key, double value );
+    /** \brief 添加字符串字段，字符串须为UTF-8编码 */
+    LogFields & addString( winux::AnsiString const & key, winux::AnsiString const & value );
+    /** \brief 添加字节串字段 */
+    LogFields & addBytes( winux::AnsiString const & key, void const * data, size_t size );
+    /** \brief 添加时间戳字段（UTC毫秒） */
+    LogFields & addTime( winux::AnsiString const & key, winux::uint64 utcTimeMs );
+    /** \brief 添加一个字段 */
+    LogFields & add( LogField const & field );
+
+    /** \brief 清空已添加的字段 */
+    void clear();
+
+    /** \brief 字段数 */
+    size_t getCount() const { return _count; }
+
+    /** \brief 编码后的数据，不复制 */
+    winux::Buffer getData() const { return winux::Buffer( _data.c_str(), _data.length(), true ); }
+
+    /** \brief 解析字段编码
+     *
+     *  \param data 数据
+     *  \param size 数据大小
+     *  \param fields 接受字段
+     *  \return bool 格式有误时返回false */
+    static bool Parse( void const * data, size_t size, std::vector<LogField> * fields );
+
+private:
+    // 写入字段头部：类型、名字
+    void _addHeader( LogFieldType type, winux::AnsiString const & key );
+
+    winux::AnsiString _data; // 编码后的数据
+    size_t _count; // 字段数
 };
 
 /** \brief 日志写入器 */
@@ -180,8 +349,9 @@ public:
     /** \brief 发送日志（不转换编码）
      *
      *  \param data 数据
+     *  \param meta 级别和类别
      *  \return size_t 发送的封包数量 */
-    size_t logEx( winux::Buffer const & data, LogFlag flag );
+    size_t logEx( winux::Buffer const & data, LogFlag flag, LogMeta meta = LogMeta() );
 
     /** \brief 发送日志（不转换编码）
      *
@@ -196,8 +366,9 @@ public:
     /** \brief 发送字符串日志（会转换编码）
      *
      *  \param str 字符串内容
+     *  \param meta 级别和类别
      *  \return size_t 发送的封包数量 */
-    size_t log( winux::String const & str, LogFlag flag );
+    size_t log( winux::String const & str, LogFlag flag, LogMeta meta = LogMeta() );
 
     /** \brief 发送字符串日志（会转换编码）
      *
@@ -230,6 +401,29 @@ public:
         return this->logEx( data, LogFlag( !fgColor.isNull(), fgColor, !bgColor.isNull(), bgColor, 0, true ) );
     }
 
+    /** \brief 发送结构化字段日志
+     *
+     *  \param fields 字段
+     *  \param flag 颜色等样式，二进制位和编码位会被设置成结构化字段
+     *  \param meta 级别和类别
+     *  \return size_t 发送的封包数量 */
+    size_t logFields( LogFields const & fields, LogFlag flag = LogFlag(), LogMeta meta = LogMeta() )
+    {
+        flag.logEncoding = lbkFields;
+        flag.binary = true;
+        return this->logEx( fields.getData(), flag, meta );
+    }
+
+    /** \brief 原样发送一个已分块的封包，用于回放抓包
+     *
+     *  \param data 封包数据
+     *  \param size 封包大小
+     *  \return bool */
+    bool sendChunk( void const * data, size_t size );
+
+    /** \brief 分块封包大小 */
+    winux::uint16 getChunkSize() const { return _chunkSize; }
+
     int errNo() const { return _errno; }
 
 private:
@@ -271,6 +465,15 @@ public:
      *  \return bool */
     bool readRecord( LogRecord * record, time_t waitTimeout = 3000, time_t updateTimeout = 3000 );
 
+    /** \brief 等待有完整的分块封包可读
+     *
+     *  \param waitTimeout 等待超时(ms)
+     *  \return bool 超时返回false */
+    bool waitChunk( time_t waitTimeout );
+
+    /** \brief 分块封包大小 */
+    winux::uint16 getChunkSize() const { return _chunkSize; }
+
     int errNo() const { return _errno; }
 
 private:
@@ -297,8 +500,9 @@ EIENLOG_FUNC_DECL(void) WriteLogBin( void const * data, size_t size );
 /** \brief 发送日志（不转换编码）
  *
  *  \param data 数据
+ *  \param meta 级别和类别
  *  \return size_t 发送的封包数量 */
-EIENLOG_FUNC_DECL(size_t) LogEx( winux::Buffer const & data, LogFlag flag );
+EIENLOG_FUNC_DECL(size_t) LogEx( winux::Buffer const & data, LogFlag flag, LogMeta meta = LogMeta() );
 
 /** \brief 发送日志（不转换编码）
  *
@@ -313,8 +517,9 @@ EIENLOG_FUNC_DECL(size_t) LogEx( winux::Buffer const & data, winux::Mixed const
 /** \brief 发送字符串日志（会转换编码）
  *
  *  \param str 字符串内容
+ *  \param meta 级别和类别
  *  \return 发送的封包数量 */
-EIENLOG_FUNC_DECL(size_t) Log( winux::String const & str, LogFlag flag );
+EIENLOG_FUNC_DECL(size_t) Log( winux::String const & str, LogFlag flag, LogMeta meta = LogMeta() );
 
 /** \brief 发送字符串日志（会转换编码）
  *
@@ -339,6 +544,14 @@ EIENLOG_FUNC_DECL(size_t) LogBin( winux::Buffer const & data, LogFlag flag );
  *  \return 发送的封包数量 */
 EIENLOG_FUNC_DECL(size_t) LogBin( winux::Buffer const & data, winux::Mixed const & fgColor = winux::mxNull, winux::Mixed const & bgColor = winux::mxNull );
 
+/** \brief 发送结构化字段日志
+ *
+ *  \param fields 字段
+ *  \param flag 颜色等样式
+ *  \param meta 级别和类别
+ *  \return 发送的封包数量 */
+EIENLOG_FUNC_DECL(size_t) LogStruct( LogFields const & fields, LogFlag flag = LogFlag(), LogMeta meta = LogMeta() );
+
 /** \brief 发送日志（不转换编码）
  *
  *  \return size_t 发送的封包数量 */
@@ -441,5 +654,7 @@ inline static void VerboseOutput( int verbose, winux::ushort vcaFlags, _ArgType&
 
 } // namespace eienlog
 
+#include "eienlog_archive.hpp"
+#include "eienlog_capture.hpp"
 
 #endif // __EIENLOG_HPP__
@@ -0,0 +1,238 @@
+﻿#ifndef __EIENLOG_ARCHIVE_HPP__
+#define __EIENLOG_ARCHIVE_HPP__
+
+namespace eienlog
+{
+
+/** \brief 日志归档文件(.eienlog)
+ *
+ *  文件结构：文件头 | 块1 | 块2 | ... | 块索引 | 尾部。整数均为小端序。
+ *  每块由块头和压缩数据组成，块头记有块内首行行号、行数和最早/最晚时间。
+ *  压缩前的数据按列存放：时间差、旗标、数据长度三列变长整数，然后是各条日志数据。
+ *  旗标列的低32位为日志样式FLAG，32~39位为元信息（`LogMeta`），只取低32位的旧读取器不受影响。
+ *  文件末尾的块索引让读取器打开文件时只读索引，按行号或时间定位只需解压一块。
+ *  追加时新块覆盖旧索引写入，再写入新索引。尾部损坏（如写入中途崩溃）时按块头顺序扫描恢复。 */
+
+#define LOG_ARCHIVE_MAGIC "EIENLOG"
+#define LOG_ARCHIVE_VERSION 1
+#define LOG_ARCHIVE_BLOCK_MAGIC 0x4b424c45 // "ELBK"
+#define LOG_ARCHIVE_TRAILER_MAGIC 0x54464c45 // "ELFT"
+
+/** \brief 归档文件头 */
+struct LogArchiveHeader
+{
+    char magic[8];              //!< "EIENLOG\0"
+    winux::uint32 version;      //!< 格式版本
+    winux::uint32 reserved;     //!< 保留
+};
+
+/** \brief 归档块头 */
+struct LogArchiveBlockHeader
+{
+    winux::uint32 magic;        //!< LOG_ARCHIVE_BLOCK_MAGIC
+    winux::uint32 rows;         //!< 块内行数
+    winux::uint64 firstRow;     //!< 块内首行行号
+    winux::uint64 minTime;      //!< 块内最早UTC时间戳(ms)
+    winux::uint64 maxTime;      //!< 块内最晚UTC时间戳(ms)
+    winux::uint32 rawSize;      //!< 压缩前大小
+    winux::uint32 zipSize;      //!< 压缩后大小
+};
+
+/** \brief 归档块索引项 */
+struct LogArchiveIndexEntry
+{
+    winux::uint64 offset;       //!< 块头在文件中的偏移
+    winux::uint64 firstRow;     //!< 块内首行行号
+    winux::uint64 minTime;      //!< 块内最早UTC时间戳(ms)
+    winux::uint64 maxTime;      //!< 块内最晚UTC时间戳(ms)
+    winux::uint32 rows;         //!< 块内行数
+    winux::uint32 reserved;     //!< 保留
+};
+
+/** \brief 归档文件尾部 */
+struct LogArchiveTrailer
+{
+    winux::uint64 indexOffset;  //!< 块索引在文件中的偏移
+    winux::uint32 blockCount;   //!< 块数
+    winux::uint32 magic;        //!< LOG_ARCHIVE_TRAILER_MAGIC
+};
+
+/** \brief 归档块的编解码
+ *
+ *  攒下一块记录，按列编码并压缩成块头和压缩数据，或把压缩数据解码回记录。
+ *  归档写入器和读取器用它读写块，需要同样块格式的地方（如界面的冷块文件）也可直接使用。 */
+class EIENLOG_DLL LogArchiveBlock
+{
+public:
+    /** \brief 加入一条记录
+     *
+     *  \param data 日志数据
+     *  \param size 数据大小
+     *  \param utcTime UTC时间戳(ms)
+     *  \param flag 日志样式FLAG
+     *  \param meta 级别和类别 */
+    void add( void const * data, size_t size, winux::uint64 utcTime, winux::uint32 flag, LogMeta meta = LogMeta() );
+
+    /** \brief 加入一条日志记录 */
+    void add( LogRecord const & record ) { this->add( record.data.getBuf(), record.data.getSize(), (winux::uint64)record.utcTime, record.flag, record.meta ); }
+
+    /** \brief 已加入的行数 */
+    size_t getRows() const { return _times.size(); }
+
+    /** \brief 已加入的日志数据字节数 */
+    size_t getBytes() const { return _data.length(); }
+
+    /** \brief 清空已加入的记录 */
+    void clear();
+
+    /** \brief 编码并压缩已加入的记录
+     *
+     *  \param firstRow 块内首行行号，记入块头
+     *  \param hdr 输出块头
+     *  \param zip 输出压缩数据，大小为块头的zipSize
+     *  \param zipLevel 压缩级别，1最快，8压缩率最高
+     *  \param extra 接在日志数据之后一起压缩的附加数据，归档文件不使用
+     *  \return bool 没有记录或压缩失败返回false */
+    bool encode( winux::uint64 firstRow, LogArchiveBlockHeader * hdr, winux::AnsiString * zip, int zipLevel = 8, winux::AnsiString const * extra = nullptr ) const;
+
+    /** \brief 解压并解码一块，追加到records
+     *
+     *  \param hdr 块头，调用者须确认压缩数据有zipSize字节
+     *  \param zipData 压缩数据
+     *  \param extra 不为空时接受编码时的附加数据
+     *  \return bool 数据损坏返回false */
+    static bool Decode( LogArchiveBlockHeader const & hdr, void const * zipData, std::vector<LogRecord> * records, winux::AnsiString * extra = nullptr );
+
+private:
+    std::vector<winux::uint64> _times;
+    std::vector<winux::uint64> _flags; // 低32位为FLAG，其上为元信息
+    std::vector<winux::uint32> _sizes;
+    winux::AnsiString _data;
+};
+
+/** \brief 日志归档写入器
+ *
+ *  记录先攒在内存中，攒满一块或调用flush()时压缩写入文件，并重写块索引和尾部。
+ *  持续写入时（如接收日志的守护进程）可定期调用flush()，使已写入的记录对读取器可见。 */
+class EIENLOG_DLL LogArchiveWriter
+{
+public:
+    enum
+    {
+        BlockBytes = 256 * 1024,    //!< 块压缩前的目标大小
+        BlockRows = 8192            //!< 块内最大行数
+    };
+
+    LogArchiveWriter();
+
+    /** \brief 析构函数，会写入未满的块 */
+    ~LogArchiveWriter();
+
+    /** \brief 打开归档文件
+     *
+     *  \param path 文件路径
+     *  \param append 文件存在时是否在末尾追加，否则清空重写
+     *  \return bool */
+    bool open( winux::String const & path, bool append = true );
+
+    /** \brief 写入一条日志记录 */
+    bool write( LogRecord const & record ) { return this->write( record.data.getBuf(), record.data.getSize(), (winux::uint64)record.utcTime, record.flag, record.meta ); }
+
+    /** \brief 写入一条日志记录
+     *
+     *  \param data 日志数据
+     *  \param size 数据大小
+     *  \param utcTime UTC时间戳(ms)
+     *  \param flag 日志样式FLAG
+     *  \param meta 级别和类别 */
+    bool write( void const * data, size_t size, winux::uint64 utcTime, winux::uint32 flag, LogMeta meta = LogMeta() );
+
+    /** \brief 把未满的块写入文件，并更新块索引 */
+    bool flush();
+
+    /** \brief 写入未满的块并关闭文件 */
+    bool close();
+
+    /** \brief 文件中和缓冲中的总行数 */
+    winux::uint64 getRowCount() const { return _rowCount; }
+
+    /** \brief 文件是否已打开 */
+    bool isOpened() const { return _opened; }
+
+private:
+    // 压缩并写入缓冲中的块
+    bool _writeBlock();
+    // 在当前位置写入块索引和尾部
+    bool _writeIndex();
+
+    winux::File _file;
+    bool _opened;
+    std::vector<LogArchiveIndexEntry> _index; // 块索引
+    winux::uint64 _rowCount; // 总行数
+    winux::uint64 _endOffset; // 最后一块之后的偏移，即块索引的写入位置
+
+    LogArchiveBlock _block; // 当前块的缓冲
+
+    DISABLE_OBJECT_COPY(LogArchiveWriter)
+};
+
+/** \brief 日志归档读取器
+ *
+ *  文件以只读方式映射进内存，打开时只读取块索引。读取记录的接口可在多个线程同时调用。 */
+class EIENLOG_DLL LogArchiveReader
+{
+public:
+    LogArchiveReader();
+
+    ~LogArchiveReader();
+
+    /** \brief 打开归档文件
+     *
+     *  尾部无效时按块头顺序扫描恢复，丢弃不完整的最后一块。
+     *  \return bool 不是归档文件时返回false */
+    bool open( winux::String const & path );
+
+    /** \brief 关闭文件 */
+    void close();
+
+    /** \brief 总行数 */
+    winux::uint64 getRowCount() const { return _rowCount; }
+
+    /** \brief 块数 */
+    size_t getBlockCount() const { return _index.size(); }
+
+    /** \brief 获取块索引项 */
+    LogArchiveIndexEntry const & getBlockInfo( size_t blockIndex ) const { return _index[blockIndex]; }
+
+    /** \brief 查找行所在的块，超出范围返回块数 */
+    size_t findBlockByRow( winux::uint64 row ) const;
+
+    /** \brief 查找第一条时间不早于utcTime的记录的行号
+     *
+     *  按块的最晚时间定位到一块，只解压这一块。时间基本有序时结果准确；没有这样的记录返回总行数。 */
+    winux::uint64 findRowByTime( winux::uint64 utcTime ) const;
+
+    /** \brief 读取一块的全部记录，追加到records */
+    bool readBlock( size_t blockIndex, std::vector<LogRecord> * records ) const;
+
+    /** \brief 读取从firstRow开始的count条记录，追加到records */
+    bool readRecords( winux::uint64 firstRow, size_t count, std::vector<LogRecord> * records ) const;
+
+private:
+    // 扫描块头恢复块索引
+    void _recoverIndex();
+    // 取得一块的块头和压缩数据，块不完整时返回false
+    bool _getBlock( size_t blockIndex, LogArchiveBlockHeader * hdr, winux::byte const * * zipData ) const;
+
+    winux::FileMapping _mapping;
+    std::vector<LogArchiveIndexEntry> _index; // 块索引
+    std::vector<winux::uint64> _maxTimes; // 各块及之前块的最晚时间，用于按时间二分查找
+    winux::uint64 _rowCount; // 总行数
+
+    DISABLE_OBJECT_COPY(LogArchiveReader)
+};
+
+
+} // namespace eienlog
+
+#endif // __EIENLOG_ARCHIVE_HPP__
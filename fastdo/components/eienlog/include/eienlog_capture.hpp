@@ -0,0 +1,167 @@
+﻿#ifndef __EIENLOG_CAPTURE_HPP__
+#define __EIENLOG_CAPTURE_HPP__
+
+namespace eienlog
+{
+
+/** \brief 日志流量抓包文件(.eiencap)
+ *
+ *  原样保存接收到的分块封包及其接收时间，供回放重现同样的流量，用于可重复的性能测试。
+ *  文件结构：文件头 | 封包1 | 封包2 | ...。整数均为小端序。
+ *  每个封包依次是：距上一封包的接收时间差(us)、封包大小、保存的字节数三个变长整数，然后是保存的字节。
+ *  封包末尾的零字节不保存（分块的日志空间常常用不满），回放时补齐到封包大小。
+ *  封包数和时长在关闭时写回文件头；写入中途崩溃时文件头里为0，读取器照常顺序读出已完整写入的封包。 */
+
+#define LOG_CAPTURE_MAGIC "EIENCAP"
+#define LOG_CAPTURE_VERSION 1
+
+/** \brief 抓包文件头 */
+struct LogCaptureHeader
+{
+    char magic[8];              //!< "EIENCAP\0"
+    winux::uint32 version;      //!< 格式版本
+    winux::uint16 chunkSize;    //!< 抓包时的分块封包大小
+    winux::uint16 reserved;     //!< 保留
+    winux::uint64 startTime;    //!< 开始抓包的UTC时间戳(us)
+    winux::uint64 chunkCount;   //!< 封包数，关闭时写入
+    winux::uint64 duration;     //!< 第一个到最后一个封包的时长(us)，关闭时写入
+};
+
+/** \brief 抓包写入器
+ *
+ *  封包先攒在内存中，攒满一定大小再写入文件。 */
+class EIENLOG_DLL LogCaptureWriter
+{
+public:
+    enum
+    {
+        BufferBytes = 256 * 1024    //!< 写入文件前攒的字节数
+    };
+
+    LogCaptureWriter();
+
+    /** \brief 析构函数，会写入缓冲并更新文件头 */
+    ~LogCaptureWriter();
+
+    /** \brief 创建抓包文件，已存在则清空重写
+     *
+     *  \param path 文件路径
+     *  \param chunkSize 分块封包大小
+     *  \return bool */
+    bool open( winux::String const & path, winux::uint16 chunkSize = LOG_CHUNK_SIZE );
+
+    /** \brief 写入一个封包
+     *
+     *  \param data 封包数据
+     *  \param size 封包大小
+     *  \param recvTime 接收时间(us)，只用其差值，可以是任意起点的单调时钟
+     *  \return bool */
+    bool write( void const * data, size_t size, winux::uint64 recvTime );
+
+    /** \brief 写入缓冲 */
+    bool flush();
+
+    /** \brief 写入缓冲、更新文件头并关闭文件 */
+    bool close();
+
+    /** \brief 已写入的封包数 */
+    winux::uint64 getChunkCount() const { return _hdr.chunkCount; }
+
+    /** \brief 已写入的封包总字节数（未去掉末尾零字节） */
+    winux::uint64 getChunkBytes() const { return _chunkBytes; }
+
+    /** \brief 文件是否已打开 */
+    bool isOpened() const { return _opened; }
+
+private:
+    winux::File _file;
+    bool _opened;
+    LogCaptureHeader _hdr;
+    winux::uint64 _firstTime; // 第一个封包的接收时间
+    winux::uint64 _lastTime; // 上一个封包的接收时间
+    winux::uint64 _chunkBytes; // 封包总字节数
+    winux::AnsiString _buf; // 待写入的数据
+
+    DISABLE_OBJECT_COPY(LogCaptureWriter)
+};
+
+/** \brief 抓包读取器
+ *
+ *  文件以只读方式映射进内存，按顺序读出封包。 */
+class EIENLOG_DLL LogCaptureReader
+{
+public:
+    LogCaptureReader();
+
+    ~LogCaptureReader();
+
+    /** \brief 打开抓包文件
+     *
+     *  \return bool 不是抓包文件时返回false */
+    bool open( winux::String const & path );
+
+    /** \brief 关闭文件 */
+    void close();
+
+    /** \brief 回到第一个封包 */
+    void rewind();
+
+    /** \brief 读取下一个封包
+     *
+     *  \param time 接受相对第一个封包的接收时间(us)
+     *  \param chunk 接受封包数据，大小为封包原来的大小
+     *  \return bool 没有更多完整的封包时返回false */
+    bool next( winux::uint64 * time, winux::Buffer * chunk );
+
+    /** \brief 文件头 */
+    LogCaptureHeader const & getHeader() const { return _hdr; }
+
+    /** \brief 文件大小 */
+    winux::uint64 getFileSize() const { return _mapping.size(); }
+
+private:
+    winux::FileMapping _mapping;
+    LogCaptureHeader _hdr;
+    winux::uint64 _offset; // 下一个封包的偏移
+    winux::uint64 _time; // 上一个封包的相对时间
+
+    DISABLE_OBJECT_COPY(LogCaptureReader)
+};
+
+/** \brief 回放统计 */
+struct LogReplayStats
+{
+    winux::uint64 chunkCount;   //!< 发送的封包数
+    winux::uint64 chunkBytes;   //!< 发送的字节数
+    winux::uint64 failCount;    //!< 发送失败的封包数
+    winux::uint64 elapsed;      //!< 耗时(us)
+    winux::uint64 maxLag;       //!< 按速度回放时最大落后于计划的时间(us)
+
+    LogReplayStats() : chunkCount(0), chunkBytes(0), failCount(0), elapsed(0), maxLag(0) { }
+};
+
+/** \brief 从读取器的套接字抓包，直到超时或达到封包数
+ *
+ *  \param reader 日志读取器，抓包期间不能再用它读取记录
+ *  \param capture 已打开的抓包写入器
+ *  \param duration 抓包时长(ms)，0表示不限
+ *  \param maxChunks 最多抓取的封包数，0表示不限
+ *  \param stop 不为空时，其值变为true即停止，供其他线程或信号处理中断
+ *  \return winux::uint64 抓取的封包数 */
+EIENLOG_FUNC_DECL(winux::uint64) CaptureChunks( LogReader * reader, LogCaptureWriter * capture, time_t duration = 0, winux::uint64 maxChunks = 0, std::atomic<bool> const * stop = nullptr );
+
+/** \brief 通过写入器的套接字回放抓包
+ *
+ *  按接收时间差控制发送节奏。落后于计划时立即发送不等待，所以回放时长不会短于接收方的处理能力允许的时长。
+ *  \param capture 已打开的抓包读取器，从当前位置开始回放
+ *  \param writer 日志写入器，分块封包大小应与抓包时相同
+ *  \param speed 回放速度倍数，1为原速，0或负数表示不等待尽快发送
+ *  \param stats 不为空时接受统计
+ *  \param stop 不为空时，其值变为true即停止
+ *  \return bool 有封包发送失败时返回false */
+EIENLOG_FUNC_DECL(bool) ReplayCapture( LogCaptureReader * capture, LogWriter * writer, double speed = 1.0, LogReplayStats * stats = nullptr, std::atomic<bool> const * stop = nullptr );
+
+
+} // namespace eienlog
+
+#endif // __EIENLOG_CAPTURE_HPP__
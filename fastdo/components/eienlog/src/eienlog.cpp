@@ -19,9 +19,11 @@
 namespace eienlog
 {
 // 根据数据创建一系列分块
-static std::vector< winux::Packet<LogChunk> > _BuildChunks( winux::Buffer const & data, time_t utcTime, winux::uint32 flag, winux::uint16 chunkSize )
+static std::vector< winux::Packet<LogChunk> > _BuildChunks( winux::Buffer const & data, time_t utcTime, winux::uint32 flag, LogMeta meta, winux::uint16 chunkSize )
 {
     static winux::uint32 recordId = 0;
+    // 记录ID的低24位区分记录，设置了元信息时高8位存放元信息
+    winux::uint32 id = ( recordId & 0xFFFFFF ) | ( meta.valid ? (winux::uint32)meta.value << 24 : 0 );
     std::vector< winux::Packet<LogChunk> > chunks;
     // 日志空间，每个数据包可以容纳的日志数据
     winux::uint16 logSpaceSize = chunkSize - sizeof(LogChunkHeader);
@@ -36,7 +38,7 @@ static std::vector< winux::Packet<LogChunk> > _BuildChunks( winux::Buffer const
         chunk->index = index++;
         chunk->total = total;
         chunk->flag = flag;
-        chunk->id = recordId;
+        chunk->id = id;
         chunk->utcTime = utcTime;
         memcpy( chunk->logSpace, data.get<winux::byte>() + ( data.size() - remainingSize ), logSpaceSize );
         chunks.push_back( std::move(chunk) );
@@ -51,7 +53,7 @@ static std::vector< winux::Packet<LogChunk> > _BuildChunks( winux::Buffer const
         chunk->index = index++;
         chunk->total = total;
         chunk->flag = flag;
-        chunk->id = recordId;
+        chunk->id = id;
         chunk->utcTime = utcTime;
         memcpy( chunk->logSpace, data.get<winux::byte>() + ( data.size() - remainingSize ), remainingSize );
         chunks.push_back( std::move(chunk) );
@@ -71,6 +73,7 @@ static bool _ResumeRecord( std::vector< winux::Packet<LogChunk> > const & chunkP
         record->data.alloc( chunk->total * logSpaceSize );
         record->flag = chunk->flag;
         record->utcTime = chunk->utcTime;
+        record->meta = LogMeta::FromChunkId(chunk->id);
     }
     size_t n = 0;
     for ( auto && chunkPack : chunkPacks )
@@ -83,6 +86,123 @@ static bool _ResumeRecord( std::vector< winux::Packet<LogChunk> > const & chunkP
     return record->data.capacity() - n < logSpaceSize;
 }
 
+// class LogFields ----------------------------------------------------------------------------
+LogFields::LogFields() : _count(0)
+{
+    _data += (char)Magic;
+}
+
+void LogFields::_addHeader( LogFieldType type, winux::AnsiString const & key )
+{
+    _data += (char)type;
+    PutVarint( &_data, key.length() );
+    _data += key;
+    _count++;
+}
+
+LogFields & LogFields::addInt( winux::AnsiString const & key, winux::int64 value )
+{
+    this->_addHeader( lftInt, key );
+    PutVarint( &_data, ZigZag(value) );
+    return *this;
+}
+
+LogFields & LogFields::addFloat( winux::AnsiString const & key, double value )
+{
+    this->_addHeader( lftFloat, key );
+    winux::uint64 bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    for ( int i = 0; i < 8; i++ ) _data += (char)( bits >> ( i * 8 ) );
+    return *this;
+}
+
+LogFields & LogFields::addString( winux::AnsiString const & key, winux::AnsiString const & value )
+{
+    this->_addHeader( lftString, key );
+    PutVarint( &_data, value.length() );
+    _data += value;
+    return *this;
+}
+
+LogFields & LogFields::addBytes( winux::AnsiString const & key, void const * data, size_t size )
+{
+    this->_addHeader( lftBytes, key );
+    PutVarint( &_data, size );
+    _data.append( (char const *)data, size );
+    return *this;
+}
+
+LogFields & LogFields::addTime( winux::AnsiString const & key, winux::uint64 utcTimeMs )
+{
+    this->_addHeader( lftTime, key );
+    PutVarint( &_data, utcTimeMs );
+    return *this;
+}
+
+LogFields & LogFields::add( LogField const & field )
+{
+    switch ( field.type )
+    {
+    case lftInt: return this->addInt( field.key, field.i );
+    case lftFloat: return this->addFloat( field.key, field.f );
+    case lftString: return this->addString( field.key, field.s );
+    case lftBytes: return this->addBytes( field.key, field.s.c_str(), field.s.length() );
+    case lftTime: return this->addTime( field.key, (winux::uint64)field.i );
+    default: return *this;
+    }
+}
+
+void LogFields::clear()
+{
+    _data.assign( 1, (char)Magic );
+    _count = 0;
+}
+
+bool LogFields::Parse( void const * data, size_t size, std::vector<LogField> * fields )
+{
+    winux::byte const * p = (winux::byte const *)data;
+    winux::byte const * end = p + size;
+    if ( size == 0 || *p++ != Magic ) return false;
+    fields->clear();
+    while ( p < end )
+    {
+        LogField field;
+        winux::uint64 len, v;
+        field.type = (LogFieldType)*p++;
+        if ( field.type >= lftCount ) return false;
+        if ( !GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+        field.key.assign( (char const *)p, (size_t)len );
+        p += len;
+        switch ( field.type )
+        {
+        case lftInt:
+            if ( !GetVarint( p, end, &v ) ) return false;
+            field.i = UnZigZag(v);
+            break;
+        case lftTime:
+            if ( !GetVarint( p, end, &v ) ) return false;
+            field.i = (winux::int64)v;
+            break;
+        case lftFloat:
+            {
+                if ( end - p < 8 ) return false;
+                winux::uint64 bits = 0;
+                for ( int i = 0; i < 8; i++ ) bits |= (winux::uint64)p[i] << ( i * 8 );
+                memcpy( &field.f, &bits, sizeof(bits) );
+                p += 8;
+            }
+            break;
+        default: // lftString, lftBytes
+            if ( !GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+            field.s.assign( (char const *)p, (size_t)len );
+            p += len;
+            break;
+        }
+        fields->push_back( std::move(field) );
+    }
+    return true;
+}
+
 // class LogWriter ----------------------------------------------------------------------------
 LogWriter::LogWriter( winux::String const & addr, winux::ushort port, winux::uint16 chunkSize ) : _ep( addr, port ), _chunkSize(chunkSize), _errno(0)
 {
@@ -91,9 +211,9 @@ LogWriter::LogWriter( winux::String const & addr, winux::ushort port, winux::uin
         _errno = eiennet::Socket::ErrNo();
 }
 
-size_t LogWriter::logEx( winux::Buffer const & data, LogFlag flag )
+size_t LogWriter::logEx( winux::Buffer const & data, LogFlag flag, LogMeta meta )
 {
-    auto chunkPacks = _BuildChunks( data, winux::GetUtcTimeMs(), flag.value, _chunkSize );
+    auto chunkPacks = _BuildChunks( data, winux::GetUtcTimeMs(), flag.value, meta, _chunkSize );
     for ( auto && chunkPack : chunkPacks )
     {
         _sock.sendTo( _ep, chunkPack );
@@ -101,12 +221,17 @@ size_t LogWriter::logEx( winux::Buffer const & data, LogFlag flag )
     return chunkPacks.size();
 }
 
+bool LogWriter::sendChunk( void const * data, size_t size )
+{
+    return _sock.sendTo( _ep, data, size ) == (int)size;
+}
+
 size_t LogWriter::logEx( winux::Buffer const & data, winux::Mixed const & fgColor, winux::Mixed const & bgColor, winux::uint8 logEncoding, bool isBinary )
 {
     return this->logEx( data, LogFlag( fgColor, bgColor, logEncoding, isBinary ) );
 }
 
-size_t LogWriter::log( winux::String const & str, LogFlag flag )
+size_t LogWriter::log( winux::String const & str, LogFlag flag, LogMeta meta )
 {
     flag.binary = false;
     switch ( flag.logEncoding )
@@ -118,44 +243,40 @@ size_t LogWriter::log( winux::String const & str, LogFlag flag )
         #else
             winux::AnsiString mbs = LOCAL_TO_UTF8(str);
         #endif
-            return this->logEx( winux::Buffer( mbs.c_str(), mbs.length(), true ), flag );
+            return this->logEx( winux::Buffer( mbs.c_str(), mbs.length(), true ), flag, meta );
         }
         break;
     case leUtf16Le:
+    case leUtf16Be:
         {
         #if defined(_UNICODE) || defined(UNICODE)
-            winux::Utf16String ustr = winux::UnicodeConverter(str).toUtf16();
-        #else
-            winux::Utf16String ustr = winux::UnicodeConverter( winux::LocalToUnicode(str) ).toUtf16();
-        #endif
-            if ( winux::IsBigEndian() )
+            if ( sizeof(winux::wchar) == sizeof(winux::char16) )
             {
+                // 宽字符串本身就是UTF-16，直接发送，字节序不同时才翻转
+                if ( ( flag.logEncoding == leUtf16Be ) == winux::IsBigEndian() )
+                {
+                    return this->logEx( winux::Buffer( str, true ), flag, meta );
+                }
+                winux::UnicodeString ustr = str;
                 if ( ustr.length() > 0 ) winux::InvertByteOrderArray( &ustr[0], ustr.length() );
+                return this->logEx( winux::Buffer( ustr, true ), flag, meta );
             }
-            return this->logEx( winux::Buffer( ustr.c_str(), ustr.length(), true ), flag );
-        }
-        break;
-    case leUtf16Be:
-        {
-        #if defined(_UNICODE) || defined(UNICODE)
-            winux::Utf16String ustr = winux::UnicodeConverter(str).toUtf16();
+            // wchar_t是UTF-32的平台经UTF-8转换
+            winux::Utf8String u8str = winux::UnicodeConverter(str).toUtf8();
         #else
-            winux::Utf16String ustr = winux::UnicodeConverter( winux::LocalToUnicode(str) ).toUtf16();
+            winux::Utf8String u8str = LOCAL_TO_UTF8(str);
         #endif
-            if ( winux::IsLittleEndian() )
-            {
-                if ( ustr.length() > 0 ) winux::InvertByteOrderArray( &ustr[0], ustr.length() );
-            }
-            return this->logEx( winux::Buffer( ustr.c_str(), ustr.length(), true ), flag );
+            // 一遍转换成目标字节序的UTF-16数据
+            return this->logEx( winux::Utf8ToUtf16Bytes( u8str, flag.logEncoding == leUtf16Be ), flag, meta );
         }
         break;
     default: // leLocal
         {
         #if defined(_UNICODE) || defined(UNICODE)
             winux::AnsiString mbs = winux::UnicodeToLocal(str);
-            return this->logEx( winux::Buffer( mbs.c_str(), mbs.length(), true ), flag );
+            return this->logEx( winux::Buffer( mbs.c_str(), mbs.length(), true ), flag, meta );
         #else
-            return this->logEx( winux::Buffer( str.c_str(), str.length(), true ), flag );
+            return this->logEx( winux::Buffer( str.c_str(), str.length(), true ), flag, meta );
         #endif
         }
         break;
@@ -189,20 +310,12 @@ bool LogReader::readChunk( winux::Packet<LogChunk> * chunk, eiennet::ip::EndPoin
 
 bool LogReader::readRecord( LogRecord * record, time_t waitTimeout, time_t updateTimeout )
 {
-    thread_local io::SelectRead sel;
     while ( true )
     {
+        bool hasChunk = this->waitChunk(waitTimeout);
         time_t curTime = winux::GetUtcTimeMs();
-        while ( _sock.getAvailable() < _chunkSize && winux::GetUtcTimeMs() - curTime < (winux::uint64)waitTimeout )
-        {
-            sel.clear();
-            sel.setReadSock(_sock);
-            sel.wait( waitTimeout / 1000.0 );
-        }
 
-        curTime = winux::GetUtcTimeMs();
-
-        if ( _sock.getAvailable() < _chunkSize )
+        if ( !hasChunk )
         {
             if ( _chunksMap.size() == 0 )
             {
@@ -248,6 +361,19 @@ bool LogReader::readRecord( LogRecord * record, time_t waitTimeout, time_t updat
     return false;
 }
 
+bool LogReader::waitChunk( time_t waitTimeout )
+{
+    thread_local io::SelectRead sel;
+    time_t curTime = winux::GetUtcTimeMs();
+    while ( _sock.getAvailable() < _chunkSize && winux::GetUtcTimeMs() - curTime < (winux::uint64)waitTimeout )
+    {
+        sel.clear();
+        sel.setReadSock(_sock);
+        sel.wait( waitTimeout / 1000.0 );
+    }
+    return _sock.getAvailable() >= _chunkSize;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
 static eiennet::SocketLib * __sockLib = nullptr; // Socket库初始化
@@ -310,12 +436,12 @@ EIENLOG_FUNC_IMPL(void) WriteLogBin( void const * data, size_t size )
     }
 }
 
-EIENLOG_FUNC_IMPL(size_t) LogEx( winux::Buffer const & data, LogFlag flag )
+EIENLOG_FUNC_IMPL(size_t) LogEx( winux::Buffer const & data, LogFlag flag, LogMeta meta )
 {
     if ( __logWriter != nullptr )
     {
         winux::ScopeGuard guard(__mtxLogWriter);
-        return __logWriter->logEx( data, flag );
+        return __logWriter->logEx( data, flag, meta );
     }
     return 0;
 }
@@ -330,12 +456,12 @@ EIENLOG_FUNC_IMPL(size_t) LogEx( winux::Buffer const & data, winux::Mixed const
     return 0;
 }
 
-EIENLOG_FUNC_IMPL(size_t) Log( winux::String const & str, LogFlag flag )
+EIENLOG_FUNC_IMPL(size_t) Log( winux::String const & str, LogFlag flag, LogMeta meta )
 {
     if ( __logWriter != nullptr )
     {
         winux::ScopeGuard guard(__mtxLogWriter);
-        return __logWriter->log( str, flag );
+        return __logWriter->log( str, flag, meta );
     }
     return 0;
 }
@@ -370,6 +496,16 @@ EIENLOG_FUNC_IMPL(size_t) LogBin( winux::Buffer const & data, winux::Mixed const
     return 0;
 }
 
+EIENLOG_FUNC_IMPL(size_t) LogStruct( LogFields const & fields, LogFlag flag, LogMeta meta )
+{
+    if ( __logWriter != nullptr )
+    {
+        winux::ScopeGuard guard(__mtxLogWriter);
+        return __logWriter->logFields( fields, flag, meta );
+    }
+    return 0;
+}
+
 winux::ushort __ccaFgColor[] = {
     winux::fgBlack,
     winux::fgNavy,
@@ -0,0 +1,422 @@
+﻿#include "eienlog.hpp"
+
+#if defined(OS_WIN)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace eienlog
+{
+// 校验块头是否完整地位于[offset, size)内，行数不超过一块的上限，压缩前大小不超过deflate的最大压缩比
+inline static bool _IsValidBlock( LogArchiveBlockHeader const & hdr, winux::uint64 offset, winux::uint64 size )
+{
+    return hdr.magic == LOG_ARCHIVE_BLOCK_MAGIC && hdr.rows > 0 && hdr.rows <= LogArchiveWriter::BlockRows &&
+        offset >= sizeof(LogArchiveHeader) && offset <= size && sizeof(LogArchiveBlockHeader) + (winux::uint64)hdr.zipSize <= size - offset &&
+        hdr.rawSize <= (winux::uint64)hdr.zipSize * 1032 + 1024;
+}
+
+// 校验索引项与其指向的块头一致，块在[offset, size)内，首行紧接上一块
+inline static bool _IsValidEntry( LogArchiveIndexEntry const & entry, LogArchiveBlockHeader const & hdr, winux::uint64 size, winux::uint64 nextRow )
+{
+    return _IsValidBlock( hdr, entry.offset, size ) && hdr.rows == entry.rows && hdr.firstRow == entry.firstRow && entry.firstRow == nextRow;
+}
+
+// 由块头生成索引项
+inline static LogArchiveIndexEntry _MakeIndexEntry( LogArchiveBlockHeader const & hdr, winux::uint64 offset )
+{
+    LogArchiveIndexEntry entry;
+    entry.offset = offset;
+    entry.firstRow = hdr.firstRow;
+    entry.minTime = hdr.minTime;
+    entry.maxTime = hdr.maxTime;
+    entry.rows = hdr.rows;
+    entry.reserved = 0;
+    return entry;
+}
+
+// class LogArchiveBlock ----------------------------------------------------------------------
+void LogArchiveBlock::add( void const * data, size_t size, winux::uint64 utcTime, winux::uint32 flag, LogMeta meta )
+{
+    _times.push_back(utcTime);
+    _flags.push_back( flag | (winux::uint64)meta.value << 32 );
+    _sizes.push_back( (winux::uint32)size );
+    _data.append( (char const *)data, size );
+}
+
+void LogArchiveBlock::clear()
+{
+    _times.clear();
+    _flags.clear();
+    _sizes.clear();
+    _data.clear();
+}
+
+bool LogArchiveBlock::encode( winux::uint64 firstRow, LogArchiveBlockHeader * hdr, winux::AnsiString * zip, int zipLevel, winux::AnsiString const * extra ) const
+{
+    if ( _times.empty() ) return false;
+
+    // 按列组织压缩前的数据
+    winux::AnsiString raw;
+    raw.reserve( _data.length() + _times.size() * 8 + ( extra ? extra->length() : 0 ) );
+    hdr->magic = LOG_ARCHIVE_BLOCK_MAGIC;
+    hdr->rows = (winux::uint32)_times.size();
+    hdr->firstRow = firstRow;
+    hdr->minTime = hdr->maxTime = _times[0];
+    winux::uint64 prevTime = 0;
+    for ( auto t : _times )
+    {
+        PutVarint( &raw, ZigZag( (winux::int64)( t - prevTime ) ) );
+        prevTime = t;
+        if ( t < hdr->minTime ) hdr->minTime = t;
+        if ( t > hdr->maxTime ) hdr->maxTime = t;
+    }
+    for ( auto f : _flags ) PutVarint( &raw, f );
+    for ( auto s : _sizes ) PutVarint( &raw, s );
+    raw += _data;
+    if ( extra ) raw += *extra;
+
+    // 压缩
+    std::vector<char> zipBuf( raw.length() + raw.length() / 8 + 1024 );
+    void * zipData = nullptr;
+    unsigned long zipSize = 0;
+    winux::Zip z;
+    if ( !z.create( zipBuf.data(), (winux::uint32)zipBuf.size() ) ) return false;
+    z.setLevel(zipLevel);
+    if ( z.addFile( $T("b"), &raw[0], (winux::uint32)raw.length() ) != ZR_OK ) return false;
+    if ( z.getMemory( &zipData, &zipSize ) != ZR_OK ) return false;
+    zip->assign( (char const *)zipData, zipSize );
+    hdr->rawSize = (winux::uint32)raw.length();
+    hdr->zipSize = (winux::uint32)zipSize;
+    return true;
+}
+
+bool LogArchiveBlock::Decode( LogArchiveBlockHeader const & hdr, void const * zipData, std::vector<LogRecord> * records, winux::AnsiString * extra )
+{
+    winux::Buffer raw;
+    raw.alloc(hdr.rawSize);
+    {
+        winux::Unzip unzip;
+        if ( !unzip.open( (void *)zipData, hdr.zipSize ) ) return false;
+        if ( unzip.unzipEntry( 0, raw.getBuf(), hdr.rawSize ) != ZR_OK ) return false;
+    }
+
+    // 依次读取时间、旗标、大小三列，然后是数据
+    size_t rows = hdr.rows;
+    std::vector<winux::uint64> columns( rows * 3 );
+    winux::byte const * p = raw.get<winux::byte>();
+    winux::byte const * end = p + raw.getSize();
+    for ( auto & v : columns )
+    {
+        if ( !GetVarint( p, end, &v ) ) return false;
+    }
+
+    records->reserve( records->size() + rows );
+    winux::uint64 t = 0;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        winux::uint64 size = columns[ rows * 2 + i ];
+        if ( size > (winux::uint64)( end - p ) ) return false;
+
+        t += UnZigZag(columns[i]);
+        LogRecord record;
+        record.utcTime = (time_t)t;
+        record.flag = (winux::uint32)columns[ rows + i ];
+        record.meta.value = (winux::uint8)( columns[ rows + i ] >> 32 );
+        record.data.setBuf( p, (size_t)size, false );
+        p += size;
+        records->push_back( std::move(record) );
+    }
+    if ( extra ) extra->assign( (char const *)p, end - p );
+    return true;
+}
+
+// class LogArchiveWriter ---------------------------------------------------------------------
+LogArchiveWriter::LogArchiveWriter() : _opened(false), _rowCount(0), _endOffset(0)
+{
+}
+
+LogArchiveWriter::~LogArchiveWriter()
+{
+    this->close();
+}
+
+bool LogArchiveWriter::open( winux::String const & path, bool append )
+{
+    this->close();
+    _index.clear();
+    _rowCount = 0;
+
+    if ( append && _file.open( path, $T("r+b") ) )
+    {
+        winux::uint64 size = _file.size();
+        LogArchiveHeader hdr;
+        if ( _file.read( &hdr, sizeof(hdr) ) != sizeof(hdr) || memcmp( hdr.magic, LOG_ARCHIVE_MAGIC, sizeof(LOG_ARCHIVE_MAGIC) ) != 0 )
+        {
+            _file.close();
+            return false;
+        }
+
+        // 读取尾部和块索引
+        LogArchiveTrailer trailer;
+        bool indexOk = false;
+        if ( size >= sizeof(hdr) + sizeof(trailer) && _file.seek( size - sizeof(trailer) ) && _file.read( &trailer, sizeof(trailer) ) == sizeof(trailer) )
+        {
+            if ( trailer.magic == LOG_ARCHIVE_TRAILER_MAGIC && trailer.indexOffset + trailer.blockCount * sizeof(LogArchiveIndexEntry) + sizeof(trailer) == size )
+            {
+                _index.resize(trailer.blockCount);
+                indexOk = _file.seek(trailer.indexOffset) && _file.read( _index.data(), _index.size() * sizeof(LogArchiveIndexEntry) ) == _index.size() * sizeof(LogArchiveIndexEntry);
+                _endOffset = trailer.indexOffset;
+                // 索引项须与块头一致，否则当作尾部损坏
+                winux::uint64 nextRow = 0;
+                LogArchiveBlockHeader blockHdr;
+                for ( size_t i = 0; indexOk && i < _index.size(); i++ )
+                {
+                    indexOk = _index[i].offset <= _endOffset && _file.seek(_index[i].offset) && _file.read( &blockHdr, sizeof(blockHdr) ) == sizeof(blockHdr) &&
+                        _IsValidEntry( _index[i], blockHdr, _endOffset, nextRow );
+                    nextRow += _index[i].rows;
+                }
+            }
+        }
+        if ( !indexOk ) // 尾部损坏，扫描块头恢复，并截掉不完整的部分
+        {
+            _index.clear();
+            _endOffset = sizeof(hdr);
+            LogArchiveBlockHeader blockHdr;
+            while ( _file.seek(_endOffset) && _file.read( &blockHdr, sizeof(blockHdr) ) == sizeof(blockHdr) && _IsValidBlock( blockHdr, _endOffset, size ) &&
+                blockHdr.firstRow == ( _index.empty() ? 0 : _index.back().firstRow + _index.back().rows ) )
+            {
+                _index.push_back( _MakeIndexEntry( blockHdr, _endOffset ) );
+                _endOffset += sizeof(blockHdr) + blockHdr.zipSize;
+            }
+            fflush( _file.get() );
+        #if defined(OS_WIN)
+            _chsize_s( _file.getFd(), _endOffset );
+        #else
+            if ( ftruncate( _file.getFd(), _endOffset ) != 0 ) { }
+        #endif
+        }
+        if ( !_index.empty() ) _rowCount = _index.back().firstRow + _index.back().rows;
+        _opened = true;
+        return _file.seek(_endOffset) && this->_writeIndex();
+    }
+
+    if ( !_file.open( path, $T("wb") ) ) return false;
+    LogArchiveHeader hdr;
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, LOG_ARCHIVE_MAGIC, sizeof(LOG_ARCHIVE_MAGIC) );
+    hdr.version = LOG_ARCHIVE_VERSION;
+    if ( _file.write( &hdr, sizeof(hdr) ) != sizeof(hdr) )
+    {
+        _file.close();
+        return false;
+    }
+    _endOffset = sizeof(hdr);
+    _opened = true;
+    return this->_writeIndex();
+}
+
+bool LogArchiveWriter::write( void const * data, size_t size, winux::uint64 utcTime, winux::uint32 flag, LogMeta meta )
+{
+    if ( !_opened ) return false;
+    _block.add( data, size, utcTime, flag, meta );
+    _rowCount++;
+
+    if ( _block.getBytes() >= BlockBytes || _block.getRows() >= BlockRows )
+    {
+        return this->_writeBlock();
+    }
+    return true;
+}
+
+bool LogArchiveWriter::flush()
+{
+    if ( !_opened ) return false;
+    bool ok = this->_writeBlock() && _file.seek(_endOffset) && this->_writeIndex();
+    fflush( _file.get() );
+    return ok;
+}
+
+bool LogArchiveWriter::close()
+{
+    if ( !_opened ) return false;
+    bool ok = this->flush();
+    _file.close();
+    _opened = false;
+    _index.clear();
+    return ok;
+}
+
+bool LogArchiveWriter::_writeBlock()
+{
+    if ( _block.getRows() == 0 ) return true;
+
+    LogArchiveBlockHeader hdr;
+    winux::AnsiString zip;
+    if ( !_block.encode( _rowCount - _block.getRows(), &hdr, &zip ) ) return false;
+    if ( !_file.seek(_endOffset) ) return false;
+    if ( _file.write( &hdr, sizeof(hdr) ) != sizeof(hdr) ) return false;
+    if ( _file.write( zip.c_str(), zip.length() ) != zip.length() ) return false;
+    _index.push_back( _MakeIndexEntry( hdr, _endOffset ) );
+    _endOffset += sizeof(hdr) + zip.length();
+    _block.clear();
+    return true;
+}
+
+bool LogArchiveWriter::_writeIndex()
+{
+    LogArchiveTrailer trailer;
+    trailer.indexOffset = _endOffset;
+    trailer.blockCount = (winux::uint32)_index.size();
+    trailer.magic = LOG_ARCHIVE_TRAILER_MAGIC;
+    size_t indexBytes = _index.size() * sizeof(LogArchiveIndexEntry);
+    if ( indexBytes && _file.write( _index.data(), indexBytes ) != indexBytes ) return false;
+    return _file.write( &trailer, sizeof(trailer) ) == sizeof(trailer);
+}
+
+// class LogArchiveReader ---------------------------------------------------------------------
+LogArchiveReader::LogArchiveReader() : _rowCount(0)
+{
+}
+
+LogArchiveReader::~LogArchiveReader()
+{
+}
+
+bool LogArchiveReader::open( winux::String const & path )
+{
+    this->close();
+    if ( !_mapping.create( path, winux::fmfReadOnly ) ) return false;
+
+    winux::byte const * base = _mapping.get<winux::byte>();
+    winux::uint64 size = _mapping.size();
+    if ( size < sizeof(LogArchiveHeader) || memcmp( base, LOG_ARCHIVE_MAGIC, sizeof(LOG_ARCHIVE_MAGIC) ) != 0 )
+    {
+        _mapping.destroy();
+        return false;
+    }
+
+    // 读取尾部和块索引
+    bool indexOk = false;
+    if ( size >= sizeof(LogArchiveHeader) + sizeof(LogArchiveTrailer) )
+    {
+        LogArchiveTrailer trailer;
+        memcpy( &trailer, base + size - sizeof(trailer), sizeof(trailer) );
+        if ( trailer.magic == LOG_ARCHIVE_TRAILER_MAGIC && trailer.indexOffset + trailer.blockCount * sizeof(LogArchiveIndexEntry) + sizeof(trailer) == size )
+        {
+            _index.resize(trailer.blockCount);
+            if ( trailer.blockCount ) memcpy( _index.data(), base + trailer.indexOffset, _index.size() * sizeof(LogArchiveIndexEntry) );
+            // 索引项须与块头一致，否则当作尾部损坏
+            indexOk = true;
+            winux::uint64 nextRow = 0;
+            LogArchiveBlockHeader hdr;
+            for ( size_t i = 0; indexOk && i < _index.size(); i++ )
+            {
+                LogArchiveIndexEntry const & entry = _index[i];
+                indexOk = entry.offset <= trailer.indexOffset && sizeof(hdr) <= trailer.indexOffset - entry.offset;
+                if ( indexOk )
+                {
+                    memcpy( &hdr, base + entry.offset, sizeof(hdr) );
+                    indexOk = _IsValidEntry( entry, hdr, trailer.indexOffset, nextRow );
+                }
+                nextRow += entry.rows;
+            }
+        }
+    }
+    if ( !indexOk ) this->_recoverIndex();
+
+    winux::uint64 maxTime = 0;
+    _maxTimes.reserve( _index.size() );
+    for ( auto && entry : _index )
+    {
+        if ( entry.maxTime > maxTime ) maxTime = entry.maxTime;
+        _maxTimes.push_back(maxTime);
+    }
+    if ( !_index.empty() ) _rowCount = _index.back().firstRow + _index.back().rows;
+    return true;
+}
+
+void LogArchiveReader::close()
+{
+    _mapping.destroy();
+    _index.clear();
+    _maxTimes.clear();
+    _rowCount = 0;
+}
+
+size_t LogArchiveReader::findBlockByRow( winux::uint64 row ) const
+{
+    if ( row >= _rowCount ) return _index.size();
+    auto it = std::upper_bound( _index.begin(), _index.end(), row, [] ( winux::uint64 row, LogArchiveIndexEntry const & entry ) { return row < entry.firstRow; } );
+    return it - _index.begin() - 1;
+}
+
+winux::uint64 LogArchiveReader::findRowByTime( winux::uint64 utcTime ) const
+{
+    size_t blockIndex = std::lower_bound( _maxTimes.begin(), _maxTimes.end(), utcTime ) - _maxTimes.begin();
+    if ( blockIndex == _index.size() ) return _rowCount;
+
+    std::vector<LogRecord> records;
+    if ( !this->readBlock( blockIndex, &records ) ) return _rowCount;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        if ( (winux::uint64)records[i].utcTime >= utcTime ) return _index[blockIndex].firstRow + i;
+    }
+    return _index[blockIndex].firstRow + records.size();
+}
+
+bool LogArchiveReader::readBlock( size_t blockIndex, std::vector<LogRecord> * records ) const
+{
+    LogArchiveBlockHeader hdr;
+    winux::byte const * zipData;
+    return this->_getBlock( blockIndex, &hdr, &zipData ) && LogArchiveBlock::Decode( hdr, zipData, records );
+}
+
+bool LogArchiveReader::readRecords( winux::uint64 firstRow, size_t count, std::vector<LogRecord> * records ) const
+{
+    winux::uint64 endRow = firstRow + count < _rowCount ? firstRow + count : _rowCount;
+    std::vector<LogRecord> blockRecords;
+    for ( size_t b = this->findBlockByRow(firstRow); b < _index.size() && _index[b].firstRow < endRow; b++ )
+    {
+        blockRecords.clear();
+        if ( !this->readBlock( b, &blockRecords ) ) return false;
+
+        winux::uint64 blockFirst = _index[b].firstRow;
+        size_t i = (size_t)( firstRow > blockFirst ? firstRow - blockFirst : 0 );
+        size_t n = (size_t)( endRow - blockFirst < blockRecords.size() ? endRow - blockFirst : blockRecords.size() );
+        for ( ; i < n; i++ ) records->push_back( std::move(blockRecords[i]) );
+    }
+    return true;
+}
+
+void LogArchiveReader::_recoverIndex()
+{
+    _index.clear();
+    winux::byte const * base = _mapping.get<winux::byte>();
+    winux::uint64 size = _mapping.size();
+    winux::uint64 offset = sizeof(LogArchiveHeader);
+    LogArchiveBlockHeader hdr;
+    while ( offset + sizeof(hdr) <= size )
+    {
+        memcpy( &hdr, base + offset, sizeof(hdr) );
+        if ( !_IsValidBlock( hdr, offset, size ) || hdr.firstRow != ( _index.empty() ? 0 : _index.back().firstRow + _index.back().rows ) ) break;
+        _index.push_back( _MakeIndexEntry( hdr, offset ) );
+        offset += sizeof(hdr) + hdr.zipSize;
+    }
+}
+
+bool LogArchiveReader::_getBlock( size_t blockIndex, LogArchiveBlockHeader * hdr, winux::byte const * * zipData ) const
+{
+    if ( blockIndex >= _index.size() ) return false;
+    LogArchiveIndexEntry const & entry = _index[blockIndex];
+    winux::uint64 size = _mapping.size();
+    if ( entry.offset > size || sizeof(LogArchiveBlockHeader) > size - entry.offset ) return false;
+    winux::byte const * p = _mapping.get<winux::byte>() + entry.offset;
+    memcpy( hdr, p, sizeof(*hdr) );
+    if ( !_IsValidBlock( *hdr, entry.offset, size ) || hdr->rows != entry.rows ) return false;
+    *zipData = p + sizeof(*hdr);
+    return true;
+}
+
+
+} // namespace eienlog
@@ -0,0 +1,219 @@
+﻿#include "eienlog.hpp"
+#include <chrono>
+#include <thread>
+
+namespace eienlog
+{
+// 单调时钟(us)，抓包和回放的时间差都用它计算，不受系统时间调整影响
+inline static winux::uint64 _MonoTimeUs()
+{
+    return (winux::uint64)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// class LogCaptureWriter ---------------------------------------------------------------------
+LogCaptureWriter::LogCaptureWriter() : _opened(false), _firstTime(0), _lastTime(0), _chunkBytes(0)
+{
+    memset( &_hdr, 0, sizeof(_hdr) );
+}
+
+LogCaptureWriter::~LogCaptureWriter()
+{
+    this->close();
+}
+
+bool LogCaptureWriter::open( winux::String const & path, winux::uint16 chunkSize )
+{
+    this->close();
+    memset( &_hdr, 0, sizeof(_hdr) );
+    memcpy( _hdr.magic, LOG_CAPTURE_MAGIC, sizeof(LOG_CAPTURE_MAGIC) );
+    _hdr.version = LOG_CAPTURE_VERSION;
+    _hdr.chunkSize = chunkSize;
+    _hdr.startTime = winux::GetUtcTimeUs();
+    _firstTime = _lastTime = 0;
+    _chunkBytes = 0;
+    _buf.clear();
+
+    if ( !_file.open( path, $T("wb") ) ) return false;
+    if ( _file.write( &_hdr, sizeof(_hdr) ) != sizeof(_hdr) )
+    {
+        _file.close();
+        return false;
+    }
+    _opened = true;
+    return true;
+}
+
+bool LogCaptureWriter::write( void const * data, size_t size, winux::uint64 recvTime )
+{
+    if ( !_opened ) return false;
+    if ( _hdr.chunkCount == 0 ) _firstTime = _lastTime = recvTime;
+
+    // 末尾的零字节不保存
+    winux::byte const * p = (winux::byte const *)data;
+    size_t stored = size;
+    while ( stored > 0 && p[ stored - 1 ] == 0 ) stored--;
+
+    PutVarint( &_buf, recvTime > _lastTime ? recvTime - _lastTime : 0 );
+    PutVarint( &_buf, size );
+    PutVarint( &_buf, stored );
+    _buf.append( (char const *)p, stored );
+    if ( recvTime > _lastTime ) _lastTime = recvTime;
+    _hdr.chunkCount++;
+    _hdr.duration = _lastTime - _firstTime;
+    _chunkBytes += size;
+
+    return _buf.length() < BufferBytes || this->flush();
+}
+
+bool LogCaptureWriter::flush()
+{
+    if ( !_opened ) return false;
+    if ( _buf.empty() ) return true;
+    bool ok = _file.write( _buf.c_str(), _buf.length() ) == _buf.length();
+    _buf.clear();
+    return ok;
+}
+
+bool LogCaptureWriter::close()
+{
+    if ( !_opened ) return true;
+    // 写回封包数和时长
+    bool ok = this->flush() && _file.seek(0) && _file.write( &_hdr, sizeof(_hdr) ) == sizeof(_hdr);
+    _file.close();
+    _opened = false;
+    return ok;
+}
+
+// class LogCaptureReader ---------------------------------------------------------------------
+LogCaptureReader::LogCaptureReader() : _offset(0), _time(0)
+{
+    memset( &_hdr, 0, sizeof(_hdr) );
+}
+
+LogCaptureReader::~LogCaptureReader()
+{
+}
+
+bool LogCaptureReader::open( winux::String const & path )
+{
+    this->close();
+    if ( !_mapping.create( path, winux::fmfReadOnly ) ) return false;
+    if ( _mapping.size() < sizeof(LogCaptureHeader) || memcmp( _mapping.get<winux::byte>(), LOG_CAPTURE_MAGIC, sizeof(LOG_CAPTURE_MAGIC) ) != 0 )
+    {
+        _mapping.destroy();
+        return false;
+    }
+    memcpy( &_hdr, _mapping.get<winux::byte>(), sizeof(_hdr) );
+    this->rewind();
+    return true;
+}
+
+void LogCaptureReader::close()
+{
+    _mapping.destroy();
+    memset( &_hdr, 0, sizeof(_hdr) );
+    _offset = 0;
+    _time = 0;
+}
+
+void LogCaptureReader::rewind()
+{
+    _offset = sizeof(LogCaptureHeader);
+    _time = 0;
+}
+
+bool LogCaptureReader::next( winux::uint64 * time, winux::Buffer * chunk )
+{
+    if ( _offset < sizeof(LogCaptureHeader) ) return false;
+    winux::byte const * base = _mapping.get<winux::byte>();
+    winux::byte const * p = base + _offset;
+    winux::byte const * end = base + _mapping.size();
+    winux::uint64 delta, size, stored;
+    if ( !GetVarint( p, end, &delta ) || !GetVarint( p, end, &size ) || !GetVarint( p, end, &stored ) ) return false;
+    if ( stored > size || stored > (winux::uint64)( end - p ) ) return false;
+
+    // 补齐末尾的零字节，大小不变时复用缓冲
+    if ( chunk->getSize() != size || chunk->isPeek() ) chunk->alloc( (size_t)size );
+    memcpy( chunk->getBuf(), p, (size_t)stored );
+    memset( chunk->get<winux::byte>() + stored, 0, (size_t)( size - stored ) );
+    _offset = p + stored - base;
+    _time += delta;
+    *time = _time;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+EIENLOG_FUNC_IMPL(winux::uint64) CaptureChunks( LogReader * reader, LogCaptureWriter * capture, time_t duration, winux::uint64 maxChunks, std::atomic<bool> const * stop )
+{
+    winux::uint64 count = 0;
+    winux::uint64 startTime = winux::GetUtcTimeMs();
+    winux::Packet<LogChunk> chunk;
+    eiennet::ip::EndPoint ep;
+    while ( maxChunks == 0 || count < maxChunks )
+    {
+        if ( stop != nullptr && stop->load() ) break;
+        time_t waitTimeout = 200; // 定期醒来检查停止条件
+        if ( duration > 0 )
+        {
+            winux::uint64 elapsed = winux::GetUtcTimeMs() - startTime;
+            if ( elapsed >= (winux::uint64)duration ) break;
+            if ( (winux::uint64)waitTimeout > duration - elapsed ) waitTimeout = (time_t)( duration - elapsed );
+        }
+        if ( !reader->waitChunk(waitTimeout) ) continue;
+        if ( !reader->readChunk( &chunk, &ep ) ) break;
+        if ( !capture->write( chunk.getBuf(), chunk.getSize(), _MonoTimeUs() ) ) break;
+        count++;
+    }
+    capture->flush();
+    return count;
+}
+
+EIENLOG_FUNC_IMPL(bool) ReplayCapture( LogCaptureReader * capture, LogWriter * writer, double speed, LogReplayStats * stats, std::atomic<bool> const * stop )
+{
+    LogReplayStats st;
+    winux::uint64 startTime = _MonoTimeUs();
+    winux::uint64 firstTime = 0;
+    bool first = true;
+    winux::uint64 time;
+    winux::Buffer chunk;
+    while ( capture->next( &time, &chunk ) )
+    {
+        if ( stop != nullptr && stop->load() ) break;
+        if ( first )
+        {
+            firstTime = time;
+            first = false;
+        }
+        if ( speed > 0 )
+        {
+            // 按计划时间发送：提前超过1ms时睡眠，剩下的不足1ms自旋等待，睡眠精度不够
+            winux::uint64 due = startTime + (winux::uint64)( ( time - firstTime ) / speed );
+            winux::uint64 now = _MonoTimeUs();
+            while ( now < due )
+            {
+                if ( due - now > 1000 )
+                    std::this_thread::sleep_for( std::chrono::microseconds( due - now - 1000 ) );
+                else
+                    std::this_thread::yield();
+                now = _MonoTimeUs();
+            }
+            if ( now - due > st.maxLag ) st.maxLag = now - due;
+        }
+        if ( writer->sendChunk( chunk.getBuf(), chunk.getSize() ) )
+        {
+            st.chunkCount++;
+            st.chunkBytes += chunk.getSize();
+        }
+        else
+        {
+            st.failCount++;
+        }
+    }
+    st.elapsed = _MonoTimeUs() - startTime;
+    if ( stats != nullptr ) *stats = st;
+    return st.failCount == 0;
+}
+
+
+} // namespace eienlog
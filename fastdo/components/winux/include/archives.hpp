@@ -6,6 +6,8 @@
 
 namespace winux
 {
+class ThreadPool;
+
 /** \brief 配置文件类 */
 class WINUX_DLL Configure
 {
@@ -190,12 +192,67 @@ public:
     Mixed & getColumnHeaders() { return _columns; }
     /** \brief 解析CSV数据，hasColumnHeaders表示CSV中第一行是否为列标头行 */
     void read( String const & content, bool hasColumnHeaders = false );
+    /** \brief 用线程池并行解析CSV数据，结果与read()相同 */
+    void read( String const & content, bool hasColumnHeaders, ThreadPool * pool );
 
 private:
     Mixed _columns; // 第一行列名代表的索引
     Mixed _records;
 };
 
+/** \brief CSV字段在源文本中的位置 */
+struct CsvFieldSpan
+{
+    size_t offset;  //!< 字段原文的起始位置
+    uint32 length;  //!< 字段原文的长度
+    bool quoted;    //!< 原文是否含有引号，含有时须经CsvFieldSpans::getValue()去除引号
+};
+
+/** \brief CSV字段位置表
+ *
+ *  只记录各字段在源文本中的位置，不生成Mixed，解析规则与CsvReader相同。
+ *  给出线程池时把文本分块并行解析：先按引号奇偶推测各块的第一个记录边界，各块独立解析后按顺序拼接，
+ *  推测有误的块（如字段中间出现单个引号）从前一块实际结束的位置重新解析，因此结果总与顺序解析一致。 */
+class WINUX_DLL CsvFieldSpans
+{
+public:
+    enum { DefaultChunkSize = 1024 * 1024 }; //!< 并行解析时每块的默认字符数
+
+    CsvFieldSpans();
+
+    /** \brief 解析CSV文本，源文本在使用期间须保持有效
+     *
+     *  \param content 源文本
+     *  \param length 文本长度
+     *  \param pool 线程池，为nullptr时在当前线程解析
+     *  \param chunkSize 并行解析时每块的字符数 */
+    void parse( String::value_type const * content, size_t length, ThreadPool * pool = nullptr, size_t chunkSize = DefaultChunkSize );
+
+    /** \brief 解析CSV文本，源文本在使用期间须保持有效 */
+    void parse( String const & content, ThreadPool * pool = nullptr, size_t chunkSize = DefaultChunkSize ) { this->parse( content.c_str(), content.length(), pool, chunkSize ); }
+
+    /** \brief 记录数 */
+    size_t getCount() const { return _rowFields.empty() ? 0 : _rowFields.size() - 1; }
+
+    /** \brief 一条记录的字段数 */
+    size_t getFieldCount( size_t row ) const { return _rowFields[row + 1] - _rowFields[row]; }
+
+    /** \brief 获取字段位置 */
+    CsvFieldSpan const & getField( size_t row, size_t col ) const { return _fields[ _rowFields[row] + col ]; }
+
+    /** \brief 获取字段的值，已去除引号 */
+    String getValue( size_t row, size_t col ) const;
+
+    /** \brief 把一条记录转成Mixed数组，与CsvReader的记录相同 */
+    void getRecord( size_t row, Mixed * record ) const;
+
+private:
+    String::value_type const * _content; // 源文本
+    size_t _length; // 源文本长度
+    std::vector<CsvFieldSpan> _fields; // 全部字段
+    std::vector<size_t> _rowFields; // 各记录首个字段的序号，末尾多一项为字段总数
+};
+
 /** \brief 文本文档类。可载入文本文件自动识别BOM文件编码，转换为指定编码。\n
 
     核心参数有三个：\n
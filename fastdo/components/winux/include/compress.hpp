@@ -62,6 +62,9 @@ public:
 
     ZRESULT getMemory( void * * buf, unsigned long * size );
 
+    /** \brief 设置之后添加文件的压缩级别，1最快，8压缩率最高（默认） */
+    ZRESULT setLevel( int level );
+
 private:
     Members<struct Zip_Data> _self;
 
@@ -264,6 +264,34 @@ inline Buffer HexToBuffer( AnsiString const & hexStr ) { return HexToBuffer<char
 #endif
 
 
+/** \brief UTF-16字节数据直接转换成UTF-8，一遍完成（ASCII段使用SIMD快速路径）
+ *
+ *  与`Utf16String`+`InvertByteOrderArray()`+`UnicodeConverter`相比，省去了中间拷贝。
+ *  不成对的代理项会被替换成U+FFFD。
+ *  \param data UTF-16字节数据
+ *  \param size 数据字节数，若为奇数则忽略最后一个字节
+ *  \param isBigEndian 数据是否为大端字节序
+ *  \param invalidCount 接收非法代理项的数量，可为nullptr
+ *  \return Utf8String */
+WINUX_FUNC_DECL(Utf8String) Utf16BytesToUtf8( void const * data, size_t size, bool isBigEndian, size_t * invalidCount = nullptr );
+
+/** \brief UTF-16字节数据直接转换成UTF-8 */
+inline Utf8String Utf16BytesToUtf8( Buffer const & buf, bool isBigEndian, size_t * invalidCount = nullptr ) { return Utf16BytesToUtf8( buf.getBuf(), buf.getSize(), isBigEndian, invalidCount ); }
+
+/** \brief UTF-8转换成指定字节序的UTF-16字节数据，一遍完成（ASCII段使用SIMD快速路径）
+ *
+ *  非法的UTF-8序列（截断、过长编码、代理项、超出U+10FFFF）会被替换成U+FFFD。
+ *  \param data UTF-8数据
+ *  \param size 数据字节数
+ *  \param isBigEndian 输出是否为大端字节序
+ *  \param invalidCount 接收非法序列的数量，可为nullptr
+ *  \return Buffer */
+WINUX_FUNC_DECL(Buffer) Utf8ToUtf16Bytes( void const * data, size_t size, bool isBigEndian, size_t * invalidCount = nullptr );
+
+/** \brief UTF-8转换成指定字节序的UTF-16字节数据 */
+inline Buffer Utf8ToUtf16Bytes( Utf8String const & str, bool isBigEndian, size_t * invalidCount = nullptr ) { return Utf8ToUtf16Bytes( str.c_str(), str.length(), isBigEndian, invalidCount ); }
+
+
 /** \brief 将数据进行md5编码，返回二进制数据 */
 WINUX_FUNC_DECL(Buffer) Md5( void const * buf, size_t size );
 /** \brief 将数据进行md5编码，返回二进制数据 */
@@ -507,6 +507,24 @@ inline UnicodeString AddQuotes( UnicodeString const & str, UnicodeString::value_
 inline AnsiString AddQuotes( AnsiString const & str, AnsiString::value_type quote = Literal<AnsiString::value_type>::quoteChar ) { return AddQuotes<char>( str, quote ); }
 #endif
 
+/** \brief 字符集位掩码：求s的前n个字符（n<=64）中属于字符集chars的位置，第i位对应s[i]
+ *
+ *  chars固定为4个字符，字符集不足4个时用重复的字符补足。有SSE2时每次比较16字节，用于CSV等文本中分隔符、引号、换行符的快速定位。 */
+template < typename _ChTy >
+uint64 StrCharsMask( _ChTy const * s, size_t n, _ChTy const chars[4] );
+template <>
+WINUX_FUNC_DECL(uint64) StrCharsMask( char const * s, size_t n, char const chars[4] );
+template <>
+WINUX_FUNC_DECL(uint64) StrCharsMask( wchar const * s, size_t n, wchar const chars[4] );
+
+/** \brief 查找第一个属于字符集chars的字符，找不到返回n。每次求64个字符的位掩码 */
+template < typename _ChTy >
+size_t StrFindChars( _ChTy const * s, size_t n, _ChTy const chars[4] );
+template <>
+WINUX_FUNC_DECL(size_t) StrFindChars( char const * s, size_t n, char const chars[4] );
+template <>
+WINUX_FUNC_DECL(size_t) StrFindChars( wchar const * s, size_t n, wchar const chars[4] );
+
 
 template < typename _ChTy >
 bool StrGetLine( XString<_ChTy> * line, XString<_ChTy> const & str, size_t * i, XString<_ChTy> * nl = nullptr );
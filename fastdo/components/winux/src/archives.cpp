@@ -6,6 +6,9 @@
 #include "strings.hpp"
 #include "filesys.hpp"
 #include "archives.hpp"
+#include "system.hpp"
+#include "threads.hpp"
+#include "threadtask.hpp"
 
 #include "eienexpr.hpp"
 #include "eienexpr_errstrs.inl"
@@ -1621,18 +1624,16 @@ String EvalSettings::valToString( String const & spacer, String const & newline
 }
 
 
+// CSV结构字符集，供StrFindChars()使用
+static String::value_type const __CsvQuoteChars[4] = { ',', '\"', '\'', '\n' }; // 需要加引号的字符
+static String::value_type const __CsvRecordChars[4] = { ',', '\"', '\n', '\n' }; // 记录中的结构字符
+static String::value_type const __CsvStringChars[4] = { '\"', '\"', '\"', '\"' }; // 字符串中的结构字符
+static String::value_type const __CsvBoundaryChars[4] = { '\"', '\n', '\n', '\n' }; // 推测记录边界的字符
+
 // class CsvWriter ----------------------------------------------------------------------------
 inline static String __JudgeAddQuotes( String const & valStr )
 {
-    String::const_iterator it = valStr.begin();
-    for ( ; it != valStr.end(); ++it )
-    {
-        if ( *it == ',' || *it == '\"' ||  *it == '\'' || *it == '\n' )
-        {
-            break;
-        }
-    }
-    if ( it != valStr.end() )
+    if ( StrFindChars( valStr.c_str(), valStr.length(), __CsvQuoteChars ) < valStr.length() )
     {
         return $T("\"") + AddQuotes( valStr, Literal<String::value_type>::quoteChar ) + $T("\"");
     }
@@ -1707,12 +1708,27 @@ CsvReader::CsvReader( String const & content, bool hasColumnHeaders )
     if ( !content.empty() ) this->read( content, hasColumnHeaders );
 }
 
+// CSV空白字符，同StrTrim()
+inline static bool _IsCsvBlank( String::value_type ch )
+{
+    return ch == ' ' || ch == '\r' || ch == '\n' || ch == '\t' || ch == '\v';
+}
+
 inline static void _ReadString( String const & str, size_t * pI, String * valStr )
 {
     size_t & i = *pI;
     ++i; // skip '\"'
     while ( i < str.length() )
     {
+        // 整段加入引号之前的字符
+        size_t run = StrFindChars( str.c_str() + i, str.length() - i, __CsvStringChars );
+        if ( run > 0 )
+        {
+            valStr->append( str.c_str() + i, run );
+            i += run;
+            if ( i >= str.length() ) break;
+        }
+
         String::value_type ch = str[i];
         if ( ch == '\"' )
         {
@@ -1743,23 +1759,33 @@ inline static void _ReadRecord( String const & str, size_t * pI, Mixed * record
     String valStr;
     while ( i < str.length() )
     {
+        // 整段加入下一个结构字符之前的字符
+        size_t run = StrFindChars( str.c_str() + i, str.length() - i, __CsvRecordChars );
+        if ( run > 0 )
+        {
+            valStr.append( str.c_str() + i, run );
+            i += run;
+            if ( i >= str.length() ) break;
+        }
+
         String::value_type ch = str[i];
         if ( ch == '\n' ) // 结束一条记录
         {
-            record->add(valStr);
+            record->add( std::move(valStr) );
+            valStr.clear();
             i++; // skip '\n'
             break;
         }
         else if ( ch == ',' ) // 结束一个值
         {
-            record->add(valStr);
+            record->add( std::move(valStr) );
             valStr.clear();
             i++; // skip ','
         }
         else if ( ch == '\"' )
         {
             // 去除之前可能的空白
-            if ( StrTrim(valStr).empty() )
+            if ( std::all_of( valStr.begin(), valStr.end(), _IsCsvBlank ) )
             {
                 valStr.clear(); // 去除之前可能获得的空白字符
                 _ReadString( str, &i, &valStr );
@@ -1783,8 +1809,120 @@ inline static void _ReadRecord( String const & str, size_t * pI, Mixed * record
 
     if ( str.length() > 0 && '\n' != str[i - 1] ) // 最后一个字符不是换行符
     {
-        record->add(valStr);
+        record->add( std::move(valStr) );
+    }
+}
+
+// 从记录边界begin开始逐条扫描记录的字段位置，直到记录的起始位置不小于limit，返回停止处的记录边界
+static size_t _CsvScanRecords( String::value_type const * s, size_t len, size_t begin, size_t limit, std::vector<CsvFieldSpan> * fields, std::vector<size_t> * rowEnds )
+{
+    size_t i = begin;
+    while ( i < len && i < limit )
+    {
+        size_t fieldStart = i;
+        bool quoted = false; // 字段原文是否含有引号
+        bool nonBlank = false; // 字段的值是否已有非空白字符
+        while ( true )
+        {
+            if ( i >= len || s[i] == '\n' ) // 结束一条记录
+            {
+                // 同_ReadRecord：文本以未闭合引号内的换行符结尾时，最后一个值不加入
+                if ( i < len || s[len - 1] != '\n' ) fields->push_back( CsvFieldSpan{ fieldStart, (uint32)( i - fieldStart ), quoted } );
+                if ( i < len ) i++; // skip '\n'
+                break;
+            }
+            String::value_type ch = s[i];
+            if ( ch == ',' ) // 结束一个值
+            {
+                fields->push_back( CsvFieldSpan{ fieldStart, (uint32)( i - fieldStart ), quoted } );
+                i++; // skip ','
+                fieldStart = i;
+                quoted = false;
+                nonBlank = false;
+            }
+            else if ( ch == '\"' )
+            {
+                quoted = true;
+                i++;
+                if ( !nonBlank ) // 字符串，其中的逗号和换行属于值
+                {
+                    while ( i < len )
+                    {
+                        // 跳过引号之前的字符
+                        size_t run = StrFindChars( s + i, len - i, __CsvStringChars );
+                        for ( size_t k = 0; !nonBlank && k < run; k++ ) if ( !_IsCsvBlank( s[i + k] ) ) nonBlank = true;
+                        i += run;
+                        if ( i >= len ) break;
+
+                        if ( s[i] == '\"' )
+                        {
+                            if ( i + 1 < len && s[i + 1] == '\"' ) // double '\"' 解析成一个'\"'
+                            {
+                                nonBlank = true;
+                                i += 2;
+                            }
+                            else
+                            {
+                                i++; // skip 作为字符串结束的尾"
+                                break;
+                            }
+                        }
+                        else
+                        {
+                            if ( !_IsCsvBlank(s[i]) ) nonBlank = true;
+                            i++;
+                        }
+                    }
+                }
+                else
+                {
+                    nonBlank = true;
+                }
+            }
+            else
+            {
+                // 跳过下一个结构字符之前的字符
+                size_t run = StrFindChars( s + i, len - i, __CsvRecordChars );
+                for ( size_t k = 0; !nonBlank && k < run; k++ ) if ( !_IsCsvBlank( s[i + k] ) ) nonBlank = true;
+                i += run;
+            }
+        }
+        rowEnds->push_back( fields->size() );
+    }
+    return i;
+}
+
+// 假定pos处是否在引号内，推测pos之后的第一个记录边界
+static size_t _CsvGuessRecordBegin( String::value_type const * s, size_t len, size_t pos, bool quoted )
+{
+    for ( ; pos < len; pos++ )
+    {
+        pos += StrFindChars( s + pos, len - pos, __CsvBoundaryChars );
+        if ( pos >= len ) break;
+        if ( s[pos] == '\"' )
+        {
+            quoted = !quoted;
+        }
+        else if ( !quoted ) // '\n'
+        {
+            return pos + 1;
+        }
     }
+    return len;
+}
+
+// 把n个任务投递到线程池并等待全部完成，fn的参数为任务序号
+template < typename _Fx >
+static void _CsvRunTasks( ThreadPool * pool, size_t n, _Fx fn )
+{
+    std::vector< Task<void> > tasks;
+    tasks.reserve(n);
+    for ( size_t k = 0; k < n; k++ )
+    {
+        tasks.push_back( pool->task( fn, k ) );
+        tasks.back().post();
+    }
+    for ( auto && task : tasks ) task.wait();
 }
 
 void CsvReader::read( String const & content, bool hasColumnHeaders )
@@ -1809,6 +1947,156 @@ void CsvReader::read( String const & content, bool hasColumnHeaders )
     }
 }
 
+void CsvReader::read( String const & content, bool hasColumnHeaders, ThreadPool * pool )
+{
+    CsvFieldSpans spans;
+    spans.parse( content, pool );
+
+    size_t firstRow = 0;
+    if ( hasColumnHeaders && spans.getCount() > 0 )
+    {
+        Mixed hdrs;
+        spans.getRecord( 0, &hdrs );
+        _columns.createCollection();
+        for ( size_t i = 0, n = hdrs.getCount(); i < n; ++i )
+        {
+            _columns[ hdrs[i] ] = i;
+        }
+        firstRow = 1;
+    }
+
+    // 先建好记录数组，各线程只写入自己负责的元素
+    size_t count = spans.getCount() - firstRow;
+    _records.createArray(count);
+    size_t const rowsPerTask = 16384;
+    size_t taskCount = pool ? ( count + rowsPerTask - 1 ) / rowsPerTask : 0;
+    if ( taskCount < 2 )
+    {
+        for ( size_t i = 0; i < count; i++ ) spans.getRecord( firstRow + i, &_records[i] );
+        return;
+    }
+    _CsvRunTasks( pool, taskCount, [this, &spans, firstRow, count, rowsPerTask] ( size_t k ) {
+        size_t end = ( k + 1 ) * rowsPerTask < count ? ( k + 1 ) * rowsPerTask : count;
+        for ( size_t i = k * rowsPerTask; i < end; i++ ) spans.getRecord( firstRow + i, &_records[i] );
+    } );
+}
+
+// class CsvFieldSpans ------------------------------------------------------------------------
+CsvFieldSpans::CsvFieldSpans() : _content(nullptr), _length(0)
+{
+}
+
+// 一个分块的解析结果
+struct CsvSpansChunk
+{
+    size_t begin; // 推测的起始记录边界
+    size_t stop; // 实际结束的记录边界
+    std::vector<CsvFieldSpan> fields;
+    std::vector<size_t> rowEnds; // 各记录结束时的字段数
+};
+
+void CsvFieldSpans::parse( String::value_type const * content, size_t length, ThreadPool * pool, size_t chunkSize )
+{
+    _content = content;
+    _length = length;
+    _fields.clear();
+    _rowFields.assign( 1, 0 );
+
+    size_t chunkCount = pool && chunkSize ? ( length + chunkSize - 1 ) / chunkSize : 0;
+    if ( chunkCount < 2 )
+    {
+        std::vector<size_t> rowEnds;
+        _CsvScanRecords( content, length, 0, length, &_fields, &rowEnds );
+        _rowFields.insert( _rowFields.end(), rowEnds.begin(), rowEnds.end() );
+        return;
+    }
+
+    // 统计各块的引号数
+    std::vector<CsvSpansChunk> chunks(chunkCount);
+    std::vector<size_t> quotes(chunkCount);
+    _CsvRunTasks( pool, chunkCount, [&] ( size_t k ) {
+        size_t end = ( k + 1 ) * chunkSize < length ? ( k + 1 ) * chunkSize : length;
+        size_t n = 0;
+        for ( size_t i = k * chunkSize; i < end; i++ ) n += content[i] == '\"';
+        quotes[k] = n;
+    } );
+
+    // 由块首的引号奇偶推测各块的第一个记录边界
+    std::vector<bool> quotedAtBegin(chunkCount);
+    size_t quoteCount = 0;
+    for ( size_t k = 0; k < chunkCount; k++ )
+    {
+        quotedAtBegin[k] = ( quoteCount & 1 ) != 0;
+        quoteCount += quotes[k];
+    }
+    _CsvRunTasks( pool, chunkCount, [&] ( size_t k ) {
+        chunks[k].begin = k == 0 ? 0 : _CsvGuessRecordBegin( content, length, k * chunkSize, quotedAtBegin[k] );
+    } );
+
+    // 各块独立解析到下一块的起始边界
+    _CsvRunTasks( pool, chunkCount, [&] ( size_t k ) {
+        size_t limit = k + 1 < chunkCount ? chunks[k + 1].begin : length;
+        chunks[k].stop = _CsvScanRecords( content, length, chunks[k].begin, limit, &chunks[k].fields, &chunks[k].rowEnds );
+    } );
+
+    // 按顺序拼接，推测有误的块从前一块实际结束处重新解析
+    size_t stop = 0;
+    for ( size_t k = 0; k < chunkCount; k++ )
+    {
+        CsvSpansChunk & chunk = chunks[k];
+        if ( chunk.begin != stop )
+        {
+            size_t limit = k + 1 < chunkCount ? chunks[k + 1].begin : length;
+            chunk.fields.clear();
+            chunk.rowEnds.clear();
+            chunk.stop = _CsvScanRecords( content, length, stop, limit, &chunk.fields, &chunk.rowEnds );
+        }
+        stop = chunk.stop;
+
+        size_t base = _fields.size();
+        _fields.insert( _fields.end(), chunk.fields.begin(), chunk.fields.end() );
+        for ( size_t rowEnd : chunk.rowEnds ) _rowFields.push_back( base + rowEnd );
+        std::vector<CsvFieldSpan>().swap(chunk.fields);
+    }
+}
+
+String CsvFieldSpans::getValue( size_t row, size_t col ) const
+{
+    CsvFieldSpan const & field = this->getField( row, col );
+    String::value_type const * p = _content + field.offset;
+    if ( !field.quoted ) return String( p, field.length );
+
+    // 与_ReadRecord的规则相同：值之前只有空白时，引号开始一个字符串
+    String valStr;
+    String::value_type const * end = p + field.length;
+    while ( p < end )
+    {
+        if ( *p == '\"' && StrTrim(valStr).empty() )
+        {
+            valStr.clear(); // 去除之前可能获得的空白字符
+            size_t i = 0, n = end - p;
+            String str( p, n );
+            _ReadString( str, &i, &valStr );
+            p += i;
+        }
+        else
+        {
+            valStr += *p++;
+        }
+    }
+    return valStr;
+}
+
+void CsvFieldSpans::getRecord( size_t row, Mixed * record ) const
+{
+    size_t n = this->getFieldCount(row);
+    record->createArray(n);
+    for ( size_t col = 0; col < n; col++ )
+    {
+        (*record)[col] = this->getValue( row, col );
+    }
+}
+
 
 // class TextArchive --------------------------------------------------------------------------
 void TextArchive::saveEx( Buffer const & content, AnsiString const & encoding, GrowBuffer * output, FileEncoding fileEncoding )
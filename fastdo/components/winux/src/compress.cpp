@@ -140,6 +140,11 @@ ZRESULT Zip::getMemory( void * * buf, unsigned long * size )
     return ZipGetMemory( _self->hzip, buf, size );
 }
 
+ZRESULT Zip::setLevel( int level )
+{
+    return ZipSetLevel( _self->hzip, level );
+}
+
 // struct Unzip_Data ----------------------------------------------------------------------
 struct Unzip_Data
 {
@@ -6,6 +6,11 @@
 #include "sha1.h"
 #include "sha2.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #include <emmintrin.h>
+    #define WINUX_ENCODING_SSE2
+#endif
+
 namespace winux
 {
 #include "is_x_funcs.inl"
@@ -829,6 +834,238 @@ WINUX_FUNC_IMPL(Buffer) HexToBuffer( XString<char32> const & hexStr )
 }
 
 
+// UTF-16 <=> UTF-8 --------------------------------------------------------------------------
+inline static uint16 _Utf16UnitAt( byte const * p, bool isBigEndian )
+{
+    return isBigEndian ? (uint16)( ( p[0] << 8 ) | p[1] ) : (uint16)( p[0] | ( p[1] << 8 ) );
+}
+
+inline static char * _Utf8PutCodePoint( char * out, uint32 cp )
+{
+    if ( cp < 0x80 )
+    {
+        *out++ = (char)cp;
+    }
+    else if ( cp < 0x800 )
+    {
+        *out++ = (char)( 0xC0 | ( cp >> 6 ) );
+        *out++ = (char)( 0x80 | ( cp & 0x3F ) );
+    }
+    else if ( cp < 0x10000 )
+    {
+        *out++ = (char)( 0xE0 | ( cp >> 12 ) );
+        *out++ = (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+        *out++ = (char)( 0x80 | ( cp & 0x3F ) );
+    }
+    else
+    {
+        *out++ = (char)( 0xF0 | ( cp >> 18 ) );
+        *out++ = (char)( 0x80 | ( ( cp >> 12 ) & 0x3F ) );
+        *out++ = (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+        *out++ = (char)( 0x80 | ( cp & 0x3F ) );
+    }
+    return out;
+}
+
+inline static byte * _Utf16PutUnit( byte * out, uint16 u, bool isBigEndian )
+{
+    if ( isBigEndian )
+    {
+        out[0] = (byte)( u >> 8 );
+        out[1] = (byte)u;
+    }
+    else
+    {
+        out[0] = (byte)u;
+        out[1] = (byte)( u >> 8 );
+    }
+    return out + 2;
+}
+
+WINUX_FUNC_IMPL(Utf8String) Utf16BytesToUtf8( void const * data, size_t size, bool isBigEndian, size_t * invalidCount )
+{
+    byte const * p = (byte const *)data;
+    size_t units = size / 2, i = 0, invalid = 0;
+    Utf8String res;
+    if ( units == 0 )
+    {
+        if ( invalidCount ) *invalidCount = 0;
+        return res;
+    }
+    // 每个UTF-16单元最多产生3个UTF-8字节（代理对是2个单元产生4个字节）
+    res.resize( units * 3 );
+    char * out = &res[0];
+
+    while ( i < units )
+    {
+    #if defined(WINUX_ENCODING_SSE2)
+        // ASCII段：每次处理16个单元
+        if ( i + 16 <= units && _Utf16UnitAt( p + i * 2, isBigEndian ) < 0x80 )
+        {
+            __m128i const asciiMask = isBigEndian ? _mm_set1_epi16( (short)0x80FF ) : _mm_set1_epi16( (short)0xFF80 );
+            __m128i const zero = _mm_setzero_si128();
+            do
+            {
+                __m128i v0 = _mm_loadu_si128( (__m128i const *)( p + i * 2 ) );
+                __m128i v1 = _mm_loadu_si128( (__m128i const *)( p + i * 2 + 16 ) );
+                __m128i t = _mm_or_si128( _mm_and_si128( v0, asciiMask ), _mm_and_si128( v1, asciiMask ) );
+                if ( _mm_movemask_epi8( _mm_cmpeq_epi16( t, zero ) ) != 0xFFFF ) break;
+                if ( isBigEndian )
+                {
+                    v0 = _mm_srli_epi16( v0, 8 );
+                    v1 = _mm_srli_epi16( v1, 8 );
+                }
+                _mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( v0, v1 ) );
+                out += 16;
+                i += 16;
+            } while ( i + 16 <= units );
+            if ( i >= units ) break;
+        }
+    #endif
+
+        uint16 u = _Utf16UnitAt( p + i * 2, isBigEndian );
+        i++;
+        if ( u < 0x80 )
+        {
+            *out++ = (char)u;
+        }
+        else if ( u < 0xD800 || u > 0xDFFF )
+        {
+            out = _Utf8PutCodePoint( out, u );
+        }
+        else if ( u <= 0xDBFF && i < units ) // 高代理项
+        {
+            uint16 u2 = _Utf16UnitAt( p + i * 2, isBigEndian );
+            if ( u2 >= 0xDC00 && u2 <= 0xDFFF )
+            {
+                i++;
+                out = _Utf8PutCodePoint( out, 0x10000 + ( ( (uint32)u - 0xD800 ) << 10 ) + ( u2 - 0xDC00 ) );
+            }
+            else
+            {
+                out = _Utf8PutCodePoint( out, 0xFFFD );
+                invalid++;
+            }
+        }
+        else // 不成对的代理项
+        {
+            out = _Utf8PutCodePoint( out, 0xFFFD );
+            invalid++;
+        }
+    }
+
+    res.resize( out - &res[0] );
+    if ( invalidCount ) *invalidCount = invalid;
+    return res;
+}
+
+WINUX_FUNC_IMPL(Buffer) Utf8ToUtf16Bytes( void const * data, size_t size, bool isBigEndian, size_t * invalidCount )
+{
+    byte const * p = (byte const *)data;
+    size_t i = 0, invalid = 0;
+    Buffer res;
+    if ( size == 0 )
+    {
+        if ( invalidCount ) *invalidCount = 0;
+        return res;
+    }
+    // 每个UTF-8字节最多产生一个UTF-16单元
+    res.alloc( size * 2, false );
+    byte * out = res.getBuf<byte>();
+
+    while ( i < size )
+    {
+    #if defined(WINUX_ENCODING_SSE2)
+        // ASCII段：每次处理16个字节
+        if ( i + 16 <= size && p[i] < 0x80 )
+        {
+            __m128i const zero = _mm_setzero_si128();
+            do
+            {
+                __m128i v = _mm_loadu_si128( (__m128i const *)( p + i ) );
+                if ( _mm_movemask_epi8(v) != 0 ) break;
+                if ( isBigEndian )
+                {
+                    _mm_storeu_si128( (__m128i *)out, _mm_unpacklo_epi8( zero, v ) );
+                    _mm_storeu_si128( (__m128i *)( out + 16 ), _mm_unpackhi_epi8( zero, v ) );
+                }
+                else
+                {
+                    _mm_storeu_si128( (__m128i *)out, _mm_unpacklo_epi8( v, zero ) );
+                    _mm_storeu_si128( (__m128i *)( out + 16 ), _mm_unpackhi_epi8( v, zero ) );
+                }
+                out += 32;
+                i += 16;
+            } while ( i + 16 <= size );
+            if ( i >= size ) break;
+        }
+    #endif
+
+        byte ch = p[i];
+        if ( ch < 0x80 )
+        {
+            out = _Utf16PutUnit( out, ch, isBigEndian );
+            i++;
+            continue;
+        }
+
+        // 三字节序列（中日韩文字）的快速路径
+        if ( ( ch & 0xF0 ) == 0xE0 && i + 3 <= size && ( p[i + 1] & 0xC0 ) == 0x80 && ( p[i + 2] & 0xC0 ) == 0x80 )
+        {
+            uint32 cp = ( ( ch & 0x0F ) << 12 ) | ( ( p[i + 1] & 0x3F ) << 6 ) | ( p[i + 2] & 0x3F );
+            if ( cp >= 0x800 && ( cp < 0xD800 || cp > 0xDFFF ) )
+            {
+                out = _Utf16PutUnit( out, (uint16)cp, isBigEndian );
+                i += 3;
+                continue;
+            }
+        }
+
+        // 多字节序列
+        size_t n;
+        uint32 cp, minCp;
+        if ( ( ch & 0xE0 ) == 0xC0 ) { n = 2; cp = ch & 0x1F; minCp = 0x80; }
+        else if ( ( ch & 0xF0 ) == 0xE0 ) { n = 3; cp = ch & 0x0F; minCp = 0x800; }
+        else if ( ( ch & 0xF8 ) == 0xF0 ) { n = 4; cp = ch & 0x07; minCp = 0x10000; }
+        else { n = 0; cp = 0; minCp = 0; }
+
+        size_t k = 1;
+        if ( n != 0 && i + n <= size )
+        {
+            for ( ; k < n; k++ )
+            {
+                if ( ( p[i + k] & 0xC0 ) != 0x80 ) break;
+                cp = ( cp << 6 ) | ( p[i + k] & 0x3F );
+            }
+        }
+
+        if ( n == 0 || k != n || cp < minCp || cp > 0x10FFFF || ( cp >= 0xD800 && cp <= 0xDFFF ) )
+        {
+            out = _Utf16PutUnit( out, 0xFFFD, isBigEndian );
+            invalid++;
+            i++; // 只跳过首字节，后续字节重新同步
+        }
+        else
+        {
+            if ( cp < 0x10000 )
+            {
+                out = _Utf16PutUnit( out, (uint16)cp, isBigEndian );
+            }
+            else
+            {
+                cp -= 0x10000;
+                out = _Utf16PutUnit( out, (uint16)( 0xD800 + ( cp >> 10 ) ), isBigEndian );
+                out = _Utf16PutUnit( out, (uint16)( 0xDC00 + ( cp & 0x3FF ) ), isBigEndian );
+            }
+            i += n;
+        }
+    }
+
+    res._setSize( out - res.getBuf<byte>() );
+    if ( invalidCount ) *invalidCount = invalid;
+    return res;
+}
+
 WINUX_FUNC_IMPL(Buffer) Md5( void const * buf, size_t size )
 {
     MD5 md5;
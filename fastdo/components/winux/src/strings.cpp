@@ -19,6 +19,14 @@
 #include <math.h>
 #include <iomanip>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #include <emmintrin.h>
+    #define WINUX_STRINGS_SSE2
+#endif
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
 #if defined(OS_WIN) // IS_WINDOWS
     #include <mbstring.h>
     #include <tchar.h>
@@ -1269,6 +1277,133 @@ WINUX_FUNC_IMPL(XString<char32>) AddQuotes( XString<char32> const & str, char32
     return Impl_AddQuotes( str, quote );
 }
 
+// 字符集扫描 ---------------------------------------------------------------------------------
+template < typename _ChTy >
+inline static uint64 Impl_StrCharsMaskScalar( _ChTy const * s, size_t n, _ChTy const chars[4] )
+{
+    uint64 mask = 0;
+    for ( size_t i = 0; i < n; i++ )
+    {
+        _ChTy ch = s[i];
+        if ( ch == chars[0] || ch == chars[1] || ch == chars[2] || ch == chars[3] ) mask |= (uint64)1 << i;
+    }
+    return mask;
+}
+
+#if defined(WINUX_STRINGS_SSE2)
+// 按字符位宽比较一个向量，返回每个字符一位的掩码
+template < size_t _ChSize >
+struct SimdCharsCompare;
+
+template <>
+struct SimdCharsCompare<1>
+{
+    enum { count = 16 };
+    static __m128i set1( int ch ) { return _mm_set1_epi8( (char)ch ); }
+    static uint32 mask( __m128i v, __m128i const c[4] )
+    {
+        __m128i m = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, c[0] ), _mm_cmpeq_epi8( v, c[1] ) ), _mm_or_si128( _mm_cmpeq_epi8( v, c[2] ), _mm_cmpeq_epi8( v, c[3] ) ) );
+        return (uint32)_mm_movemask_epi8(m);
+    }
+};
+
+template <>
+struct SimdCharsCompare<2>
+{
+    enum { count = 8 };
+    static __m128i set1( int ch ) { return _mm_set1_epi16( (short)ch ); }
+    static uint32 mask( __m128i v, __m128i const c[4] )
+    {
+        __m128i m = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi16( v, c[0] ), _mm_cmpeq_epi16( v, c[1] ) ), _mm_or_si128( _mm_cmpeq_epi16( v, c[2] ), _mm_cmpeq_epi16( v, c[3] ) ) );
+        return (uint32)_mm_movemask_epi8( _mm_packs_epi16( m, _mm_setzero_si128() ) );
+    }
+};
+
+template <>
+struct SimdCharsCompare<4>
+{
+    enum { count = 4 };
+    static __m128i set1( int ch ) { return _mm_set1_epi32(ch); }
+    static uint32 mask( __m128i v, __m128i const c[4] )
+    {
+        __m128i m = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi32( v, c[0] ), _mm_cmpeq_epi32( v, c[1] ) ), _mm_or_si128( _mm_cmpeq_epi32( v, c[2] ), _mm_cmpeq_epi32( v, c[3] ) ) );
+        return (uint32)_mm_movemask_epi8( _mm_packs_epi16( _mm_packs_epi32( m, _mm_setzero_si128() ), _mm_setzero_si128() ) );
+    }
+};
+#endif
+
+template < typename _ChTy >
+inline static uint64 Impl_StrCharsMask( _ChTy const * s, size_t n, _ChTy const chars[4] )
+{
+    if ( n > 64 ) n = 64;
+#if defined(WINUX_STRINGS_SSE2)
+    typedef SimdCharsCompare< sizeof(_ChTy) > Cmp;
+    __m128i c[4] = { Cmp::set1( chars[0] ), Cmp::set1( chars[1] ), Cmp::set1( chars[2] ), Cmp::set1( chars[3] ) };
+    uint64 mask = 0;
+    size_t i = 0;
+    for ( ; i + Cmp::count <= n; i += Cmp::count )
+    {
+        mask |= (uint64)Cmp::mask( _mm_loadu_si128( (__m128i const *)( s + i ) ), c ) << i;
+    }
+    if ( i < n ) mask |= Impl_StrCharsMaskScalar( s + i, n - i, chars ) << i;
+    return mask;
+#else
+    return Impl_StrCharsMaskScalar( s, n, chars );
+#endif
+}
+
+// 最低的置位位置
+inline static size_t _LowestBit( uint64 mask )
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64( &index, mask );
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if ( _BitScanForward( &index, (unsigned long)mask ) ) return index;
+    _BitScanForward( &index, (unsigned long)( mask >> 32 ) );
+    return index + 32;
+#else
+    return (size_t)__builtin_ctzll(mask);
+#endif
+}
+
+template < typename _ChTy >
+inline static size_t Impl_StrFindChars( _ChTy const * s, size_t n, _ChTy const chars[4] )
+{
+    for ( size_t i = 0; i < n; i += 64 )
+    {
+        uint64 mask = Impl_StrCharsMask( s + i, n - i, chars );
+        if ( mask ) return i + _LowestBit(mask);
+    }
+    return n;
+}
+
+template <>
+WINUX_FUNC_IMPL(uint64) StrCharsMask( char const * s, size_t n, char const chars[4] )
+{
+    return Impl_StrCharsMask( s, n, chars );
+}
+
+template <>
+WINUX_FUNC_IMPL(uint64) StrCharsMask( wchar const * s, size_t n, wchar const chars[4] )
+{
+    return Impl_StrCharsMask( s, n, chars );
+}
+
+template <>
+WINUX_FUNC_IMPL(size_t) StrFindChars( char const * s, size_t n, char const chars[4] )
+{
+    return Impl_StrFindChars( s, n, chars );
+}
+
+template <>
+WINUX_FUNC_IMPL(size_t) StrFindChars( wchar const * s, size_t n, wchar const chars[4] )
+{
+    return Impl_StrFindChars( s, n, chars );
+}
+
 
 template < typename _ChTy >
 inline static bool Impl_StrGetLine( XString<_ChTy> * line, _ChTy const * str, size_t len, size_t * pI, XString<_ChTy> * nl )
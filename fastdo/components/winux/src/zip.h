@@ -93,6 +93,10 @@ ZRESULT ZipGetMemory(HZIP hz, void **buf, unsigned long *len);
 // buf will receive a pointer to its start, and len its length.
 // Note: you can't add any more after calling this.
 
+ZRESULT ZipSetLevel(HZIP hz, int level);
+// ZipSetLevel - sets the deflate pack level (1 fastest .. 8 best, the default)
+// for items added afterwards.
+
 ZRESULT CloseZip(HZIP hz);
 // CloseZip - the zip handle must be closed with this function.
 
@@ -0,0 +1,83 @@
+﻿#include "Bench.h"
+#include "LogCsvExporter.h"
+
+// 把整数打散成均匀分布的散列值
+inline static winux::uint64 _Mix( winux::uint64 x )
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+    return x ^ ( x >> 31 );
+}
+
+LogTextRecord BenchMakeRecord( size_t i )
+{
+    static char const * words[] = {
+        "request", "timeout", "connect", "database", "user", "login", "failed", "ok", "retry",
+        "cache", "miss", "hit", "GET", "POST", "/api/v1/items", "error", "warning", "session"
+    };
+    winux::uint64 h = _Mix(i);
+    winux::uint64 tpl = h % BenchTemplates;
+    winux::uint64 t = _Mix( tpl + 0x5BD1E995 );
+
+    LogTextRecord tr;
+    winux::Utf8String & s = tr.strContent;
+    s = winux::FormatA( "[pid:%u] ", (unsigned)( 1000 + ( h >> 20 ) % 64 ) );
+    for ( size_t k = 0, n = 4 + t % 8; k < n; k++ )
+    {
+        s += words[ ( t >> ( k * 5 + 3 ) ) % 18 ];
+        s += ' ';
+    }
+    s += winux::FormatA( "id=%u cost=%ums", (unsigned)( h >> 32 ), (unsigned)( h >> 8 ) % 1000 );
+    tr.contentSize = s.length();
+    tr.strContentSlashes = winux::AddCSlashes(s);
+    tr.utcTimeMs = 1700000000000ULL + i * 3;
+    tr.utcTime = winux::DateTimeL::FromMilliSec(tr.utcTimeMs).toString<char>();
+    if ( tpl % 7 == 0 ) tr.flag = eienlog::LogFlag( true, 0x001F, false, 0, eienlog::leUtf8, false ); // 红色前景
+    else if ( tpl % 11 == 0 ) tr.flag = eienlog::LogFlag( false, 0, true, 0x00F0, eienlog::leUtf8, false ); // 绿色背景
+    else tr.flag = eienlog::LogFlag(eienlog::leUtf8);
+    tr.meta = eienlog::LogMeta( (eienlog::LogSeverity)( 1 + tpl % 6 ), (winux::uint8)( tpl % 16 ) );
+    return tr;
+}
+
+winux::uint64 BenchFillStore( LogStore * store, size_t rows )
+{
+    winux::uint64 bytes = 0;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        LogTextRecord tr = BenchMakeRecord(i);
+        bytes += tr.contentSize;
+        store->append( std::move(tr) );
+    }
+    return bytes;
+}
+
+winux::Utf8String BenchMakeCsvLog( size_t rows )
+{
+    winux::Utf8String text;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        LogTextRecord tr = BenchMakeRecord(i);
+        if ( i % 5 == 0 ) tr.strContent += "\nsay \"hi\", ok";
+        LogCsvExporter::FormatRecord( tr, &text );
+    }
+    return text;
+}
+
+long BenchAnonRssMBytes()
+{
+#if defined(OS_LINUX)
+    FILE * fp = fopen( "/proc/self/status", "r" );
+    if ( !fp ) return -1;
+    char line[256];
+    long kb = -1;
+    while ( fgets( line, sizeof(line), fp ) )
+    {
+        if ( strncmp( line, "RssAnon:", 8 ) == 0 ) kb = atol( line + 8 );
+    }
+    fclose(fp);
+    return kb < 0 ? -1 : kb / 1024;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "LogStore.h"
+
+/** \brief 基准命令，argv[0]为命令名 */
+typedef int (* BenchCommand)( int argc, char * argv[] );
+
+/** \brief 计时器 */
+class BenchTimer
+{
+public:
+    BenchTimer() : _start( std::chrono::steady_clock::now() ) { }
+
+    /** \brief 重新开始计时 */
+    void restart() { _start = std::chrono::steady_clock::now(); }
+
+    /** \brief 经过的秒数 */
+    double seconds() const { return std::chrono::duration<double>( std::chrono::steady_clock::now() - _start ).count(); }
+
+private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+/** \brief 取第i个命令行参数，不存在时返回默认值 */
+inline size_t BenchArg( int argc, char * argv[], int i, size_t defValue )
+{
+    return argc > i ? (size_t)strtoull( argv[i], nullptr, 10 ) : defValue;
+}
+
+/** \brief 每秒处理量，耗时为0时返回0 */
+inline double BenchRate( double count, double sec )
+{
+    return sec > 0 ? count / sec : 0;
+}
+
+/** \brief 生成第i条合成日志
+ *
+ *  内容取自BenchTemplates个模板，模板由固定单词组成，其中夹着变化的数字，与实际流量相似。
+ *  同一i总是得到相同的记录，可以在多个线程中并行生成。部分记录带颜色、级别和类别。 */
+LogTextRecord BenchMakeRecord( size_t i );
+
+/** \brief 合成日志的模板数 */
+enum { BenchTemplates = 300 };
+
+/** \brief 向存储追加rows条合成日志，返回内容的总字节数 */
+winux::uint64 BenchFillStore( LogStore * store, size_t rows );
+
+/** \brief 生成rows行合成日志的csvlog文本（不含BOM），每5行有一条带引号和换行的内容 */
+winux::Utf8String BenchMakeCsvLog( size_t rows );
+
+/** \brief 进程的匿名内存（MB），只在Linux下统计，其他平台返回-1 */
+long BenchAnonRssMBytes();
+
+// 各基准命令
+int BenchUtf16( int argc, char * argv[] );
+int BenchSearch( int argc, char * argv[] );
+int BenchExpr( int argc, char * argv[] );
+int BenchParallel( int argc, char * argv[] );
+int BenchExport( int argc, char * argv[] );
+int BenchCsvParse( int argc, char * argv[] );
+int BenchCsvScan( int argc, char * argv[] );
+int BenchTier( int argc, char * argv[] );
+int BenchSort( int argc, char * argv[] );
+int BenchTemplate( int argc, char * argv[] );
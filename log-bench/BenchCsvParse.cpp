@@ -0,0 +1,66 @@
+﻿#include "Bench.h"
+#include <algorithm>
+#include <thread>
+
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+// 两种解析结果的一条记录是否相同
+static bool _SameRecord( winux::Mixed const & record, winux::CsvFieldSpans const & spans, size_t row )
+{
+    if ( record.getCount() != spans.getFieldCount(row) ) return false;
+    for ( size_t col = 0; col < record.getCount(); col++ )
+    {
+        if ( record[(int)col].toString<winux::String::value_type>() != spans.getValue( row, col ) ) return false;
+    }
+    return true;
+}
+
+int BenchCsvParse( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 1000000 );
+    size_t threads = BenchArg( argc, argv, 2, std::max( std::thread::hardware_concurrency(), 1u ) );
+
+    winux::Utf8String text = BenchMakeCsvLog(rows);
+    winux::String content = _ToString(text);
+    double mb = text.size() / 1048576.0;
+    printf( "rows=%zu text=%.1f MB threads=%zu\n", rows, mb, threads );
+
+    winux::ThreadPool pool( (int)threads );
+    BenchTimer timer;
+    winux::CsvReader reader(content);
+    double readerSec = timer.seconds();
+
+    timer.restart();
+    winux::CsvReader poolReader( winux::String(), false );
+    poolReader.read( content, false, &pool );
+    double poolReaderSec = timer.seconds();
+
+    timer.restart();
+    winux::CsvFieldSpans spans;
+    spans.parse(content);
+    double spansSec = timer.seconds();
+
+    timer.restart();
+    winux::CsvFieldSpans poolSpans;
+    poolSpans.parse( content, &pool );
+    double poolSpansSec = timer.seconds();
+
+    bool same = reader.getCount() == rows && poolReader.getCount() == rows && spans.getCount() == rows && poolSpans.getCount() == rows;
+    for ( size_t row = 0; same && row < rows; row += 997 )
+    {
+        same = _SameRecord( reader[(int)row], spans, row ) && _SameRecord( reader[(int)row], poolSpans, row ) && reader[(int)row].myJson() == poolReader[(int)row].myJson();
+    }
+    printf( "CsvReader: %.0f ms, %.0f MB/s\n", readerSec * 1000, BenchRate( mb, readerSec ) );
+    printf( "CsvReader+pool: %.0f ms, %.0f MB/s\n", poolReaderSec * 1000, BenchRate( mb, poolReaderSec ) );
+    printf( "CsvFieldSpans: %.0f ms, %.0f MB/s\n", spansSec * 1000, BenchRate( mb, spansSec ) );
+    printf( "CsvFieldSpans+pool: %.0f ms, %.0f MB/s\n", poolSpansSec * 1000, BenchRate( mb, poolSpansSec ) );
+    printf( "results %s\n", same ? "match" : "DIFFER" );
+    return same ? 0 : 1;
+}
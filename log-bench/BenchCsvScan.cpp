@@ -0,0 +1,97 @@
+﻿#include "Bench.h"
+
+// 逐字符找记录边界，引号内的换行不结束记录
+static size_t _ScanScalar( char const * s, size_t n )
+{
+    size_t rows = 0;
+    bool quoted = false;
+    for ( size_t i = 0; i < n; i++ )
+    {
+        char ch = s[i];
+        if ( ch == '\"' ) quoted = !quoted;
+        else if ( ch == '\n' && !quoted ) rows++;
+    }
+    return rows;
+}
+
+// 用StrFindChars跳到下一个引号或换行
+static size_t _ScanChars( char const * s, size_t n )
+{
+    static char const chars[4] = { '\"', '\n', '\n', '\n' };
+    size_t rows = 0;
+    bool quoted = false;
+    for ( size_t i = 0; i < n; i++ )
+    {
+        i += winux::StrFindChars( s + i, n - i, chars );
+        if ( i >= n ) break;
+        if ( s[i] == '\"' ) quoted = !quoted;
+        else if ( !quoted ) rows++;
+    }
+    return rows;
+}
+
+// 字段值是否需要加引号，与CsvWriter的判断相同
+static bool _NeedQuotesScalar( winux::Utf8String const & value )
+{
+    for ( char ch : value )
+    {
+        if ( ch == ',' || ch == '\"' || ch == '\'' || ch == '\n' ) return true;
+    }
+    return false;
+}
+
+int BenchCsvScan( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 2000000 );
+    int times = (int)BenchArg( argc, argv, 2, 5 );
+    winux::Utf8String text = BenchMakeCsvLog(rows);
+    double mb = text.size() / 1048576.0 * times;
+    printf( "rows=%zu text=%.1f MB times=%d\n", rows, text.size() / 1048576.0, times );
+
+    // 记录边界扫描
+    size_t scalarRows = 0, charsRows = 0;
+    BenchTimer timer;
+    for ( int t = 0; t < times; t++ ) scalarRows = _ScanScalar( text.c_str(), text.size() );
+    double scalarSec = timer.seconds();
+    timer.restart();
+    for ( int t = 0; t < times; t++ ) charsRows = _ScanChars( text.c_str(), text.size() );
+    double charsSec = timer.seconds();
+    printf( "row scan scalar: %.0f ms, %.0f MB/s\n", scalarSec * 1000, BenchRate( mb, scalarSec ) );
+    printf( "row scan StrFindChars: %.0f ms, %.0f MB/s\n", charsSec * 1000, BenchRate( mb, charsSec ) );
+
+    // 字段结构扫描
+    timer.restart();
+    size_t fields = 0;
+    for ( int t = 0; t < times; t++ )
+    {
+        winux::CsvFieldSpans spans;
+        spans.parse(text);
+        fields = spans.getCount();
+    }
+    double spansSec = timer.seconds();
+    printf( "CsvFieldSpans: %.0f ms, %.0f MB/s\n", spansSec * 1000, BenchRate( mb, spansSec ) );
+
+    // 导出时判断字段是否需要加引号
+    std::vector<winux::Utf8String> values;
+    size_t valueBytes = 0;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        values.push_back( BenchMakeRecord(i).strContent );
+        valueBytes += values.back().size();
+    }
+    static char const quoteChars[4] = { ',', '\"', '\'', '\n' };
+    size_t scalarQuotes = 0, charsQuotes = 0;
+    timer.restart();
+    for ( int t = 0; t < times; t++ ) for ( auto && v : values ) scalarQuotes += _NeedQuotesScalar(v);
+    double quoteScalarSec = timer.seconds();
+    timer.restart();
+    for ( int t = 0; t < times; t++ ) for ( auto && v : values ) charsQuotes += winux::StrFindChars( v.c_str(), v.size(), quoteChars ) < v.size();
+    double quoteCharsSec = timer.seconds();
+    double quoteMb = valueBytes / 1048576.0 * times;
+    printf( "needs-quote scalar: %.0f ms, %.0f MB/s\n", quoteScalarSec * 1000, BenchRate( quoteMb, quoteScalarSec ) );
+    printf( "needs-quote StrFindChars: %.0f ms, %.0f MB/s\n", quoteCharsSec * 1000, BenchRate( quoteMb, quoteCharsSec ) );
+
+    bool same = scalarRows == rows && charsRows == rows && fields == rows && scalarQuotes == charsQuotes;
+    printf( "results %s\n", same ? "match" : "DIFFER" );
+    return same ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+﻿#include "Bench.h"
+#include <thread>
+#include "LogCsvExporter.h"
+
+int BenchExport( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 1000000 );
+    char const * path = argc > 2 ? argv[2] : "log-bench-export.csvlog";
+    LogStore store;
+    BenchFillStore( &store, rows );
+
+    // 原来的保存方式：每行一个Mixed写入内存中的CsvWriter，再整体转换编码保存
+    BenchTimer timer;
+    {
+        winux::MemoryFile memFile;
+        winux::CsvWriter csv(&memFile);
+        LogStore::Reader reader(store);
+        for ( size_t row = 0; row < rows; row++ )
+        {
+            LogTextRecord const & log = reader[row];
+            winux::Mixed record;
+            record.createArray();
+            record.add(log.contentSize);
+            record.add(log.strContent);
+            record.add(log.utcTime);
+            record.add(log.flag.value);
+            csv.writeRecord(record);
+        }
+        winux::TextArchive archive;
+        archive.saveEx( memFile.buffer(), "UTF-8", path, winux::feUtf8Bom );
+    }
+    double oldSec = timer.seconds();
+
+    // 流式导出，导出期间继续向存储追加记录
+    timer.restart();
+    LogCsvExporter exporter( store, { { 0, rows } }, path );
+    if ( !exporter.start() )
+    {
+        fprintf( stderr, "无法创建 %s\n", path );
+        return 1;
+    }
+    size_t appended = 0;
+    while ( !exporter.isFinished() )
+    {
+        store.append( BenchMakeRecord( rows + appended ) );
+        appended++;
+    }
+    exporter.wait();
+    double newSec = timer.seconds();
+    double mb = exporter.getWrittenBytes() / 1048576.0;
+    printf( "rows=%zu file=%.1f MB\n", rows, mb );
+    printf( "CsvWriter+TextArchive: %.0f ms, %.0f MB/s\n", oldSec * 1000, BenchRate( mb, oldSec ) );
+    printf( "LogCsvExporter: %.0f ms, %.0f MB/s, %zu rows appended meanwhile%s\n", newSec * 1000, BenchRate( mb, newSec ), appended, exporter.isFailed() ? ", FAILED" : "" );
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,51 @@
+﻿#include "Bench.h"
+#include "LogExprFilter.h"
+
+int BenchExpr( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 2000000 );
+    LogStore store;
+    BenchFillStore( &store, rows );
+    LogStore::Reader reader(store);
+
+    char const * exprs[] = {
+        "size > 60 && fg == red",
+        "size > 60 && fg == red && contains(text, \"timeout\")",
+        "severity >= warning && icontains(text, \"LOGIN\")",
+        "!(bg == green) && (size - 10) * 2 >= 120 || startswith(text, \"[pid:1001]\") && len(text) < 80",
+    };
+    for ( char const * e : exprs )
+    {
+        LogExprFilter filter(e);
+        BenchTimer timer;
+        size_t count = 0;
+        for ( size_t row = 0; row < rows; row++ )
+        {
+            if ( filter.matchRow( reader[row], reader.fields(row) ) ) count++;
+        }
+        double sec = timer.seconds();
+        printf( "%-100s %zu rows %.2f Mrows/s\n", e, count, BenchRate( rows / 1e6, sec ) );
+    }
+
+    // 对比：通用的eienexpr，每行把字段写入VarContext再求值
+    eienexpr::ExprPackage package;
+    eienexpr::VarContext ctx;
+    winux::Mixed size, fg;
+    ctx.setPtr( "size", &size );
+    ctx.setPtr( "fg", &fg );
+    ctx.set( "red", (int)lccRed );
+    eienexpr::Expression expr( &package, &ctx, nullptr, nullptr );
+    eienexpr::ExprParser().parse( &expr, "size > 60 && fg == red" );
+    BenchTimer timer;
+    size_t count = 0;
+    for ( size_t row = 0; row < rows; row++ )
+    {
+        LogTextRecord const & tr = reader[row];
+        size = (winux::uint64)tr.contentSize;
+        fg = (int)GetLogColorClass(tr.flag);
+        if ( expr.val().toBool() ) count++;
+    }
+    double sec = timer.seconds();
+    printf( "%-100s %zu rows %.2f Mrows/s\n", "generic eienexpr: size > 60 && fg == red", count, BenchRate( rows / 1e6, sec ) );
+    return 0;
+}
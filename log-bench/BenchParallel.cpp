@@ -0,0 +1,52 @@
+﻿#include "Bench.h"
+#include <thread>
+#include "LogExprFilter.h"
+
+int BenchParallel( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 4000000 );
+    size_t maxThreads = BenchArg( argc, argv, 2, std::max( std::thread::hardware_concurrency(), 1u ) );
+    LogStore store;
+    BenchFillStore( &store, rows );
+    winux::SharedPointer<LogFilter> filter( new LogExprFilter( "size > 70 && icontains(text, \"timeout\") || endswith(text, \"9ms\")" ) );
+
+    // 单线程扫描作为基准和正确结果
+    std::vector<winux::uint32> expected;
+    LogStore::Reader reader(store);
+    BenchTimer timer;
+    for ( size_t row = 0; row < rows; row++ )
+    {
+        if ( filter->matchRow( reader[row], reader.fields(row) ) ) expected.push_back( (winux::uint32)row );
+    }
+    double serial = timer.seconds();
+    printf( "serial: %zu rows matched, %.0f ms\n", expected.size(), serial * 1000 );
+
+    for ( size_t threads = 1; threads <= maxThreads; threads *= 2 )
+    {
+        winux::ThreadPool pool( (int)threads );
+        LogFilterView view(filter);
+        timer.restart();
+        view.updateParallel( &pool, store );
+        double firstPartial = 0;
+        while ( view.isScanning() )
+        {
+            view.poll(store);
+            if ( firstPartial == 0 && view.size() > 0 ) firstPartial = timer.seconds();
+            std::this_thread::sleep_for( std::chrono::microseconds(200) );
+        }
+        double sec = timer.seconds();
+        bool ok = view.size() == expected.size();
+        for ( size_t i = 0; ok && i < expected.size(); i++ ) ok = view[i] == expected[i];
+        printf( "threads=%zu: %.0f ms, speedup %.2fx, first partial result %.1f ms, %s\n", threads, sec * 1000, BenchRate( serial, sec ), firstPartial * 1000, ok ? "ok" : "MISMATCH" );
+    }
+
+    // 扫描中途取消
+    winux::ThreadPool pool( (int)maxThreads );
+    LogFilterView view(filter);
+    view.updateParallel( &pool, store );
+    std::this_thread::sleep_for( std::chrono::milliseconds(5) );
+    timer.restart();
+    view.reset();
+    printf( "cancel after 5 ms: returned in %.2f ms\n", timer.seconds() * 1000 );
+    return 0;
+}
@@ -0,0 +1,52 @@
+﻿#include "Bench.h"
+#include "LogSearchIndex.h"
+
+int BenchSearch( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 2000000 );
+
+    // 追加记录的同时维护索引，分别统计两者的耗时
+    LogStore store;
+    LogSearchIndex index;
+    double storeSec = 0, indexSec = 0;
+    winux::uint64 bytes = 0;
+    BenchTimer timer;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        LogTextRecord tr = BenchMakeRecord(i);
+        if ( i == rows / 2 ) tr.strContent += " UniqueNeedleXYZ";
+        bytes += tr.strContent.length();
+        timer.restart();
+        size_t row = store.append( std::move(tr) );
+        storeSec += timer.seconds();
+        timer.restart();
+        index.add( (winux::uint32)row, store[row].strContent );
+        indexSec += timer.seconds();
+    }
+    printf( "rows=%zu content=%.1f MB postings=%.1f MB\n", rows, bytes / 1048576.0, index.getPostingsBytes() / 1048576.0 );
+    printf( "ingest: store %.2f s, index %.2f s (%.1f ns/byte)\n", storeSec, indexSec, BenchRate( indexSec * 1e9, (double)bytes ) );
+
+    char const * queries[] = { "UniqueNeedleXYZ", "uniqueneedle", "timeout database", "id=12345", "GET", "ok" };
+    for ( char const * q : queries )
+    {
+        std::vector<winux::uint32> result;
+        timer.restart();
+        size_t substr = index.search( store, q, LogSearchIndex::smSubstring, false, &result );
+        double substrMs = timer.seconds() * 1000;
+        timer.restart();
+        size_t token = index.search( store, q, LogSearchIndex::smToken, false, &result );
+        double tokenMs = timer.seconds() * 1000;
+
+        // 不用索引逐行匹配，作为对比
+        timer.restart();
+        size_t scan = 0;
+        LogStore::Reader reader(store);
+        for ( size_t row = 0; row < store.size(); row++ )
+        {
+            if ( LogSearchIndex::Match( reader[row].strContent, q, LogSearchIndex::smSubstring, false ) ) scan++;
+        }
+        double scanMs = timer.seconds() * 1000;
+        printf( "%-18s substring %zu rows %.1f ms | token %zu rows %.1f ms | scan %zu rows %.1f ms\n", q, substr, substrMs, token, tokenMs, scan, scanMs );
+    }
+    return 0;
+}
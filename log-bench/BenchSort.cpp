@@ -0,0 +1,90 @@
+﻿#include "Bench.h"
+#include <algorithm>
+#include <thread>
+#include "LogSort.h"
+
+// 检查排序结果：相邻两行按排序键有序，键都相同时按行号升序
+static size_t _CountDisorder( LogStore const & store, LogSortIndex const & index, std::vector<LogSortIndex::Key> const & keys )
+{
+    size_t bad = 0;
+    LogStore::Reader reader(store);
+    for ( size_t i = 1; i < index.size(); i++ )
+    {
+        winux::uint32 rowA = index[i - 1], rowB = index[i];
+        LogTextRecord const & a = reader[rowA];
+        LogTextRecord const & b = reader[rowB];
+        int c = 0;
+        for ( auto && key : keys )
+        {
+            if ( key.column == LogSortIndex::scTime ) c = a.utcTimeMs < b.utcTimeMs ? -1 : ( a.utcTimeMs > b.utcTimeMs ? 1 : 0 );
+            else if ( key.column == LogSortIndex::scSize ) c = a.contentSize < b.contentSize ? -1 : ( a.contentSize > b.contentSize ? 1 : 0 );
+            else if ( key.column == LogSortIndex::scContent ) c = a.strContent.compare(b.strContent);
+            else c = rowA < rowB ? -1 : ( rowA > rowB ? 1 : 0 );
+            if ( key.descending ) c = -c;
+            if ( c != 0 ) break;
+        }
+        if ( c > 0 || ( c == 0 && rowA > rowB ) ) bad++;
+    }
+    return bad;
+}
+
+int BenchSort( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 2000000 );
+    size_t threads = BenchArg( argc, argv, 2, std::max( std::thread::hardware_concurrency(), 1u ) );
+    size_t batches = 50;
+    size_t batchRows = std::max( rows / 1000, (size_t)1 ); // 追加的行按每批并入，相当于界面每200ms并入一次
+    winux::ThreadPool pool( (int)threads );
+    printf( "rows=%zu threads=%zu, then %zu batches of %zu appended rows\n", rows, threads, batches, batchRows );
+
+    std::vector< std::vector<LogSortIndex::Key> > keySets = {
+        { { LogSortIndex::scTime, false } },
+        { { LogSortIndex::scTime, true } },
+        { { LogSortIndex::scSize, true }, { LogSortIndex::scTime, false } },
+        { { LogSortIndex::scContent, false }, { LogSortIndex::scSize, false } },
+    };
+    static char const * columnNames[] = { "row", "time", "size", "content" };
+    for ( auto && keys : keySets )
+    {
+        winux::Utf8String name;
+        for ( auto && key : keys ) name += winux::FormatA( "%s%s%s", name.empty() ? "" : ",", columnNames[key.column], key.descending ? " desc" : "" );
+
+        LogStore store;
+        BenchFillStore( &store, rows );
+
+        // 后台排序，主线程像界面一样每帧轮询，统计轮询最长的耗时
+        BenchTimer timer;
+        LogSortTask task( &pool, store, keys );
+        task.start();
+        double maxPoll = 0;
+        size_t polls = 0;
+        while ( true )
+        {
+            BenchTimer pollTimer;
+            bool done = task.isDone();
+            maxPoll = std::max( maxPoll, pollTimer.seconds() );
+            polls++;
+            if ( done ) break;
+            std::this_thread::sleep_for( std::chrono::milliseconds(16) );
+        }
+        LogSortIndex index;
+        task.takeIndex(&index);
+        double sortSec = timer.seconds();
+
+        // 之后追加的行分批并入
+        double maxMerge = 0, totalMerge = 0;
+        for ( size_t b = 0; b < batches; b++ )
+        {
+            for ( size_t i = 0; i < batchRows; i++ ) store.append( BenchMakeRecord( store.size() ) );
+            timer.restart();
+            index.update(store);
+            double sec = timer.seconds();
+            maxMerge = std::max( maxMerge, sec );
+            totalMerge += sec;
+        }
+        size_t bad = index.size() == store.size() ? _CountDisorder( store, index, keys ) : (size_t)-1;
+        printf( "%s: sort %.0f ms in background (%zu polls, longest %.3f ms), merge avg %.2f ms max %.2f ms, %s\n", name.c_str(), sortSec * 1000, polls, maxPoll * 1000,
+            totalMerge * 1000 / batches, maxMerge * 1000, bad == 0 ? "ok" : "DISORDERED" );
+    }
+    return 0;
+}
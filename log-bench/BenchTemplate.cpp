@@ -0,0 +1,156 @@
+﻿#include "Bench.h"
+#include <atomic>
+#include <thread>
+#include "LogFilter.h"
+
+enum { BenchTemplatePort = 22398 }; // 本机收发用的端口
+
+// 经本机端口把rows条合成日志抓成抓包文件，发送时适当让出，避免接收缓冲区溢出丢包
+static bool _MakeCapture( winux::String const & path, size_t rows )
+{
+    eienlog::LogReader reader( $T("127.0.0.1"), BenchTemplatePort );
+    eienlog::LogWriter writer( $T("127.0.0.1"), BenchTemplatePort );
+    eienlog::LogCaptureWriter capture;
+    if ( reader.errNo() != 0 || writer.errNo() != 0 || !capture.open( path, reader.getChunkSize() ) ) return false;
+
+    std::atomic<bool> stop(false);
+    winux::uint64 captured = 0;
+    std::thread captureThread( [&] () { captured = eienlog::CaptureChunks( &reader, &capture, 0, 0, &stop ); } );
+    winux::uint64 sent = 0;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        LogTextRecord tr = BenchMakeRecord(i);
+        sent += writer.logEx( winux::Buffer( tr.strContent.c_str(), tr.strContent.length(), true ), tr.flag, tr.meta );
+        if ( i % 64 == 63 ) std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+    std::this_thread::sleep_for( std::chrono::milliseconds(500) );
+    stop = true;
+    captureThread.join();
+    capture.close();
+    printf( "capture: %llu/%llu chunks\n", (unsigned long long)captured, (unsigned long long)sent );
+    return captured > 0;
+}
+
+// 本机回放抓包，接收重组的记录并转换成文本记录
+static void _ReplayCapture( winux::String const & path, double speed, std::vector<LogTextRecord> * records, std::vector< std::vector<eienlog::LogField> > * fields )
+{
+    eienlog::LogCaptureReader capture;
+    if ( !capture.open(path) ) return;
+    eienlog::LogReader reader( $T("127.0.0.1"), BenchTemplatePort, capture.getHeader().chunkSize );
+    eienlog::LogWriter writer( $T("127.0.0.1"), BenchTemplatePort, capture.getHeader().chunkSize );
+    if ( reader.errNo() != 0 || writer.errNo() != 0 ) return;
+
+    std::atomic<bool> sent(false);
+    std::thread recvThread( [&] () {
+        eienlog::LogRecord record;
+        for ( ;; )
+        {
+            if ( reader.readRecord( &record, 200, 200 ) )
+            {
+                records->emplace_back();
+                fields->emplace_back();
+                LogRecordToText( record, &records->back(), &fields->back() );
+            }
+            else if ( sent )
+            {
+                break;
+            }
+        }
+    } );
+    eienlog::LogReplayStats stats;
+    eienlog::ReplayCapture( &capture, &writer, speed, &stats );
+    sent = true;
+    recvThread.join();
+    printf( "replay: %llu chunks, %zu records received\n", (unsigned long long)stats.chunkCount, records->size() );
+}
+
+// 追加全部记录，返回耗时（秒）
+static double _Ingest( LogStore * store, std::vector<LogTextRecord> const & records, std::vector< std::vector<eienlog::LogField> > const & fields )
+{
+    BenchTimer timer;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord tr = records[i];
+        store->append( std::move(tr), &fields[i] );
+    }
+    store->trim();
+    return timer.seconds();
+}
+
+// 筛选一遍，输出行数和耗时
+static void _RunFilter( LogStore const & store, LogFilter * filter )
+{
+    LogFilterView view{ winux::SharedPointer<LogFilter>(filter) };
+    BenchTimer timer;
+    view.update(store);
+    printf( "  %-60s %8zu rows, %.1f ms\n", filter->getDescription().c_str(), view.size(), timer.seconds() * 1000 );
+}
+
+int BenchTemplate( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 500000 );
+    winux::String path = argc > 2 ? winux::String( argv[2], argv[2] + strlen(argv[2]) ) : winux::String( $T("log-bench.eiencap") );
+    double speed = argc > 3 ? atof(argv[3]) : 1.0;
+
+    // 抓包文件不存在时先用合成日志生成一份
+    if ( !winux::DetectPath(path) && !_MakeCapture( path, rows ) )
+    {
+        fprintf( stderr, "无法生成抓包文件\n" );
+        return 1;
+    }
+    std::vector<LogTextRecord> records;
+    std::vector< std::vector<eienlog::LogField> > fields;
+    _ReplayCapture( path, speed, &records, &fields );
+    if ( records.empty() )
+    {
+        fprintf( stderr, "抓包文件中没有可回放的记录\n" );
+        return 1;
+    }
+
+    // 启用和不启用模板字典各追加一遍，内存按存储的估算和进程匿名内存的增量统计，启用的存储保留到最后，不影响后面的增量
+    long rss0 = BenchAnonRssMBytes();
+    LogStore store;
+    store.setTemplateDict(true);
+    double dictSec = _Ingest( &store, records, fields );
+    auto & dict = store.getTemplateDict();
+    winux::uint64 dictBytes = store.getHotBytes() + store.getTemplateBytes() + dict->getBytes();
+    long dictRss = BenchAnonRssMBytes() - rss0;
+    rss0 = BenchAnonRssMBytes();
+    {
+        LogStore plain;
+        double plainSec = _Ingest( &plain, records, fields );
+        winux::uint64 plainBytes = plain.getHotBytes();
+        printf( "plain: %.0f rec/s, %.1f MB, anon RSS +%ld MB\n", BenchRate( records.size(), plainSec ), plainBytes / 1048576.0, BenchAnonRssMBytes() - rss0 );
+        printf( "dict:  %.0f rec/s, %.1f MB (templates %zu, %.1f KB), anon RSS +%ld MB, %.1fx smaller\n", BenchRate( records.size(), dictSec ), dictBytes / 1048576.0, dict->getCount(),
+            dict->getBytes() / 1024.0, dictRss, dictBytes > 0 ? (double)plainBytes / dictBytes : 0.0 );
+    }
+
+    // 解码后与原记录逐条比较
+    size_t bad = 0;
+    BenchTimer timer;
+    {
+        LogStore::Reader reader(store);
+        for ( size_t row = 0; row < records.size(); row++ )
+        {
+            LogTextRecord const & tr = reader[row];
+            LogTextRecord const & expect = records[row];
+            if ( tr.strContent != expect.strContent || tr.strContentSlashes != expect.strContentSlashes || tr.utcTimeMs != expect.utcTimeMs || tr.flag.value != expect.flag.value || tr.meta.value != expect.meta.value ) bad++;
+        }
+    }
+    printf( "decode: %.0f rec/s, %zu mismatched\n", BenchRate( records.size(), timer.seconds() ), bad );
+
+    // 同模板筛选只比较编号，对比按模板中的固定文本筛选
+    size_t probe = records.size() - 1;
+    while ( probe > 0 && ( store.getTemplateId(probe) == 0 || records[probe].strContent.empty() ) ) probe--; // 丢包超时的记录可能没有内容
+    winux::uint32 id = store.getTemplateId(probe);
+    if ( id != 0 )
+    {
+        winux::Utf8String const & content = records[probe].strContent;
+        size_t begin = content.find("] "), end = content.find(" id=");
+        _RunFilter( store, new LogTemplateFilter( id, dict->getTemplateText(id) ) );
+        LogCondFilter * cond = new LogCondFilter();
+        cond->text = begin != winux::Utf8String::npos && end != winux::Utf8String::npos && end > begin ? content.substr( begin + 2, end - begin - 2 ) : content;
+        _RunFilter( store, cond );
+    }
+    return 0;
+}
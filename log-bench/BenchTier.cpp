@@ -0,0 +1,102 @@
+﻿#include "Bench.h"
+#include <random>
+#include <thread>
+#include "LogExprFilter.h"
+#include "LogParallelScan.h"
+
+int BenchTier( int argc, char * argv[] )
+{
+    size_t rows = BenchArg( argc, argv, 1, 5000000 );
+    winux::uint64 hotBytes = BenchArg( argc, argv, 2, 256 ) * 1024 * 1024;
+    winux::String coldPath = argc > 3 ? winux::String( argv[3], argv[3] + strlen(argv[3]) ) : winux::String( $T("log-bench.cold") );
+    LogStore store;
+    if ( !store.setTiering( coldPath, hotBytes ) )
+    {
+        fprintf( stderr, "无法创建冷块文件\n" );
+        return 1;
+    }
+
+    // 追加，中途取快照在后台线程扫描，同时继续追加和换出
+    std::thread scanner;
+    size_t snapRows = 0, snapFound = 0;
+    BenchTimer timer;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        store.append( BenchMakeRecord(i) );
+        if ( i == rows / 2 )
+        {
+            LogStore snap = store;
+            snapRows = snap.size();
+            scanner = std::thread( [snap, &snapFound] () {
+                LogStore::Reader reader(snap);
+                for ( size_t row = snap.getFirstRow(); row < snap.size(); row++ )
+                {
+                    if ( reader[row].strContent.find("timeout") != winux::Utf8String::npos ) snapFound++;
+                }
+            } );
+        }
+        if ( ( i + 1 ) % ( rows / 10 > 0 ? rows / 10 : 1 ) == 0 )
+        {
+            printf( "%zu rows: %.0f rec/s, hot %.1f MB, loaded blocks %zu/%zu, cold file %.1f MB, anon RSS %ld MB\n", i + 1, BenchRate( i + 1, timer.seconds() ), store.getHotBytes() / 1048576.0,
+                store.getLoadedBlocks(), ( store.size() + LogStore::BlockRecords - 1 ) / LogStore::BlockRecords, winux::FileSize(coldPath) / 1048576.0, BenchAnonRssMBytes() );
+            fflush(stdout);
+        }
+    }
+    printf( "ingest: %.0f rec/s, logical %.1f MB\n", BenchRate( rows, timer.seconds() ), store.getBytes() / 1048576.0 );
+    if ( scanner.joinable() ) scanner.join();
+    printf( "snapshot scan of %zu rows while ingesting: %zu matched\n", snapRows, snapFound );
+
+    // 随机访问换入
+    std::mt19937_64 rng(1);
+    size_t bad = 0;
+    timer.restart();
+    for ( int k = 0; k < 2000; k++ )
+    {
+        size_t row = rng() % rows;
+        LogTextRecord expect = BenchMakeRecord(row);
+        LogTextRecord const & tr = store[row];
+        if ( tr.strContent != expect.strContent || tr.utcTimeMs != expect.utcTimeMs || tr.flag.value != expect.flag.value ) bad++;
+        if ( k % 50 == 49 ) store.trim();
+    }
+    printf( "random access: %.2f ms/row, %zu mismatched, hot %.1f MB\n", timer.seconds() * 1000 / 2000, bad, store.getHotBytes() / 1048576.0 );
+
+    // 全量并行扫描，冷块只在读取器内临时解压
+    winux::ThreadPool pool( (int)std::max( std::thread::hardware_concurrency(), 1u ) );
+    winux::SharedPointer<LogFilter> filter( new LogExprFilter( "contains(text, \"timeout\")" ) );
+    std::vector<winux::uint32> matched;
+    timer.restart();
+    {
+        LogParallelScan scan( &pool, store, filter );
+        scan.start();
+        scan.wait();
+        scan.takeRows(&matched);
+    }
+    double scanSec = timer.seconds();
+    size_t expected = 0;
+    {
+        LogStore::Reader reader(store);
+        for ( size_t row = 0; row < rows; row++ )
+        {
+            if ( reader[row].strContent.find("timeout") != winux::Utf8String::npos ) expected++;
+        }
+    }
+    printf( "parallel scan: %.0f rows/s, %zu matched (%s), loaded blocks %zu, anon RSS %ld MB\n", BenchRate( rows, scanSec ), matched.size(), matched.size() == expected ? "ok" : "MISMATCH",
+        store.getLoadedBlocks(), BenchAnonRssMBytes() );
+
+    // 时间范围只换入边界块
+    winux::uint64 t0 = BenchMakeRecord( rows / 3 ).utcTimeMs;
+    size_t rangeRows = 0;
+    store.forEachTimeRange( t0, t0 + 3000, [&rangeRows] ( size_t begin, size_t end ) { rangeRows += end - begin; } );
+    printf( "time range: %zu rows (expect 1000)\n", rangeRows );
+
+    // 按时间淘汰，最早的块早已换出到冷块文件
+    LogRetention retention;
+    retention.maxAgeMs = BenchMakeRecord( rows - 1 ).utcTimeMs - BenchMakeRecord( rows / 2 ).utcTimeMs;
+    store.setRetention(retention);
+    printf( "age retention: first row %zu (expect about %zu)\n", store.getFirstRow(), rows / 2 );
+
+    store.clear();
+    store.setTiering( winux::String(), 0 );
+    printf( "cold file removed: %s\n", winux::DetectPath(coldPath) ? "no" : "yes" );
+    return bad == 0 && matched.size() == expected ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+﻿#include "Bench.h"
+
+// 生成大约bytes字节的UTF-8文本，cjk为true时以中文为主
+static winux::Utf8String _MakeText( size_t bytes, bool cjk )
+{
+    char const * line = cjk ? u8"数据库连接超时，正在重试第3次，请检查网络配置。\n" : "[pid:1234, tid:5678] - request /api/v1/items?id=42 done in 12ms\n";
+    winux::Utf8String text;
+    while ( text.length() < bytes ) text += line;
+    return text;
+}
+
+// 转成指定字节序的UTF-16字节数据，作为接收到的日志数据
+static winux::Buffer _ToUtf16Bytes( winux::Utf8String const & text, bool isBigEndian )
+{
+    winux::Utf16String u = winux::UnicodeConverter(text).toUtf16();
+    if ( isBigEndian != winux::IsBigEndian() && u.length() > 0 ) winux::InvertByteOrderArray( &u[0], u.length() );
+    return winux::Buffer(u);
+}
+
+static void _Run( char const * name, winux::Utf8String const & text, int times )
+{
+    double mb = text.length() * (double)times / 1048576;
+    size_t sink = 0;
+    for ( bool be : { false, true } )
+    {
+        winux::Buffer data = _ToUtf16Bytes( text, be );
+
+        // 解码：原来的toString<char16>()、翻转字节序、UnicodeConverter三遍拷贝
+        BenchTimer timer;
+        for ( int i = 0; i < times; i++ )
+        {
+            winux::Utf16String u = data.toString<winux::char16>();
+            if ( be != winux::IsBigEndian() && u.length() > 0 ) winux::InvertByteOrderArray( &u[0], u.length() );
+            sink += winux::UnicodeConverter(u).toUtf8().length();
+        }
+        double oldDecode = timer.seconds();
+        timer.restart();
+        for ( int i = 0; i < times; i++ ) sink += winux::Utf16BytesToUtf8( data, be ).length();
+        double newDecode = timer.seconds();
+
+        // 编码：UnicodeConverter再翻转字节序，对比一遍完成的Utf8ToUtf16Bytes()
+        timer.restart();
+        for ( int i = 0; i < times; i++ )
+        {
+            winux::Utf16String u = winux::UnicodeConverter(text).toUtf16();
+            if ( be != winux::IsBigEndian() && u.length() > 0 ) winux::InvertByteOrderArray( &u[0], u.length() );
+            sink += u.length();
+        }
+        double oldEncode = timer.seconds();
+        timer.restart();
+        for ( int i = 0; i < times; i++ ) sink += winux::Utf8ToUtf16Bytes( text, be ).getSize();
+        double newEncode = timer.seconds();
+
+        printf( "%s %s: decode UnicodeConverter %.0f MB/s, Utf16BytesToUtf8 %.0f MB/s | encode UnicodeConverter %.0f MB/s, Utf8ToUtf16Bytes %.0f MB/s\n",
+            name, be ? "BE" : "LE",
+            BenchRate( mb, oldDecode ), BenchRate( mb, newDecode ),
+            BenchRate( mb, oldEncode ), BenchRate( mb, newEncode )
+        );
+    }
+    if ( sink == 0 ) printf( "\n" );
+}
+
+int BenchUtf16( int argc, char * argv[] )
+{
+    size_t bytes = BenchArg( argc, argv, 1, 1 << 20 );
+    int times = (int)BenchArg( argc, argv, 2, 200 );
+    _Run( "ascii", _MakeText( bytes, false ), times );
+    _Run( "cjk", _MakeText( bytes, true ), times );
+    return 0;
+}
@@ -0,0 +1,37 @@
+﻿// 无界面的后端基准测试：各命令分别测量编码转换、搜索、筛选、导出、CSV解析、分层存储、模板字典等的吞吐，输出可重复对比的数字
+// 用法：log-bench <命令> [参数...]，不带参数运行列出全部命令
+// Linux下编译：g++ -std=c++17 -O2 -I../main -I<fastdo各组件include> *.cpp <main下无界面的Log*.cpp> <winux、eienexpr、eiennet、eienlog库> -lpthread -ldl
+#include "Bench.h"
+
+static struct
+{
+    char const * name;
+    BenchCommand command;
+    char const * usage;
+} const _Commands[] = {
+    { "utf16", BenchUtf16, "[字节数=1048576] [次数=200]    UTF-16与UTF-8互转：UnicodeConverter对比一遍转换" },
+    { "search", BenchSearch, "[行数=2000000]    全文索引：维护索引的追加开销，子串和单词查询对比逐行匹配" },
+    { "expr", BenchExpr, "[行数=2000000]    表达式筛选：预绑定字段槽的单线程求值速度，对比每行写入VarContext" },
+    { "parallel", BenchParallel, "[行数=4000000] [最多线程数=CPU核数]    并行筛选：按线程数翻倍统计加速比、首批结果时间和取消耗时" },
+    { "export", BenchExport, "[行数=1000000] [输出文件=log-bench-export.csvlog]    csvlog导出：原来的内存拼接方式对比流式导出，并统计导出期间追加的行数" },
+    { "csv-parse", BenchCsvParse, "[行数=1000000] [线程数=CPU核数]    CSV解析：CsvReader对比只记录字段位置的CsvFieldSpans，各自顺序和并行解析" },
+    { "csv-scan", BenchCsvScan, "[行数=2000000] [遍数=5]    CSV结构字符扫描：逐字符循环对比StrFindChars，含记录边界、字段结构和是否需要引号" },
+    { "tier", BenchTier, "[行数=5000000] [热数据MB=256] [冷块文件=log-bench.cold]    分层存储：生成大量日志时的追加速度和内存，换入、并行扫描、按时间范围和按时间淘汰" },
+    { "sort", BenchSort, "[行数=2000000] [线程数=CPU核数]    排序：后台排序时界面线程轮询的耗时，以及之后分批追加的行并入排序结果的耗时" },
+    { "template", BenchTemplate, "[行数=500000] [抓包文件=log-bench.eiencap] [回放速度=1，0为尽快]    模板字典：回放抓包（不存在时先用合成日志生成），对比启用前后的追加速度和内存，校验解码并对比同模板筛选和文本筛选" },
+};
+
+int main( int argc, char * argv[] )
+{
+    if ( argc > 1 )
+    {
+        for ( auto && cmd : _Commands )
+        {
+            if ( strcmp( argv[1], cmd.name ) == 0 ) return cmd.command( argc - 1, argv + 1 );
+        }
+        fprintf( stderr, "未知命令：%s\n", argv[1] );
+    }
+    fprintf( stderr, "用法：log-bench <命令> [参数...]\n" );
+    for ( auto && cmd : _Commands ) fprintf( stderr, "  %s %s\n", cmd.name, cmd.usage );
+    return 2;
+}
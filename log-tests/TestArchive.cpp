@@ -0,0 +1,130 @@
+﻿#include "Tests.h"
+#include "LogArchiveFile.h"
+
+// 检查打开后加载的记录
+static int _CheckRows( LogArchiveFile & archive, size_t begin, size_t end )
+{
+    int failed = 0;
+    TEST_CHECK( archive.getFirstRow() == begin );
+    TEST_CHECK( archive.getRowCount() == end - begin );
+    std::vector<LogTextRecord> records;
+    archive.loadRecords( 0, archive.getRowCount(), &records );
+    TEST_CHECK( records.size() == end - begin );
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord expect = TestMakeRecord( begin + i );
+        if ( records[i].strContent != expect.strContent || records[i].utcTimeMs != expect.utcTimeMs || records[i].flag.value != expect.flag.value || records[i].meta.value != expect.meta.value )
+        {
+            TEST_CHECK( !"记录内容不一致" );
+            break;
+        }
+    }
+    return failed;
+}
+
+int TestArchive()
+{
+    int failed = 0;
+    size_t const rows = eienlog::LogArchiveWriter::BlockRows * 3 + 500;
+    winux::String path = TestTempPath("archive.eienlog");
+    winux::String truncPath = TestTempPath("truncated.eienlog");
+    winux::RemovePath(path);
+    TEST_CHECK( LogArchiveFile::IsArchivePath(path) );
+
+    // 分两次追加，第二次打开已有文件接着写
+    size_t const half = rows / 2;
+    for ( size_t begin = 0; begin < rows; begin += half )
+    {
+        LogArchiveSpill spill;
+        TEST_CHECK( spill.open(path) );
+        std::vector<LogTextRecord> records;
+        for ( size_t i = begin; i < rows && i < begin + half; i++ ) records.push_back( TestMakeRecord(i) );
+        spill.evictRecords( begin, records );
+        TEST_CHECK( spill.getRowCount() == begin + records.size() );
+    }
+
+    // 全部、行区间、时间区间
+    {
+        LogArchiveFile archive;
+        TEST_CHECK( archive.open(path) );
+        TEST_CHECK( archive.getFileRowCount() == rows );
+        failed += _CheckRows( archive, 0, rows );
+    }
+    {
+        LogArchiveFile archive;
+        TEST_CHECK( archive.open( path, LogRange( LogRange::lrRows, 9000, 20000 ) ) );
+        failed += _CheckRows( archive, 9000, 20000 );
+    }
+    {
+        LogArchiveFile archive;
+        TEST_CHECK( archive.open( path, LogRange( LogRange::lrTime, TestMakeRecord(300).utcTimeMs, TestMakeRecord(17000).utcTimeMs ) ) );
+        failed += _CheckRows( archive, 300, 17000 );
+    }
+
+    // 写入中途崩溃：截掉尾部和最后一块的一部分，按块头恢复出完整的块
+    winux::Buffer content;
+    {
+        winux::File file;
+        TEST_CHECK( file.open( path, $T("rb") ) );
+        content = file.buffer(false);
+    }
+    size_t lastBlockRows;
+    {
+        eienlog::LogArchiveReader reader;
+        TEST_CHECK( reader.open(path) );
+        eienlog::LogArchiveIndexEntry const & last = reader.getBlockInfo( reader.getBlockCount() - 1 );
+        lastBlockRows = last.rows;
+        winux::Buffer truncated( content.getBuf(), (size_t)last.offset + sizeof(eienlog::LogArchiveBlockHeader) + 10 );
+        TEST_CHECK( winux::FilePutContentsEx( truncPath, truncated, false ) );
+    }
+    {
+        LogArchiveFile archive;
+        TEST_CHECK( archive.open(truncPath) );
+        failed += _CheckRows( archive, 0, rows - lastBlockRows );
+    }
+
+    // 尾部完好但索引损坏：偏移越界、指到块中间、行数或首行与块头不一致时按块头扫描恢复
+    {
+        eienlog::LogArchiveTrailer trailer;
+        memcpy( &trailer, content.getBuf<char>() + content.getSize() - sizeof(trailer), sizeof(trailer) );
+        for ( int corrupt = 0; corrupt < 5; corrupt++ )
+        {
+            winux::Buffer bad( content.getBuf(), content.getSize() );
+            eienlog::LogArchiveIndexEntry * index = (eienlog::LogArchiveIndexEntry *)( bad.getBuf<char>() + trailer.indexOffset );
+            size_t end = rows;
+            if ( corrupt == 0 ) index[0].offset = 0xFFFFFFFFFFULL; // 越界
+            else if ( corrupt == 1 ) index[0].offset += 8; // 不是块头
+            else if ( corrupt == 2 ) index[1].rows++; // 行数不一致
+            else if ( corrupt == 3 ) index[1].firstRow = 0; // 首行不连续
+            else // 第二块的块头也损坏，只能恢复出第一块
+            {
+                ( (eienlog::LogArchiveBlockHeader *)( bad.getBuf<char>() + index[1].offset ) )->zipSize = 0xFFFFFFF0;
+                index[1].offset = 1;
+                end = index[0].rows;
+            }
+            TEST_CHECK( winux::FilePutContentsEx( truncPath, bad, false ) );
+
+            eienlog::LogArchiveReader reader;
+            TEST_CHECK( reader.open(truncPath) );
+            TEST_CHECK( reader.getRowCount() == end );
+            std::vector<eienlog::LogRecord> records;
+            TEST_CHECK( reader.readBlock( 0, &records ) && records.size() == index[0].rows );
+            TEST_CHECK( !reader.readBlock( reader.getBlockCount(), &records ) );
+            reader.close();
+            LogArchiveFile archive;
+            TEST_CHECK( archive.open(truncPath) );
+            failed += _CheckRows( archive, 0, end );
+        }
+    }
+
+    // 不是归档文件
+    {
+        TEST_CHECK( winux::FilePutContentsEx( truncPath, winux::Buffer( "not an archive file", 19, true ), false ) );
+        LogArchiveFile archive;
+        TEST_CHECK( !archive.open(truncPath) );
+    }
+
+    winux::RemovePath(path);
+    winux::RemovePath(truncPath);
+    return failed;
+}
@@ -0,0 +1,103 @@
+﻿#include "Tests.h"
+
+// 第i个测试封包：固定大小，日志空间只用了一部分，末尾补零，部分封包中间也有零字节
+static winux::Buffer _MakeChunk( size_t i, size_t chunkSize )
+{
+    winux::Buffer chunk;
+    chunk.alloc(chunkSize);
+    memset( chunk.getBuf(), 0, chunkSize );
+    size_t used = 1 + ( i * 37 ) % chunkSize;
+    for ( size_t k = 0; k < used; k++ ) chunk.get<winux::byte>()[k] = (winux::byte)( i % 5 == 0 && k % 9 == 0 ? 0 : 1 + ( i + k ) % 255 );
+    return chunk;
+}
+
+// 第i个封包的接收时间(us)
+static winux::uint64 _ChunkTime( size_t i )
+{
+    return 5000000 + i * 150 + ( i % 4 ) * 20;
+}
+
+// 顺序读出全部封包，与写入的比较，返回读出的封包数
+static size_t _ReadChunks( eienlog::LogCaptureReader & capture, size_t chunkSize, int * failedPtr )
+{
+    int & failed = *failedPtr;
+    size_t count = 0;
+    winux::uint64 time;
+    winux::Buffer chunk;
+    while ( capture.next( &time, &chunk ) )
+    {
+        if ( !( chunk == _MakeChunk( count, chunkSize ) ) || time != _ChunkTime(count) - _ChunkTime(0) )
+        {
+            TEST_CHECK( !"封包内容或接收时间不一致" );
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+int TestCapture()
+{
+    int failed = 0;
+    winux::String path = TestTempPath("traffic.eiencap");
+    winux::String truncPath = TestTempPath("traffic-trunc.eiencap");
+    size_t const chunks = 3000, chunkSize = 512;
+
+    // 写入：末尾的零字节不保存，超过缓冲大小时分多次写入文件
+    {
+        eienlog::LogCaptureWriter capture;
+        TEST_CHECK( capture.open( path, (winux::uint16)chunkSize ) );
+        for ( size_t i = 0; i < chunks; i++ ) TEST_CHECK( capture.write( _MakeChunk( i, chunkSize ).getBuf(), chunkSize, _ChunkTime(i) ) );
+        TEST_CHECK( capture.getChunkCount() == chunks );
+        TEST_CHECK( capture.getChunkBytes() == chunks * chunkSize );
+        TEST_CHECK( capture.close() );
+    }
+    TEST_CHECK( winux::FileSize(path) < chunks * chunkSize * 2 / 3 );
+
+    // 读取：文件头记下封包数和时长，封包补齐到原来的大小，回到开头可以再读一遍
+    {
+        eienlog::LogCaptureReader capture;
+        TEST_CHECK( capture.open(path) );
+        eienlog::LogCaptureHeader const & hdr = capture.getHeader();
+        TEST_CHECK( hdr.version == LOG_CAPTURE_VERSION );
+        TEST_CHECK( hdr.chunkSize == chunkSize );
+        TEST_CHECK( hdr.chunkCount == chunks );
+        TEST_CHECK( hdr.duration == _ChunkTime( chunks - 1 ) - _ChunkTime(0) );
+        TEST_CHECK( _ReadChunks( capture, chunkSize, &failed ) == chunks );
+        capture.rewind();
+        TEST_CHECK( _ReadChunks( capture, chunkSize, &failed ) == chunks );
+    }
+
+    // 写入中途崩溃：文件头未写回，最后一个封包不完整，读出之前完整的封包
+    {
+        winux::Buffer content;
+        {
+            winux::File file;
+            TEST_CHECK( file.open( path, $T("rb") ) );
+            content = file.buffer(false);
+        }
+        winux::Buffer truncated( content.getBuf(), content.getSize() - 3 );
+        eienlog::LogCaptureHeader hdr;
+        memcpy( &hdr, truncated.getBuf(), sizeof(hdr) );
+        hdr.chunkCount = 0;
+        hdr.duration = 0;
+        memcpy( truncated.getBuf(), &hdr, sizeof(hdr) );
+        TEST_CHECK( winux::FilePutContentsEx( truncPath, truncated, false ) );
+
+        eienlog::LogCaptureReader capture;
+        TEST_CHECK( capture.open(truncPath) );
+        TEST_CHECK( capture.getHeader().chunkCount == 0 );
+        TEST_CHECK( _ReadChunks( capture, chunkSize, &failed ) == chunks - 1 );
+    }
+
+    // 不是抓包文件
+    {
+        TEST_CHECK( winux::FilePutContentsEx( truncPath, winux::Buffer( "not a capture", 13, true ), false ) );
+        eienlog::LogCaptureReader capture;
+        TEST_CHECK( !capture.open(truncPath) );
+    }
+
+    winux::RemovePath(path);
+    winux::RemovePath(truncPath);
+    return failed;
+}
@@ -0,0 +1,103 @@
+﻿#include "Tests.h"
+#include "LogColdFile.h"
+
+// 部分记录带有折叠次数、不同的内容大小、不由内容转义的转义内容、不由时间格式化的时间字符串
+static LogTextRecord _MakeColdRecord( size_t i )
+{
+    LogTextRecord tr = TestMakeRecord(i);
+    if ( i % 50 == 0 )
+    {
+        tr.repeatCount = 3;
+        tr.lastTimeMs = tr.utcTimeMs + 25;
+    }
+    if ( i % 61 == 0 ) tr.contentSize = 7;
+    if ( i % 89 == 0 ) tr.strContentSlashes = tr.strContent;
+    if ( i % 101 == 0 ) tr.strContentSlashes = "escaped";
+    if ( i % 103 == 0 ) tr.utcTime = "custom time";
+    return tr;
+}
+
+int TestColdFile()
+{
+    int failed = 0;
+    winux::String path = TestTempPath("store.cold");
+
+    // 直接读写：每块写入后按偏移和大小读回
+    {
+        LogColdFile cold;
+        TEST_CHECK( cold.open(path) );
+        std::vector<winux::uint64> offsets;
+        std::vector<winux::uint32> sizes;
+        for ( size_t b = 0; b < 3; b++ )
+        {
+            std::vector<LogTextRecord> records;
+            for ( size_t i = 0; i < 1000; i++ ) records.push_back( _MakeColdRecord( b * 1000 + i ) );
+            winux::uint64 offset;
+            winux::uint32 size;
+            TEST_CHECK( cold.write( records, &offset, &size ) );
+            offsets.push_back(offset);
+            sizes.push_back(size);
+        }
+        TEST_CHECK( cold.getSize() == offsets.back() + sizes.back() );
+        for ( size_t b = 3; b-- > 0; )
+        {
+            std::vector<LogTextRecord> records;
+            TEST_CHECK( cold.read( offsets[b], sizes[b], &records ) );
+            TEST_CHECK( records.size() == 1000 );
+            for ( size_t i = 0; i < records.size(); i++ )
+            {
+                LogTextRecord expect = _MakeColdRecord( b * 1000 + i );
+                LogTextRecord const & tr = records[i];
+                if ( tr.strContent != expect.strContent || tr.strContentSlashes != expect.strContentSlashes || tr.contentSize != expect.contentSize || tr.utcTime != expect.utcTime || tr.utcTimeMs != expect.utcTimeMs ||
+                    tr.flag.value != expect.flag.value || tr.meta.value != expect.meta.value || tr.repeatCount != expect.repeatCount || tr.lastTimeMs != expect.lastTimeMs )
+                {
+                    TEST_CHECK( !"记录内容不一致" );
+                    break;
+                }
+            }
+        }
+        cold.close();
+        TEST_CHECK( !winux::DetectPath(path) ); // 关闭时删除
+    }
+
+    // 分层存储：热数据超出上限的块换出，经Reader和operator[]读回
+    size_t const rows = LogStore::BlockRecords * 40;
+    LogStore store;
+    TEST_CHECK( store.setTiering( path, 1024 * 1024 ) );
+    for ( size_t i = 0; i < rows; i++ ) store.append( TestMakeRecord(i) );
+    store.trim();
+    TEST_CHECK( store.getLoadedBlocks() < rows / LogStore::BlockRecords );
+    TEST_CHECK( winux::FileSize(path) > 0 );
+    {
+        LogStore::Reader reader(store);
+        for ( size_t row = 0; row < rows; row += 37 )
+        {
+            if ( reader[row].strContent != TestMakeRecord(row).strContent )
+            {
+                TEST_CHECK( !"Reader读到的记录不一致" );
+                break;
+            }
+        }
+    }
+
+    // 按时间区间遍历时，换出的边界块只在读取器内临时解压
+    size_t loadedBlocks = store.getLoadedBlocks();
+    size_t rangeRows = 0;
+    store.forEachTimeRange( TestMakeRecord(100).utcTimeMs, TestMakeRecord(9000).utcTimeMs, [&rangeRows] ( size_t begin, size_t end ) { rangeRows += end - begin; } );
+    TEST_CHECK( rangeRows == 8900 );
+    TEST_CHECK( store.getLoadedBlocks() == loadedBlocks );
+
+    TEST_CHECK( store[5].strContent == TestMakeRecord(5).strContent );
+
+    // 最早的块已换出，按时间淘汰仍然生效
+    LogRetention retention;
+    retention.maxAgeMs = TestMakeRecord( rows - 1 ).utcTimeMs - TestMakeRecord( rows / 2 ).utcTimeMs;
+    store.setRetention(retention);
+    TEST_CHECK( store.getFirstRow() >= rows / 2 - LogStore::BlockRecords && store.getFirstRow() <= rows / 2 );
+    TEST_CHECK( store[ store.getFirstRow() ].strContent == TestMakeRecord( store.getFirstRow() ).strContent );
+
+    store.clear();
+    store.setTiering( winux::String(), 0 );
+    TEST_CHECK( !winux::DetectPath(path) );
+    return failed;
+}
@@ -0,0 +1,132 @@
+﻿#include "Tests.h"
+#include "LogCsvFile.h"
+#include "LogCsvExporter.h"
+
+// 写一个rows行的csvlog文件
+static bool _WriteCsvLog( winux::String const & path, size_t rows )
+{
+    winux::Utf8String text = "\xef\xbb\xbf";
+    for ( size_t i = 0; i < rows; i++ ) LogCsvExporter::FormatRecord( TestMakeRecord(i), &text );
+    winux::File file;
+    return file.open( path, $T("wb") ) && file.write( text.c_str(), text.size() ) == text.size();
+}
+
+// 检查按行区间打开后加载的记录
+static int _CheckRows( LogCsvFile & csv, size_t begin, size_t end )
+{
+    int failed = 0;
+    TEST_CHECK( csv.getFirstRow() == begin );
+    TEST_CHECK( csv.getRowCount() == end - begin );
+    std::vector<LogTextRecord> records;
+    csv.loadRecords( 0, csv.getRowCount() + 10, &records ); // 超出部分不加载
+    TEST_CHECK( records.size() == end - begin );
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord expect = TestMakeRecord( begin + i );
+        if ( records[i].strContent != expect.strContent || records[i].utcTimeMs != expect.utcTimeMs || records[i].flag.value != expect.flag.value || records[i].meta.value != expect.meta.value )
+        {
+            TEST_CHECK( !"记录内容不一致" );
+            break;
+        }
+    }
+    return failed;
+}
+
+int TestCsvSparseIndex()
+{
+    int failed = 0;
+    size_t const rows = LogCsvFile::SparseRows * 3 + 100;
+    winux::String path = TestTempPath("sparse.csvlog");
+    winux::String idxPath = path + $T(".idx");
+    winux::RemovePath(path);
+    winux::RemovePath(idxPath);
+    TEST_CHECK( _WriteCsvLog( path, rows ) );
+
+    // 首次按范围打开建立并保存索引
+    {
+        LogCsvFile csv;
+        TEST_CHECK( csv.open( path, LogRange( LogRange::lrRows, 5000, 9000 ) ) );
+        TEST_CHECK( csv.getFileRowCount() == rows );
+        TEST_CHECK( csv.getSparseIndex().size() == 4 );
+        failed += _CheckRows( csv, 5000, 9000 );
+        TEST_CHECK( winux::DetectPath(idxPath) );
+
+        // 行号超出已加载的范围得到空记录
+        LogTextRecord tr;
+        csv.parseRecord( csv.getRowCount(), &tr );
+        TEST_CHECK( tr.strContent.empty() && tr.utcTimeMs == 0 );
+    }
+
+    // 再次打开读取索引，按时间区间定位
+    {
+        LogCsvFile csv;
+        TEST_CHECK( csv.open( path, LogRange( LogRange::lrTime, TestMakeRecord(100).utcTimeMs, TestMakeRecord(12000).utcTimeMs ) ) );
+        failed += _CheckRows( csv, 100, 12000 );
+    }
+
+    // 建立在csvlog上的存储：Reader和按级别查找只临时解析，不载入存储；operator[]载入的块由trim()按上限释放
+    {
+        winux::SharedPointer<LogCsvFile> csv( new LogCsvFile() );
+        TEST_CHECK( csv->open(path) );
+        LogStore store;
+        store.attachSource( csv, csv->getRowCount() );
+        {
+            LogStore::Reader reader(store);
+            size_t bad = 0;
+            for ( size_t row = 0; row < rows; row++ )
+            {
+                if ( reader[row].strContent != TestMakeRecord(row).strContent ) bad++;
+            }
+            TEST_CHECK( bad == 0 );
+        }
+        LogMetaQuery query;
+        query.severityMask = 1 << 2;
+        query.timeBegin = TestMakeRecord(5000).utcTimeMs;
+        query.timeEnd = TestMakeRecord(6000).utcTimeMs;
+        std::vector<winux::uint32> found;
+        store.findByMeta( query, &found );
+        TEST_CHECK( found.size() == 1000 / 6 && found.front() >= 5000 && found.back() < 6000 );
+        TEST_CHECK( store.getLoadedBlocks() == 0 );
+
+        TEST_CHECK( store[7].strContent == TestMakeRecord(7).strContent );
+        TEST_CHECK( store.getLoadedBlocks() == 1 );
+        store.trim();
+        TEST_CHECK( store.getLoadedBlocks() == 1 && store.getHotBytes() > 0 ); // 未超出上限
+    }
+
+    // 大小和修改时间未变但内容损坏的索引：偏移越界或不递增时重建
+    winux::Buffer idx;
+    {
+        winux::File file;
+        TEST_CHECK( file.open( idxPath, $T("rb") ) );
+        idx = file.buffer(false);
+    }
+    size_t const hdrSize = idx.getSize() - 4 * sizeof(LogCsvFile::SparseEntry);
+    for ( int corrupt = 0; corrupt < 3; corrupt++ )
+    {
+        winux::Buffer bad( idx.getBuf(), idx.getSize() );
+        LogCsvFile::SparseEntry * entries = (LogCsvFile::SparseEntry *)( bad.getBuf<char>() + hdrSize );
+        if ( corrupt == 0 ) entries[2].offset = 0xFFFFFFFFFFULL; // 越界
+        else if ( corrupt == 1 ) entries[2].offset = entries[1].offset; // 不递增
+        else entries[0].offset = 0; // 不是正文开头
+        {
+            winux::File file;
+            TEST_CHECK( file.open( idxPath, $T("wb") ) && file.write(bad) == bad.getSize() );
+        }
+        LogCsvFile csv;
+        TEST_CHECK( csv.open( path, LogRange( LogRange::lrRows, 8000, rows ) ) );
+        failed += _CheckRows( csv, 8000, rows );
+    }
+
+    // 重建后索引与最初的相同
+    {
+        winux::File file;
+        TEST_CHECK( file.open( idxPath, $T("rb") ) );
+        winux::Buffer rebuilt = file.buffer(false);
+        TEST_CHECK( rebuilt == idx );
+    }
+
+    winux::RemovePath(path);
+    winux::RemovePath(idxPath);
+    return failed;
+}
@@ -0,0 +1,48 @@
+﻿#include "Tests.h"
+
+int TestTemplateRetention()
+{
+    int failed = 0;
+    size_t const rows = LogStore::BlockRecords * 20;
+
+    // 启用模板字典后，写满的块编码存放，不再处于载入状态
+    LogStore store;
+    TEST_CHECK( store.setTemplateDict(true) );
+    for ( size_t i = 0; i < rows; i++ ) store.append( TestMakeRecord(i) );
+    store.trim();
+    TEST_CHECK( store.getTemplateDict()->getCount() > 0 );
+    TEST_CHECK( store.getTemplateBytes() > 0 );
+    TEST_CHECK( store.getTemplateId( rows - 1 ) != 0 ); // 模板首次出现的记录不编码
+
+    // 按时间淘汰对编码的块同样生效
+    LogRetention retention;
+    retention.maxAgeMs = TestMakeRecord( rows - 1 ).utcTimeMs - TestMakeRecord( rows / 2 ).utcTimeMs;
+    store.setRetention(retention);
+    TEST_CHECK( store.getFirstRow() >= rows / 2 - LogStore::BlockRecords && store.getFirstRow() <= rows / 2 );
+    TEST_CHECK( store.size() == rows );
+
+    // 剩下的行解码后与原记录一致，按模板查找只返回未淘汰的行
+    {
+        LogStore::Reader reader(store);
+        for ( size_t row = store.getFirstRow(); row < rows; row += 41 )
+        {
+            LogTextRecord const & tr = reader[row];
+            LogTextRecord expect = TestMakeRecord(row);
+            if ( tr.strContent != expect.strContent || tr.utcTimeMs != expect.utcTimeMs || tr.flag.value != expect.flag.value || tr.meta.value != expect.meta.value )
+            {
+                TEST_CHECK( !"解码的记录不一致" );
+                break;
+            }
+        }
+    }
+    std::vector<winux::uint32> found;
+    winux::uint32 id = store.getTemplateId( rows - 1 );
+    store.findByTemplate( id, 0, rows, &found );
+    TEST_CHECK( !found.empty() && found.front() >= store.getFirstRow() && found.back() == rows - 1 );
+
+    // 全部过期时只保留最后一块
+    retention.maxAgeMs = 1;
+    store.setRetention(retention);
+    TEST_CHECK( store.getFirstRow() == rows - LogStore::BlockRecords );
+    return failed;
+}
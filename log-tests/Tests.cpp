@@ -0,0 +1,21 @@
+﻿#include "Tests.h"
+
+LogTextRecord TestMakeRecord( size_t i )
+{
+    LogTextRecord tr;
+    tr.strContent = winux::FormatA( "[%u] request id=%u, \"quoted\", cost=%ums", (unsigned)( i % 97 ), (unsigned)i, (unsigned)( i * 7 % 1000 ) );
+    if ( i % 13 == 0 ) tr.strContent += "\nsecond line";
+    tr.contentSize = tr.strContent.size();
+    tr.strContentSlashes = winux::AddCSlashes(tr.strContent);
+    tr.utcTimeMs = 1700000000000ULL + i * 10;
+    tr.utcTime = winux::DateTimeL::FromMilliSec(tr.utcTimeMs).toString<char>();
+    if ( i % 7 == 0 ) tr.flag = eienlog::LogFlag( true, 0x001F, false, 0, eienlog::leUtf8, false );
+    else tr.flag = eienlog::LogFlag(eienlog::leUtf8);
+    tr.meta = eienlog::LogMeta( (eienlog::LogSeverity)( 1 + i % 6 ), (winux::uint8)( i % 16 ) );
+    return tr;
+}
+
+winux::String TestTempPath( char const * name )
+{
+    return winux::String( $T("log-tests-") ) + winux::String( name, name + strlen(name) );
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <cstdio>
+#include <cstring>
+#include "LogStore.h"
+
+/** \brief 测试函数，返回失败的检查数 */
+typedef int (* TestFunc)();
+
+/** \brief 检查条件，不成立时输出位置并计为一次失败，测试函数须有int型的局部变量failed */
+#define TEST_CHECK(cond) do { if ( !(cond) ) { fprintf( stderr, "%s:%d: 检查失败：%s\n", __FILE__, __LINE__, #cond ); failed++; } } while ( 0 )
+
+/** \brief 生成第i条测试日志，时间按i递增，部分记录带颜色、级别和类别 */
+LogTextRecord TestMakeRecord( size_t i );
+
+/** \brief 当前目录下的测试临时文件路径 */
+winux::String TestTempPath( char const * name );
+
+// 各格式的测试
+int TestCsvSparseIndex();
+int TestArchive();
+int TestColdFile();
+int TestTemplateRetention();
+int TestCapture();
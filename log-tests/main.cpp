@@ -0,0 +1,33 @@
+﻿// 无界面的后端格式测试：写入后读回csvlog稀疏索引、归档、冷存储文件、抓包文件等磁盘格式，检查内容一致以及损坏文件的处理
+// 用法：log-tests [测试名...]，不带参数运行全部测试，有失败时返回1
+// Linux下编译：g++ -std=c++17 -O2 -I../main -I<fastdo各组件include> *.cpp <main下无界面的Log*.cpp> <winux、eienexpr、eiennet、eienlog库> -lpthread -ldl
+#include "Tests.h"
+
+static struct
+{
+    char const * name;
+    TestFunc func;
+} const _Tests[] = {
+    { "csv-index", TestCsvSparseIndex },
+    { "archive", TestArchive },
+    { "cold-file", TestColdFile },
+    { "template-retention", TestTemplateRetention },
+    { "capture", TestCapture },
+};
+
+int main( int argc, char * argv[] )
+{
+    int failedTests = 0, runTests = 0;
+    for ( auto && test : _Tests )
+    {
+        bool selected = argc < 2;
+        for ( int i = 1; i < argc && !selected; i++ ) selected = strcmp( argv[i], test.name ) == 0;
+        if ( !selected ) continue;
+        int failed = test.func();
+        printf( "%s %s\n", failed ? "FAIL" : "ok  ", test.name );
+        runTests++;
+        if ( failed ) failedTests++;
+    }
+    printf( "%d/%d passed\n", runTests - failedTests, runTests );
+    return failedTests ? 1 : 0;
+}
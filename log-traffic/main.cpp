@@ -0,0 +1,240 @@
+﻿// 日志流量抓包与回放：无界面，抓取eienlog的原始分块封包存成文件，再按原速、倍速或尽快回放，用于可重复的性能测试
+// 用法：log-traffic capture <抓包文件> [地址=0.0.0.0] [端口=22345] [秒数=0] [封包数=0]
+//       log-traffic replay <抓包文件> [地址=127.0.0.1] [端口=22345] [速度=1|max] [次数=1]
+//       log-traffic info <抓包文件>
+//       log-traffic bench <抓包文件> [速度=max] [端口=22399]    本机回放给进程内的LogReader，统计重组记录的吞吐和丢失
+// Linux下编译：g++ -std=c++17 -O2 -I<fastdo各组件include> main.cpp <winux、eiennet、eienlog库> -lpthread -ldl
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "eienlog.hpp"
+
+static std::atomic<bool> _stop(false);
+
+static void _OnSignal( int )
+{
+    _stop = true;
+}
+
+static double _Seconds( winux::uint64 us )
+{
+    return us / 1000000.0;
+}
+
+// 命令行参数转成winux::String
+static winux::String _Arg( char const * s )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::LocalToUnicode(s);
+#else
+    return s;
+#endif
+}
+
+// 解析速度参数，max表示尽快发送
+static double _ParseSpeed( char const * s )
+{
+    return strcmp( s, "max" ) == 0 ? 0 : atof(s);
+}
+
+static int _Capture( int argc, char * argv[] )
+{
+    char const * path = argv[2];
+    char const * addr = argc > 3 ? argv[3] : "0.0.0.0";
+    winux::ushort port = (winux::ushort)( argc > 4 ? atoi(argv[4]) : 22345 );
+    time_t seconds = argc > 5 ? atoi(argv[5]) : 0;
+    winux::uint64 maxChunks = argc > 6 ? strtoull( argv[6], nullptr, 10 ) : 0;
+
+    eienlog::LogReader reader( _Arg(addr), port );
+    if ( reader.errNo() != 0 )
+    {
+        fprintf( stderr, "无法监听 %s:%u，错误码 %d\n", addr, port, reader.errNo() );
+        return 1;
+    }
+    eienlog::LogCaptureWriter capture;
+    if ( !capture.open( _Arg(path), reader.getChunkSize() ) )
+    {
+        fprintf( stderr, "无法创建 %s\n", path );
+        return 1;
+    }
+    fprintf( stderr, "抓包 %s:%u -> %s，Ctrl+C结束\n", addr, port, path );
+    winux::uint64 startTime = winux::GetUtcTimeMs();
+    winux::uint64 count = eienlog::CaptureChunks( &reader, &capture, seconds * 1000, maxChunks, &_stop );
+    winux::uint64 elapsed = winux::GetUtcTimeMs() - startTime;
+    winux::uint64 bytes = capture.getChunkBytes();
+    if ( !capture.close() )
+    {
+        fprintf( stderr, "写入 %s 失败\n", path );
+        return 1;
+    }
+    printf( "封包 %llu 个，%llu 字节，用时 %.3f 秒\n", (unsigned long long)count, (unsigned long long)bytes, elapsed / 1000.0 );
+    return 0;
+}
+
+static int _Replay( int argc, char * argv[] )
+{
+    char const * path = argv[2];
+    char const * addr = argc > 3 ? argv[3] : "127.0.0.1";
+    winux::ushort port = (winux::ushort)( argc > 4 ? atoi(argv[4]) : 22345 );
+    double speed = argc > 5 ? _ParseSpeed(argv[5]) : 1.0;
+    int times = argc > 6 ? atoi(argv[6]) : 1;
+
+    eienlog::LogCaptureReader capture;
+    if ( !capture.open( _Arg(path) ) )
+    {
+        fprintf( stderr, "%s 不是抓包文件\n", path );
+        return 1;
+    }
+    eienlog::LogWriter writer( _Arg(addr), port, capture.getHeader().chunkSize );
+    if ( writer.errNo() != 0 )
+    {
+        fprintf( stderr, "无法创建套接字，错误码 %d\n", writer.errNo() );
+        return 1;
+    }
+    for ( int i = 0; i < times && !_stop; i++ )
+    {
+        eienlog::LogReplayStats stats;
+        capture.rewind();
+        eienlog::ReplayCapture( &capture, &writer, speed, &stats, &_stop );
+        double sec = _Seconds(stats.elapsed);
+        printf(
+            "第%d次：封包 %llu 个，失败 %llu 个，用时 %.3f 秒，%.0f 包/秒，%.1f MB/秒，最大落后 %.3f 毫秒\n",
+            i + 1,
+            (unsigned long long)stats.chunkCount,
+            (unsigned long long)stats.failCount,
+            sec,
+            sec > 0 ? stats.chunkCount / sec : 0.0,
+            sec > 0 ? stats.chunkBytes / sec / 1048576 : 0.0,
+            stats.maxLag / 1000.0
+        );
+    }
+    return 0;
+}
+
+static int _Info( int argc, char * argv[] )
+{
+    char const * path = argv[2];
+    eienlog::LogCaptureReader capture;
+    if ( !capture.open( _Arg(path) ) )
+    {
+        fprintf( stderr, "%s 不是抓包文件\n", path );
+        return 1;
+    }
+    // 顺序读一遍，不依赖文件头里关闭时才写入的统计
+    winux::uint64 count = 0, bytes = 0, records = 0, lastTime = 0, maxGap = 0;
+    winux::uint64 time;
+    winux::Buffer chunk;
+    while ( capture.next( &time, &chunk ) )
+    {
+        if ( count > 0 && time - lastTime > maxGap ) maxGap = time - lastTime;
+        lastTime = time;
+        count++;
+        bytes += chunk.getSize();
+        if ( chunk.getSize() >= sizeof(eienlog::LogChunkHeader) && chunk.get<eienlog::LogChunk>()->index == 0 ) records++;
+    }
+    double sec = _Seconds(lastTime);
+    printf( "开始时间：%s\n", winux::DateTimeL::FromMilliSec( capture.getHeader().startTime / 1000 ).toString<char>().c_str() );
+    printf( "分块大小：%u\n", capture.getHeader().chunkSize );
+    printf( "封包：%llu 个，%llu 字节，文件 %llu 字节\n", (unsigned long long)count, (unsigned long long)bytes, (unsigned long long)capture.getFileSize() );
+    printf( "记录：%llu 条\n", (unsigned long long)records );
+    printf( "时长：%.3f 秒，平均 %.0f 包/秒，最大间隔 %.3f 毫秒\n", sec, sec > 0 ? count / sec : 0.0, maxGap / 1000.0 );
+    if ( capture.getHeader().chunkCount != count ) printf( "文件头记录的封包数为 %llu，抓包可能未正常结束\n", (unsigned long long)capture.getHeader().chunkCount );
+    return 0;
+}
+
+static int _Bench( int argc, char * argv[] )
+{
+    char const * path = argv[2];
+    double speed = argc > 3 ? _ParseSpeed(argv[3]) : 0;
+    winux::ushort port = (winux::ushort)( argc > 4 ? atoi(argv[4]) : 22399 );
+
+    eienlog::LogCaptureReader capture;
+    if ( !capture.open( _Arg(path) ) )
+    {
+        fprintf( stderr, "%s 不是抓包文件\n", path );
+        return 1;
+    }
+    winux::uint64 expected = 0;
+    winux::uint64 time;
+    winux::Buffer chunk;
+    while ( capture.next( &time, &chunk ) )
+    {
+        if ( chunk.getSize() >= sizeof(eienlog::LogChunkHeader) && chunk.get<eienlog::LogChunk>()->index == 0 ) expected++;
+    }
+    capture.rewind();
+
+    eienlog::LogReader reader( $T("127.0.0.1"), port, capture.getHeader().chunkSize );
+    eienlog::LogWriter writer( $T("127.0.0.1"), port, capture.getHeader().chunkSize );
+    if ( reader.errNo() != 0 || writer.errNo() != 0 )
+    {
+        fprintf( stderr, "无法监听本机端口 %u\n", port );
+        return 1;
+    }
+
+    // 接收线程重组记录，回放结束后等到再无封包为止
+    std::atomic<bool> sent(false);
+    winux::uint64 records = 0, dataBytes = 0, lastRecvTime = 0;
+    std::thread recvThread( [&] () {
+        eienlog::LogRecord record;
+        for ( ;; )
+        {
+            if ( reader.readRecord( &record, 200, 200 ) )
+            {
+                records++;
+                dataBytes += record.data.getSize();
+                lastRecvTime = winux::GetUtcTimeUs();
+            }
+            else if ( sent )
+            {
+                break;
+            }
+        }
+    } );
+
+    winux::uint64 startTime = winux::GetUtcTimeUs();
+    eienlog::LogReplayStats stats;
+    eienlog::ReplayCapture( &capture, &writer, speed, &stats, &_stop );
+    sent = true;
+    recvThread.join();
+
+    double sendSec = _Seconds(stats.elapsed);
+    double recvSec = _Seconds( lastRecvTime > startTime ? lastRecvTime - startTime : 0 );
+    printf( "发送：封包 %llu 个，用时 %.3f 秒，%.0f 包/秒\n", (unsigned long long)stats.chunkCount, sendSec, sendSec > 0 ? stats.chunkCount / sendSec : 0.0 );
+    printf( "接收：记录 %llu/%llu 条，丢失 %.2f%%，用时 %.3f 秒，%.0f 条/秒，%.1f MB/秒\n",
+        (unsigned long long)records,
+        (unsigned long long)expected,
+        expected > 0 ? 100.0 * ( expected - std::min( records, expected ) ) / expected : 0.0,
+        recvSec,
+        recvSec > 0 ? records / recvSec : 0.0,
+        recvSec > 0 ? dataBytes / recvSec / 1048576 : 0.0
+    );
+    return 0;
+}
+
+int main( int argc, char * argv[] )
+{
+    if ( argc < 3 )
+    {
+        fprintf( stderr,
+            "用法：log-traffic capture <抓包文件> [地址=0.0.0.0] [端口=22345] [秒数=0] [封包数=0]\n"
+            "      log-traffic replay <抓包文件> [地址=127.0.0.1] [端口=22345] [速度=1|max] [次数=1]\n"
+            "      log-traffic info <抓包文件>\n"
+            "      log-traffic bench <抓包文件> [速度=max] [端口=22399]\n"
+        );
+        return 2;
+    }
+    eiennet::SocketLib initSock;
+    signal( SIGINT, _OnSignal );
+    signal( SIGTERM, _OnSignal );
+
+    char const * cmd = argv[1];
+    if ( strcmp( cmd, "capture" ) == 0 ) return _Capture( argc, argv );
+    if ( strcmp( cmd, "replay" ) == 0 ) return _Replay( argc, argv );
+    if ( strcmp( cmd, "info" ) == 0 ) return _Info( argc, argv );
+    if ( strcmp( cmd, "bench" ) == 0 ) return _Bench( argc, argv );
+    fprintf( stderr, "未知命令：%s\n", cmd );
+    return 2;
+}
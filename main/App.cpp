@@ -56,6 +56,14 @@ void App::loadConfig()
         listenParams.updateTimeout = lparams.get( L"update_timeout", 300 ).toUInt64();
         listenParams.vScrollToBottom = lparams.get( L"vscroll_to_bottom", true ).toBool();
         listenParams.soundEffect = lparams.get( L"sound_effect", true ).toBool();
+        listenParams.maxRecords = lparams.get( L"max_records", 0 ).toUInt64();
+        listenParams.maxMBytes = lparams.get( L"max_mbytes", 0 ).toUInt64();
+        listenParams.maxAgeSec = lparams.get( L"max_age", 0 ).toUInt64();
+        listenParams.spillFile = winux::UnicodeConverter( lparams.get( L"spill_file", L"" ).toUnicode() ).toUtf8();
+        listenParams.hotMBytes = lparams.get( L"hot_mbytes", 0 ).toUInt64();
+        listenParams.coldFile = winux::UnicodeConverter( lparams.get( L"cold_file", L"" ).toUnicode() ).toUtf8();
+        listenParams.collapseMs = lparams.get( L"collapse_ms", 0 ).toUInt64();
+        listenParams.templateDict = lparams.get( L"template_dict", false ).toBool();
 
         this->appConfig.listenHistory.push_back( std::move(listenParams) );
     }
@@ -93,6 +101,14 @@ void App::saveConfig()
         lparams[L"update_timeout"] = listenParams.updateTimeout;
         lparams[L"vscroll_to_bottom"] = listenParams.vScrollToBottom;
         lparams[L"sound_effect"] = listenParams.soundEffect;
+        lparams[L"max_records"] = listenParams.maxRecords;
+        lparams[L"max_mbytes"] = listenParams.maxMBytes;
+        lparams[L"max_age"] = listenParams.maxAgeSec;
+        lparams[L"spill_file"] = winux::UnicodeConverter(listenParams.spillFile).toUnicode();
+        lparams[L"hot_mbytes"] = listenParams.hotMBytes;
+        lparams[L"cold_file"] = winux::UnicodeConverter(listenParams.coldFile).toUnicode();
+        lparams[L"collapse_ms"] = listenParams.collapseMs;
+        lparams[L"template_dict"] = listenParams.templateDict;
         listenHistory.add( std::move(lparams) );
     }
     auto & logFileHistory = jsonConfig[L"logfile_history"].createArray();
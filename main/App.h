@@ -13,6 +13,7 @@
 #include "winplus.hpp"
 #include "GraphicsInterface.h"
 #include "WindowInterface.h"
+#include "UiCommon.h"
 
 struct MainWindow;
 // 本应用程序
@@ -28,6 +29,29 @@ struct App
         time_t updateTimeout;
         bool vScrollToBottom; // 是否滚动到底
         bool soundEffect; // 是否有音效
+        winux::uint64 maxRecords; // 最多保留的日志条数，0不限
+        winux::uint64 maxMBytes; // 日志最多占用的内存（MB），0不限
+        winux::uint64 maxAgeSec; // 日志最长保留时间（秒），0不限
+        winux::Utf8String spillFile; // 淘汰的日志转存的归档文件，空表示直接丢弃
+        winux::uint64 hotMBytes; // 内存中保留的热数据（MB），超出时把冷块换出到冷块文件，0不分层
+        winux::Utf8String coldFile; // 冷块文件
+        winux::uint64 collapseMs; // 重复日志折叠的时间窗口（毫秒），0不折叠
+        bool templateDict; // 是否按模板字典编码日志内容
+
+        // 复制同一地址端口的窗口共用的设置，这些设置由该地址端口上的日志接收使用
+        void assignShared( ListenParams const & other )
+        {
+            this->waitTimeout = other.waitTimeout;
+            this->updateTimeout = other.updateTimeout;
+            this->maxRecords = other.maxRecords;
+            this->maxMBytes = other.maxMBytes;
+            this->maxAgeSec = other.maxAgeSec;
+            this->spillFile = other.spillFile;
+            this->hotMBytes = other.hotMBytes;
+            this->coldFile = other.coldFile;
+            this->collapseMs = other.collapseMs;
+            this->templateDict = other.templateDict;
+        }
 
         bool operator == ( ListenParams const & other ) const
         {
@@ -38,7 +62,15 @@ struct App
                 this->waitTimeout == other.waitTimeout &&
                 this->updateTimeout == other.updateTimeout &&
                 this->vScrollToBottom == other.vScrollToBottom &&
-                this->soundEffect == other.soundEffect
+                this->soundEffect == other.soundEffect &&
+                this->maxRecords == other.maxRecords &&
+                this->maxMBytes == other.maxMBytes &&
+                this->maxAgeSec == other.maxAgeSec &&
+                this->spillFile == other.spillFile &&
+                this->hotMBytes == other.hotMBytes &&
+                this->coldFile == other.coldFile &&
+                this->collapseMs == other.collapseMs &&
+                this->templateDict == other.templateDict
             ;
         }
     };
@@ -106,36 +138,3 @@ struct App
 };
 
 extern App g_app;
-
-// 渲染Tooltip
-static void HelpMarker(const char* desc)
-{
-    ImGui::TextDisabled("(?)");
-    if ( ImGui::BeginItemTooltip() )
-    {
-        ImGui::PushTextWrapPos(ImGui::GetFontSize() * 50.0f);
-        ImGui::TextUnformatted(desc);
-        ImGui::PopTextWrapPos();
-        ImGui::EndTooltip();
-    }
-}
-
-// Foreground color: R5G5B5
-inline static void _GetImVec4ColorFromColorR5G5B5( winux::uint16 fgColor, ImVec4 * color )
-{
-    float r = ( fgColor & 31 ) / 31.0f, g = ( ( fgColor >> 5 ) & 31 ) / 31.0f, b = ( ( fgColor >> 10 ) & 31 ) / 31.0f;
-    color->x = r;
-    color->y = g;
-    color->z = b;
-    color->w = 1.0f;
-}
-
-// Background color: R4G4B4
-inline static void _GetImVec4ColorFromColorR4G4B4( winux::uint16 bgColor, ImVec4 * color )
-{
-    float r = ( bgColor & 15 ) / 15.0f, g = ( ( bgColor >> 4 ) & 15 ) / 15.0f, b = ( ( bgColor >> 8 ) & 15 ) / 15.0f;
-    color->x = r;
-    color->y = g;
-    color->z = b;
-    color->w = 1.0f;
-}
@@ -0,0 +1,66 @@
+﻿#include "LogArchiveFile.h"
+
+// class LogArchiveFile -----------------------------------------------------------------------
+bool LogArchiveFile::open( winux::String const & path, LogRange const & range )
+{
+    _firstRow = 0;
+    _rowCount = 0;
+    if ( !_reader.open(path) ) return false;
+
+    winux::uint64 rows = _reader.getRowCount();
+    winux::uint64 rowBegin = 0, rowEnd = rows;
+    if ( range.type == LogRange::lrRows )
+    {
+        rowBegin = range.begin < rows ? range.begin : rows;
+        rowEnd = range.end != 0 && range.end < rows ? range.end : rows;
+    }
+    else if ( range.type == LogRange::lrTime )
+    {
+        rowBegin = _reader.findRowByTime(range.begin);
+        rowEnd = range.end != 0 ? _reader.findRowByTime(range.end) : rows;
+    }
+    if ( rowEnd > rowBegin )
+    {
+        _firstRow = (size_t)rowBegin;
+        _rowCount = (size_t)( rowEnd - rowBegin );
+    }
+    return true;
+}
+
+void LogArchiveFile::loadRecords( size_t first, size_t count, std::vector<LogTextRecord> * records )
+{
+    std::vector<eienlog::LogRecord> logRecords;
+    _reader.readRecords( _firstRow + first, count, &logRecords );
+    for ( auto && record : logRecords )
+    {
+        LogTextRecord tr;
+        LogRecordToText( record, &tr );
+        records->push_back( std::move(tr) );
+    }
+    // 块损坏时补足空记录，保持行数与索引一致
+    for ( size_t i = logRecords.size(); i < count; i++ )
+    {
+        LogTextRecord tr;
+        tr.contentSize = 0;
+        tr.utcTimeMs = 0;
+        records->push_back( std::move(tr) );
+    }
+}
+
+bool LogArchiveFile::IsArchivePath( winux::String const & path )
+{
+    winux::String extName;
+    winux::FileTitle( path, &extName );
+    return winux::StrLower(extName) == $T("eienlog");
+}
+
+// class LogArchiveSpill ----------------------------------------------------------------------
+void LogArchiveSpill::evictRecords( size_t firstRow, std::vector<LogTextRecord> const & records )
+{
+    eienlog::LogRecord record;
+    for ( auto && tr : records )
+    {
+        LogTextToRecord( tr, &record );
+        _writer.write(record);
+    }
+}
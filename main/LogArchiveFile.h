@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief .eienlog归档文件，按需解压记录
+ *
+ *  打开时只读取块索引，记录在LogStore首次访问其所在的块时才解压并转换成文本记录。
+ *  按范围打开时由块索引定位范围，范围之外的块不解压。 */
+class LogArchiveFile : public LogBlockSource
+{
+public:
+    LogArchiveFile() : _firstRow(0), _rowCount(0) { }
+
+    /** \brief 打开归档文件，不是归档文件返回false
+     *
+     *  \param path 文件路径
+     *  \param range 要加载的范围。时间范围按块的最晚时间定位，时间基本有序时结果准确 */
+    bool open( winux::String const & path, LogRange const & range = LogRange() );
+
+    /** \brief 已加载的记录数 */
+    size_t getRowCount() const { return _rowCount; }
+
+    /** \brief 已加载的第一条记录在文件中的行号 */
+    size_t getFirstRow() const { return _firstRow; }
+
+    /** \brief 文件的总行数 */
+    size_t getFileRowCount() const { return (size_t)_reader.getRowCount(); }
+
+    virtual void loadRecords( size_t first, size_t count, std::vector<LogTextRecord> * records ) override;
+
+    /** \brief 是否归档文件的路径（按扩展名判断） */
+    static bool IsArchivePath( winux::String const & path );
+
+private:
+    eienlog::LogArchiveReader _reader;
+    size_t _firstRow; // 已加载的第一行在文件中的行号
+    size_t _rowCount; // 已加载的记录数
+};
+
+/** \brief 把LogStore淘汰的记录追加到归档文件，之后可以打开该文件查看和搜索 */
+class LogArchiveSpill : public LogEvictSink
+{
+public:
+    /** \brief 打开归档文件，已存在时在末尾追加 */
+    bool open( winux::String const & path ) { return _writer.open( path, true ); }
+
+    virtual void evictRecords( size_t firstRow, std::vector<LogTextRecord> const & records ) override;
+
+    /** \brief 归档文件的总行数 */
+    winux::uint64 getRowCount() const { return _writer.getRowCount(); }
+
+private:
+    eienlog::LogArchiveWriter _writer;
+};
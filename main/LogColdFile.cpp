@@ -0,0 +1,175 @@
+﻿#include "LogColdFile.h"
+
+#define LOG_COLD_ZIP_LEVEL 2
+
+// 附加信息的标志，记录的这些信息不能由内容和时间推出时才保存
+enum LogColdExtraFlags : winux::byte
+{
+    lcefUtcTime = 1,    // 时间字符串不是由时间格式化得到
+    lcefSlashes = 2,    // 转义内容与内容不同
+    lcefContentSize = 4,    // 内容大小与内容长度不同
+    lcefCollapsed = 8   // 折叠了重复日志
+};
+
+// class LogColdFile --------------------------------------------------------------------------
+bool LogColdFile::open( winux::String const & path )
+{
+    this->close();
+    // 读写打开，内存映射需要文件可读
+    if ( !_file.open( path, $T("w+b") ) ) return false;
+    _path = path;
+    _size = 0;
+    return true;
+}
+
+void LogColdFile::close()
+{
+    if ( !_file ) return;
+    _mapping.reset(); // 先撤销映射才能删除文件
+    _file.close();
+    winux::UnlinkFile(_path);
+    _path.clear();
+    _size = 0;
+}
+
+bool LogColdFile::write( std::vector<LogTextRecord> const & records, winux::uint64 * offset, winux::uint32 * size )
+{
+    if ( !_file ) return false;
+
+    // 内容、时间、旗标和元信息按归档块的格式编码，附加数据是各条记录的标志，然后是标志对应的值，一起压缩
+    eienlog::LogArchiveBlock block;
+    winux::AnsiString extra( records.size(), '\0' ), values;
+    winux::uint64 cacheSec = 0;
+    winux::AnsiString cache;
+    winux::Utf8String utcTime;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord const & tr = records[i];
+        block.add( tr.strContent.c_str(), tr.strContent.length(), tr.utcTimeMs, tr.flag.value, tr.meta );
+
+        winux::byte flags = 0;
+        LogFormatTime( tr.utcTimeMs, &cacheSec, &cache, &utcTime );
+        if ( utcTime != tr.utcTime )
+        {
+            flags |= lcefUtcTime;
+            eienlog::PutVarint( &values, tr.utcTime.length() );
+            values += tr.utcTime;
+        }
+        if ( tr.strContentSlashes != tr.strContent )
+        {
+            flags |= lcefSlashes;
+            eienlog::PutVarint( &values, tr.strContentSlashes.length() );
+            values += tr.strContentSlashes;
+        }
+        if ( tr.contentSize != tr.strContent.length() )
+        {
+            flags |= lcefContentSize;
+            eienlog::PutVarint( &values, tr.contentSize );
+        }
+        if ( tr.repeatCount != 1 || tr.lastTimeMs != 0 )
+        {
+            flags |= lcefCollapsed;
+            eienlog::PutVarint( &values, tr.repeatCount );
+            eienlog::PutVarint( &values, tr.lastTimeMs ? tr.lastTimeMs - tr.utcTimeMs + 1 : 0 );
+        }
+        extra[i] = (char)flags;
+    }
+    extra += values;
+
+    // 换出在追加记录的线程中进行，用较快的压缩级别
+    eienlog::LogArchiveBlockHeader hdr;
+    winux::AnsiString zip;
+    if ( !block.encode( 0, &hdr, &zip, LOG_COLD_ZIP_LEVEL, &extra ) ) return false;
+
+    if ( !_file.seek(_size) ) return false;
+    if ( _file.write( &hdr, sizeof(hdr) ) != sizeof(hdr) ) return false;
+    if ( _file.write( zip.c_str(), zip.length() ) != zip.length() ) return false;
+    fflush( _file.get() ); // 写入系统后映射才能读到
+
+    *offset = _size;
+    *size = (winux::uint32)( sizeof(hdr) + zip.length() );
+    _size += *size;
+    return true;
+}
+
+bool LogColdFile::read( winux::uint64 offset, winux::uint32 size, std::vector<LogTextRecord> * records ) const
+{
+    // 取得覆盖该块的映射，文件增长后重新映射整个文件
+    winux::SharedPointer<winux::FileMapping> mapping;
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        if ( !_mapping || _mapping->size() < offset + size )
+        {
+            winux::SharedPointer<winux::FileMapping> newMapping( new winux::FileMapping() );
+            if ( !newMapping->create( _file.getOsHandle(), true, winux::fmfReadOnly ) || newMapping->size() < offset + size ) return false;
+            _mapping = newMapping;
+        }
+        mapping = _mapping;
+    }
+
+    eienlog::LogArchiveBlockHeader hdr;
+    if ( size < sizeof(hdr) ) return false;
+    winux::byte const * p = mapping->get<winux::byte>() + offset;
+    memcpy( &hdr, p, sizeof(hdr) );
+    if ( hdr.zipSize != size - sizeof(hdr) ) return false;
+    std::vector<eienlog::LogRecord> blockRecords;
+    winux::AnsiString extra;
+    if ( !eienlog::LogArchiveBlock::Decode( hdr, p + sizeof(hdr), &blockRecords, &extra ) ) return false;
+
+    size_t rows = blockRecords.size();
+    if ( extra.length() < rows ) return false;
+    winux::byte const * flags = (winux::byte const *)extra.c_str();
+    p = flags + rows;
+    winux::byte const * end = flags + extra.length();
+
+    std::vector<LogTextRecord> texts( rows );
+    winux::uint64 cacheSec = 0;
+    winux::AnsiString cache;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        eienlog::LogRecord const & record = blockRecords[i];
+        LogTextRecord & tr = texts[i];
+        tr.strContent.assign( record.data.get<char>(), record.data.getSize() );
+        tr.contentSize = tr.strContent.length();
+        tr.utcTimeMs = (winux::uint64)record.utcTime;
+        tr.flag.value = record.flag;
+        tr.meta = record.meta;
+
+        winux::uint64 len;
+        if ( flags[i] & lcefUtcTime )
+        {
+            if ( !eienlog::GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+            tr.utcTime.assign( (char const *)p, (size_t)len );
+            p += len;
+        }
+        else
+        {
+            LogFormatTime( tr.utcTimeMs, &cacheSec, &cache, &tr.utcTime );
+        }
+        if ( flags[i] & lcefSlashes )
+        {
+            if ( !eienlog::GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+            tr.strContentSlashes.assign( (char const *)p, (size_t)len );
+            p += len;
+        }
+        else
+        {
+            tr.strContentSlashes = tr.strContent;
+        }
+        if ( flags[i] & lcefContentSize )
+        {
+            if ( !eienlog::GetVarint( p, end, &len ) ) return false;
+            tr.contentSize = (size_t)len;
+        }
+        if ( flags[i] & lcefCollapsed )
+        {
+            winux::uint64 repeatCount, lastDelta;
+            if ( !eienlog::GetVarint( p, end, &repeatCount ) || !eienlog::GetVarint( p, end, &lastDelta ) ) return false;
+            tr.repeatCount = (winux::uint32)repeatCount;
+            tr.lastTimeMs = lastDelta ? tr.utcTimeMs + lastDelta - 1 : 0;
+        }
+    }
+    records->reserve( records->size() + rows );
+    for ( auto && tr : texts ) records->push_back( std::move(tr) );
+    return true;
+}
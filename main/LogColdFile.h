@@ -0,0 +1,48 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief 冷块文件，分层存储时LogStore把换出的块压缩后追加到此文件
+ *
+ *  每块只写入一次，块内记录按归档块的格式（LogArchiveBlock）编码压缩，转义内容、折叠次数等作为块的附加数据一起压缩。读取时通过内存映射访问文件，
+ *  文件增长后重新映射，旧的映射在仍被读取时保留，因此读取可以在多个线程中与写入同时进行。
+ *  文件只在本次运行中有效，关闭时删除。 */
+class LogColdFile
+{
+public:
+    LogColdFile() : _size(0), _pageIns(0) { }
+    ~LogColdFile() { this->close(); }
+
+    /** \brief 创建冷块文件，已存在时清空 */
+    bool open( winux::String const & path );
+
+    /** \brief 关闭并删除冷块文件 */
+    void close();
+
+    /** \brief 压缩写入一块记录
+     *
+     *  \param records 块内记录
+     *  \param offset 输出块在文件中的偏移
+     *  \param size 输出块占用的字节数
+     *  \return 写入失败返回false */
+    bool write( std::vector<LogTextRecord> const & records, winux::uint64 * offset, winux::uint32 * size );
+
+    /** \brief 读取一块记录，追加到records */
+    bool read( winux::uint64 offset, winux::uint32 size, std::vector<LogTextRecord> * records ) const;
+
+    /** \brief 文件大小 */
+    winux::uint64 getSize() const { return _size; }
+
+    /** \brief 换入的次数，LogStore据此判断是否需要重新统计热数据 */
+    winux::uint64 getPageIns() const { return _pageIns.load(std::memory_order_relaxed); }
+
+    /** \brief 记下一次换入 */
+    void addPageIn() const { _pageIns.fetch_add( 1, std::memory_order_relaxed ); }
+
+private:
+    winux::File _file;
+    winux::String _path;
+    winux::uint64 _size; // 已写入的字节数
+    mutable std::atomic<winux::uint64> _pageIns; // 换入的次数
+    mutable std::mutex _mtx; // 保护映射
+    mutable winux::SharedPointer<winux::FileMapping> _mapping; // 当前映射，覆盖文件的前一部分
+};
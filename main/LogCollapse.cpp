@@ -0,0 +1,78 @@
+﻿#include "LogCollapse.h"
+
+// 64位整数混合，取自MurmurHash3的终结步骤
+inline static winux::uint64 _Mix64( winux::uint64 x )
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// class LogCollapser -------------------------------------------------------------------------
+winux::uint64 LogCollapser::Hash( eienlog::LogRecord const & record )
+{
+    winux::byte const * p = record.data.get<winux::byte>();
+    size_t n = record.data.getSize();
+    winux::uint64 h = _Mix64( n ^ ( (winux::uint64)record.flag << 32 ) );
+    for ( ; n >= 8; p += 8, n -= 8 )
+    {
+        winux::uint64 v;
+        memcpy( &v, p, 8 );
+        h = ( h ^ _Mix64(v) ) * 0x9e3779b97f4a7c15ULL;
+    }
+    if ( n > 0 )
+    {
+        winux::uint64 v = 0;
+        memcpy( &v, p, n );
+        h = ( h ^ _Mix64(v) ) * 0x9e3779b97f4a7c15ULL;
+    }
+    return _Mix64(h);
+}
+
+bool LogCollapser::collapse( LogStore & store, eienlog::LogRecord const & record, winux::uint64 hash )
+{
+    winux::uint64 utcTime = (winux::uint64)record.utcTime;
+    size_t size = record.data.getSize();
+    // 从最近追加的行往前找
+    for ( size_t i = 0; i < _recent.size(); i++ )
+    {
+        Entry & e = _recent[ ( _next + _recent.size() - 1 - i ) % _recent.size() ];
+        if ( e.hash != hash || e.flag != record.flag || e.meta != record.meta.value || e.data.length() != size ) continue;
+        if ( e.row < store.getTailBlockRow() || e.row >= store.size() ) continue;
+        if ( size != 0 && memcmp( e.data.data(), record.data.getBuf(), size ) != 0 ) continue;
+
+        LogTextRecord & tr = store[e.row];
+        winux::uint64 lastTime = tr.lastTimeMs ? tr.lastTimeMs : tr.utcTimeMs;
+        if ( utcTime > lastTime + _windowMs ) continue;
+
+        tr.repeatCount++;
+        tr.lastTimeMs = utcTime > lastTime ? utcTime : lastTime;
+        return true;
+    }
+    return false;
+}
+
+void LogCollapser::add( size_t row, eienlog::LogRecord const & record, winux::uint64 hash )
+{
+    if ( _recent.size() < MaxRecent )
+    {
+        _recent.emplace_back();
+        _next = _recent.size() - 1;
+    }
+    Entry & e = _recent[_next];
+    e.hash = hash;
+    e.row = row;
+    e.flag = record.flag;
+    e.meta = record.meta.value;
+    e.data.assign( record.data.getBuf<char>(), record.data.getSize() );
+    _next = ( _next + 1 ) % MaxRecent;
+}
+
+void LogCollapser::clear()
+{
+    _recent.clear();
+    _next = 0;
+}
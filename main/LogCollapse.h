@@ -0,0 +1,52 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief 重复日志折叠
+ *
+ *  接收日志时，在转换成文本之前按内容和旗标计算哈希，与最近若干行比较。
+ *  与时间窗口内的某行重复时，不再追加新行，只增加该行的重复次数并更新最后时间。
+ *  能折叠的行限于存储中正在追加的最后一块，该块不会被换出，快照读取的字符串也不会被修改。 */
+class LogCollapser
+{
+public:
+    enum { MaxRecent = 32 }; //!< 参与比较的最近行数
+
+    LogCollapser() : _windowMs(0), _next(0) { }
+
+    /** \brief 设置时间窗口（毫秒），与上次重复相隔不超过窗口的记录被折叠，0表示不折叠 */
+    void setWindow( winux::uint64 windowMs ) { _windowMs = windowMs; this->clear(); }
+
+    /** \brief 是否启用 */
+    bool isEnabled() const { return _windowMs != 0; }
+
+    /** \brief 记录与窗口内的某行重复时折叠到该行
+     *
+     *  \param store 日志存储
+     *  \param record 接收的日志记录
+     *  \param hash 记录的哈希，由Hash()计算
+     *  \return 折叠了返回true，否则应追加新行并调用add() */
+    bool collapse( LogStore & store, eienlog::LogRecord const & record, winux::uint64 hash );
+
+    /** \brief 记下新追加的行 */
+    void add( size_t row, eienlog::LogRecord const & record, winux::uint64 hash );
+
+    /** \brief 清空最近行，存储清空时调用 */
+    void clear();
+
+    /** \brief 计算日志记录内容和旗标的哈希，非加密哈希，每次处理8字节 */
+    static winux::uint64 Hash( eienlog::LogRecord const & record );
+
+private:
+    struct Entry
+    {
+        winux::uint64 hash;
+        size_t row;
+        winux::uint32 flag;
+        winux::uint8 meta; // 级别和类别不同的记录不折叠
+        winux::AnsiString data; // 原始内容，哈希相同时再比较内容
+    };
+
+    winux::uint64 _windowMs; // 时间窗口
+    std::vector<Entry> _recent; // 最近的行，循环使用
+    size_t _next; // 下一个写入的位置
+};
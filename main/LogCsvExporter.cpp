@@ -0,0 +1,172 @@
+﻿#include "LogCsvExporter.h"
+
+// 按平台追加换行
+inline static void _AppendNewline( winux::Utf8String * out )
+{
+#if defined(OS_WIN)
+    *out += "\r\n";
+#elif defined(OS_DARWIN)
+    *out += '\r';
+#else
+    *out += '\n';
+#endif
+}
+
+// 追加一个字段，规则同CsvWriter：含有`,` `"` `'` `\n`时用双引号括起，内部的双引号写两次
+inline static void _AppendField( char const * str, size_t len, winux::Utf8String * out )
+{
+    static char const quoteChars[4] = { ',', '"', '\'', '\n' };
+    static char const escapeChars[4] = { '"', '\n', '\n', '\n' };
+    size_t i = winux::StrFindChars( str, len, quoteChars );
+    if ( i == len )
+    {
+        out->append( str, len );
+        return;
+    }
+
+    *out += '"';
+    size_t start = 0;
+    for ( ; i < len; i++ ) // i之前没有引号和换行
+    {
+        i += winux::StrFindChars( str + i, len - i, escapeChars );
+        if ( i >= len ) break;
+        char ch = str[i];
+        if ( ch == '"' )
+        {
+            out->append( str + start, i + 1 - start );
+            *out += '"';
+            start = i + 1;
+        }
+        else if ( ch == '\n' )
+        {
+            out->append( str + start, i - start );
+            _AppendNewline(out);
+            start = i + 1;
+        }
+    }
+    out->append( str + start, len - start );
+    *out += '"';
+}
+
+// 追加一个无符号整数
+inline static void _AppendUInt( winux::uint64 v, winux::Utf8String * out )
+{
+    char buf[24];
+    int i = sizeof(buf);
+    do
+    {
+        buf[--i] = (char)( '0' + v % 10 );
+        v /= 10;
+    } while ( v );
+    out->append( buf + i, sizeof(buf) - i );
+}
+
+// class LogCsvExporter -----------------------------------------------------------------------
+LogCsvExporter::LogCsvExporter( LogStore const & store, std::vector< std::pair< size_t, size_t > > const & ranges, winux::String const & path ) :
+    _store(store), _path(path), _archive( LogArchiveFile::IsArchivePath(path) ), _totalRows(0), _writtenRows(0), _writtenBytes(0), _cancelled(false), _finished(false), _failed(false)
+{
+    // 去掉已被淘汰的行
+    size_t firstRow = _store.getFirstRow();
+    for ( auto && range : ranges )
+    {
+        size_t begin = range.first > firstRow ? range.first : firstRow;
+        if ( begin >= range.second ) continue;
+        _ranges.emplace_back( begin, range.second );
+        _totalRows += range.second - begin;
+    }
+}
+
+LogCsvExporter::~LogCsvExporter()
+{
+    this->cancel();
+    this->wait();
+}
+
+bool LogCsvExporter::start()
+{
+    if ( _archive ? !_archiveWriter.open( _path, false ) : !_file.open( _path, $T("wb") ) )
+    {
+        _failed = true;
+        _finished = true;
+        return false;
+    }
+    _th.attachNew( new std::thread( _archive ? &LogCsvExporter::_runArchive : &LogCsvExporter::_run, this ) );
+    return true;
+}
+
+void LogCsvExporter::wait()
+{
+    if ( _th && _th->joinable() ) _th->join();
+}
+
+void LogCsvExporter::FormatRecord( LogTextRecord const & tr, winux::Utf8String * out )
+{
+    _AppendUInt( tr.contentSize, out );
+    *out += ',';
+    _AppendField( tr.strContent.c_str(), tr.strContent.length(), out );
+    *out += ',';
+    _AppendField( tr.utcTime.c_str(), tr.utcTime.length(), out );
+    *out += ',';
+    _AppendUInt( tr.flag.value, out );
+    *out += ',';
+    _AppendUInt( tr.meta.value, out );
+    _AppendNewline(out);
+}
+
+bool LogCsvExporter::_flush( winux::Utf8String * buf )
+{
+    if ( buf->empty() ) return true;
+    if ( _file.write( buf->c_str(), buf->length() ) != buf->length() ) return false;
+    _writtenBytes += buf->length();
+    buf->clear();
+    return true;
+}
+
+void LogCsvExporter::_run()
+{
+    winux::Utf8String buf;
+    buf.reserve( ChunkBytes + 4096 );
+    buf += "\xef\xbb\xbf"; // BOM
+
+    LogStore::Reader reader(_store);
+    bool ok = true;
+    for ( auto && range : _ranges )
+    {
+        for ( size_t row = range.first; row < range.second && ok; row++ )
+        {
+            if ( _cancelled ) break;
+            FormatRecord( reader[row], &buf );
+            _writtenRows++;
+            if ( buf.length() >= ChunkBytes ) ok = this->_flush(&buf);
+        }
+        if ( _cancelled || !ok ) break;
+    }
+    if ( ok ) ok = this->_flush(&buf);
+    _file.close();
+
+    _failed = !ok;
+    _finished = true;
+}
+
+void LogCsvExporter::_runArchive()
+{
+    LogStore::Reader reader(_store);
+    bool ok = true;
+    eienlog::LogRecord record;
+    for ( auto && range : _ranges )
+    {
+        for ( size_t row = range.first; row < range.second && ok; row++ )
+        {
+            if ( _cancelled ) break;
+            LogTextToRecord( reader[row], &record );
+            ok = _archiveWriter.write(record);
+            _writtenBytes += record.data.getSize();
+            _writtenRows++;
+        }
+        if ( _cancelled || !ok ) break;
+    }
+    if ( !_archiveWriter.close() ) ok = false;
+
+    _failed = !ok;
+    _finished = true;
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <atomic>
+#include <thread>
+#include "LogStore.h"
+#include "LogArchiveFile.h"
+
+/** \brief csvlog流式导出器
+ *
+ *  在后台线程中把存储快照里指定区间的记录直接格式化成UTF-8文本，攒满一块就写入文件，不经过Mixed和UTF-16转换，也不在内存中生成整个文件。
+ *  输出与原来的保存方式一致：UTF-8 BOM，字段按CsvWriter的规则加引号，Windows下换行为CRLF。
+ *  输出路径的扩展名为.eienlog时改为写入二进制归档文件。 */
+class LogCsvExporter
+{
+public:
+    enum { ChunkBytes = 1024 * 1024 }; //!< 每次写入文件的字节数
+
+    /** \brief 构造函数
+     *
+     *  \param store 日志存储的快照
+     *  \param ranges 要导出的行区间[begin, end)，升序，已被淘汰的行自动跳过
+     *  \param path 输出文件路径 */
+    LogCsvExporter( LogStore const & store, std::vector< std::pair< size_t, size_t > > const & ranges, winux::String const & path );
+
+    ~LogCsvExporter();
+
+    /** \brief 打开文件并启动后台线程，文件打开失败返回false */
+    bool start();
+
+    /** \brief 取消导出，已写入的部分保留 */
+    void cancel() { _cancelled = true; }
+
+    /** \brief 等待后台线程结束 */
+    void wait();
+
+    /** \brief 是否已结束（完成、取消或失败） */
+    bool isFinished() const { return _finished; }
+
+    /** \brief 是否写入出错 */
+    bool isFailed() const { return _failed; }
+
+    /** \brief 导出进度，0~1 */
+    float getProgress() const { return _totalRows ? (float)_writtenRows / _totalRows : 1.0f; }
+
+    /** \brief 已导出的行数 */
+    size_t getWrittenRows() const { return _writtenRows; }
+
+    /** \brief 要导出的总行数 */
+    size_t getTotalRows() const { return _totalRows; }
+
+    /** \brief 已写入的字节数 */
+    winux::uint64 getWrittenBytes() const { return _writtenBytes; }
+
+    /** \brief 把一条记录格式化成一行csvlog追加到out，换行已按平台转换 */
+    static void FormatRecord( LogTextRecord const & tr, winux::Utf8String * out );
+
+private:
+    // 后台线程
+    void _run();
+    // 后台线程，写入归档文件
+    void _runArchive();
+    // 把缓冲写入文件
+    bool _flush( winux::Utf8String * buf );
+
+    LogStore _store; // 存储快照
+    std::vector< std::pair< size_t, size_t > > _ranges; // 导出的行区间
+    winux::String _path; // 输出文件路径
+    winux::File _file; // 输出文件
+    bool _archive; // 是否输出归档文件
+    eienlog::LogArchiveWriter _archiveWriter; // 归档文件写入器
+    winux::SimplePointer<std::thread> _th; // 后台线程
+
+    size_t _totalRows; // 总行数
+    std::atomic<size_t> _writtenRows; // 已导出的行数
+    std::atomic<winux::uint64> _writtenBytes; // 已写入的字节数
+    std::atomic<bool> _cancelled; // 已取消
+    std::atomic<bool> _finished; // 已结束
+    std::atomic<bool> _failed; // 写入出错
+};
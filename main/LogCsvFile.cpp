@@ -0,0 +1,355 @@
+﻿#include "LogCsvFile.h"
+
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+// 是否为记录结束符，与NewlineFromFile转换后CsvReader遇到'\n'结束记录的效果相同
+inline static bool _IsRowEnd( char ch )
+{
+#if defined(OS_DARWIN)
+    return ch == '\n' || ch == '\r';
+#else
+    return ch == '\n';
+#endif
+}
+
+// 解析一行已转换换行符的文本，规则同CsvReader的_ReadRecord
+static size_t _ParseFields( char const * p, char const * end, winux::Utf8String * fields, size_t maxFields )
+{
+    size_t n = 0;
+    winux::Utf8String valStr;
+    while ( p < end )
+    {
+        char ch = *p;
+        if ( ch == '\n' ) // 结束一条记录
+        {
+            break;
+        }
+        else if ( ch == ',' ) // 结束一个值
+        {
+            if ( n < maxFields ) fields[n].swap(valStr);
+            n++;
+            valStr.clear();
+            p++;
+        }
+        else if ( ch == '\"' && winux::StrTrim(valStr).empty() )
+        {
+            valStr.clear(); // 去除之前可能获得的空白字符
+            p++; // skip '\"'
+            while ( p < end )
+            {
+                if ( *p == '\"' )
+                {
+                    if ( p + 1 < end && p[1] == '\"' ) // 两个'\"'解析成一个'\"'
+                    {
+                        valStr += '\"';
+                        p += 2;
+                    }
+                    else
+                    {
+                        p++; // skip 作为字符串结束的尾"
+                        break;
+                    }
+                }
+                else
+                {
+                    valStr += *p++;
+                }
+            }
+        }
+        else
+        {
+            valStr += ch;
+            p++;
+        }
+    }
+    if ( n < maxFields ) fields[n].swap(valStr);
+    return n + 1;
+}
+
+// 从行首pos开始扫描至多maxRows行，把各行的起始偏移追加到offsets，最后追加结束偏移，没有行时不追加
+static void _ScanRows( char const * base, size_t size, size_t pos, size_t maxRows, std::vector<winux::uint64> * offsets )
+{
+    if ( pos >= size || maxRows == 0 ) return;
+#if defined(OS_DARWIN)
+    static char const boundaryChars[4] = { '\"', '\n', '\r', '\r' };
+#else
+    static char const boundaryChars[4] = { '\"', '\n', '\n', '\n' };
+#endif
+    // 引号内的换行不结束记录
+    offsets->push_back(pos);
+    size_t rows = 1;
+    bool quoted = false;
+    for ( size_t i = pos; i < size; i++ )
+    {
+        i += winux::StrFindChars( base + i, size - i, boundaryChars );
+        if ( i >= size ) break;
+        char ch = base[i];
+        if ( ch == '\"' )
+        {
+            quoted = !quoted;
+        }
+        else if ( !quoted && _IsRowEnd(ch) )
+        {
+            offsets->push_back( i + 1 );
+            if ( i + 1 >= size || rows == maxRows ) return;
+            rows++;
+        }
+    }
+    offsets->push_back(size);
+}
+
+// 只解析一行的时间字段文本
+static winux::Utf8String _ParseTimeText( char const * p, size_t len )
+{
+    winux::Utf8String fields[3];
+    if ( _ParseFields( p, p + len, fields, 3 ) < 3 ) return winux::Utf8String();
+    return std::move(fields[2]);
+}
+
+// 只解析一行的时间
+static winux::uint64 _ParseTime( char const * p, size_t len )
+{
+    winux::Utf8String utcTime = _ParseTimeText( p, len );
+    return utcTime.empty() ? 0 : winux::DateTimeL( _ToString(utcTime) ).toUtcTimeMs();
+}
+
+// 稀疏索引文件头
+struct CsvSparseIndexHeader
+{
+    char magic[8];          // "ELCSVIDX"
+    winux::uint64 fileSize; // csvlog文件大小
+    winux::int64 fileMTime; // csvlog文件修改时间
+    winux::uint64 fileRows; // csvlog文件行数
+    winux::uint64 entries;  // 索引项数
+};
+
+static char const __CsvSparseIndexMagic[8] = { 'E', 'L', 'C', 'S', 'V', 'I', 'D', 'X' };
+
+// class LogCsvFile ---------------------------------------------------------------------------
+LogCsvFile::LogCsvFile() : _firstRow(0), _fileRows(0), _fileSize(0), _fileMTime(0)
+{
+}
+
+LogCsvFile::~LogCsvFile()
+{
+}
+
+bool LogCsvFile::open( winux::String const & path, LogRange const & range )
+{
+    _offsets.clear();
+    _sparse.clear();
+    _firstRow = 0;
+    _fileRows = 0;
+    if ( !_mapping.create( path, winux::fmfReadOnly ) ) return false;
+
+    char const * base = _mapping.get<char>();
+    size_t size = _mapping.size();
+    if ( size < 3 || memcmp( base, "\xef\xbb\xbf", 3 ) != 0 ) // 只支持UTF-8 BOM
+    {
+        _mapping.destroy();
+        return false;
+    }
+    _fileSize = size;
+    _fileMTime = winux::FileMTime(path);
+
+    // 全部加载：扫描记录边界
+    if ( range.type == LogRange::lrAll )
+    {
+        _offsets.reserve( size / 64 + 2 );
+        _ScanRows( base, size, 3, (size_t)-1, &_offsets );
+        _fileRows = this->getRowCount();
+        return true;
+    }
+
+    // 按范围加载：先取得稀疏索引，再只扫描范围所在的段
+    winux::String idxPath = path + $T(".idx");
+    if ( !this->_loadSparseIndex(idxPath) )
+    {
+        this->_buildSparseIndex();
+        this->_saveSparseIndex(idxPath); // 目录不可写时只是下次还要重建
+    }
+
+    size_t rowBegin, rowEnd;
+    if ( range.type == LogRange::lrRows )
+    {
+        rowBegin = range.begin < _fileRows ? (size_t)range.begin : _fileRows;
+        rowEnd = range.end != 0 && range.end < _fileRows ? (size_t)range.end : _fileRows;
+    }
+    else
+    {
+        rowBegin = this->findRowByTime(range.begin);
+        rowEnd = range.end != 0 ? this->findRowByTime(range.end) : _fileRows;
+    }
+    if ( rowEnd <= rowBegin ) return true;
+
+    // 从段首跳过范围之前的行
+    size_t entry = rowBegin / SparseRows;
+    size_t skip = rowBegin % SparseRows;
+    _ScanRows( base, size, (size_t)_sparse[entry].offset, skip + ( rowEnd - rowBegin ), &_offsets );
+    _offsets.erase( _offsets.begin(), _offsets.begin() + ( skip < _offsets.size() ? skip : _offsets.size() ) );
+    if ( _offsets.size() == 1 ) _offsets.clear();
+    _firstRow = rowBegin;
+    return true;
+}
+
+size_t LogCsvFile::findRowByTime( winux::uint64 utcTimeMs ) const
+{
+    auto it = std::lower_bound( _sparse.begin(), _sparse.end(), utcTimeMs, [] ( SparseEntry const & e, winux::uint64 t ) { return e.maxTimeMs < t; } );
+    if ( it == _sparse.end() ) return _fileRows;
+
+    // 在这一段中逐行查找
+    size_t entry = it - _sparse.begin();
+    std::vector<winux::uint64> offsets;
+    _ScanRows( _mapping.get<char>(), _mapping.size(), (size_t)it->offset, SparseRows, &offsets );
+    char const * base = _mapping.get<char>();
+    for ( size_t i = 0; i + 1 < offsets.size(); i++ )
+    {
+        if ( _ParseTime( base + offsets[i], (size_t)( offsets[i + 1] - offsets[i] ) ) >= utcTimeMs ) return entry * SparseRows + i;
+    }
+    return entry * SparseRows + ( offsets.empty() ? 0 : offsets.size() - 1 );
+}
+
+bool LogCsvFile::_loadSparseIndex( winux::String const & idxPath )
+{
+    winux::File file;
+    if ( !file.open( idxPath, $T("rb") ) ) return false;
+
+    CsvSparseIndexHeader hdr;
+    if ( file.read( &hdr, sizeof(hdr) ) != sizeof(hdr) ) return false;
+    if ( memcmp( hdr.magic, __CsvSparseIndexMagic, sizeof(hdr.magic) ) != 0 ) return false;
+    if ( hdr.fileSize != _fileSize || hdr.fileMTime != (winux::int64)_fileMTime ) return false; // csvlog已改变
+    if ( hdr.entries != ( hdr.fileRows + SparseRows - 1 ) / SparseRows ) return false;
+
+    _sparse.resize( (size_t)hdr.entries );
+    size_t bytes = _sparse.size() * sizeof(SparseEntry);
+    if ( bytes && file.read( _sparse.data(), bytes ) != bytes )
+    {
+        _sparse.clear();
+        return false;
+    }
+    // 大小和修改时间相同也可能是损坏或过期的索引，段首偏移须从正文开头起严格递增且在文件内
+    for ( size_t i = 0; i < _sparse.size(); i++ )
+    {
+        winux::uint64 offset = _sparse[i].offset;
+        if ( offset >= _fileSize || ( i == 0 ? offset != 3 : offset <= _sparse[i - 1].offset ) )
+        {
+            _sparse.clear();
+            return false;
+        }
+    }
+    _fileRows = (size_t)hdr.fileRows;
+    return true;
+}
+
+void LogCsvFile::_buildSparseIndex()
+{
+    char const * base = _mapping.get<char>();
+    size_t size = _mapping.size();
+    std::vector<winux::uint64> offsets;
+    winux::uint64 maxTimeMs = 0;
+    _sparse.clear();
+    _fileRows = 0;
+    for ( size_t pos = 3; pos < size; pos = (size_t)offsets.back() )
+    {
+        offsets.clear();
+        _ScanRows( base, size, pos, SparseRows, &offsets );
+        // 时间文本是定宽的日期时间格式，按字典序比较即可，每段只转换最晚的一个
+        winux::Utf8String maxTime;
+        for ( size_t i = 0; i + 1 < offsets.size(); i++ )
+        {
+            winux::Utf8String utcTime = _ParseTimeText( base + offsets[i], (size_t)( offsets[i + 1] - offsets[i] ) );
+            if ( maxTime < utcTime ) maxTime.swap(utcTime);
+        }
+        winux::uint64 t = maxTime.empty() ? 0 : winux::DateTimeL( _ToString(maxTime) ).toUtcTimeMs();
+        if ( t > maxTimeMs ) maxTimeMs = t;
+        _sparse.push_back( SparseEntry{ pos, maxTimeMs } );
+        _fileRows += offsets.size() - 1;
+    }
+}
+
+bool LogCsvFile::_saveSparseIndex( winux::String const & idxPath ) const
+{
+    winux::File file;
+    if ( !file.open( idxPath, $T("wb") ) ) return false;
+
+    CsvSparseIndexHeader hdr;
+    memcpy( hdr.magic, __CsvSparseIndexMagic, sizeof(hdr.magic) );
+    hdr.fileSize = _fileSize;
+    hdr.fileMTime = (winux::int64)_fileMTime;
+    hdr.fileRows = _fileRows;
+    hdr.entries = _sparse.size();
+    size_t bytes = _sparse.size() * sizeof(SparseEntry);
+    return file.write( &hdr, sizeof(hdr) ) == sizeof(hdr) && ( !bytes || file.write( _sparse.data(), bytes ) == bytes );
+}
+
+void LogCsvFile::parseRecord( size_t row, LogTextRecord * tr ) const
+{
+    if ( row >= this->getRowCount() )
+    {
+        *tr = LogTextRecord();
+        return;
+    }
+    char const * p = _mapping.get<char>() + _offsets[row];
+    size_t len = (size_t)( _offsets[row + 1] - _offsets[row] );
+
+    winux::Utf8String fields[5];
+    size_t columns;
+#if defined(OS_WIN) || defined(OS_DARWIN)
+    if ( memchr( p, '\r', len ) ) // 含有需要转换的换行符
+    {
+        winux::Utf8String str = winux::NewlineFromFile( p, len, false );
+        columns = _ParseFields( str.c_str(), str.c_str() + str.length(), fields, 5 );
+    }
+    else
+#endif
+    {
+        columns = _ParseFields( p, p + len, fields, 5 );
+    }
+
+    tr->contentSize = 0;
+    tr->utcTimeMs = 0;
+    tr->flag.value = 0;
+    tr->meta.value = 0;
+    if ( columns > 0 )
+    {
+        tr->contentSize = (size_t)strtoull( fields[0].c_str(), nullptr, 10 );
+    }
+    if ( columns > 1 )
+    {
+        tr->strContent.swap(fields[1]);
+        tr->strContentSlashes = winux::AddCSlashes(tr->strContent);
+    }
+    if ( columns > 2 )
+    {
+        tr->utcTime.swap(fields[2]);
+        tr->utcTimeMs = winux::DateTimeL( _ToString(tr->utcTime) ).toUtcTimeMs();
+    }
+    if ( columns > 3 )
+    {
+        tr->flag.value = (winux::uint32)strtoul( fields[3].c_str(), nullptr, 10 );
+    }
+    if ( columns > 4 ) // 第5列为级别和类别，旧文件没有此列
+    {
+        tr->meta.value = (winux::uint8)strtoul( fields[4].c_str(), nullptr, 10 );
+    }
+}
+
+void LogCsvFile::loadRecords( size_t first, size_t count, std::vector<LogTextRecord> * records )
+{
+    size_t rows = this->getRowCount();
+    if ( first >= rows ) return;
+    if ( count > rows - first ) count = rows - first;
+    for ( size_t row = first; row < first + count; row++ )
+    {
+        LogTextRecord tr;
+        this->parseRecord( row, &tr );
+        records->push_back( std::move(tr) );
+    }
+}
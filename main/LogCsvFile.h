@@ -0,0 +1,70 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief 内存映射的csvlog文件，按需解析记录
+ *
+ *  打开时把文件映射进内存，只扫描一遍建立行偏移索引，不解析字段。
+ *  记录在LogStore首次访问其所在的块时才解析，因此打开大文件很快，内存也只随实际浏览过的块增长。
+ *  解析规则与CsvReader一致：换行按平台换行符转换，字段以逗号分隔，引号内的逗号和换行属于字段内容，两个引号表示一个引号。
+ *
+ *  按范围打开时使用稀疏索引：每SparseRows行记一项，保存该段的起始偏移和截至该段的最晚时间。
+ *  索引首次建立后存到文件旁的`.idx`文件，文件大小和修改时间不变时直接读取，之后只扫描范围所在的段。 */
+class LogCsvFile : public LogBlockSource
+{
+public:
+    enum { SparseRows = 4096 }; //!< 稀疏索引每项的行数
+
+    /** \brief 稀疏索引项 */
+    struct SparseEntry
+    {
+        winux::uint64 offset;       //!< 段首行的偏移
+        winux::uint64 maxTimeMs;    //!< 文件开头至本段末的最晚时间
+    };
+
+    LogCsvFile();
+
+    virtual ~LogCsvFile();
+
+    /** \brief 打开csvlog文件并建立行偏移索引
+     *
+     *  只支持带BOM的UTF-8文件，其他编码返回false，调用者可改用CsvReader读取。
+     *  \param path 文件路径
+     *  \param range 要加载的范围，范围之外的行不扫描。时间范围按稀疏索引定位，时间基本有序时结果准确 */
+    bool open( winux::String const & path, LogRange const & range = LogRange() );
+
+    /** \brief 已加载的记录数 */
+    size_t getRowCount() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+    /** \brief 已加载的第一条记录在文件中的行号 */
+    size_t getFirstRow() const { return _firstRow; }
+
+    /** \brief 文件的总行数，按范围打开时由稀疏索引得到 */
+    size_t getFileRowCount() const { return _fileRows; }
+
+    /** \brief 解析一条已加载的记录，row超出已加载的范围时得到空记录 */
+    void parseRecord( size_t row, LogTextRecord * tr ) const;
+
+    virtual void loadRecords( size_t first, size_t count, std::vector<LogTextRecord> * records ) override;
+
+    /** \brief 查找第一条时间不早于utcTimeMs的记录在文件中的行号，须已建立稀疏索引，没有这样的记录返回总行数 */
+    size_t findRowByTime( winux::uint64 utcTimeMs ) const;
+
+    /** \brief 稀疏索引，按范围打开时才建立 */
+    std::vector<SparseEntry> const & getSparseIndex() const { return _sparse; }
+
+private:
+    // 读取稀疏索引文件，文件已改变时返回false
+    bool _loadSparseIndex( winux::String const & idxPath );
+    // 扫描整个文件建立稀疏索引
+    void _buildSparseIndex();
+    // 保存稀疏索引文件
+    bool _saveSparseIndex( winux::String const & idxPath ) const;
+
+    winux::FileMapping _mapping; // 文件映射
+    std::vector<winux::uint64> _offsets; // 已加载各行的起始偏移，末尾多一项为结束偏移
+    size_t _firstRow; // 已加载的第一行在文件中的行号
+    size_t _fileRows; // 文件的总行数
+    std::vector<SparseEntry> _sparse; // 稀疏索引
+    winux::uint64 _fileSize; // 建立索引时的文件大小
+    time_t _fileMTime; // 建立索引时的文件修改时间
+};
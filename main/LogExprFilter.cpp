@@ -0,0 +1,402 @@
+﻿#include "LogExprFilter.h"
+#include <math.h>
+
+using namespace eienexpr;
+
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+inline static winux::Utf8String _ToUtf8( winux::String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUtf8();
+#else
+    return LOCAL_TO_UTF8(str);
+#endif
+}
+
+inline static bool _IEqual( char const * a, char const * b, size_t n )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        char x = a[i], y = b[i];
+        if ( x >= 'A' && x <= 'Z' ) x += 'a' - 'A';
+        if ( y >= 'A' && y <= 'Z' ) y += 'a' - 'A';
+        if ( x != y ) return false;
+    }
+    return true;
+}
+
+inline static bool _Find( char const * s, size_t n, char const * sub, size_t m, bool caseSensitive )
+{
+    if ( m == 0 ) return true;
+    if ( m > n ) return false;
+    if ( caseSensitive )
+    {
+        char const * end = s + n - m + 1;
+        for ( char const * p = s; ( p = (char const *)memchr( p, sub[0], end - p ) ) != nullptr; p++ )
+        {
+            if ( memcmp( p, sub, m ) == 0 ) return true;
+        }
+        return false;
+    }
+    for ( size_t i = 0; i + m <= n; i++ )
+    {
+        if ( _IEqual( s + i, sub, m ) ) return true;
+    }
+    return false;
+}
+
+// 只按前景色判断颜色类别
+inline static LogColorClass _FgColorClass( eienlog::LogFlag flag )
+{
+    eienlog::LogFlag fg;
+    fg.fgColorUse = flag.fgColorUse;
+    fg.fgColor = flag.fgColor;
+    return GetLogColorClass(fg);
+}
+
+// 只按背景色判断颜色类别
+inline static LogColorClass _BgColorClass( eienlog::LogFlag flag )
+{
+    eienlog::LogFlag bg;
+    bg.bgColorUse = flag.bgColorUse;
+    bg.bgColor = flag.bgColor;
+    return GetLogColorClass(bg);
+}
+
+// class LogExprFilter ------------------------------------------------------------------------
+LogExprFilter::LogExprFilter( winux::Utf8String const & exprStr ) : _root(-1), _exprStr(exprStr)
+{
+    ExprPackage package;
+    VarContext ctx;
+    Expression e( &package, &ctx, nullptr, nullptr );
+    ExprParser().parse( &e, _ToString(exprStr) );
+    if ( e.isEmpty() ) throw ExprError( ExprError::eeExprParseError, "Empty filter expression" );
+    _root = this->_compile(&e);
+}
+
+int LogExprFilter::_addNode( NodeType type, int a, int b )
+{
+    Node node;
+    node.type = type;
+    node.a = a;
+    node.b = b;
+    node.num = 0;
+    _nodes.push_back( std::move(node) );
+    return (int)_nodes.size() - 1;
+}
+
+int LogExprFilter::_compile( Expression const * e )
+{
+    static std::map< winux::String, NodeType > fields = {
+        { $T("size"), ntSize }, { $T("time"), ntTime }, { $T("text"), ntText },
+        { $T("fg"), ntFg }, { $T("bg"), ntBg }, { $T("color"), ntColor },
+        { $T("fgcolor"), ntFgColor }, { $T("bgcolor"), ntBgColor },
+        { $T("binary"), ntBinary }, { $T("encoding"), ntEncoding },
+        { $T("severity"), ntSeverity }, { $T("category"), ntCategory }, { $T("template"), ntTemplate }
+    };
+    static std::map< winux::String, int > constants = {
+        { $T("none"), lccNone }, { $T("red"), lccRed }, { $T("green"), lccGreen }, { $T("blue"), lccBlue }, { $T("other"), lccOther },
+        { $T("trace"), eienlog::lsTrace }, { $T("debug"), eienlog::lsDebug }, { $T("info"), eienlog::lsInfo },
+        { $T("warning"), eienlog::lsWarning }, { $T("error"), eienlog::lsError }, { $T("fatal"), eienlog::lsFatal }
+    };
+    static std::map< winux::String, std::pair< NodeType, int > > funcs = {
+        { $T("contains"), { ntContains, 2 } }, { $T("icontains"), { ntIContains, 2 } },
+        { $T("startswith"), { ntStartsWith, 2 } }, { $T("endswith"), { ntEndsWith, 2 } },
+        { $T("len"), { ntLen, 1 } },
+        { $T("field"), { ntField, 1 } }, { $T("has"), { ntHas, 1 } }
+    };
+    static std::map< winux::String, NodeType > binaryOprs = {
+        { $T("*"), ntMul }, { $T("/"), ntDiv }, { $T("%"), ntMod }, { $T("+"), ntAdd }, { $T("-"), ntSub },
+        { $T(">"), ntGreater }, { $T("<"), ntLess }, { $T(">="), ntGreaterEqual }, { $T("<="), ntLessEqual },
+        { $T("!="), ntNotEqual }, { $T("=="), ntEqual }, { $T("&&"), ntAnd }, { $T("||"), ntOr }
+    };
+
+    std::vector<int> stk;
+    for ( ExprAtom * atom : e->_suffixAtoms )
+    {
+        if ( atom->getAtomType() == ExprAtom::eatOperand )
+        {
+            ExprOperand * opd = static_cast<ExprOperand *>(atom);
+            switch ( opd->getOperandType() )
+            {
+            case ExprOperand::eotLiteral:
+                {
+                    winux::Mixed const & val = static_cast<ExprLiteral *>(opd)->getValue();
+                    if ( val.isString() )
+                    {
+                        int i = this->_addNode(ntString);
+                        _nodes[i].str = $u8( val.toUnicode() );
+                        stk.push_back(i);
+                    }
+                    else if ( val.isNumeric() )
+                    {
+                        int i = this->_addNode(ntNumber);
+                        _nodes[i].num = val.toDouble();
+                        stk.push_back(i);
+                    }
+                    else
+                    {
+                        throw ExprError( ExprError::eeValueTypeError, "Unsupported literal in filter expression: " + _ToUtf8( opd->toString() ) );
+                    }
+                }
+                break;
+            case ExprOperand::eotIdentifier:
+                {
+                    winux::String const & name = static_cast<ExprIdentifier *>(opd)->getName();
+                    if ( winux::IsSet( fields, name ) )
+                    {
+                        stk.push_back( this->_addNode( fields[name] ) );
+                    }
+                    else if ( winux::IsSet( constants, name ) )
+                    {
+                        int i = this->_addNode(ntNumber);
+                        _nodes[i].num = constants[name];
+                        stk.push_back(i);
+                    }
+                    else
+                    {
+                        throw ExprError( ExprError::eeVarNotFound, "Unknown field in filter expression: " + _ToUtf8(name) );
+                    }
+                }
+                break;
+            case ExprOperand::eotFunction:
+                {
+                    ExprFunc * func = static_cast<ExprFunc *>(opd);
+                    if ( !winux::IsSet( funcs, func->_funcName ) )
+                    {
+                        throw ExprError( ExprError::eeFuncNotFound, "Unknown function in filter expression: " + _ToUtf8(func->_funcName) );
+                    }
+                    auto & fn = funcs[func->_funcName];
+                    if ( (int)func->_params.size() != fn.second )
+                    {
+                        throw ExprError( ExprError::eeFuncParamCountError, "Wrong parameter count: " + _ToUtf8(func->_funcName) );
+                    }
+                    int a = this->_compile( func->_params[0] );
+                    int b = fn.second > 1 ? this->_compile( func->_params[1] ) : -1;
+                    if ( fn.first == ntField || fn.first == ntHas )
+                    {
+                        // 字段名须为字符串常量，编译时记在结点上
+                        if ( _nodes[a].type != ntString )
+                        {
+                            throw ExprError( ExprError::eeValueTypeError, "Field name must be a string literal: " + _ToUtf8(func->_funcName) );
+                        }
+                        _nodes[a].type = fn.first;
+                        stk.push_back(a);
+                    }
+                    else
+                    {
+                        stk.push_back( this->_addNode( fn.first, a, b ) );
+                    }
+                }
+                break;
+            case ExprOperand::eotExpression:
+                stk.push_back( this->_compile( static_cast<Expression *>(opd) ) );
+                break;
+            default:
+                throw ExprError( ExprError::eeOperandTypeError, "Unsupported operand in filter expression: " + _ToUtf8( opd->toString() ) );
+                break;
+            }
+        }
+        else
+        {
+            ExprOperator * opr = static_cast<ExprOperator *>(atom);
+            if ( opr->isUnary() )
+            {
+                if ( stk.empty() ) throw ExprError( ExprError::eeExprParseError, "Missing operand: " + _ToUtf8( opr->getStr() ) );
+                int a = stk.back();
+                stk.pop_back();
+                if ( opr->getStr() == $T("-") )
+                    stk.push_back( this->_addNode( ntNeg, a ) );
+                else if ( opr->getStr() == $T("!") )
+                    stk.push_back( this->_addNode( ntNot, a ) );
+                else if ( opr->getStr() == $T("+") )
+                    stk.push_back(a);
+                else
+                    throw ExprError( ExprError::eeExprParseError, "Unsupported operator in filter expression: " + _ToUtf8( opr->getStr() ) );
+            }
+            else
+            {
+                if ( stk.size() < 2 ) throw ExprError( ExprError::eeExprParseError, "Missing operand: " + _ToUtf8( opr->getStr() ) );
+                if ( !winux::IsSet( binaryOprs, opr->getStr() ) )
+                {
+                    throw ExprError( ExprError::eeExprParseError, "Unsupported operator in filter expression: " + _ToUtf8( opr->getStr() ) );
+                }
+                int b = stk.back();
+                stk.pop_back();
+                int a = stk.back();
+                stk.pop_back();
+                stk.push_back( this->_addNode( binaryOprs[ opr->getStr() ], a, b ) );
+            }
+        }
+    }
+
+    if ( stk.size() != 1 ) throw ExprError( ExprError::eeExprParseError, "Invalid filter expression" );
+    return stk.back();
+}
+
+void LogExprFilter::_eval( int node, LogTextRecord const & tr, LogFieldRow const & fields, Value * v ) const
+{
+    Node const & n = _nodes[node];
+    v->isStr = false;
+    switch ( n.type )
+    {
+    case ntNumber: v->num = n.num; break;
+    case ntString: v->isStr = true; v->str = n.str.c_str(); v->len = n.str.length(); break;
+    case ntSize: v->num = (double)tr.contentSize; break;
+    case ntTime: v->num = (double)tr.utcTimeMs; break;
+    case ntText: v->isStr = true; v->str = tr.strContent.c_str(); v->len = tr.strContent.length(); break;
+    case ntFg: v->num = _FgColorClass(tr.flag); break;
+    case ntBg: v->num = _BgColorClass(tr.flag); break;
+    case ntColor: v->num = GetLogColorClass(tr.flag); break;
+    case ntFgColor: v->num = tr.flag.fgColorUse ? tr.flag.fgColor : -1; break;
+    case ntBgColor: v->num = tr.flag.bgColorUse ? tr.flag.bgColor : -1; break;
+    case ntBinary: v->num = tr.flag.binary; break;
+    case ntEncoding: v->num = tr.flag.logEncoding; break;
+    case ntSeverity: v->num = tr.meta.severity; break;
+    case ntCategory: v->num = tr.meta.category; break;
+    case ntTemplate: v->num = tr.templateId; break;
+    case ntNeg: this->_eval( n.a, tr, fields, v ); v->num = v->isStr ? 0 : -v->num; v->isStr = false; break;
+    case ntNot: v->num = !this->_evalBool( n.a, tr, fields ); break;
+    case ntAnd: v->num = this->_evalBool( n.a, tr, fields ) && this->_evalBool( n.b, tr, fields ); break;
+    case ntOr: v->num = this->_evalBool( n.a, tr, fields ) || this->_evalBool( n.b, tr, fields ); break;
+    case ntLen: this->_eval( n.a, tr, fields, v ); v->num = v->isStr ? (double)v->len : 0; v->isStr = false; break;
+    case ntHas: v->num = fields.find(n.str) != nullptr; break;
+    case ntField:
+        {
+            LogFieldBlock::Column const * col = fields.find(n.str);
+            if ( col == nullptr )
+            {
+                v->num = NAN;
+            }
+            else if ( col->isNumeric() )
+            {
+                v->num = col->getNumber(fields.offset);
+            }
+            else
+            {
+                winux::AnsiString const & s = col->strs[fields.offset];
+                v->isStr = true;
+                v->str = s.c_str();
+                v->len = s.length();
+            }
+        }
+        break;
+    case ntContains:
+    case ntIContains:
+    case ntStartsWith:
+    case ntEndsWith:
+        {
+            Value s, sub;
+            this->_eval( n.a, tr, fields, &s );
+            this->_eval( n.b, tr, fields, &sub );
+            if ( !s.isStr || !sub.isStr )
+            {
+                v->num = 0;
+            }
+            else if ( n.type == ntContains || n.type == ntIContains )
+            {
+                v->num = _Find( s.str, s.len, sub.str, sub.len, n.type == ntContains );
+            }
+            else
+            {
+                v->num = sub.len <= s.len && memcmp( n.type == ntStartsWith ? s.str : s.str + s.len - sub.len, sub.str, sub.len ) == 0;
+            }
+        }
+        break;
+    default: // 二元算术与比较
+        {
+            Value x, y;
+            this->_eval( n.a, tr, fields, &x );
+            this->_eval( n.b, tr, fields, &y );
+            if ( x.isStr && y.isStr && n.type >= ntGreater )
+            {
+                int r = memcmp( x.str, y.str, x.len < y.len ? x.len : y.len );
+                if ( r == 0 ) r = x.len < y.len ? -1 : ( x.len > y.len ? 1 : 0 );
+                switch ( n.type )
+                {
+                case ntGreater: v->num = r > 0; break;
+                case ntLess: v->num = r < 0; break;
+                case ntGreaterEqual: v->num = r >= 0; break;
+                case ntLessEqual: v->num = r <= 0; break;
+                case ntNotEqual: v->num = r != 0; break;
+                default: v->num = r == 0; break;
+                }
+            }
+            else if ( x.isStr || y.isStr )
+            {
+                // 字符串和数字不可比，只有“不等于”成立
+                v->num = n.type == ntNotEqual;
+            }
+            else
+            {
+                switch ( n.type )
+                {
+                case ntMul: v->num = x.num * y.num; break;
+                case ntDiv: v->num = y.num != 0 ? x.num / y.num : 0; break;
+                case ntMod: v->num = (winux::int64)y.num != 0 ? (double)( (winux::int64)x.num % (winux::int64)y.num ) : 0; break;
+                case ntAdd: v->num = x.num + y.num; break;
+                case ntSub: v->num = x.num - y.num; break;
+                case ntGreater: v->num = x.num > y.num; break;
+                case ntLess: v->num = x.num < y.num; break;
+                case ntGreaterEqual: v->num = x.num >= y.num; break;
+                case ntLessEqual: v->num = x.num <= y.num; break;
+                case ntNotEqual: v->num = x.num != y.num; break;
+                default: v->num = x.num == y.num; break;
+                }
+            }
+        }
+        break;
+    }
+}
+
+bool LogExprFilter::_evalBool( int node, LogTextRecord const & tr, LogFieldRow const & fields ) const
+{
+    Value v;
+    this->_eval( node, tr, fields, &v );
+    return v.isStr ? v.len > 0 : v.num != 0 && !isnan(v.num); // 缺少的字段为假
+}
+
+bool LogExprFilter::match( LogTextRecord const & tr ) const
+{
+    return this->matchRow( tr, LogFieldRow() );
+}
+
+bool LogExprFilter::matchRow( LogTextRecord const & tr, LogFieldRow const & fields ) const
+{
+    return this->_evalBool( _root, tr, fields );
+}
+
+winux::Utf8String LogExprFilter::getDescription() const
+{
+    return _exprStr;
+}
+
+bool LogExprFilter::_findIndexQuery( int node, winux::Utf8String * text, bool * caseSensitive ) const
+{
+    Node const & n = _nodes[node];
+    if ( n.type == ntAnd )
+    {
+        return this->_findIndexQuery( n.a, text, caseSensitive ) || this->_findIndexQuery( n.b, text, caseSensitive );
+    }
+    if ( ( n.type == ntContains || n.type == ntIContains ) && _nodes[n.a].type == ntText && _nodes[n.b].type == ntString )
+    {
+        *text = _nodes[n.b].str;
+        *caseSensitive = n.type == ntContains;
+        return true;
+    }
+    return false;
+}
+
+bool LogExprFilter::getIndexQuery( winux::Utf8String * text, LogSearchIndex::SearchMode * mode, bool * caseSensitive ) const
+{
+    *mode = LogSearchIndex::smSubstring;
+    return this->_findIndexQuery( _root, text, caseSensitive );
+}
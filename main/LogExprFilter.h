@@ -0,0 +1,70 @@
+﻿#pragma once
+#include "eienexpr.hpp"
+#include "LogFilter.h"
+
+/** \brief 表达式筛选器
+ *
+ *  用eienexpr解析表达式，再把后缀式编译成求值树。记录字段在编译时解析成槽位，逐条求值时不查找变量、不构建变量场景、不分配内存。\n
+ *  字段：size 内容大小，time 时间戳（毫秒），text 内容，fg/bg/color 前景/背景/综合颜色类别，fgcolor/bgcolor 原始颜色值，binary 是否二进制，encoding 编码，severity 级别，category 类别，template 模板编号（未启用模板字典时为0）。\n
+ *  常量：none red green blue other，trace debug info warning error fatal。\n
+ *  函数：contains(s,sub) icontains(s,sub) startswith(s,prefix) endswith(s,suffix) len(s)。\n
+ *  结构化字段：field("key") 取字段值，从按列存放的字段中读取，不解析文本，没有此字段时为NaN，除!=外的比较都不成立；has("key") 是否有此字段。\n
+ *  例：`size > 1000 && fg == red && contains(text, "timeout")`，`field("latency") > 200 && field("user") == "bob"` */
+class LogExprFilter : public LogFilter
+{
+public:
+    /** \brief 构造函数，表达式有误时抛出eienexpr::ExprError */
+    explicit LogExprFilter( winux::Utf8String const & exprStr );
+
+    virtual bool match( LogTextRecord const & tr ) const override;
+    virtual bool matchRow( LogTextRecord const & tr, LogFieldRow const & fields ) const override;
+    virtual winux::Utf8String getDescription() const override;
+    virtual bool getIndexQuery( winux::Utf8String * text, LogSearchIndex::SearchMode * mode, bool * caseSensitive ) const override;
+
+private:
+    // 求值树结点类型
+    enum NodeType
+    {
+        ntNumber, ntString,
+        ntSize, ntTime, ntText, ntFg, ntBg, ntColor, ntFgColor, ntBgColor, ntBinary, ntEncoding, ntSeverity, ntCategory, ntTemplate,
+        ntNeg, ntNot,
+        ntMul, ntDiv, ntMod, ntAdd, ntSub,
+        ntGreater, ntLess, ntGreaterEqual, ntLessEqual, ntNotEqual, ntEqual,
+        ntAnd, ntOr,
+        ntContains, ntIContains, ntStartsWith, ntEndsWith, ntLen,
+        ntField, ntHas
+    };
+
+    // 求值树结点
+    struct Node
+    {
+        NodeType type;
+        int a, b; // 子结点索引
+        double num; // 数字常量
+        winux::Utf8String str; // 字符串常量，或字段名
+    };
+
+    // 求值结果
+    struct Value
+    {
+        double num;
+        char const * str;
+        size_t len;
+        bool isStr;
+    };
+
+    // 把表达式的后缀式编译成求值树，返回根结点索引
+    int _compile( eienexpr::Expression const * e );
+    // 添加一个结点
+    int _addNode( NodeType type, int a = -1, int b = -1 );
+    // 求值
+    void _eval( int node, LogTextRecord const & tr, LogFieldRow const & fields, Value * v ) const;
+    // 求值并转成布尔
+    bool _evalBool( int node, LogTextRecord const & tr, LogFieldRow const & fields ) const;
+    // 从与运算链中找出可交给索引的文本条件
+    bool _findIndexQuery( int node, winux::Utf8String * text, bool * caseSensitive ) const;
+
+    std::vector<Node> _nodes; // 求值树结点
+    int _root; // 根结点
+    winux::Utf8String _exprStr; // 表达式文本
+};
@@ -0,0 +1,25 @@
+﻿#include "LogFeed.h"
+
+// struct LogFeed -----------------------------------------------------------------------------
+size_t LogFeed::addLog( LogTextRecord && tr, std::vector<eienlog::LogField> const * fields )
+{
+    size_t firstRow = this->logs.getFirstRow();
+    size_t row = this->logs.append( std::move(tr), fields );
+    LogTextRecord const & log = this->logs[row];
+    this->rates.add( log.utcTimeMs, log.contentSize, GetLogColorClass(log.flag) );
+    this->searchIndex.add( (winux::uint32)row, log.strContent );
+    if ( this->logs.getFirstRow() != firstRow ) // 淘汰了最早的块
+    {
+        this->searchIndex.evict( (winux::uint32)this->logs.getFirstRow() );
+    }
+    return row;
+}
+
+void LogFeed::clear()
+{
+    this->logs.clear();
+    this->searchIndex.clear();
+    this->collapser.clear();
+    this->rates.clear();
+    this->clearCount++;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <mutex>
+#include "LogStore.h"
+#include "LogSearchIndex.h"
+#include "LogCollapse.h"
+#include "LogRateTimeline.h"
+
+/** \brief 日志数据
+ *
+ *  日志存储及随存储维护的搜索索引、重复折叠和速率时间线。多个窗口共享同一份日志数据，
+ *  各窗口只保留自己的筛选视图、排序索引和选择，每帧在界面线程里接续上次处理到的行，
+ *  因此接收日志的开销与窗口数、视图数无关。 */
+struct LogFeed
+{
+    /** \brief 追加一条日志并更新索引和速率，存储淘汰了记录时一并丢弃索引中的这些行，调用者须持有mtx
+     *
+     *  \param tr 记录
+     *  \param fields 结构化字段记录解析出的字段，为空时由存储从文本解析
+     *  \return 新记录的行号 */
+    size_t addLog( LogTextRecord && tr, std::vector<eienlog::LogField> const * fields = nullptr );
+
+    /** \brief 清空日志及索引，调用者须持有mtx */
+    void clear();
+
+    LogStore logs; //!< 日志存储，有效行为[logs.getFirstRow(), logs.size())
+    LogSearchIndex searchIndex; //!< 全文搜索索引
+    LogCollapser collapser; //!< 接收日志时折叠重复行
+    LogRateTimeline rates; //!< 日志速率时间线，折叠的重复记录也计入
+    winux::uint64 clearCount = 0; //!< 清空的次数，窗口据此发现其他窗口清空了日志
+    std::mutex mtx; //!< 数据同步互斥量
+};
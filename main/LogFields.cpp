@@ -0,0 +1,251 @@
+﻿#include "LogFields.h"
+#include <math.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 最低的置位位的序号，v不为0
+inline static size_t _LowestBit( winux::uint64 v )
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanForward64( &i, v );
+    return i;
+#elif defined(__GNUC__)
+    return (size_t)__builtin_ctzll(v);
+#else
+    size_t n = 0;
+    for ( ; !( v & 1 ); v >>= 1 ) n++;
+    return n;
+#endif
+}
+
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+winux::Utf8String LogFieldsToText( std::vector<eienlog::LogField> const & fields )
+{
+    winux::Utf8String text;
+    char buf[64];
+    for ( auto && field : fields )
+    {
+        if ( !text.empty() ) text += ' ';
+        text += field.key;
+        text += '=';
+        switch ( field.type )
+        {
+        case eienlog::lftInt:
+            snprintf( buf, sizeof(buf), "%lld", (long long)field.i );
+            text += buf;
+            break;
+        case eienlog::lftFloat:
+            // 没有小数点和指数时补上".0"，与整数区分
+            snprintf( buf, sizeof(buf), "%.17g", field.f );
+            text += buf;
+            if ( strpbrk( buf, ".eEni" ) == nullptr ) text += ".0";
+            break;
+        case eienlog::lftString:
+            text += '"';
+            text += winux::AddCSlashes(field.s);
+            text += '"';
+            break;
+        case eienlog::lftBytes:
+            {
+                winux::AnsiString hex = winux::BufferToHex<char>( winux::Buffer( field.s.c_str(), field.s.length(), true ) );
+                winux::StrMakeUpper(&hex);
+                text += '<';
+                text += hex;
+                text += '>';
+            }
+            break;
+        case eienlog::lftTime:
+            text += '@';
+            text += winux::DateTimeL::FromMilliSec(field.i).toString<char>();
+            break;
+        default: // lftCount不是字段类型
+            break;
+        }
+    }
+    return text;
+}
+
+bool LogFieldsFromText( winux::Utf8String const & text, std::vector<eienlog::LogField> * fields )
+{
+    fields->clear();
+    char const * p = text.c_str();
+    char const * end = p + text.length();
+    while ( p < end )
+    {
+        eienlog::LogField field;
+        char const * eq = (char const *)memchr( p, '=', end - p );
+        if ( eq == nullptr || eq == p ) return false;
+        field.key.assign( p, eq - p );
+        p = eq + 1;
+        if ( p == end ) return false;
+
+        char const * valEnd;
+        if ( *p == '"' ) // 字符串，找到未转义的引号
+        {
+            char const * q = p + 1;
+            while ( q < end && *q != '"' ) q += *q == '\\' ? 2 : 1;
+            if ( q >= end ) return false;
+            field.type = eienlog::lftString;
+            field.s = winux::StripCSlashes( winux::AnsiString( p + 1, q - p - 1 ) );
+            valEnd = q + 1;
+        }
+        else
+        {
+            valEnd = (char const *)memchr( p, ' ', end - p );
+            if ( valEnd == nullptr ) valEnd = end;
+            winux::AnsiString val( p, valEnd - p );
+            if ( val[0] == '<' ) // 字节串
+            {
+                if ( val.back() != '>' ) return false;
+                field.type = eienlog::lftBytes;
+                field.s = winux::HexToBuffer( val.substr( 1, val.length() - 2 ) ).toAnsi();
+            }
+            else if ( val[0] == '@' ) // 时间戳
+            {
+                field.type = eienlog::lftTime;
+                field.i = (winux::int64)winux::DateTimeL( _ToString( val.substr(1) ) ).toUtcTimeMs();
+            }
+            else
+            {
+                char * numEnd;
+                if ( val.find_first_of(".eEni") != winux::AnsiString::npos )
+                {
+                    field.type = eienlog::lftFloat;
+                    field.f = strtod( val.c_str(), &numEnd );
+                }
+                else
+                {
+                    field.type = eienlog::lftInt;
+                    field.i = strtoll( val.c_str(), &numEnd, 10 );
+                }
+                if ( numEnd != val.c_str() + val.length() ) return false;
+            }
+        }
+        fields->push_back( std::move(field) );
+
+        p = valEnd;
+        if ( p < end )
+        {
+            if ( *p != ' ' ) return false;
+            p++;
+        }
+    }
+    return true;
+}
+
+// class LogFieldBlock ------------------------------------------------------------------------
+void LogFieldBlock::set( size_t offset, std::vector<eienlog::LogField> const & fields )
+{
+    size_t count = _count.load(std::memory_order_relaxed);
+    for ( auto && field : fields )
+    {
+        // 按字段名和类型找列，没有时新建
+        Column * col = nullptr;
+        for ( size_t i = 0; i < count; i++ )
+        {
+            Column * c = _columns[i].get();
+            if ( c->type == field.type && c->key == field.key )
+            {
+                col = c;
+                break;
+            }
+        }
+        if ( col == nullptr )
+        {
+            if ( count == MaxColumns ) continue;
+            col = new Column();
+            col->key = field.key;
+            col->type = field.type;
+            col->present = std::vector< std::atomic<winux::uint64> >( ( _capacity + 63 ) / 64 );
+            if ( field.type == eienlog::lftFloat )
+                col->floats.resize(_capacity);
+            else if ( col->isNumeric() )
+                col->ints.resize(_capacity);
+            else
+                col->strs.resize(_capacity);
+            _columns[count].attachNew(col);
+            _count.store( ++count, std::memory_order_release ); // 列的内容写好之后再发布
+        }
+
+        switch ( field.type )
+        {
+        case eienlog::lftFloat: col->floats[offset] = field.f; break;
+        case eienlog::lftInt:
+        case eienlog::lftTime: col->ints[offset] = field.i; break;
+        default: col->strs[offset] = field.s; break;
+        }
+        col->present[ offset / 64 ].fetch_or( (winux::uint64)1 << ( offset % 64 ), std::memory_order_relaxed );
+    }
+}
+
+LogFieldBlock::Column const * LogFieldBlock::find( winux::AnsiString const & key, size_t offset ) const
+{
+    size_t count = this->getColumnCount();
+    for ( size_t i = 0; i < count; i++ )
+    {
+        Column const * col = _columns[i].get();
+        if ( col->key.length() == key.length() && col->has(offset) && col->key == key ) return col;
+    }
+    return nullptr;
+}
+
+// struct LogFieldStats -----------------------------------------------------------------------
+void LogFieldStats::clear()
+{
+    count = 0;
+    numCount = 0;
+    sum = 0;
+    min = 0;
+    max = 0;
+}
+
+void LogFieldStats::_addNumber( double v )
+{
+    if ( isnan(v) ) return;
+    if ( numCount == 0 || v < min ) min = v;
+    if ( numCount == 0 || v > max ) max = v;
+    sum += v;
+    numCount++;
+}
+
+void LogFieldStats::add( LogFieldBlock const & block, winux::AnsiString const & key, size_t begin, size_t end )
+{
+    size_t columns = block.getColumnCount();
+    for ( size_t i = 0; i < columns; i++ )
+    {
+        LogFieldBlock::Column const & col = block.getColumn(i);
+        if ( col.key != key ) continue;
+        // 按位图逐字跳过没有此字段的行
+        for ( size_t w = begin / 64; w * 64 < end; w++ )
+        {
+            winux::uint64 bits = col.present[w].load(std::memory_order_relaxed);
+            if ( w == begin / 64 ) bits &= ~(winux::uint64)0 << ( begin % 64 );
+            if ( ( w + 1 ) * 64 > end ) bits &= ~( ~(winux::uint64)0 << ( end % 64 ) );
+            for ( ; bits != 0; bits &= bits - 1 )
+            {
+                size_t offset = w * 64 + _LowestBit(bits);
+                count++;
+                if ( col.isNumeric() ) this->_addNumber( col.getNumber(offset) );
+            }
+        }
+    }
+}
+
+void LogFieldStats::add( LogFieldRow const & row, winux::AnsiString const & key )
+{
+    LogFieldBlock::Column const * col = row.find(key);
+    if ( col == nullptr ) return;
+    count++;
+    if ( col->isNumeric() ) this->_addNumber( col->getNumber(row.offset) );
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+#include <atomic>
+#include "eienlog.hpp"
+
+/** \brief 把结构化字段渲染成文本
+ *
+ *  字段以空格分隔，形如`key=value`。整数原样输出，浮点数总带小数点或指数，字符串加双引号并按C风格转义，
+ *  字节串为尖括号内的十六进制，时间戳为`@`加本地时间。文本可由LogFieldsFromText()无损还原。 */
+winux::Utf8String LogFieldsToText( std::vector<eienlog::LogField> const & fields );
+
+/** \brief 从LogFieldsToText()生成的文本解析出字段，格式有误返回false */
+bool LogFieldsFromText( winux::Utf8String const & text, std::vector<eienlog::LogField> * fields );
+
+/** \brief 一块记录的结构化字段，按列存放
+ *
+ *  每个字段名和类型占一列，列内按块内偏移存放值，另有一个位图标记哪些行有此字段，筛选和统计时按列读取，不解析文本。
+ *  列在首次出现时分配整块容量，此后不再搬移，列数用原子量发布，因此追加时其他线程可以同时读取已追加的行。
+ *  一块最多MaxColumns列，超出的字段只保留在文本中。 */
+class LogFieldBlock
+{
+public:
+    enum { MaxColumns = 32 }; //!< 每块最多的列数
+
+    /** \brief 一列 */
+    struct Column
+    {
+        winux::AnsiString key;          //!< 字段名
+        eienlog::LogFieldType type;     //!< 字段类型
+        std::vector< std::atomic<winux::uint64> > present; //!< 有此字段的行的位图
+        std::vector<winux::int64> ints;     //!< 整数、时间戳列
+        std::vector<double> floats;         //!< 浮点数列
+        std::vector<winux::AnsiString> strs; //!< 字符串、字节串列
+
+        /** \brief 块内第offset行是否有此字段 */
+        bool has( size_t offset ) const { return ( present[ offset / 64 ].load(std::memory_order_relaxed) >> ( offset % 64 ) ) & 1; }
+
+        /** \brief 是否数值列 */
+        bool isNumeric() const { return type == eienlog::lftInt || type == eienlog::lftFloat || type == eienlog::lftTime; }
+
+        /** \brief 第offset行的数值，非数值列返回0 */
+        double getNumber( size_t offset ) const
+        {
+            if ( type == eienlog::lftFloat ) return floats[offset];
+            return isNumeric() ? (double)ints[offset] : 0;
+        }
+    };
+
+    explicit LogFieldBlock( size_t capacity ) : _capacity(capacity), _count(0) { }
+
+    /** \brief 设置块内第offset行的字段，只由追加记录的线程调用 */
+    void set( size_t offset, std::vector<eienlog::LogField> const & fields );
+
+    /** \brief 列数 */
+    size_t getColumnCount() const { return _count.load(std::memory_order_acquire); }
+
+    /** \brief 第i列 */
+    Column const & getColumn( size_t i ) const { return *_columns[i].get(); }
+
+    /** \brief 查找第offset行名为key的字段所在的列，没有时返回nullptr */
+    Column const * find( winux::AnsiString const & key, size_t offset ) const;
+
+private:
+    size_t _capacity; // 每列的行数
+    winux::SimplePointer<Column> _columns[MaxColumns];
+    std::atomic<size_t> _count; // 已发布的列数
+};
+
+/** \brief 一行的结构化字段 */
+struct LogFieldRow
+{
+    LogFieldBlock const * block; //!< 所在块的字段，可为空
+    size_t offset; //!< 块内偏移
+
+    LogFieldRow() : block(nullptr), offset(0) { }
+    LogFieldRow( LogFieldBlock const * block, size_t offset ) : block(block), offset(offset) { }
+
+    /** \brief 查找名为key的字段所在的列，没有时返回nullptr */
+    LogFieldBlock::Column const * find( winux::AnsiString const & key ) const { return block ? block->find( key, offset ) : nullptr; }
+};
+
+/** \brief 一个字段的统计 */
+struct LogFieldStats
+{
+    size_t count;       //!< 有此字段的行数
+    size_t numCount;    //!< 其中数值的行数
+    double sum, min, max; //!< 数值的合计、最小、最大值
+
+    LogFieldStats() { this->clear(); }
+
+    void clear();
+
+    /** \brief 平均值，没有数值时为0 */
+    double getAvg() const { return numCount ? sum / numCount : 0; }
+
+    /** \brief 按列统计一块中[begin, end)行的key字段 */
+    void add( LogFieldBlock const & block, winux::AnsiString const & key, size_t begin, size_t end );
+
+    /** \brief 统计一行的key字段 */
+    void add( LogFieldRow const & row, winux::AnsiString const & key );
+
+private:
+    // 累计一个数值
+    void _addNumber( double v );
+};
@@ -0,0 +1,247 @@
+﻿#include "LogFilter.h"
+#include "LogParallelScan.h"
+
+static char const * _ColorClassNames[] = { u8"无颜色", u8"红色系", u8"绿色系", u8"蓝色系", u8"其他颜色" };
+
+// class LogCondFilter ------------------------------------------------------------------------
+LogCondFilter::LogCondFilter() : colorClass(-1), severityMask(0), categoryMask(0), minSize(0), maxSize(0), timeBegin(0), timeEnd(0), textMode(LogSearchIndex::smSubstring), textCaseSensitive(false)
+{
+}
+
+bool LogCondFilter::match( LogTextRecord const & tr ) const
+{
+    if ( colorClass != -1 && GetLogColorClass(tr.flag) != colorClass ) return false;
+    if ( severityMask != 0 && !( severityMask >> tr.meta.severity & 1 ) ) return false;
+    if ( categoryMask != 0 && !( categoryMask >> tr.meta.category & 1 ) ) return false;
+    if ( tr.contentSize < minSize ) return false;
+    if ( maxSize != 0 && tr.contentSize > maxSize ) return false;
+    if ( timeBegin != 0 && tr.utcTimeMs < timeBegin ) return false;
+    if ( timeEnd != 0 && tr.utcTimeMs >= timeEnd ) return false;
+    if ( !text.empty() && !LogSearchIndex::Match( tr.strContent, text, textMode, textCaseSensitive ) ) return false;
+    return true;
+}
+
+winux::Utf8String LogCondFilter::getDescription() const
+{
+    winux::Utf8String desc;
+    if ( colorClass >= 0 && colorClass < lccCount )
+    {
+        desc += _ColorClassNames[colorClass];
+        desc += " ";
+    }
+    if ( severityMask != 0 )
+    {
+        desc += u8"级别";
+        for ( int i = 0; i <= eienlog::lsFatal; i++ )
+        {
+            if ( severityMask >> i & 1 ) desc += winux::Utf8String(GetLogSeverityName(i)) + "|";
+        }
+        desc.back() = ' ';
+    }
+    if ( categoryMask != 0 )
+    {
+        desc += u8"类别";
+        for ( int i = 0; i < LOG_CATEGORY_COUNT; i++ )
+        {
+            if ( categoryMask >> i & 1 ) desc += winux::FormatA( "%d|", i );
+        }
+        desc.back() = ' ';
+    }
+    if ( minSize != 0 )
+    {
+        desc += winux::FormatA( u8"长度>=%u ", (winux::uint)minSize );
+    }
+    if ( maxSize != 0 )
+    {
+        desc += winux::FormatA( u8"长度<=%u ", (winux::uint)maxSize );
+    }
+    if ( timeBegin != 0 )
+    {
+        desc += u8"自" + winux::DateTimeL::FromMilliSec(timeBegin).toString<char>() + " ";
+    }
+    if ( timeEnd != 0 )
+    {
+        desc += u8"至" + winux::DateTimeL::FromMilliSec(timeEnd).toString<char>() + " ";
+    }
+    if ( !text.empty() )
+    {
+        desc += u8"含“" + text + u8"” ";
+    }
+    if ( desc.empty() )
+    {
+        desc = u8"全部";
+    }
+    else
+    {
+        desc.erase( desc.length() - 1 );
+    }
+    return desc;
+}
+
+bool LogCondFilter::getIndexQuery( winux::Utf8String * text, LogSearchIndex::SearchMode * mode, bool * caseSensitive ) const
+{
+    if ( this->text.empty() ) return false;
+    *text = this->text;
+    *mode = textMode;
+    *caseSensitive = textCaseSensitive;
+    return true;
+}
+
+bool LogCondFilter::getMetaQuery( LogMetaQuery * query ) const
+{
+    if ( severityMask == 0 && categoryMask == 0 ) return false;
+    query->severityMask = severityMask;
+    query->categoryMask = categoryMask;
+    query->timeBegin = timeBegin;
+    query->timeEnd = timeEnd;
+    return true;
+}
+
+// class LogTemplateFilter --------------------------------------------------------------------
+winux::Utf8String LogTemplateFilter::getDescription() const
+{
+    return u8"模板 " + _templateText;
+}
+
+bool LogTemplateFilter::getTemplateQuery( winux::uint32 * templateId ) const
+{
+    *templateId = _templateId;
+    return true;
+}
+
+// class LogFilterView ------------------------------------------------------------------------
+LogFilterView::LogFilterView( winux::SharedPointer<LogFilter> filter ) : _filter(filter), _firstIndex(0), _scannedRows(0)
+{
+}
+
+LogFilterView::~LogFilterView()
+{
+}
+
+void LogFilterView::update( LogStore const & store, LogSearchIndex const * index )
+{
+    // 并行扫描期间暂缓，由poll()接续
+    if ( _scan ) return;
+
+    // 存储被清空过，重新开始
+    if ( store.size() < _scannedRows ) this->reset();
+
+    // 跳过已淘汰的行
+    bool firstScan = _scannedRows == 0;
+    this->_evict( store.getFirstRow() );
+    if ( _scannedRows < store.getFirstRow() ) _scannedRows = store.getFirstRow();
+
+    size_t count = store.size();
+    if ( _scannedRows == count ) return;
+
+    LogStore::Reader reader(store);
+    winux::Utf8String text;
+    LogSearchIndex::SearchMode mode;
+    bool caseSensitive;
+    LogMetaQuery metaQuery;
+    winux::uint32 templateId;
+    if ( _filter->getTemplateQuery(&templateId) )
+    {
+        // 只读取模板编号列，不读取记录
+        store.findByTemplate( templateId, _scannedRows, count, &_rows );
+    }
+    else if ( firstScan && index != nullptr && index->getRowCount() == count && _filter->getIndexQuery( &text, &mode, &caseSensitive ) )
+    {
+        // 首次扫描，先由索引得到满足文本条件的行，再检查其余条件
+        std::vector<winux::uint32> rows;
+        index->search( store, text, mode, caseSensitive, &rows );
+        for ( winux::uint32 row : rows )
+        {
+            if ( _filter->matchRow( reader[row], reader.fields(row) ) ) _rows.push_back(row);
+        }
+    }
+    else if ( firstScan && _filter->getMetaQuery(&metaQuery) )
+    {
+        // 首次扫描，先由级别、类别位图得到候选行，再检查其余条件
+        std::vector<winux::uint32> rows;
+        store.findByMeta( metaQuery, &rows );
+        for ( winux::uint32 row : rows )
+        {
+            if ( _filter->matchRow( reader[row], reader.fields(row) ) ) _rows.push_back(row);
+        }
+    }
+    else
+    {
+        for ( size_t row = _scannedRows; row < count; row++ )
+        {
+            if ( _filter->matchRow( reader[row], reader.fields(row) ) ) _rows.push_back( (winux::uint32)row );
+        }
+    }
+    _scannedRows = count;
+}
+
+void LogFilterView::updateParallel( winux::ThreadPool * pool, LogStore const & store, LogSearchIndex const * index )
+{
+    this->reset();
+
+    // 模板条件只读取模板编号列，直接得出结果
+    winux::uint32 templateId;
+    if ( _filter->getTemplateQuery(&templateId) )
+    {
+        this->update(store);
+        return;
+    }
+
+    winux::Utf8String text;
+    LogSearchIndex::SearchMode mode;
+    bool caseSensitive;
+    std::vector<winux::uint32> candidates;
+    bool useCandidates = index != nullptr && index->getRowCount() == store.size() && _filter->getIndexQuery( &text, &mode, &caseSensitive ) && index->getCandidates( text, &candidates );
+    LogMetaQuery metaQuery;
+    if ( !useCandidates && _filter->getMetaQuery(&metaQuery) )
+    {
+        store.findByMeta( metaQuery, &candidates );
+        useCandidates = true;
+    }
+
+    _scan.attachNew( new LogParallelScan( pool, store, _filter, useCandidates ? &candidates : nullptr ) );
+    _scan->start();
+}
+
+bool LogFilterView::poll( LogStore const & store )
+{
+    if ( !_scan ) return false;
+
+    bool done = _scan->isDone(); // 先判断完成，再取结果，保证完成时不会漏取最后的块
+    bool changed = _scan->takeRows(&_rows) > 0;
+    this->_evict( store.getFirstRow() ); // 扫描的快照中可能有之后被淘汰的行
+    if ( done )
+    {
+        _scannedRows = _scan->getRowCount();
+        _scan.reset();
+        size_t count = _rows.size();
+        this->update(store); // 接续扫描期间追加的记录
+        changed = changed || _rows.size() != count;
+    }
+    return changed;
+}
+
+float LogFilterView::getProgress() const
+{
+    return _scan ? _scan->getProgress() : 1.0f;
+}
+
+void LogFilterView::reset()
+{
+    _scan.reset();
+    _rows.clear();
+    _rows.shrink_to_fit();
+    _firstIndex = 0;
+    _scannedRows = 0;
+}
+
+void LogFilterView::_evict( size_t firstRow )
+{
+    while ( _firstIndex < _rows.size() && _rows[_firstIndex] < firstRow ) _firstIndex++;
+    // 过期的项不少于有效项时才搬移，摊还到每项是O(1)的
+    if ( _firstIndex > 0 && _firstIndex >= _rows.size() - _firstIndex )
+    {
+        _rows.erase( _rows.begin(), _rows.begin() + _firstIndex );
+        _firstIndex = 0;
+    }
+}
@@ -0,0 +1,139 @@
+﻿#pragma once
+#include "LogStore.h"
+#include "LogSearchIndex.h"
+
+/** \brief 日志筛选器基类 */
+class LogFilter
+{
+public:
+    virtual ~LogFilter() { }
+
+    /** \brief 判断记录是否满足筛选条件 */
+    virtual bool match( LogTextRecord const & tr ) const = 0;
+
+    /** \brief 判断记录是否满足筛选条件，可使用记录的结构化字段。默认只判断记录 */
+    virtual bool matchRow( LogTextRecord const & tr, LogFieldRow const & fields ) const { return this->match(tr); }
+
+    /** \brief 筛选条件的描述文字 */
+    virtual winux::Utf8String getDescription() const = 0;
+
+    /** \brief 获取可交给搜索索引预筛候选行的文本条件
+     *
+     *  满足筛选条件的记录必须也满足返回的文本条件。无文本条件时返回false */
+    virtual bool getIndexQuery( winux::Utf8String * text, LogSearchIndex::SearchMode * mode, bool * caseSensitive ) const { return false; }
+
+    /** \brief 获取可交给存储的级别、类别位图预筛候选行的条件
+     *
+     *  满足筛选条件的记录必须也满足返回的条件。无此类条件时返回false */
+    virtual bool getMetaQuery( LogMetaQuery * query ) const { return false; }
+
+    /** \brief 获取可直接由存储的模板编号列得出结果的模板条件
+     *
+     *  返回true时满足筛选条件的记录恰为模板编号等于templateId的记录，不再逐条检查。无此类条件时返回false */
+    virtual bool getTemplateQuery( winux::uint32 * templateId ) const { return false; }
+};
+
+/** \brief 条件筛选器，所有设置的条件同时满足才匹配 */
+class LogCondFilter : public LogFilter
+{
+public:
+    LogCondFilter();
+
+    virtual bool match( LogTextRecord const & tr ) const override;
+    virtual winux::Utf8String getDescription() const override;
+    virtual bool getIndexQuery( winux::Utf8String * text, LogSearchIndex::SearchMode * mode, bool * caseSensitive ) const override;
+    virtual bool getMetaQuery( LogMetaQuery * query ) const override;
+
+    int colorClass; //!< 颜色类别（LogColorClass），-1表示不限
+    winux::uint8 severityMask; //!< 级别位掩码，0表示不限
+    winux::uint16 categoryMask; //!< 类别位掩码，0表示不限
+    size_t minSize; //!< 最小内容大小
+    size_t maxSize; //!< 最大内容大小，0表示不限
+    winux::uint64 timeBegin; //!< 起始时间（毫秒，含），0表示不限
+    winux::uint64 timeEnd; //!< 结束时间（毫秒，不含），0表示不限
+    winux::Utf8String text; //!< 包含文本，空表示不限
+    LogSearchIndex::SearchMode textMode; //!< 文本搜索方式
+    bool textCaseSensitive; //!< 文本区分大小写
+};
+
+/** \brief 模板筛选器，筛选与给定记录同模板（只有数字不同）的记录，逐条只比较模板编号
+ *
+ *  模板首次出现的那条记录按原内容保存，没有模板编号，不在结果中 */
+class LogTemplateFilter : public LogFilter
+{
+public:
+    /** \brief 构造函数
+     *
+     *  \param templateId 模板编号，不为0
+     *  \param templateText 模板文本，用于描述 */
+    LogTemplateFilter( winux::uint32 templateId, winux::Utf8String const & templateText ) : _templateId(templateId), _templateText(templateText) { }
+
+    virtual bool match( LogTextRecord const & tr ) const override { return tr.templateId == _templateId; }
+    virtual winux::Utf8String getDescription() const override;
+    virtual bool getTemplateQuery( winux::uint32 * templateId ) const override;
+
+private:
+    winux::uint32 _templateId;
+    winux::Utf8String _templateText;
+};
+
+class LogParallelScan;
+
+/** \brief 日志筛选视图
+ *
+ *  保存满足筛选条件的行号，随记录追加增量扩展，不重新扫描已检查过的记录。占用内存与匹配行数成正比。
+ *  首次扫描可以交给线程池并行执行，扫描期间增量更新暂缓，扫描结果通过poll()逐步并入 */
+class LogFilterView
+{
+public:
+    explicit LogFilterView( winux::SharedPointer<LogFilter> filter );
+    ~LogFilterView();
+
+    /** \brief 检查上次更新之后追加的记录，并去掉存储已淘汰的行
+     *
+     *  \param store 日志存储
+     *  \param index 搜索索引。首次扫描且筛选器有文本条件时用它预筛候选行，可为空。
+     *  首次扫描且没有用索引时，筛选器有级别、类别条件的用存储的位图预筛候选行。筛选器为模板条件时只读取存储的模板编号列 */
+    void update( LogStore const & store, LogSearchIndex const * index = nullptr );
+
+    /** \brief 用线程池并行完成首次扫描
+     *
+     *  \param pool 线程池
+     *  \param store 日志存储，扫描的是调用时的快照
+     *  \param index 搜索索引。筛选器有文本条件时用它预筛候选行，可为空。没有用索引时，筛选器有级别、类别条件的用存储的位图预筛候选行。
+     *  筛选器为模板条件时只读取存储的模板编号列，不启动并行扫描 */
+    void updateParallel( winux::ThreadPool * pool, LogStore const & store, LogSearchIndex const * index = nullptr );
+
+    /** \brief 并入并行扫描已按顺序完成的部分结果，扫描完毕后恢复增量更新
+     *
+     *  \return bool 结果是否有变化 */
+    bool poll( LogStore const & store );
+
+    /** \brief 是否正在并行扫描 */
+    bool isScanning() const { return (bool)_scan; }
+
+    /** \brief 并行扫描进度，0~1 */
+    float getProgress() const;
+
+    /** \brief 清空结果并取消进行中的扫描，下次更新时重新扫描 */
+    void reset();
+
+    /** \brief 匹配的行数 */
+    size_t size() const { return _rows.size() - _firstIndex; }
+
+    /** \brief 第i条匹配记录在存储中的行号 */
+    winux::uint32 operator [] ( size_t i ) const { return _rows[ _firstIndex + i ]; }
+
+    /** \brief 筛选器 */
+    LogFilter const & getFilter() const { return *_filter.get(); }
+
+private:
+    winux::SharedPointer<LogFilter> _filter; // 筛选器
+    // 去掉存储已淘汰的行
+    void _evict( size_t firstRow );
+
+    std::vector<winux::uint32> _rows; // 匹配的行号，升序
+    size_t _firstIndex; // _rows中第一个未被淘汰的行的位置
+    size_t _scannedRows; // 已检查的行数
+    winux::SimplePointer<LogParallelScan> _scan; // 进行中的并行扫描
+};
@@ -3,118 +3,78 @@
 #include "LogListenWindow.h"
 #include "resource.h"
 
-// struct LogListenWindow ---------------------------------------------------------------------
-LogListenWindow::LogListenWindow( LogWindowsManager * manager, App::ListenParams const & lparams ) :
-    LogViewerWindow( manager, lparams.name, lparams.vScrollToBottom ), lparams(lparams)
+// struct LogListener -------------------------------------------------------------------------
+LogListener::LogListener( App::ListenParams const & lparams ) : lparams(lparams), feed( new LogFeed() ), running(true), failed(false), soundEffects(0)
 {
-    // 创建线程读取LOGs
+    // 保留策略，长时间监听时内存不再无限增长
+    LogRetention retention;
+    retention.maxRecords = (size_t)this->lparams.maxRecords;
+    retention.maxBytes = this->lparams.maxMBytes * 1024 * 1024;
+    retention.maxAgeMs = this->lparams.maxAgeSec * 1000;
+    winux::SharedPointer<LogArchiveSpill> spill;
+    if ( retention.isLimited() && !this->lparams.spillFile.empty() )
+    {
+        spill.attachNew( new LogArchiveSpill() );
+        if ( !spill->open( $L(this->lparams.spillFile) ) ) spill.reset();
+    }
+    this->feed->logs.setRetention( retention, spill );
+
+    // 分层存储，冷块换出到文件
+    if ( this->lparams.hotMBytes != 0 && !this->lparams.coldFile.empty() )
+    {
+        this->feed->logs.setTiering( $L(this->lparams.coldFile), this->lparams.hotMBytes * 1024 * 1024 );
+    }
+    this->feed->logs.setTemplateDict(this->lparams.templateDict);
+    this->feed->collapser.setWindow(this->lparams.collapseMs);
+
+    // 创建线程读取LOGs，记录只追加一次，各订阅窗口在界面线程里接续
     this->th.attachNew( new std::thread( [this] () {
+        LogFeed * feed = this->feed.get();
         eienlog::LogReader reader( winux::UnicodeConverter(this->lparams.addr).toUnicode(), this->lparams.port );
         time_t lastLogRecordTime = winux::GetUtcTime(); // 最后获取日志记录时间
-        if ( reader.errNo() ) this->show = false;
-        while ( this->show )
+        std::vector<eienlog::LogField> fields; // 复用的字段缓冲
+        if ( reader.errNo() ) this->failed = true;
+        while ( this->running && !this->failed )
         {
             eienlog::LogRecord record;
             if ( reader.readRecord( &record, this->lparams.waitTimeout, this->lparams.updateTimeout ) )
             {
-                std::lock_guard<std::mutex> lk(this->mtx);
+                // 在转换成文本之前判断重复，折叠的记录不再转换、追加和播放音效
+                winux::uint64 hash = feed->collapser.isEnabled() ? LogCollapser::Hash(record) : 0;
+                std::lock_guard<std::mutex> lk(feed->mtx);
 
                 lastLogRecordTime = winux::GetUtcTime();
-                LogTextRecord tr;
-                tr.flag.value = record.flag;
-                tr.utcTime = winux::DateTimeL::FromMilliSec(record.utcTime).toString<char>();
-                tr.contentSize = record.data.getSize();
-
-                // 如果非二进制，才进行编码转换
-                if ( !tr.flag.binary )
+                if ( feed->collapser.isEnabled() && feed->collapser.collapse( feed->logs, record, hash ) )
                 {
-                    // 根据编码进行转换
-                    switch ( tr.flag.logEncoding )
-                    {
-                    case eienlog::leUtf8:
-                        {
-                            tr.strContent.assign( record.data.toString<char>() );
-                        }
-                        break;
-                    case eienlog::leUtf16Le:
-                        {
-                            winux::Utf16String ustr = record.data.toString<winux::char16>();
-                            if ( winux::IsBigEndian() )
-                            {
-                                if ( ustr.length() > 0 ) winux::InvertByteOrderArray( &ustr[0], ustr.length() );
-                            }
-                            tr.strContent.assign( winux::UnicodeConverter(ustr).toUtf8() );
-                        }
-                        break;
-                    case eienlog::leUtf16Be:
-                        {
-                            winux::Utf16String ustr = record.data.toString<winux::char16>();
-                            if ( winux::IsLittleEndian() )
-                            {
-                                if ( ustr.length() > 0 ) winux::InvertByteOrderArray( &ustr[0], ustr.length() );
-                            }
-                            tr.strContent.assign( winux::UnicodeConverter(ustr).toUtf8() );
-                        }
-                        break;
-                    default:
-                        {
-                            tr.strContent.assign( winux::LocalToUtf8( record.data.toString<char>() ) );
-                        }
-                        break;
-                    }
-                }
-                else // 二进制数据
-                {
-                    int i = 1;
-                    for ( auto && byt : record.data )
-                    {
-                        tr.strContent += winux::BufferToHex<char>( winux::Buffer( &byt, 1, true ) );
-                        if ( i % 16 )
-                        {
-                            tr.strContent += " ";
-                        }
-                        else
-                        {
-                            tr.strContent += "\n";
-                        }
-                        i++;
-                    }
-                    winux::StrMakeUpper(&tr.strContent);
+                    // 折叠的记录仍计入速率
+                    eienlog::LogFlag flag;
+                    flag.value = record.flag;
+                    feed->rates.add( record.utcTime, record.data.getSize(), GetLogColorClass(flag) );
+                    continue;
                 }
 
-                tr.strContentSlashes = winux::AddCSlashes(tr.strContent);
-                this->logs.push_back(tr);
+                LogTextRecord tr;
+                LogRecordToText( record, &tr, &fields ); // 结构化字段只解析一次，存储不再从文本解析
+                size_t row = feed->addLog( std::move(tr), &fields ); // flag为平凡类型，移动后仍可用于下面的音效判断
+                if ( feed->collapser.isEnabled() ) feed->collapser.add( row, record, hash );
 
                 // 播放音效
-                if ( this->lparams.soundEffect )
+                if ( this->soundEffects > 0 )
                 {
                     winux::uint idSe = IDR_WAVE_LOG_SE00;
-                    if ( tr.flag.fgColorUse )
-                    {
-                        winux::ushort fgColor = tr.flag.fgColor;
-                        float r = ( fgColor & 31 ) / 31.0f, g = ( ( fgColor >> 5 ) & 31 ) / 31.0f, b = ( ( fgColor >> 10 ) & 31 ) / 31.0f;
-                        if ( r > g + b ) // 红色系
-                        {
-                            idSe = IDR_WAVE_LOG_SE02;
-                        }
-                        else if ( g > r + b ) // 绿色系
-                        {
-                            idSe = IDR_WAVE_LOG_SE01;
-                        }
-                    }
-                    else if ( tr.flag.bgColorUse )
+                    switch ( GetLogColorClass(tr.flag) )
                     {
-                        winux::ushort bgColor = tr.flag.bgColor;
-                        float r = ( bgColor & 15 ) / 15.0f, g = ( ( bgColor >> 4 ) & 15 ) / 15.0f, b = ( ( bgColor >> 8 ) & 15 ) / 15.0f;
-                        if ( r > g + b ) // 红色系
-                        {
-                            idSe = IDR_WAVE_LOG_SE02;
-                        }
-                        else if ( g > r + b ) // 绿色系
-                        {
-                            idSe = IDR_WAVE_LOG_SE01;
-                        }
+                    case lccRed: // 红色系
+                        idSe = IDR_WAVE_LOG_SE02;
+                        break;
+                    case lccGreen: // 绿色系
+                        idSe = IDR_WAVE_LOG_SE01;
+                        break;
+                    default:
+                        break;
                     }
+                    // 有级别的记录按级别判断是否为错误，不看颜色
+                    if ( record.meta.valid ) idSe = record.meta.severity >= eienlog::lsError ? IDR_WAVE_LOG_SE02 : ( idSe == IDR_WAVE_LOG_SE02 ? IDR_WAVE_LOG_SE00 : idSe );
                     PlaySound( MAKEINTRESOURCE(idSe), GetModuleHandle(nullptr), SND_RESOURCE | SND_ASYNC );
                 }
             }
@@ -129,6 +89,19 @@ LogListenWindow::LogListenWindow( LogWindowsManager * manager, App::ListenParams
             }
         }
     } ) );
+}
+
+LogListener::~LogListener()
+{
+    this->running = false;
+    this->th->join();
+}
+
+// struct LogListenWindow ---------------------------------------------------------------------
+LogListenWindow::LogListenWindow( LogWindowsManager * manager, App::ListenParams const & lparams, winux::SharedPointer<LogListener> listener ) :
+    LogViewerWindow( manager, lparams.name, lparams.vScrollToBottom, listener->feed ), manager(manager), lparams(lparams), listener(listener)
+{
+    if ( this->lparams.soundEffect ) this->listener->soundEffects++;
 
     // 终止多余的异步播放
     if ( this->lparams.soundEffect ) PlaySound( nullptr, nullptr, 0 );
@@ -136,18 +109,27 @@ LogListenWindow::LogListenWindow( LogWindowsManager * manager, App::ListenParams
 
 LogListenWindow::~LogListenWindow()
 {
-    this->show = false;
-    this->th->join();
+    if ( this->lparams.soundEffect ) this->listener->soundEffects--;
+    this->manager->unsubscribe( this->listener.get() );
 }
 
 void LogListenWindow::renderComponents()
 {
+    // 读取器创建失败时关闭窗口
+    if ( this->listener->failed ) this->show = false;
+
     ImGui::Text( u8"正在监听<%s#%u>的日志...", this->lparams.addr.c_str(), this->lparams.port );
+    if ( this->listener->subscribers > 1 )
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled( u8"(%d个窗口共享)", this->listener->subscribers );
+    }
     ImGui::SameLine();
 
     ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
     if ( ImGui::Checkbox( u8"音效", &this->lparams.soundEffect ) )
     {
+        this->listener->soundEffects += this->lparams.soundEffect ? 1 : -1;
         bToggleVScrollToBottom = true;
     }
     ImGui::PopStyleVar();
@@ -155,65 +137,80 @@ void LogListenWindow::renderComponents()
     ImGui::SameLine();
 
     ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 6.0f, 0 ) );
-    if ( ImGui::Button(u8"保存文件") )
+    if ( this->exporter && !this->exporter->isFinished() )
+    {
+        ImGui::Text( u8"正在保存 %d%%", (int)( this->exporter->getProgress() * 100 ) );
+        ImGui::SameLine();
+        if ( ImGui::Button(u8"取消保存") )
+        {
+            this->exporter->cancel();
+        }
+    }
+    else if ( ImGui::Button(u8"保存文件") )
     {
-        std::lock_guard<std::mutex> lk(this->mtx);
-
         winplus::FileDialog dlg{ this->manager->mainWindow->app.wi.hWnd, FALSE, L"保存日志文件", L"csvlog" };
-        if ( dlg.doModal( L".", L"日志文件(*.csvlog)\0*.csvlog\0全部文件(*.*)\0*.*\0\0" ) )
+        if ( dlg.doModal( L".", L"日志文件(*.csvlog)\0*.csvlog\0日志归档(*.eienlog)\0*.eienlog\0全部文件(*.*)\0*.*\0\0" ) )
         {
             winux::String path = dlg.getFilePath();
-            winux::MemoryFile memFile;
-            winux::CsvWriter csv(&memFile);
+            std::vector< std::pair< size_t, size_t > > ranges;
+            auto addRange = [&ranges] ( size_t begin, size_t end ) { ranges.emplace_back( begin, end ); };
+
+            // 只在取快照和行区间时加锁，导出在后台线程进行，不妨碍接收日志
+            std::lock_guard<std::mutex> lk(this->feed->mtx);
             switch ( this->saveTargetType )
             {
             case 0:
+                addRange( 0, this->feed->logs.size() );
+                break;
+            case 1:
+                this->selected.forEachRange( true, this->feed->logs.size(), addRange );
+                break;
             case 2:
-                for ( int i = 0; i < (int)this->logs.size(); i++ )
+                this->selected.forEachRange( false, this->feed->logs.size(), addRange );
+                break;
+            case 3:
                 {
-                    if ( this->saveTargetType == 2 && winux::IsSet( this->selected, i ) && this->selected[i] ) continue;
-                    auto && log = this->logs[i];
-                    winux::Mixed record;
-                    record.createArray();
-                    record.add(log.contentSize);
-                    record.add( $L(log.strContent) );
-                    record.add( $L(log.utcTime) );
-                    record.add(log.flag.value);
-                    csv.writeRecord(record);
+                    LogRange range = LogRange::Parse( LogRange::lrRows, this->saveRangeBegin, this->saveRangeEnd );
+                    size_t end = range.end != 0 && range.end < this->feed->logs.size() ? (size_t)range.end : this->feed->logs.size();
+                    if ( range.begin < end ) addRange( (size_t)range.begin, end );
                 }
                 break;
-            case 1:
-                for ( auto && pr : this->selected )
+            case 4:
                 {
-                    if ( pr.second )
-                    {
-                        auto && log = this->logs[pr.first];
-                        winux::Mixed record;
-                        record.createArray();
-                        record.add(log.contentSize);
-                        record.add( $L(log.strContent) );
-                        record.add( $L(log.utcTime) );
-                        record.add(log.flag.value);
-                        csv.writeRecord(record);
-                    }
+                    LogRange range = LogRange::Parse( LogRange::lrTime, this->saveRangeBegin, this->saveRangeEnd );
+                    this->feed->logs.forEachTimeRange( range.begin, range.end, addRange );
                 }
                 break;
             }
-
-            winux::TextArchive ta;
-            ta.saveEx( memFile.buffer(), winux::IsLittleEndian() ? "UTF-16LE" : "UTF-16BE", path, winux::feUtf8Bom );
+            this->exporter.attachNew( new LogCsvExporter( this->feed->logs, ranges, path ) );
+            this->exporter->start();
         }
     }
+    if ( this->exporter && this->exporter->isFailed() )
+    {
+        ImGui::SameLine();
+        ImGui::TextColored( ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), u8"保存失败" );
+    }
 
     ImGui::SameLine();
 
-    static char const * saveTargetTypes[] = { u8"全部", u8"已选择", u8"非选择" };
+    static char const * saveTargetTypes[] = { u8"全部", u8"已选择", u8"非选择", u8"行范围", u8"时间范围" };
     ImGui::PushItemWidth( ImGui::GetFontSize() * 4 + 2 * 6.0f );
     if ( ImGui::Combo(u8"##save_target", &this->saveTargetType, saveTargetTypes, countof(saveTargetTypes) ) )
     {
         //printf("%d\n", this->saveTarget);
     }
     ImGui::PopItemWidth();
+    if ( this->saveTargetType >= 3 )
+    {
+        bool isTime = this->saveTargetType == 4;
+        ImGui::SameLine();
+        ImGui::PushItemWidth( ImGui::GetFontSize() * ( isTime ? 12 : 6 ) );
+        ImGui::InputTextWithHint( u8"##save_range_begin", isTime ? u8"2024-01-01T00:00:00.000" : u8"起始行", &this->saveRangeBegin );
+        ImGui::SameLine();
+        ImGui::InputTextWithHint( u8"##save_range_end", isTime ? u8"结束时间(不含)" : u8"结束行(不含)", &this->saveRangeEnd );
+        ImGui::PopItemWidth();
+    }
 
     ImGui::PopStyleVar();
 
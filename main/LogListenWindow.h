@@ -1,16 +1,37 @@
 ﻿#pragma once
 
 #include <thread>
+#include <atomic>
 #include "LogViewerWindow.h"
+#include "LogCsvExporter.h"
+
+// 一个地址端口上的日志接收：一个读取线程把记录追加到共享的日志数据，由窗口管理器按地址端口登记，
+// 监听同一地址端口的窗口都订阅它，各自在日志数据上建筛选视图
+struct LogListener
+{
+    LogListener( App::ListenParams const & lparams );
+    ~LogListener();
+
+    App::ListenParams lparams; // 创建时的参数，日志数据的保留策略、分层存储、重复折叠按它设置
+    winux::SharedPointer<LogFeed> feed; // 共享的日志数据
+    winux::SimplePointer<std::thread> th; // 读取线程
+    std::atomic<bool> running; // 读取线程是否继续
+    std::atomic<bool> failed; // 读取器创建失败
+    std::atomic<int> soundEffects; // 开启音效的订阅窗口数
+    int subscribers = 0; // 订阅窗口数，由窗口管理器维护
+};
 
 struct LogWindowsManager;
 struct LogListenWindow : LogViewerWindow
 {
-    LogListenWindow( LogWindowsManager * manager, App::ListenParams const & lparams );
+    LogListenWindow( LogWindowsManager * manager, App::ListenParams const & lparams, winux::SharedPointer<LogListener> listener );
     ~LogListenWindow() override;
     void renderComponents() override;
 
+    LogWindowsManager * manager;
     App::ListenParams lparams;
-    winux::SimplePointer<std::thread> th; // 监听线程
-    int saveTargetType = 0; // 保存文件时日志目标类型：0全部日志，1已选择的日志，2不选择的日志
+    winux::SharedPointer<LogListener> listener; // 订阅的日志接收
+    int saveTargetType = 0; // 保存文件时日志目标类型：0全部日志，1已选择的日志，2不选择的日志，3行范围，4时间范围
+    winux::Utf8String saveRangeBegin, saveRangeEnd; // 保存的行范围或时间范围
+    winux::SimplePointer<LogCsvExporter> exporter; // 后台保存文件
 };
@@ -0,0 +1,47 @@
+﻿#include "LogMetaIndex.h"
+
+char const * GetLogSeverityName( int severity )
+{
+    static char const * names[] = { u8"未指定", u8"跟踪", u8"调试", u8"信息", u8"警告", u8"错误", u8"致命" };
+    return severity >= 0 && severity < (int)( sizeof(names) / sizeof(names[0]) ) ? names[severity] : u8"未知";
+}
+
+// class LogMetaBlock -------------------------------------------------------------------------
+LogMetaBlock::LogMetaBlock( size_t capacity ) : _words( ( capacity + 63 ) / 64 ), _bits( _words * ( eienlog::lsCount + LOG_CATEGORY_COUNT ) ), _present(0)
+{
+}
+
+void LogMetaBlock::set( size_t offset, eienlog::LogMeta meta )
+{
+    winux::uint64 bit = (winux::uint64)1 << ( offset % 64 );
+    _bits[ meta.severity * _words + offset / 64 ].fetch_or( bit, std::memory_order_relaxed );
+    _bits[ ( eienlog::lsCount + meta.category ) * _words + offset / 64 ].fetch_or( bit, std::memory_order_relaxed );
+    _present.fetch_or( ( 1u << meta.severity ) | ( 1u << ( eienlog::lsCount + meta.category ) ), std::memory_order_relaxed );
+}
+
+bool LogMetaBlock::mayMatch( winux::uint8 severityMask, winux::uint16 categoryMask ) const
+{
+    winux::uint32 present = _present.load(std::memory_order_relaxed);
+    if ( severityMask != 0 && ( present & severityMask ) == 0 ) return false;
+    if ( categoryMask != 0 && ( ( present >> eienlog::lsCount ) & categoryMask ) == 0 ) return false;
+    return true;
+}
+
+winux::uint64 LogMetaBlock::getWord( winux::uint8 severityMask, winux::uint16 categoryMask, size_t w ) const
+{
+    // 每行恰好属于一个级别和一个类别，不限级别时取所有级别的并集即全部已设置的行
+    if ( severityMask == 0 ) severityMask = 0xFF;
+    winux::uint64 bits = 0;
+    for ( int i = 0; i < eienlog::lsCount; i++ )
+    {
+        if ( severityMask >> i & 1 ) bits |= _bits[ i * _words + w ].load(std::memory_order_relaxed);
+    }
+    if ( categoryMask == 0 || bits == 0 ) return bits;
+
+    winux::uint64 categories = 0;
+    for ( int i = 0; i < LOG_CATEGORY_COUNT; i++ )
+    {
+        if ( categoryMask >> i & 1 ) categories |= _bits[ ( eienlog::lsCount + i ) * _words + w ].load(std::memory_order_relaxed);
+    }
+    return bits & categories;
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <atomic>
+#include "eienlog.hpp"
+
+/** \brief 日志级别的名称 */
+char const * GetLogSeverityName( int severity );
+
+/** \brief 按级别、类别和时间查找记录的条件 */
+struct LogMetaQuery
+{
+    winux::uint8 severityMask;  //!< 级别位掩码，第i位对应级别i，0表示不限
+    winux::uint16 categoryMask; //!< 类别位掩码，第i位对应类别i，0表示不限
+    winux::uint64 timeBegin;    //!< 起始时间（毫秒，含），0表示不限
+    winux::uint64 timeEnd;      //!< 结束时间（毫秒，不含），0表示不限
+
+    LogMetaQuery() : severityMask(0), categoryMask(0), timeBegin(0), timeEnd(0) { }
+
+    /** \brief 级别不低于severity的掩码 */
+    static winux::uint8 SeverityAtLeast( int severity ) { return (winux::uint8)( 0xFF << severity ); }
+
+    /** \brief 元信息是否满足条件 */
+    bool match( eienlog::LogMeta meta ) const
+    {
+        return ( severityMask == 0 || ( severityMask >> meta.severity & 1 ) ) && ( categoryMask == 0 || ( categoryMask >> meta.category & 1 ) );
+    }
+};
+
+/** \brief 一块记录的级别和类别位图
+ *
+ *  每个级别、每个类别各有一个位图，第i位表示块内第i行属于该级别或类别，没有元信息的记录计为未指定级别、类别0。
+ *  查找时把所选级别的位图相或、所选类别的位图相或，再相与，每次处理64行，不读取记录。
+ *  另记块内出现过的级别和类别，不含所选级别或类别的块整块跳过。
+ *  位图在块创建时按整块容量分配，位用原子量设置，追加时其他线程可以同时读取已追加的行。 */
+class LogMetaBlock
+{
+public:
+    explicit LogMetaBlock( size_t capacity );
+
+    /** \brief 设置块内第offset行的元信息，只由追加记录的线程调用 */
+    void set( size_t offset, eienlog::LogMeta meta );
+
+    /** \brief 块内是否可能有满足条件的行，掩码为0表示不限 */
+    bool mayMatch( winux::uint8 severityMask, winux::uint16 categoryMask ) const;
+
+    /** \brief 块内第w组64行中满足条件的行，掩码为0表示不限 */
+    winux::uint64 getWord( winux::uint8 severityMask, winux::uint16 categoryMask, size_t w ) const;
+
+    /** \brief 每个位图的字数 */
+    size_t getWordCount() const { return _words; }
+
+private:
+    size_t _words; // 每个位图的字数
+    std::vector< std::atomic<winux::uint64> > _bits; // 各级别的位图，然后是各类别的位图
+    std::atomic<winux::uint32> _present; // 块内出现过的级别（低8位）和类别（其上16位）
+};
@@ -0,0 +1,97 @@
+﻿#include "LogParallelScan.h"
+#include <algorithm>
+
+// class LogParallelScan ----------------------------------------------------------------------
+LogParallelScan::LogParallelScan( winux::ThreadPool * pool, LogStore const & store, winux::SharedPointer<LogFilter> filter, std::vector<winux::uint32> const * candidates ) :
+    _pool(pool), _store(store), _filter(filter), _useCandidates( candidates != nullptr ), _nextMorsel(0), _doneMorsels(0), _cancelled(false), _mergedMorsels(0)
+{
+    size_t count = _store.size() - _store.getFirstRow();
+    if ( _useCandidates )
+    {
+        // 只保留快照范围内的候选行
+        auto begin = std::lower_bound( candidates->begin(), candidates->end(), (winux::uint32)_store.getFirstRow() );
+        auto end = std::lower_bound( begin, candidates->end(), (winux::uint32)_store.size() );
+        _candidates.assign( begin, end );
+        count = _candidates.size();
+    }
+    _morselCount = ( count + MorselRows - 1 ) / MorselRows;
+    _results.resize(_morselCount);
+    _ready.resize( _morselCount, false );
+}
+
+LogParallelScan::~LogParallelScan()
+{
+    this->cancel();
+    this->wait();
+}
+
+void LogParallelScan::start()
+{
+    size_t threads = _pool->getThreadCount();
+    if ( threads > _morselCount ) threads = _morselCount;
+    for ( size_t i = 0; i < threads; i++ )
+    {
+        _tasks.push_back( _pool->task( &LogParallelScan::_worker, this ) );
+        _tasks.back().post();
+    }
+}
+
+void LogParallelScan::wait()
+{
+    for ( auto && task : _tasks )
+    {
+        task.wait();
+    }
+}
+
+void LogParallelScan::_worker()
+{
+    size_t firstRow = _store.getFirstRow();
+    size_t total = _useCandidates ? _candidates.size() : _store.size() - firstRow;
+    LogStore::Reader reader(_store); // 冷块在本线程内临时解压
+    std::vector<winux::uint32> rows;
+    while ( !_cancelled )
+    {
+        size_t morsel = _nextMorsel++;
+        if ( morsel >= _morselCount ) break;
+
+        size_t begin = morsel * MorselRows, end = begin + MorselRows < total ? begin + MorselRows : total;
+        rows.clear();
+        if ( _useCandidates )
+        {
+            for ( size_t i = begin; i < end; i++ )
+            {
+                if ( _filter->matchRow( reader[ _candidates[i] ], reader.fields( _candidates[i] ) ) ) rows.push_back( _candidates[i] );
+            }
+        }
+        else
+        {
+            for ( size_t row = firstRow + begin; row < firstRow + end; row++ )
+            {
+                if ( _filter->matchRow( reader[row], reader.fields(row) ) ) rows.push_back( (winux::uint32)row );
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(_mtx);
+            _results[morsel].assign( rows.begin(), rows.end() );
+            _ready[morsel] = true;
+        }
+        _doneMorsels++;
+    }
+}
+
+size_t LogParallelScan::takeRows( std::vector<winux::uint32> * rows )
+{
+    std::lock_guard<std::mutex> lk(_mtx);
+    size_t n = 0;
+    while ( _mergedMorsels < _morselCount && _ready[_mergedMorsels] )
+    {
+        auto & result = _results[_mergedMorsels];
+        rows->insert( rows->end(), result.begin(), result.end() );
+        n += result.size();
+        std::vector<winux::uint32>().swap(result);
+        _mergedMorsels++;
+    }
+    return n;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <atomic>
+#include <mutex>
+#include "LogFilter.h"
+
+/** \brief 并行筛选扫描
+ *
+ *  把待扫描的行切成固定行数的小块，由线程池中的线程各自领取求值，结果按块的顺序合并。
+ *  已连续完成的前缀随时可以取出作为部分结果。可随时取消，析构时会取消并等待工作线程结束。 */
+class LogParallelScan
+{
+public:
+    enum { MorselRows = 16384 }; //!< 每块行数
+
+    /** \brief 构造函数
+     *
+     *  \param pool 线程池
+     *  \param store 日志存储的快照，扫描只读取其中的行
+     *  \param filter 筛选器，其matchRow()会被多个线程同时调用
+     *  \param candidates 候选行（升序），只扫描这些行。为空指针时扫描全部行 */
+    LogParallelScan( winux::ThreadPool * pool, LogStore const & store, winux::SharedPointer<LogFilter> filter, std::vector<winux::uint32> const * candidates = nullptr );
+
+    ~LogParallelScan();
+
+    /** \brief 开始扫描，每个线程池线程投递一个工作任务 */
+    void start();
+
+    /** \brief 取消扫描，尚未领取的块不再执行 */
+    void cancel() { _cancelled = true; }
+
+    /** \brief 等待所有工作任务结束 */
+    void wait();
+
+    /** \brief 是否已扫描完毕（被取消的不算） */
+    bool isDone() const { return !_cancelled && _doneMorsels == _morselCount; }
+
+    /** \brief 是否已取消 */
+    bool isCancelled() const { return _cancelled; }
+
+    /** \brief 扫描进度，0~1 */
+    float getProgress() const { return _morselCount ? (float)_doneMorsels / _morselCount : 1.0f; }
+
+    /** \brief 快照的行数 */
+    size_t getRowCount() const { return _store.size(); }
+
+    /** \brief 取出按顺序合并好的新结果，追加到rows末尾，返回追加的行数 */
+    size_t takeRows( std::vector<winux::uint32> * rows );
+
+private:
+    // 工作任务：循环领取块并求值
+    void _worker();
+
+    winux::ThreadPool * _pool; // 线程池
+    LogStore _store; // 日志存储快照
+    winux::SharedPointer<LogFilter> _filter; // 筛选器
+    std::vector<winux::uint32> _candidates; // 候选行
+    bool _useCandidates; // 是否只扫描候选行
+    size_t _morselCount; // 块数
+
+    std::atomic<size_t> _nextMorsel; // 下一个待领取的块
+    std::atomic<size_t> _doneMorsels; // 已完成的块数
+    std::atomic<bool> _cancelled; // 已取消
+
+    std::mutex _mtx; // 保护下面的结果
+    std::vector< std::vector<winux::uint32> > _results; // 各块的结果
+    std::vector<bool> _ready; // 各块是否已完成
+    size_t _mergedMorsels; // 已取出的块数
+
+    std::vector< winux::Task<void> > _tasks; // 工作任务
+};
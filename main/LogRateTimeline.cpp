@@ -0,0 +1,140 @@
+﻿#include "LogRateTimeline.h"
+
+static winux::uint64 const _SpanMs[LogRateTimeline::lvCount] = { 1000, 60 * 1000, 60 * 60 * 1000 };
+static size_t const _Capacity[LogRateTimeline::lvCount] = { 60 * 60, 7 * 24 * 60, 31 * 24 };
+
+// class LogRateTimeline ----------------------------------------------------------------------
+LogRateTimeline::LogRateTimeline() : _lastTimeMs(0)
+{
+    for ( int level = 0; level < lvCount; level++ )
+    {
+        _levels[level].resize( _Capacity[level] );
+    }
+}
+
+void LogRateTimeline::add( winux::uint64 utcTimeMs, winux::uint64 bytes, LogColorClass colorClass )
+{
+    for ( int level = 0; level < lvCount; level++ )
+    {
+        winux::uint64 index = utcTimeMs / _SpanMs[level];
+        // 比已保留的范围还早的记录不再计入这一级
+        if ( _lastTimeMs != 0 && index + _Capacity[level] <= _lastTimeMs / _SpanMs[level] ) continue;
+
+        Slot & slot = _levels[level][ index % _Capacity[level] ];
+        if ( slot.index != index + 1 )
+        {
+            slot.index = index + 1;
+            slot.bucket.clear();
+        }
+        slot.bucket.counts[colorClass]++;
+        slot.bucket.bytes[colorClass] += bytes;
+    }
+    if ( utcTimeMs > _lastTimeMs ) _lastTimeMs = utcTimeMs;
+}
+
+void LogRateTimeline::clear()
+{
+    for ( int level = 0; level < lvCount; level++ )
+    {
+        for ( auto && slot : _levels[level] ) slot.index = 0;
+    }
+    _lastTimeMs = 0;
+}
+
+void LogRateTimeline::getBuckets( Level level, winux::uint64 beginMs, size_t count, std::vector<Bucket> * buckets ) const
+{
+    buckets->resize(count);
+    winux::uint64 index = beginMs / _SpanMs[level];
+    for ( size_t i = 0; i < count; i++ )
+    {
+        Bucket const * bucket = this->_bucket( level, index + i );
+        if ( bucket )
+            (*buckets)[i] = *bucket;
+        else
+            (*buckets)[i].clear();
+    }
+}
+
+LogRateTimeline::Bucket LogRateTimeline::sum( winux::uint64 beginMs, winux::uint64 endMs ) const
+{
+    Bucket result;
+    if ( beginMs < endMs ) this->_sum( lvHour, beginMs, endMs, &result );
+    return result;
+}
+
+winux::uint64 LogRateTimeline::GetSpanMs( Level level )
+{
+    return _SpanMs[level];
+}
+
+size_t LogRateTimeline::GetCapacity( Level level )
+{
+    return _Capacity[level];
+}
+
+size_t LogRateTimeline::GetMemoryBytes()
+{
+    size_t n = sizeof(LogRateTimeline);
+    for ( int level = 0; level < lvCount; level++ ) n += _Capacity[level] * sizeof(Slot);
+    return n;
+}
+
+LogRateTimeline::Bucket const * LogRateTimeline::_bucket( Level level, winux::uint64 index ) const
+{
+    Slot const & slot = _levels[level][ index % _Capacity[level] ];
+    return slot.index == index + 1 ? &slot.bucket : nullptr;
+}
+
+void LogRateTimeline::_sum( int level, winux::uint64 beginMs, winux::uint64 endMs, Bucket * result ) const
+{
+    winux::uint64 span = _SpanMs[level];
+    if ( level == lvSecond )
+    {
+        // 与区间相交的秒桶
+        for ( winux::uint64 index = beginMs / span; index * span < endMs; index++ )
+        {
+            Bucket const * bucket = this->_bucket( lvSecond, index );
+            if ( bucket ) result->add(*bucket);
+        }
+        return;
+    }
+
+    // 完整落在区间内的桶[first, last)
+    winux::uint64 first = ( beginMs + span - 1 ) / span, last = endMs / span;
+    if ( first >= last )
+    {
+        this->_sumEdge( level, beginMs, endMs, result );
+        return;
+    }
+    for ( winux::uint64 index = first; index < last; index++ )
+    {
+        Bucket const * bucket = this->_bucket( (Level)level, index );
+        if ( bucket ) result->add(*bucket);
+    }
+    if ( beginMs < first * span ) this->_sumEdge( level, beginMs, first * span, result );
+    if ( last * span < endMs ) this->_sumEdge( level, last * span, endMs, result );
+}
+
+void LogRateTimeline::_sumEdge( int level, winux::uint64 beginMs, winux::uint64 endMs, Bucket * result ) const
+{
+    // 细一级还保留着这段时间时用细一级统计，否则计入整个粗桶
+    if ( beginMs >= this->_retainedBeginMs( (Level)( level - 1 ) ) )
+    {
+        this->_sum( level - 1, beginMs, endMs, result );
+    }
+    else
+    {
+        winux::uint64 span = _SpanMs[level];
+        for ( winux::uint64 index = beginMs / span; index * span < endMs; index++ )
+        {
+            Bucket const * bucket = this->_bucket( (Level)level, index );
+            if ( bucket ) result->add(*bucket);
+        }
+    }
+}
+
+winux::uint64 LogRateTimeline::_retainedBeginMs( Level level ) const
+{
+    winux::uint64 last = _lastTimeMs / _SpanMs[level];
+    return last + 1 > _Capacity[level] ? ( last + 1 - _Capacity[level] ) * _SpanMs[level] : 0;
+}
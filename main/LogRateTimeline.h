@@ -0,0 +1,116 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief 日志速率时间线
+ *
+ *  接收日志时按记录时间累计到秒、分、时三级时间桶，每个桶分颜色类别记录条数和字节数。
+ *  每级是固定长度的循环数组，桶按绝对序号定位，序号不符的桶视为空，因此时间推进时不必逐桶清零。
+ *  秒级保留1小时，分级保留1周，时级保留31天，占用内存固定，与记录数无关。
+ *  查询任意时间段只访问桶，不访问记录。 */
+class LogRateTimeline
+{
+public:
+    /** \brief 桶的粒度 */
+    enum Level
+    {
+        lvSecond,   //!< 秒
+        lvMinute,   //!< 分
+        lvHour,     //!< 时
+        lvCount
+    };
+
+    /** \brief 一个时间桶的统计 */
+    struct Bucket
+    {
+        winux::uint32 counts[lccCount]; //!< 各颜色类别的记录数
+        winux::uint64 bytes[lccCount];  //!< 各颜色类别的字节数
+
+        Bucket() { this->clear(); }
+
+        void clear()
+        {
+            memset( counts, 0, sizeof(counts) );
+            memset( bytes, 0, sizeof(bytes) );
+        }
+
+        /** \brief 并入另一个桶 */
+        void add( Bucket const & other )
+        {
+            for ( int i = 0; i < lccCount; i++ )
+            {
+                counts[i] += other.counts[i];
+                bytes[i] += other.bytes[i];
+            }
+        }
+
+        /** \brief 记录总数 */
+        winux::uint64 getCount() const
+        {
+            winux::uint64 n = 0;
+            for ( int i = 0; i < lccCount; i++ ) n += counts[i];
+            return n;
+        }
+
+        /** \brief 字节总数 */
+        winux::uint64 getBytes() const
+        {
+            winux::uint64 n = 0;
+            for ( int i = 0; i < lccCount; i++ ) n += bytes[i];
+            return n;
+        }
+    };
+
+    LogRateTimeline();
+
+    /** \brief 累计一条记录
+     *
+     *  \param utcTimeMs 记录时间（毫秒）
+     *  \param bytes 记录内容大小
+     *  \param colorClass 记录的颜色类别 */
+    void add( winux::uint64 utcTimeMs, winux::uint64 bytes, LogColorClass colorClass );
+
+    /** \brief 清空 */
+    void clear();
+
+    /** \brief 已累计的最新记录时间（毫秒），没有记录时为0 */
+    winux::uint64 getLastTimeMs() const { return _lastTimeMs; }
+
+    /** \brief 取level级从beginMs所在的桶开始的count个桶，未保留或没有记录的桶为空 */
+    void getBuckets( Level level, winux::uint64 beginMs, size_t count, std::vector<Bucket> * buckets ) const;
+
+    /** \brief 统计[beginMs, endMs)内的合计
+     *
+     *  整段用最粗的桶，两端不足一个粗桶的部分用细一级的桶补齐，秒级的桶只要与区间相交就计入。
+     *  两端已超出细一级的保留范围时，改为计入整个粗桶。 */
+    Bucket sum( winux::uint64 beginMs, winux::uint64 endMs ) const;
+
+    /** \brief 一级的桶跨度（毫秒） */
+    static winux::uint64 GetSpanMs( Level level );
+
+    /** \brief 一级保留的桶数 */
+    static size_t GetCapacity( Level level );
+
+    /** \brief 占用的内存字节数 */
+    static size_t GetMemoryBytes();
+
+private:
+    struct Slot
+    {
+        winux::uint64 index; // 桶的绝对序号加1，0表示未使用
+        Bucket bucket;
+
+        Slot() : index(0) { }
+    };
+
+    // 取绝对序号为index的桶，未保留时返回nullptr
+    Bucket const * _bucket( Level level, winux::uint64 index ) const;
+    // 按level级统计[beginMs, endMs)
+    void _sum( int level, winux::uint64 beginMs, winux::uint64 endMs, Bucket * result ) const;
+    // 统计level级两端不足一个桶的部分
+    void _sumEdge( int level, winux::uint64 beginMs, winux::uint64 endMs, Bucket * result ) const;
+    // level级保留的最早时间
+    winux::uint64 _retainedBeginMs( Level level ) const;
+
+    std::vector<Slot> _levels[lvCount];
+    winux::uint64 _lastTimeMs;
+};
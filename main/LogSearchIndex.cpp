@@ -0,0 +1,259 @@
+﻿#include "LogSearchIndex.h"
+#include <algorithm>
+
+inline static winux::byte _FoldByte( winux::byte ch )
+{
+    return ( ch >= 'A' && ch <= 'Z' ) ? ch + ( 'a' - 'A' ) : ch;
+}
+
+inline static bool _IsWordByte( winux::byte ch )
+{
+    return ( ch >= '0' && ch <= '9' ) || ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' ) || ch == '_';
+}
+
+inline static winux::uint32 _Trigram( winux::byte const * p )
+{
+    return ( _FoldByte(p[0]) << 16 ) | ( _FoldByte(p[1]) << 8 ) | _FoldByte(p[2]);
+}
+
+// class LogSearchIndex -----------------------------------------------------------------------
+LogSearchIndex::LogSearchIndex( size_t maxIndexBytes ) : _maxIndexBytes(maxIndexBytes), _rowCount(0), _postingsBytes(0), _firstRow(0), _compactedRow(0)
+{
+}
+
+void LogSearchIndex::add( winux::uint32 row, winux::Utf8String const & content )
+{
+    _rowCount = row + 1;
+    if ( content.length() > _maxIndexBytes )
+    {
+        _unindexedRows.push_back(row);
+        return;
+    }
+    if ( content.length() < 3 ) return;
+
+    winux::byte const * p = (winux::byte const *)content.c_str();
+    size_t n = content.length() - 2;
+    for ( size_t i = 0; i < n; i++ )
+    {
+        PostingList & list = *this->_find( _Trigram( p + i ), true );
+        if ( list.count > 0 && list.lastRow == row ) continue; // 同一行只记一次
+        _postingsBytes += _Append( list, row );
+    }
+}
+
+size_t LogSearchIndex::_Append( PostingList & list, winux::uint32 row )
+{
+    // 第一项保存 row + 1，之后保存与上一行的差值，差值总是大于0
+    winux::uint32 delta = list.count > 0 ? row - list.lastRow : row + 1;
+    size_t oldSize = list.data.size();
+    while ( delta >= 0x80 )
+    {
+        list.data.push_back( (winux::byte)( delta | 0x80 ) );
+        delta >>= 7;
+    }
+    list.data.push_back( (winux::byte)delta );
+
+    list.lastRow = row;
+    list.count++;
+    return list.data.size() - oldSize;
+}
+
+LogSearchIndex::PostingList * LogSearchIndex::_find( winux::uint32 trigram, bool create )
+{
+    if ( _slots.empty() )
+    {
+        if ( !create ) return nullptr;
+        _slots.resize( 1 << 12, Slot{ 0, 0 } );
+    }
+
+    size_t mask = _slots.size() - 1;
+    size_t i = ( trigram * 2654435761u ) & mask;
+    while ( _slots[i].list != 0 )
+    {
+        if ( _slots[i].trigram == trigram ) return &_lists[ _slots[i].list - 1 ];
+        i = ( i + 1 ) & mask;
+    }
+    if ( !create ) return nullptr;
+
+    // 装载率超过一半时扩容重排
+    if ( ( _lists.size() + 1 ) * 2 > _slots.size() )
+    {
+        std::vector<Slot> slots( _slots.size() * 2, Slot{ 0, 0 } );
+        mask = slots.size() - 1;
+        for ( Slot const & slot : _slots )
+        {
+            if ( slot.list == 0 ) continue;
+            size_t k = ( slot.trigram * 2654435761u ) & mask;
+            while ( slots[k].list != 0 ) k = ( k + 1 ) & mask;
+            slots[k] = slot;
+        }
+        _slots.swap(slots);
+        i = ( trigram * 2654435761u ) & mask;
+        while ( _slots[i].list != 0 ) i = ( i + 1 ) & mask;
+    }
+
+    _lists.emplace_back();
+    _lists.back().lastRow = 0;
+    _lists.back().count = 0;
+    _slots[i].trigram = trigram;
+    _slots[i].list = (winux::uint32)_lists.size();
+    return &_lists.back();
+}
+
+void LogSearchIndex::_Decode( PostingList const & list, std::vector<winux::uint32> * rows )
+{
+    rows->clear();
+    rows->reserve(list.count);
+    winux::uint32 row = (winux::uint32)-1;
+    winux::uint32 delta = 0;
+    int shift = 0;
+    for ( winux::byte b : list.data )
+    {
+        delta |= (winux::uint32)( b & 0x7F ) << shift;
+        if ( b & 0x80 )
+        {
+            shift += 7;
+        }
+        else
+        {
+            row += delta;
+            rows->push_back(row);
+            delta = 0;
+            shift = 0;
+        }
+    }
+}
+
+bool LogSearchIndex::getCandidates( winux::Utf8String const & text, std::vector<winux::uint32> * rows ) const
+{
+    rows->clear();
+    if ( text.length() < 3 ) return false; // 不足一个三元组，只能逐行校验
+
+    // 收集搜索文本中不重复的三元组对应的倒排表，按行数从少到多排列
+    std::vector<PostingList const *> lists;
+    bool missing = false;
+    winux::byte const * p = (winux::byte const *)text.c_str();
+    for ( size_t i = 0; i + 2 < text.length(); i++ )
+    {
+        PostingList const * list = this->_find( _Trigram( p + i ) );
+        if ( list == nullptr )
+        {
+            missing = true;
+            break;
+        }
+        if ( std::find( lists.begin(), lists.end(), list ) == lists.end() ) lists.push_back(list);
+    }
+
+    if ( !missing )
+    {
+        std::sort( lists.begin(), lists.end(), [] ( PostingList const * a, PostingList const * b ) { return a->count < b->count; } );
+        _Decode( *lists[0], rows );
+        std::vector<winux::uint32> other;
+        for ( size_t k = 1; k < lists.size() && !rows->empty(); k++ )
+        {
+            _Decode( *lists[k], &other );
+            auto end = std::set_intersection( rows->begin(), rows->end(), other.begin(), other.end(), rows->begin() );
+            rows->erase( end, rows->end() );
+        }
+    }
+
+    // 合并未建三元组的行
+    if ( !_unindexedRows.empty() )
+    {
+        std::vector<winux::uint32> merged;
+        merged.reserve( rows->size() + _unindexedRows.size() );
+        std::merge( rows->begin(), rows->end(), _unindexedRows.begin(), _unindexedRows.end(), std::back_inserter(merged) );
+        rows->swap(merged);
+    }
+
+    // 去掉已丢弃的行
+    if ( _firstRow > 0 ) rows->erase( rows->begin(), std::lower_bound( rows->begin(), rows->end(), _firstRow ) );
+    return true;
+}
+
+size_t LogSearchIndex::search( LogStore const & store, winux::Utf8String const & text, SearchMode mode, bool caseSensitive, std::vector<winux::uint32> * rows ) const
+{
+    rows->clear();
+    if ( text.empty() ) return 0;
+
+    size_t rowCount = _rowCount < store.size() ? _rowCount : store.size();
+    size_t firstRow = store.getFirstRow();
+    LogStore::Reader reader(store);
+    std::vector<winux::uint32> candidates;
+    if ( !this->getCandidates( text, &candidates ) )
+    {
+        for ( size_t row = firstRow; row < rowCount; row++ )
+        {
+            if ( Match( reader[row].strContent, text, mode, caseSensitive ) ) rows->push_back( (winux::uint32)row );
+        }
+        return rows->size();
+    }
+
+    for ( winux::uint32 row : candidates )
+    {
+        if ( row < firstRow ) continue;
+        if ( row >= rowCount ) break;
+        if ( Match( reader[row].strContent, text, mode, caseSensitive ) ) rows->push_back(row);
+    }
+    return rows->size();
+}
+
+bool LogSearchIndex::Match( winux::Utf8String const & content, winux::Utf8String const & text, SearchMode mode, bool caseSensitive )
+{
+    if ( text.empty() || content.length() < text.length() ) return false;
+
+    auto eq = [caseSensitive] ( char a, char b ) {
+        return caseSensitive ? a == b : _FoldByte( (winux::byte)a ) == _FoldByte( (winux::byte)b );
+    };
+
+    auto first = content.begin();
+    while ( true )
+    {
+        auto it = std::search( first, content.end(), text.begin(), text.end(), eq );
+        if ( it == content.end() ) return false;
+        if ( mode == smSubstring ) return true;
+
+        // 词匹配需要检查两端边界
+        size_t start = it - content.begin(), end = start + text.length();
+        bool leftOk = start == 0 || !_IsWordByte( (winux::byte)content[start - 1] ) || !_IsWordByte( (winux::byte)text[0] );
+        bool rightOk = end == content.length() || !_IsWordByte( (winux::byte)content[end] ) || !_IsWordByte( (winux::byte)text[text.length() - 1] );
+        if ( leftOk && rightOk ) return true;
+        first = it + 1;
+    }
+}
+
+void LogSearchIndex::clear()
+{
+    _slots.clear();
+    _lists.clear();
+    _unindexedRows.clear();
+    _rowCount = 0;
+    _postingsBytes = 0;
+    _firstRow = 0;
+    _compactedRow = 0;
+}
+
+void LogSearchIndex::evict( winux::uint32 firstRow )
+{
+    if ( firstRow <= _firstRow ) return;
+    _firstRow = firstRow;
+    if ( _firstRow - _compactedRow < _rowCount - _firstRow ) return; // 过期的行还不多，暂不压缩
+    _compactedRow = _firstRow;
+
+    // 重新编码各倒排表，只保留有效的行
+    std::vector<winux::uint32> rows;
+    _postingsBytes = 0;
+    for ( PostingList & list : _lists )
+    {
+        _Decode( list, &rows );
+        list.data.clear();
+        list.count = 0;
+        for ( auto it = std::lower_bound( rows.begin(), rows.end(), _firstRow ); it != rows.end(); ++it )
+        {
+            _Append( list, *it );
+        }
+        list.data.shrink_to_fit();
+        _postingsBytes += list.data.size();
+    }
+    _unindexedRows.erase( _unindexedRows.begin(), std::lower_bound( _unindexedRows.begin(), _unindexedRows.end(), _firstRow ) );
+}
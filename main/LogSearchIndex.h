@@ -0,0 +1,91 @@
+﻿#pragma once
+#include "LogStore.h"
+
+/** \brief 日志全文搜索索引
+ *
+ *  以三元组（连续3个字节，ASCII字母折叠成小写）为键的倒排索引，随记录追加增量维护。
+ *  倒排表保存行号差值的变长整数编码。查询时先对各三元组的倒排表求交集得到候选行，再到存储中逐行校验。 */
+class LogSearchIndex
+{
+public:
+    /** \brief 搜索方式 */
+    enum SearchMode
+    {
+        smSubstring, //!< 子串
+        smToken      //!< 词，两端须是边界或非字母数字字符
+    };
+
+    /** \brief 构造函数
+     *
+     *  \param maxIndexBytes 每条记录最多索引的字节数。超出此长度的记录不建三元组，查询时总是作为候选行校验，以此限定每条记录的索引开销 */
+    explicit LogSearchIndex( size_t maxIndexBytes = 1024 );
+
+    /** \brief 索引一条记录，行号必须递增 */
+    void add( winux::uint32 row, winux::Utf8String const & content );
+
+    /** \brief 搜索
+     *
+     *  \param store 被索引的日志存储
+     *  \param text 搜索文本
+     *  \param mode 搜索方式
+     *  \param caseSensitive 是否区分大小写
+     *  \param rows 接收匹配的行号（升序）
+     *  \return size_t 匹配的行数 */
+    size_t search( LogStore const & store, winux::Utf8String const & text, SearchMode mode, bool caseSensitive, std::vector<winux::uint32> * rows ) const;
+
+    /** \brief 获取可能匹配的候选行（升序），未经校验
+     *
+     *  \return bool 搜索文本不足一个三元组、无法缩小范围时返回false，此时全部行都是候选行 */
+    bool getCandidates( winux::Utf8String const & text, std::vector<winux::uint32> * rows ) const;
+
+    /** \brief 判断内容是否匹配搜索文本 */
+    static bool Match( winux::Utf8String const & content, winux::Utf8String const & text, SearchMode mode, bool caseSensitive );
+
+    /** \brief 清空索引 */
+    void clear();
+
+    /** \brief 丢弃firstRow之前的行，用于存储淘汰记录之后
+     *
+     *  被丢弃的行不再作为候选行返回。过期的行数达到有效行数时才重新编码倒排表，摊还到每行的开销是O(1)的。 */
+    void evict( winux::uint32 firstRow );
+
+    /** \brief 已索引的行数 */
+    size_t getRowCount() const { return _rowCount; }
+
+    /** \brief 倒排表占用的字节数 */
+    size_t getPostingsBytes() const { return _postingsBytes; }
+
+private:
+    // 倒排表
+    struct PostingList
+    {
+        std::vector<winux::byte> data; // 行号差值的变长整数编码
+        winux::uint32 lastRow; // 最后加入的行号
+        winux::uint32 count; // 行数
+    };
+
+    // 开放寻址散列表的槽
+    struct Slot
+    {
+        winux::uint32 trigram; // 三元组
+        winux::uint32 list; // 倒排表索引+1，0表示空槽
+    };
+
+    // 解码一个倒排表
+    static void _Decode( PostingList const & list, std::vector<winux::uint32> * rows );
+    // 向倒排表追加一行，返回增加的字节数
+    static size_t _Append( PostingList & list, winux::uint32 row );
+
+    // 查找三元组对应的倒排表，不存在时若create为true则创建
+    PostingList * _find( winux::uint32 trigram, bool create );
+    PostingList const * _find( winux::uint32 trigram ) const { return const_cast<LogSearchIndex *>(this)->_find( trigram, false ); }
+
+    std::vector<Slot> _slots; // 三元组 => 倒排表，容量为2的幂
+    std::vector<PostingList> _lists; // 倒排表
+    std::vector<winux::uint32> _unindexedRows; // 超出索引字节上限的行
+    size_t _maxIndexBytes; // 每条记录最多索引的字节数
+    size_t _rowCount; // 已索引的行数
+    size_t _postingsBytes; // 倒排表占用字节数
+    winux::uint32 _firstRow; // 有效的第一行
+    winux::uint32 _compactedRow; // 上次重新编码时的有效第一行
+};
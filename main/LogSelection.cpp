@@ -0,0 +1,223 @@
+﻿#include "LogSelection.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline static size_t _PopCount( winux::uint64 v )
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (size_t)__popcnt64(v);
+#elif defined(__GNUC__)
+    return (size_t)__builtin_popcountll(v);
+#else
+    size_t n = 0;
+    for ( ; v; v &= v - 1 ) n++;
+    return n;
+#endif
+}
+
+// class LogSelection -------------------------------------------------------------------------
+LogSelection::LogSelection() : _dense(false), _runs(0), _count(0)
+{
+}
+
+void LogSelection::clear()
+{
+    _ranges.clear();
+    _bits.clear();
+    _bits.shrink_to_fit();
+    _dense = false;
+    _runs = 0;
+    _count = 0;
+}
+
+bool LogSelection::isSelected( size_t row ) const
+{
+    if ( _dense )
+    {
+        return row / 64 < _bits.size() && ( ( _bits[ row / 64 ] >> ( row % 64 ) ) & 1 );
+    }
+    auto it = _ranges.upper_bound(row);
+    if ( it == _ranges.begin() ) return false;
+    --it;
+    return row < it->second;
+}
+
+void LogSelection::selectRange( size_t first, size_t last, bool sel )
+{
+    if ( first > last ) std::swap( first, last );
+    if ( _dense )
+    {
+        this->_setBits( first, last + 1, sel );
+        this->_checkSparse();
+    }
+    else
+    {
+        if ( sel )
+            this->_addRange( first, last + 1 );
+        else
+            this->_removeRange( first, last + 1 );
+        this->_checkDense();
+    }
+}
+
+void LogSelection::invert( size_t rowCount )
+{
+    if ( _dense )
+    {
+        if ( _bits.size() * 64 < rowCount ) _bits.resize( ( rowCount + 63 ) / 64, 0 );
+        _count = 0;
+        for ( size_t w = 0; w < _bits.size(); w++ )
+        {
+            size_t begin = w * 64;
+            winux::uint64 mask = begin + 64 <= rowCount ? ~(winux::uint64)0 : ( begin < rowCount ? ( (winux::uint64)1 << ( rowCount - begin ) ) - 1 : 0 );
+            _bits[w] = ( _bits[w] ^ mask ) & mask;
+            _count += _PopCount(_bits[w]);
+        }
+        _runs = this->_countStarts( 0, _bits.size() * 64 );
+        this->_checkSparse();
+        return;
+    }
+
+    std::map< size_t, size_t > ranges;
+    size_t count = 0;
+    this->forEachRange( false, rowCount, [&ranges, &count] ( size_t begin, size_t end ) {
+        ranges.emplace_hint( ranges.end(), begin, end );
+        count += end - begin;
+    } );
+    _ranges.swap(ranges);
+    _count = count;
+    this->_checkDense();
+}
+
+void LogSelection::_addRange( size_t begin, size_t end )
+{
+    // 与前一个重叠或相邻的区间合并
+    auto it = _ranges.upper_bound(begin);
+    if ( it != _ranges.begin() )
+    {
+        auto prev = std::prev(it);
+        if ( prev->second >= begin )
+        {
+            if ( prev->second >= end ) return; // 已全部选中
+            begin = prev->first;
+            _count -= prev->second - prev->first;
+            _ranges.erase(prev);
+        }
+    }
+    // 吞并后面重叠或相邻的区间
+    while ( it != _ranges.end() && it->first <= end )
+    {
+        if ( it->second > end ) end = it->second;
+        _count -= it->second - it->first;
+        it = _ranges.erase(it);
+    }
+    _ranges.emplace_hint( it, begin, end );
+    _count += end - begin;
+}
+
+void LogSelection::_removeRange( size_t begin, size_t end )
+{
+    auto it = _ranges.upper_bound(begin);
+    if ( it != _ranges.begin() )
+    {
+        auto prev = std::prev(it);
+        if ( prev->second > begin ) // 前一个区间跨过begin，截断，必要时拆成两段
+        {
+            size_t prevEnd = prev->second;
+            prev->second = begin;
+            _count -= prevEnd - begin;
+            if ( prevEnd > end )
+            {
+                _ranges.emplace_hint( it, end, prevEnd );
+                _count += prevEnd - end;
+                return;
+            }
+            if ( prev->first == prev->second ) _ranges.erase(prev);
+        }
+    }
+    while ( it != _ranges.end() && it->first < end )
+    {
+        if ( it->second > end ) // 跨过end，保留后半段
+        {
+            size_t rangeEnd = it->second;
+            _count -= end - it->first;
+            _ranges.erase(it);
+            _ranges.emplace( end, rangeEnd );
+            return;
+        }
+        _count -= it->second - it->first;
+        it = _ranges.erase(it);
+    }
+}
+
+void LogSelection::_setBits( size_t begin, size_t end, bool sel )
+{
+    if ( sel && _bits.size() * 64 < end ) _bits.resize( ( end + 63 ) / 64 + _bits.size() / 2, 0 );
+    if ( !sel && end > _bits.size() * 64 ) end = _bits.size() * 64;
+    if ( begin >= end ) return;
+    // 区间起点只在[begin, end]内变化
+    _runs -= this->_countStarts( begin, end + 1 );
+    for ( size_t w = begin / 64; w * 64 < end; w++ )
+    {
+        size_t lo = w * 64 < begin ? begin - w * 64 : 0;
+        size_t hi = ( w + 1 ) * 64 <= end ? 64 : end - w * 64;
+        winux::uint64 mask = ( hi == 64 ? ~(winux::uint64)0 : ( (winux::uint64)1 << hi ) - 1 ) & ~( ( (winux::uint64)1 << lo ) - 1 );
+        winux::uint64 old = _bits[w];
+        _bits[w] = sel ? old | mask : old & ~mask;
+        _count += _PopCount(_bits[w]);
+        _count -= _PopCount(old);
+    }
+    _runs += this->_countStarts( begin, end + 1 );
+}
+
+void LogSelection::_checkDense()
+{
+    // 每个区间结点约占48字节，超过同范围位图的大小时转为位图
+    if ( _ranges.size() < 1024 ) return;
+    size_t maxRow = _ranges.rbegin()->second;
+    if ( _ranges.size() * 48 < maxRow / 8 ) return;
+
+    _bits.assign( ( maxRow + 63 ) / 64, 0 );
+    _dense = true;
+    _runs = 0;
+    _count = 0;
+    for ( auto && pr : _ranges )
+    {
+        this->_setBits( pr.first, pr.second, true );
+    }
+    _ranges.clear();
+}
+
+size_t LogSelection::_countStarts( size_t begin, size_t end ) const
+{
+    if ( end > _bits.size() * 64 ) end = _bits.size() * 64;
+    size_t n = 0;
+    for ( size_t w = begin / 64; w * 64 < end; w++ )
+    {
+        // 本位选中而前一位未选中的是区间起点
+        winux::uint64 prevBit = w > 0 ? _bits[ w - 1 ] >> 63 : 0;
+        winux::uint64 starts = _bits[w] & ~( ( _bits[w] << 1 ) | prevBit );
+        size_t lo = w * 64 < begin ? begin - w * 64 : 0;
+        size_t hi = ( w + 1 ) * 64 <= end ? 64 : end - w * 64;
+        winux::uint64 mask = ( hi == 64 ? ~(winux::uint64)0 : ( (winux::uint64)1 << hi ) - 1 ) & ~( ( (winux::uint64)1 << lo ) - 1 );
+        n += _PopCount( starts & mask );
+    }
+    return n;
+}
+
+void LogSelection::_checkSparse()
+{
+    // 与转为位图的条件相差四倍，避免在两种形式间来回转换
+    if ( _runs >= 256 && _runs * 48 * 4 >= _bits.size() * 8 ) return;
+
+    std::map< size_t, size_t > ranges;
+    this->forEachRange( true, _bits.size() * 64, [&ranges] ( size_t begin, size_t end ) {
+        ranges.emplace_hint( ranges.end(), begin, end );
+    } );
+    _ranges.swap(ranges);
+    _bits.clear();
+    _bits.shrink_to_fit();
+    _dense = false;
+}
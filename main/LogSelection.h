@@ -0,0 +1,114 @@
+﻿#pragma once
+#include "winux.hpp"
+#include <map>
+
+/** \brief 日志行选择集
+ *
+ *  用有序区间集合保存选中的行，区间范围选择、反选、计数都不必逐行操作。
+ *  零散的区间过多时转为位图保存，此时按字（64行）操作；区间数减少到四分之一以下时转回区间集合。 */
+class LogSelection
+{
+public:
+    LogSelection();
+
+    /** \brief 清空选择，恢复为区间集合 */
+    void clear();
+
+    /** \brief 是否没有选中的行 */
+    bool empty() const { return _count == 0; }
+
+    /** \brief 选中的行数 */
+    size_t count() const { return _count; }
+
+    /** \brief 行是否选中 */
+    bool isSelected( size_t row ) const;
+
+    /** \brief 选中或取消选中一行 */
+    void select( size_t row, bool sel = true ) { this->selectRange( row, row, sel ); }
+
+    /** \brief 切换一行的选中状态 */
+    void toggle( size_t row ) { this->select( row, !this->isSelected(row) ); }
+
+    /** \brief 选中或取消选中闭区间[first, last]内的行，first和last不分先后 */
+    void selectRange( size_t first, size_t last, bool sel = true );
+
+    /** \brief 对[0, rowCount)内的行反选 */
+    void invert( size_t rowCount );
+
+    /** \brief 按升序遍历[0, rowCount)内选中（或未选中）的行区间
+     *
+     *  \param selected true遍历选中的区间，false遍历未选中的区间
+     *  \param rowCount 总行数
+     *  \param fn 回调`fn( size_t begin, size_t end )`，区间为[begin, end) */
+    template < typename _Fx >
+    void forEachRange( bool selected, size_t rowCount, _Fx fn ) const
+    {
+        size_t pos = 0; // 未选区间的起点
+        auto emit = [&] ( size_t begin, size_t end ) {
+            if ( begin >= rowCount ) return;
+            if ( end > rowCount ) end = rowCount;
+            if ( selected )
+            {
+                fn( begin, end );
+            }
+            else
+            {
+                if ( pos < begin ) fn( pos, begin );
+            }
+            pos = end;
+        };
+
+        if ( _dense )
+        {
+            size_t begin = 0;
+            bool inRange = false;
+            for ( size_t w = 0; w < _bits.size() && w * 64 < rowCount; w++ )
+            {
+                winux::uint64 word = _bits[w];
+                // 整字相同时跳过
+                if ( word == ( inRange ? ~(winux::uint64)0 : 0 ) ) continue;
+                for ( size_t b = 0; b < 64; b++ )
+                {
+                    bool bit = ( word >> b ) & 1;
+                    if ( bit != inRange )
+                    {
+                        if ( bit ) begin = w * 64 + b;
+                        else emit( begin, w * 64 + b );
+                        inRange = bit;
+                    }
+                }
+            }
+            if ( inRange ) emit( begin, _bits.size() * 64 );
+        }
+        else
+        {
+            for ( auto && pr : _ranges )
+            {
+                if ( pr.first >= rowCount ) break;
+                emit( pr.first, pr.second );
+            }
+        }
+
+        if ( !selected && pos < rowCount ) fn( pos, rowCount );
+    }
+
+private:
+    // 区间集合：选中[begin, end)区间
+    void _addRange( size_t begin, size_t end );
+    // 区间集合：取消选中[begin, end)区间
+    void _removeRange( size_t begin, size_t end );
+    // 位图：设置[begin, end)区间的位
+    void _setBits( size_t begin, size_t end, bool sel );
+    // 区间过于零散时转为位图
+    void _checkDense();
+    // 位图：统计[begin, end)内选中区间的起点数
+    size_t _countStarts( size_t begin, size_t end ) const;
+    // 位图：区间数减少到一定程度时转回区间集合
+    void _checkSparse();
+
+    std::map< size_t, size_t > _ranges; // 区间集合 begin => end，互不重叠也不相邻
+    std::vector<winux::uint64> _bits; // 位图
+    bool _dense; // 是否使用位图
+    size_t _runs; // 位图中选中区间的个数
+    size_t _count; // 选中的行数
+};
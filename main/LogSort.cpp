@@ -0,0 +1,384 @@
+﻿#include "LogSort.h"
+#include <algorithm>
+
+// 用线程池执行fn(0)~fn(count-1)并等待完成，没有线程池时在本线程依次执行
+template < typename _Fn >
+inline static void _RunParallel( winux::ThreadPool * pool, size_t count, _Fn const & fn )
+{
+    if ( pool == nullptr || count <= 1 )
+    {
+        for ( size_t i = 0; i < count; i++ ) fn(i);
+        return;
+    }
+    std::vector< winux::Task<void> > tasks;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        tasks.push_back( pool->task( [&fn, i] () { fn(i); } ) );
+        tasks.back().post();
+    }
+    for ( auto && task : tasks )
+    {
+        task.wait();
+    }
+}
+
+// class LogSortIndex -------------------------------------------------------------------------
+bool LogSortIndex::_WordsLess( Entry const & a, Entry const & b )
+{
+    if ( a.words[0] != b.words[0] ) return a.words[0] < b.words[0];
+    if ( a.words[1] != b.words[1] ) return a.words[1] < b.words[1];
+    return a.row < b.row;
+}
+
+void LogSortIndex::setKeys( std::vector<Key> const & keys )
+{
+    _keys = keys;
+    // 只按行号升序排即存储的原始顺序，不需要索引
+    if ( _keys.size() == 1 && _keys[0].column == scRow && !_keys[0].descending ) _keys.clear();
+    this->reset();
+}
+
+void LogSortIndex::sort( winux::ThreadPool * pool, LogStore const & store, std::vector<winux::uint32> const * rows, std::atomic<bool> const * cancelled )
+{
+    auto isCancelled = [cancelled] () { return cancelled && cancelled->load(std::memory_order_relaxed); };
+    _entries.clear();
+    _delta.clear();
+    _firstRow = store.getFirstRow();
+    _nextRow = rows ? ( rows->empty() ? _firstRow : rows->back() + 1 ) : store.size();
+    if ( _keys.empty() ) return;
+
+    size_t count = rows ? rows->size() : store.size() - _firstRow;
+    _entries.resize(count);
+
+    // 分段：每段各自编码并按编码排序
+    size_t chunks = pool ? pool->getThreadCount() : 1;
+    if ( chunks > count / MinChunkRows ) chunks = count / MinChunkRows;
+    if ( chunks == 0 ) chunks = 1;
+    std::vector<size_t> bounds( chunks + 1 );
+    for ( size_t i = 0; i <= chunks; i++ ) bounds[i] = count * i / chunks;
+
+    _RunParallel( pool, chunks, [&] ( size_t chunk ) {
+        LogStore::Reader reader(store); // 冷块在本线程内临时解压
+        for ( size_t i = bounds[chunk]; i < bounds[chunk + 1]; i++ )
+        {
+            if ( i % 4096 == 0 && isCancelled() ) return;
+            winux::uint32 row = rows ? (*rows)[i] : (winux::uint32)( _firstRow + i );
+            this->_encode( reader[row], row, 0, 0, &_entries[i] );
+        }
+        std::sort( _entries.begin() + bounds[chunk], _entries.begin() + bounds[chunk + 1], _WordsLess );
+    } );
+
+    if ( isCancelled() ) return;
+
+    // 逐轮两两归并相邻的段，只比编码，不读记录
+    std::vector<Entry> buffer;
+    if ( chunks > 1 ) buffer.resize(count);
+    for ( size_t width = 1; width < chunks; width *= 2 )
+    {
+        size_t pairs = ( chunks + width * 2 - 1 ) / ( width * 2 );
+        _RunParallel( pool, pairs, [&] ( size_t pair ) {
+            size_t lo = bounds[ pair * width * 2 ];
+            size_t mid = bounds[ std::min( pair * width * 2 + width, chunks ) ];
+            size_t hi = bounds[ std::min( pair * width * 2 + width * 2, chunks ) ];
+            std::merge( _entries.begin() + lo, _entries.begin() + mid, _entries.begin() + mid, _entries.begin() + hi, buffer.begin() + lo, _WordsLess );
+        } );
+        _entries.swap(buffer);
+    }
+    buffer = std::vector<Entry>();
+    if ( isCancelled() ) return;
+
+    // 编码相同的行再按后面的键排序，分段时不拆开编码相同的行
+    for ( size_t i = 1; i < chunks; i++ )
+    {
+        size_t pos = std::max( count * i / chunks, bounds[i - 1] );
+        while ( pos > 0 && pos < count && _SameWords( _entries[pos - 1], _entries[pos] ) ) pos++;
+        bounds[i] = pos;
+    }
+    _RunParallel( pool, chunks, [&] ( size_t chunk ) {
+        if ( isCancelled() ) return;
+        this->_refine( store, _entries.data() + bounds[chunk], _entries.data() + bounds[chunk + 1], 0, 0 );
+    } );
+}
+
+void LogSortIndex::update( LogStore const & store, LogFilterView const * view )
+{
+    if ( _keys.empty() ) return;
+
+    // 去掉已淘汰的行，本来就要搬移主结果，先并入差量
+    size_t firstRow = store.getFirstRow();
+    if ( firstRow > _firstRow )
+    {
+        this->_foldDelta();
+        _entries.erase( std::remove_if( _entries.begin(), _entries.end(), [firstRow] ( Entry const & e ) { return e.row < firstRow; } ), _entries.end() );
+        _firstRow = firstRow;
+    }
+    if ( _nextRow < firstRow ) _nextRow = firstRow;
+
+    // 收集新行
+    std::vector<Entry> entries;
+    if ( view )
+    {
+        size_t lo = 0, hi = view->size();
+        while ( lo < hi )
+        {
+            size_t mid = ( lo + hi ) / 2;
+            if ( (*view)[mid] < _nextRow ) lo = mid + 1; else hi = mid;
+        }
+        for ( size_t i = lo; i < view->size(); i++ )
+        {
+            entries.emplace_back();
+            this->_encode( store[ (*view)[i] ], (*view)[i], 0, 0, &entries.back() );
+        }
+        if ( view->size() > 0 && (*view)[ view->size() - 1 ] >= _nextRow ) _nextRow = (*view)[ view->size() - 1 ] + 1;
+    }
+    else
+    {
+        for ( size_t row = _nextRow; row < store.size(); row++ )
+        {
+            entries.emplace_back();
+            this->_encode( store[row], (winux::uint32)row, 0, 0, &entries.back() );
+        }
+        _nextRow = store.size();
+    }
+    if ( !entries.empty() ) this->_merge( store, std::move(entries) );
+}
+
+void LogSortIndex::reset()
+{
+    _entries.clear();
+    _entries.shrink_to_fit();
+    _delta.clear();
+    _delta.shrink_to_fit();
+    _nextRow = 0;
+    _firstRow = 0;
+}
+
+void LogSortIndex::_encode( LogTextRecord const & tr, winux::uint32 row, size_t key, size_t offset, Entry * entry ) const
+{
+    entry->row = row;
+    entry->words[0] = entry->words[1] = 0;
+    size_t w = 0;
+    for ( ; key < _keys.size() && w < 2; key++, offset = 0 )
+    {
+        size_t first = w;
+        switch ( _keys[key].column )
+        {
+        case scTime:
+            entry->words[w++] = tr.utcTimeMs;
+            break;
+        case scSize:
+            entry->words[w++] = tr.contentSize;
+            break;
+        case scContent:
+            {
+                // 剩下的字按大端存内容的若干字节，与按字节比较字符串的结果一致，最低字节存剩余长度，超出时为255
+                size_t capacity = ( 2 - w ) * 8 - 1;
+                size_t remain = tr.strContent.size() > offset ? tr.strContent.size() - offset : 0;
+                size_t n = remain < capacity ? remain : capacity;
+                for ( size_t i = 0; i < n; i++ ) entry->words[ w + i / 8 ] |= (winux::uint64)(winux::byte)tr.strContent[ offset + i ] << ( 56 - i % 8 * 8 );
+                entry->words[1] |= remain > capacity ? 255 : remain;
+                w = 2;
+            }
+            break;
+        default:
+            entry->words[w++] = row;
+            break;
+        }
+        if ( _keys[key].descending )
+        {
+            for ( size_t i = first; i < w; i++ ) entry->words[i] = ~entry->words[i];
+        }
+    }
+}
+
+size_t LogSortIndex::_nextKey( size_t key, size_t offset, Entry const & entry, size_t * nextOffset ) const
+{
+    size_t w = 0;
+    *nextOffset = 0;
+    for ( ; key < _keys.size() && w < 2; key++, offset = 0 )
+    {
+        if ( _keys[key].column != scContent )
+        {
+            w++;
+            continue;
+        }
+        // 长度标记表示内容还没编完，下次从同一键接着编
+        if ( ( entry.words[1] & 255 ) == ( _keys[key].descending ? 0 : 255 ) )
+        {
+            *nextOffset = offset + ( 2 - w ) * 8 - 1;
+            return key;
+        }
+        return key + 1;
+    }
+    return key;
+}
+
+void LogSortIndex::_refine( LogStore const & store, Entry * begin, Entry * end, size_t key, size_t offset ) const
+{
+    // 编码相同的行按后面的键重新编码再排序，每行只读一次记录。写回时只改行号，编码都相同不用改
+    std::vector<Entry> run;
+    for ( Entry * i = begin; i < end; )
+    {
+        Entry * j = i + 1;
+        while ( j < end && _SameWords( *i, *j ) ) j++;
+        size_t nextOffset;
+        size_t nextKey = this->_nextKey( key, offset, *i, &nextOffset );
+        if ( j - i > 1 && nextKey < _keys.size() )
+        {
+            run.resize( j - i );
+            if ( nextOffset >= MaxContentOffset )
+            {
+                // 内容前面相同的部分太长时直接比较字符串
+                for ( size_t t = 0; t < run.size(); t++ ) run[t] = i[t];
+                std::sort( run.begin(), run.end(), [this, &store, nextKey] ( Entry const & a, Entry const & b ) {
+                    int c = this->_compare( store[a.row], a.row, store[b.row], b.row, nextKey );
+                    return c != 0 ? c < 0 : a.row < b.row;
+                } );
+            }
+            else
+            {
+                for ( size_t t = 0; t < run.size(); t++ ) this->_encode( store[ i[t].row ], i[t].row, nextKey, nextOffset, &run[t] );
+                std::sort( run.begin(), run.end(), _WordsLess );
+                this->_refine( store, run.data(), run.data() + run.size(), nextKey, nextOffset );
+            }
+            for ( size_t t = 0; t < run.size(); t++ ) i[t].row = run[t].row;
+        }
+        i = j;
+    }
+}
+
+int LogSortIndex::_compare( LogTextRecord const & a, winux::uint32 rowA, LogTextRecord const & b, winux::uint32 rowB, size_t key ) const
+{
+    for ( ; key < _keys.size(); key++ )
+    {
+        int c;
+        switch ( _keys[key].column )
+        {
+        case scTime:
+            c = a.utcTimeMs < b.utcTimeMs ? -1 : ( a.utcTimeMs > b.utcTimeMs ? 1 : 0 );
+            break;
+        case scSize:
+            c = a.contentSize < b.contentSize ? -1 : ( a.contentSize > b.contentSize ? 1 : 0 );
+            break;
+        case scContent:
+            c = a.strContent.compare(b.strContent);
+            break;
+        default:
+            c = rowA < rowB ? -1 : ( rowA > rowB ? 1 : 0 );
+            break;
+        }
+        if ( c != 0 ) return _keys[key].descending ? -c : c;
+    }
+    return 0;
+}
+
+bool LogSortIndex::_less( LogStore const & store, Entry const & a, Entry const & b ) const
+{
+    if ( a.words[0] != b.words[0] ) return a.words[0] < b.words[0];
+    if ( a.words[1] != b.words[1] ) return a.words[1] < b.words[1];
+
+    // 编码相同时读取记录，从编码之后的键比较起
+    size_t offset;
+    size_t key = this->_nextKey( 0, 0, a, &offset );
+    if ( key < _keys.size() )
+    {
+        int c = this->_compare( store[a.row], a.row, store[b.row], b.row, key );
+        if ( c != 0 ) return c < 0;
+    }
+    return a.row < b.row;
+}
+
+void LogSortIndex::_merge( LogStore const & store, std::vector<Entry> && entries )
+{
+    std::sort( entries.begin(), entries.end(), _WordsLess );
+    this->_refine( store, entries.data(), entries.data() + entries.size(), 0, 0 );
+    auto less = [this, &store] ( Entry const & a, Entry const & b ) { return this->_less( store, a, b ); };
+
+    // 新行在主结果中的位置，新行已排好，每次只在上一行的位置之后二分
+    auto pos = _entries.begin();
+    for ( auto && entry : entries )
+    {
+        pos = std::lower_bound( pos, _entries.end(), entry, less );
+        entry.rank = (winux::uint32)( pos - _entries.begin() );
+    }
+
+    // 从尾部往前归并进差量，比新行都小的差量行不必移动
+    size_t i = _delta.size(), j = entries.size();
+    _delta.resize( i + j );
+    size_t k = i + j;
+    while ( j > 0 )
+    {
+        if ( i > 0 && less( entries[j - 1], _delta[i - 1] ) )
+            _delta[--k] = _delta[--i];
+        else
+            _delta[--k] = entries[--j];
+    }
+
+    if ( _delta.size() > MinDeltaRows && _delta.size() > _entries.size() / 16 ) this->_foldDelta();
+}
+
+void LogSortIndex::_foldDelta()
+{
+    if ( _delta.empty() ) return;
+    // 按差量行记下的位置从尾部往前放，排在全部主结果之后的差量行不必移动主结果
+    size_t i = _entries.size(), j = _delta.size();
+    _entries.resize( i + j );
+    size_t k = i + j;
+    while ( j > 0 )
+    {
+        if ( i > _delta[j - 1].rank )
+            _entries[--k] = _entries[--i];
+        else
+            _entries[--k] = _delta[--j];
+    }
+    _delta.clear();
+}
+
+winux::uint32 LogSortIndex::_at( size_t i ) const
+{
+    // 第j个差量行排在第rank + j位，找第一个不早于i的差量行，在它之前的差量行数即主结果要跳过的行数
+    size_t lo = 0, hi = _delta.size();
+    while ( lo < hi )
+    {
+        size_t mid = ( lo + hi ) / 2;
+        if ( _delta[mid].rank + mid < i ) lo = mid + 1; else hi = mid;
+    }
+    if ( lo < _delta.size() && _delta[lo].rank + lo == i ) return _delta[lo].row;
+    return _entries[ i - lo ].row;
+}
+
+// class LogSortTask --------------------------------------------------------------------------
+LogSortTask::LogSortTask( winux::ThreadPool * pool, LogStore const & store, std::vector<LogSortIndex::Key> const & keys, std::vector<winux::uint32> const * rows ) :
+    _pool(pool), _store(store), _useRows( rows != nullptr ), _cancelled(false), _finished(false)
+{
+    if ( rows ) _rows = *rows;
+    _index.setKeys(keys);
+}
+
+LogSortTask::~LogSortTask()
+{
+    this->cancel();
+    this->wait();
+}
+
+void LogSortTask::start()
+{
+    _th.attachNew( new std::thread( &LogSortTask::_run, this ) );
+}
+
+void LogSortTask::wait()
+{
+    if ( _th && _th->joinable() ) _th->join();
+}
+
+void LogSortTask::takeIndex( LogSortIndex * index )
+{
+    this->wait();
+    std::swap( *index, _index );
+}
+
+void LogSortTask::_run()
+{
+    _index.sort( _pool, _store, _useRows ? &_rows : nullptr, &_cancelled );
+    _finished = true;
+}
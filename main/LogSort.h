@@ -0,0 +1,153 @@
+﻿#pragma once
+#include <atomic>
+#include <thread>
+#include "LogStore.h"
+#include "LogFilter.h"
+
+/** \brief 日志排序索引
+ *
+ *  不复制记录，只保存按排序键排列的行号。每行预先把排序键编码成两个64位字：时间、大小、行号各占一个字，
+ *  内容占用剩下的字，存若干字节和剩余长度。排序先只比编码，编码相同的一段再按后面的键（或内容后面的字节）
+ *  重新编码排序，每行每轮只读一次记录；最后按行号比较，因此排序是稳定的。
+ *  首次排序由线程池分段并行排序，再逐轮两两并行归并。之后新追加的行单独排序，归并进一个小的差量结果，
+ *  差量中每行记下排在它前面的主结果行数，按位置取行时二分差量即可，不必移动主结果；
+ *  差量超过主结果的一定比例时才一次并入主结果，因此按时间降序等新行排在前面的排序，每次并入新行也不搬移全部结果。 */
+class LogSortIndex
+{
+public:
+    enum { MinChunkRows = 65536 }; //!< 并行排序时每段的最少行数
+    enum { MaxContentOffset = 64 }; //!< 内容前面相同的部分超过此字节数时改为直接比较字符串
+    enum { MinDeltaRows = 65536 }; //!< 差量超过此行数且超过主结果的1/16时并入主结果
+
+    /** \brief 排序列 */
+    enum Column
+    {
+        scRow,      //!< 行号
+        scTime,     //!< 时间
+        scSize,     //!< 内容大小
+        scContent   //!< 内容
+    };
+
+    /** \brief 排序键 */
+    struct Key
+    {
+        Column column;
+        bool descending;
+    };
+
+    LogSortIndex() : _nextRow(0), _firstRow(0) { }
+
+    /** \brief 设置排序键并清空结果，空表示不排序 */
+    void setKeys( std::vector<Key> const & keys );
+
+    /** \brief 排序键 */
+    std::vector<Key> const & getKeys() const { return _keys; }
+
+    /** \brief 是否在排序，只按行号升序排时等同于不排序 */
+    bool isEnabled() const { return !_keys.empty(); }
+
+    /** \brief 用线程池并行排序
+     *
+     *  \param pool 线程池
+     *  \param store 日志存储，可以是快照，排序期间其中的行不能被淘汰
+     *  \param rows 要排序的行（升序），为空指针时排序存储中全部未淘汰的行
+     *  \param cancelled 取消标志，置位后尽快返回，结果无效 */
+    void sort( winux::ThreadPool * pool, LogStore const & store, std::vector<winux::uint32> const * rows = nullptr, std::atomic<bool> const * cancelled = nullptr );
+
+    /** \brief 并入排序之后追加的行，并去掉存储已淘汰的行
+     *
+     *  \param store 日志存储
+     *  \param view 排序的是筛选视图时为该视图，新行从视图中取 */
+    void update( LogStore const & store, LogFilterView const * view = nullptr );
+
+    /** \brief 清空结果，保留排序键，之后追加的行由update()并入 */
+    void reset();
+
+    /** \brief 行数 */
+    size_t size() const { return _entries.size() + _delta.size(); }
+
+    /** \brief 排在第i位的行号，有差量时二分差量定位 */
+    winux::uint32 operator [] ( size_t i ) const { return _delta.empty() ? _entries[i].row : this->_at(i); }
+
+private:
+    struct Entry
+    {
+        winux::uint64 words[2]; // 排序键的编码
+        winux::uint32 row;
+        winux::uint32 rank; // 差量中的行：排在它前面的主结果行数
+    };
+
+    // 从第key个键编码，内容键从第offset个字节编起
+    void _encode( LogTextRecord const & tr, winux::uint32 row, size_t key, size_t offset, Entry * entry ) const;
+    // 从第key个键编出的编码相同时，接着要比较的键，内容未编完时nextOffset为接着编码的位置
+    size_t _nextKey( size_t key, size_t offset, Entry const & entry, size_t * nextOffset ) const;
+    // 已按从第key个键编出的编码排好的一段，其中编码相同的行再按后面的键排序
+    void _refine( LogStore const & store, Entry * begin, Entry * end, size_t key, size_t offset ) const;
+    // 从第key个键起比较两条记录
+    int _compare( LogTextRecord const & a, winux::uint32 rowA, LogTextRecord const & b, winux::uint32 rowB, size_t key ) const;
+    // 比较两行，编码相同时读取记录比较其余的键
+    bool _less( LogStore const & store, Entry const & a, Entry const & b ) const;
+    // 只比较编码和行号
+    static bool _WordsLess( Entry const & a, Entry const & b );
+    // 编码是否相同
+    static bool _SameWords( Entry const & a, Entry const & b ) { return a.words[0] == b.words[0] && a.words[1] == b.words[1]; }
+    // 排序新行，从尾部往前归并进差量，差量过大时并入主结果
+    void _merge( LogStore const & store, std::vector<Entry> && entries );
+    // 把差量并入主结果
+    void _foldDelta();
+    // 有差量时排在第i位的行号
+    winux::uint32 _at( size_t i ) const;
+
+    std::vector<Key> _keys; // 排序键
+    std::vector<Entry> _entries; // 排好的行（主结果）
+    std::vector<Entry> _delta; // 之后并入的行（差量），按排序键有序
+    size_t _nextRow; // 下一个要并入的行号
+    size_t _firstRow; // 结果中的行都不小于此行号
+};
+
+/** \brief 后台排序
+ *
+ *  在后台线程中对存储快照排序，分段排序和归并仍交给线程池并行执行，界面线程只需轮询是否完成，完成后把结果换入。
+ *  排序期间接收线程可以继续追加，之后追加的行由LogSortIndex::update()并入。析构时会取消并等待后台线程结束。 */
+class LogSortTask
+{
+public:
+    /** \brief 构造函数
+     *
+     *  \param pool 线程池
+     *  \param store 日志存储的快照
+     *  \param keys 排序键
+     *  \param rows 要排序的行（升序），为空指针时排序存储中全部未淘汰的行 */
+    LogSortTask( winux::ThreadPool * pool, LogStore const & store, std::vector<LogSortIndex::Key> const & keys, std::vector<winux::uint32> const * rows = nullptr );
+
+    ~LogSortTask();
+
+    /** \brief 启动后台线程 */
+    void start();
+
+    /** \brief 取消排序 */
+    void cancel() { _cancelled = true; }
+
+    /** \brief 等待后台线程结束 */
+    void wait();
+
+    /** \brief 是否已排序完毕（被取消的不算） */
+    bool isDone() const { return !_cancelled && _finished; }
+
+    /** \brief 取出排序结果，须在isDone()之后调用 */
+    void takeIndex( LogSortIndex * index );
+
+private:
+    // 后台线程
+    void _run();
+
+    winux::ThreadPool * _pool; // 线程池
+    LogStore _store; // 日志存储快照
+    std::vector<winux::uint32> _rows; // 要排序的行
+    bool _useRows; // 是否只排序_rows中的行
+    LogSortIndex _index; // 排序结果
+
+    std::atomic<bool> _cancelled; // 已取消
+    std::atomic<bool> _finished; // 后台线程已结束
+    winux::SimplePointer<std::thread> _th; // 后台线程
+};
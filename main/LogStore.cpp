@@ -0,0 +1,563 @@
+﻿#include "LogStore.h"
+#include "LogColdFile.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+LogColorClass GetLogColorClass( eienlog::LogFlag flag )
+{
+    float r, g, b;
+    if ( flag.fgColorUse )
+    {
+        r = ( flag.fgColor & 31 ) / 31.0f, g = ( ( flag.fgColor >> 5 ) & 31 ) / 31.0f, b = ( ( flag.fgColor >> 10 ) & 31 ) / 31.0f;
+    }
+    else if ( flag.bgColorUse )
+    {
+        r = ( flag.bgColor & 15 ) / 15.0f, g = ( ( flag.bgColor >> 4 ) & 15 ) / 15.0f, b = ( ( flag.bgColor >> 8 ) & 15 ) / 15.0f;
+    }
+    else
+    {
+        return lccNone;
+    }
+
+    if ( r > g + b ) return lccRed;
+    if ( g > r + b ) return lccGreen;
+    if ( b > r + g ) return lccBlue;
+    return lccOther;
+}
+
+void LogFormatTime( winux::uint64 utcTimeMs, winux::uint64 * cacheSec, winux::AnsiString * cache, winux::Utf8String * out )
+{
+    winux::uint64 sec = utcTimeMs / 1000;
+    if ( sec != *cacheSec || cache->empty() )
+    {
+        *cache = winux::DateTimeL::FromMilliSec( sec * 1000 ).toString<char>();
+        *cacheSec = sec;
+    }
+    size_t len = cache->length();
+    if ( len < 4 || (*cache)[ len - 4 ] != '.' )
+    {
+        *out = winux::DateTimeL::FromMilliSec(utcTimeMs).toString<char>();
+        return;
+    }
+    *out = *cache;
+    unsigned ms = (unsigned)( utcTimeMs % 1000 );
+    (*out)[ len - 3 ] = (char)( '0' + ms / 100 );
+    (*out)[ len - 2 ] = (char)( '0' + ms / 10 % 10 );
+    (*out)[ len - 1 ] = (char)( '0' + ms % 10 );
+}
+
+void LogRecordToText( eienlog::LogRecord const & record, LogTextRecord * tr, std::vector<eienlog::LogField> * fields )
+{
+    tr->flag.value = record.flag;
+    tr->meta = record.meta;
+    tr->utcTime = winux::DateTimeL::FromMilliSec(record.utcTime).toString<char>();
+    tr->utcTimeMs = record.utcTime;
+    tr->contentSize = record.data.getSize();
+    tr->strContent.clear();
+
+    std::vector<eienlog::LogField> parsed;
+    if ( fields == nullptr ) fields = &parsed;
+    fields->clear();
+
+    if ( tr->flag.isFields() && eienlog::LogFields::Parse( record.data.getBuf(), record.data.getSize(), fields ) )
+    {
+        tr->strContent = LogFieldsToText(*fields);
+    }
+    // 如果非二进制，才进行编码转换
+    else if ( !tr->flag.binary )
+    {
+        // 根据编码进行转换
+        switch ( tr->flag.logEncoding )
+        {
+        case eienlog::leUtf8:
+            {
+                tr->strContent.assign( record.data.toString<char>() );
+            }
+            break;
+        case eienlog::leUtf16Le:
+            {
+                tr->strContent = winux::Utf16BytesToUtf8( record.data, false );
+            }
+            break;
+        case eienlog::leUtf16Be:
+            {
+                tr->strContent = winux::Utf16BytesToUtf8( record.data, true );
+            }
+            break;
+        default:
+            {
+                tr->strContent.assign( winux::LocalToUtf8( record.data.toString<char>() ) );
+            }
+            break;
+        }
+    }
+    else // 二进制数据
+    {
+        int i = 1;
+        for ( auto && byt : record.data )
+        {
+            tr->strContent += winux::BufferToHex<char>( winux::Buffer( &byt, 1, true ) );
+            if ( i % 16 )
+            {
+                tr->strContent += " ";
+            }
+            else
+            {
+                tr->strContent += "\n";
+            }
+            i++;
+        }
+        winux::StrMakeUpper(&tr->strContent);
+        fields->clear();
+    }
+
+    tr->strContentSlashes = winux::AddCSlashes(tr->strContent);
+}
+
+void LogTextToRecord( LogTextRecord const & tr, eienlog::LogRecord * record )
+{
+    eienlog::LogFlag flag = tr.flag;
+    std::vector<eienlog::LogField> fields;
+    if ( flag.isFields() && LogFieldsFromText( tr.strContent, &fields ) )
+    {
+        eienlog::LogFields encoder;
+        for ( auto && field : fields ) encoder.add(field);
+        winux::Buffer data = encoder.getData();
+        record->data.setBuf( data.getBuf(), data.getSize(), false );
+    }
+    else if ( flag.isFields() ) // 文本已不是字段格式，按文本保存
+    {
+        flag.binary = false;
+        flag.logEncoding = eienlog::leUtf8;
+        record->data.setBuf( tr.strContent.c_str(), tr.strContent.length(), false );
+    }
+    else if ( !flag.binary )
+    {
+        flag.logEncoding = eienlog::leUtf8;
+        record->data.setBuf( tr.strContent.c_str(), tr.strContent.length(), false );
+    }
+    else // 去掉分隔的空白再还原
+    {
+        winux::AnsiString hex;
+        hex.reserve( tr.strContent.length() );
+        for ( char ch : tr.strContent )
+        {
+            if ( ch != ' ' && ch != '\n' ) hex += ch;
+        }
+        record->data = winux::HexToBuffer(hex);
+    }
+    record->utcTime = (time_t)tr.utcTimeMs;
+    record->flag = flag.value;
+    record->meta = tr.meta;
+}
+
+// struct LogRange ----------------------------------------------------------------------------
+LogRange LogRange::Parse( Type type, winux::Utf8String const & begin, winux::Utf8String const & end )
+{
+    auto parse = [type] ( winux::Utf8String const & str ) -> winux::uint64 {
+        winux::Utf8String s = winux::StrTrim(str);
+        if ( s.empty() ) return 0;
+        if ( type == lrTime ) return winux::DateTimeL( _ToString(s) ).toUtcTimeMs();
+        return strtoull( s.c_str(), nullptr, 10 );
+    };
+    return LogRange( type, parse(begin), parse(end) );
+}
+
+// 最低的置位位的序号，v不为0
+inline static size_t _LowestBit( winux::uint64 v )
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanForward64( &i, v );
+    return i;
+#elif defined(__GNUC__)
+    return (size_t)__builtin_ctzll(v);
+#else
+    size_t n = 0;
+    for ( ; !( v & 1 ); v >>= 1 ) n++;
+    return n;
+#endif
+}
+
+// 估算一条记录占用的字节数
+inline static winux::uint64 _RecordBytes( LogTextRecord const & tr )
+{
+    return sizeof(LogTextRecord) + tr.strContent.capacity() + tr.strContentSlashes.capacity() + tr.utcTime.capacity();
+}
+
+// 补足空记录，块损坏时保持行数不变
+inline static void _FillEmptyRecords( size_t count, std::vector<LogTextRecord> * records )
+{
+    while ( records->size() < count )
+    {
+        LogTextRecord tr;
+        tr.contentSize = 0;
+        tr.utcTimeMs = 0;
+        records->push_back( std::move(tr) );
+    }
+}
+
+// class LogStore::Reader ---------------------------------------------------------------------
+LogTextRecord const & LogStore::Reader::operator [] ( size_t row )
+{
+    size_t blockIndex = row / BlockRecords;
+    Block * block = (*_store._blocks.get())[ blockIndex - _store._firstBlock ].get();
+    if ( block->loaded.load(std::memory_order_acquire) ) return block->records[ row % BlockRecords ];
+
+    if ( blockIndex != _blockIndex )
+    {
+        size_t first = blockIndex * BlockRecords;
+        size_t count = _store._count - first < BlockRecords ? _store._count - first : BlockRecords;
+        _records.clear();
+        if ( block->templates )
+        {
+            block->templates->decode( *_store._dict.get(), &_records );
+        }
+        else if ( block->coldSize != 0 )
+        {
+            _store._cold->read( block->coldOffset, block->coldSize, &_records );
+        }
+        else // 数据源的块临时解析，首次解析时顺便建立时间范围等信息
+        {
+            _store._source->loadRecords( first, count, &_records );
+            if ( block->isSourcePending() )
+            {
+                std::lock_guard<std::mutex> lk(block->mtx);
+                if ( block->isSourcePending() ) LogStore::_IndexSource( block, _records );
+            }
+        }
+        _FillEmptyRecords( count, &_records );
+        _blockIndex = blockIndex;
+    }
+    return _records[ row % BlockRecords ];
+}
+
+// class LogStore -----------------------------------------------------------------------------
+LogStore::LogStore() : _blocks( new BlockList() ), _firstBlock(0), _count(0), _bytes(0), _newestTimeMs(0), _templateBytes(0), _maxHotBytes(0), _hotBytes(0), _useTick(0), _seenPageIns(0)
+{
+}
+
+size_t LogStore::append( LogTextRecord && tr, std::vector<eienlog::LogField> const * fields )
+{
+    if ( _count % BlockRecords != 0 )
+    {
+        this->_records( _count / BlockRecords ); // 最后一块可能尚未载入
+    }
+    else
+    {
+        auto block = winux::MakeShared( new Block() );
+        block->records.reserve(BlockRecords);
+        block->lastUse = _useTick;
+        if ( _dict ) block->templates.attachNew( new LogTemplateBlock(BlockRecords) );
+        this->_mutableBlocks().push_back(block);
+        // 前一块已写满，可以换出。启用模板字典时立即封存，只保留编码
+        if ( _dict && _blocks->size() > 1 ) this->_pageOut( _count / BlockRecords - 1 );
+        if ( ( _cold || _dict ) && _hotBytes > this->_getMaxHotBytes() ) this->trim();
+    }
+    Block * block = _blocks->back().get();
+    winux::uint64 bytes = _RecordBytes(tr);
+    block->addTime(tr.utcTimeMs);
+    block->bytes += bytes;
+    _bytes += bytes;
+    _hotBytes += bytes;
+    if ( tr.utcTimeMs > _newestTimeMs ) _newestTimeMs = tr.utcTimeMs;
+    if ( tr.flag.isFields() )
+    {
+        std::vector<eienlog::LogField> parsed;
+        if ( fields == nullptr && LogFieldsFromText( tr.strContent, &parsed ) ) fields = &parsed;
+        if ( fields ) block->fields->set( block->records.size(), *fields );
+    }
+    block->meta->set( block->records.size(), tr.meta );
+    if ( block->templates ) tr.templateId = block->templates->add( _dict.get(), tr );
+    block->records.push_back( std::move(tr) );
+    size_t row = _count++;
+
+    if ( _retention.isLimited() ) this->_enforceRetention();
+    return row;
+}
+
+void LogStore::clear()
+{
+    _blocks.attachNew( new BlockList() ); // 快照仍持有原来的列表
+    _firstBlock = 0;
+    _count = 0;
+    _bytes = 0;
+    _newestTimeMs = 0;
+    _hotBytes = 0;
+    _templateBytes = 0;
+    _source.reset();
+}
+
+void LogStore::setRetention( LogRetention const & retention, winux::SharedPointer<LogEvictSink> sink )
+{
+    _retention = retention;
+    _evictSink = sink;
+    if ( _retention.isLimited() ) this->_enforceRetention();
+}
+
+void LogStore::_enforceRetention()
+{
+    while ( _blocks->size() > 1 )
+    {
+        // 换出到冷存储或已编码的块仍保留时间范围，只有未载入的数据源块不知道时间
+        Block * front = _blocks->front().get();
+        bool evict = ( _retention.maxRecords != 0 && _count - this->getFirstRow() > _retention.maxRecords ) ||
+            ( _retention.maxBytes != 0 && _bytes > _retention.maxBytes ) ||
+            ( _retention.maxAgeMs != 0 && !front->isSourcePending() && front->maxTimeMs + _retention.maxAgeMs < _newestTimeMs );
+        if ( !evict ) break;
+
+        if ( front->loaded ) _hotBytes -= front->bytes;
+        if ( front->templates && front->templates->isSealed() ) _templateBytes -= front->templates->getBytes();
+        if ( _evictSink ) _evictSink->evictRecords( this->getFirstRow(), this->_records(_firstBlock) );
+        if ( !front->fromSource ) _bytes -= front->bytes;
+        this->_mutableBlocks().pop_front(); // 快照仍持有的块在快照销毁时才释放
+        _firstBlock++;
+    }
+}
+
+void LogStore::attachSource( winux::SharedPointer<LogBlockSource> source, size_t count )
+{
+    this->clear();
+    _retention = LogRetention();
+    _cold.reset();
+    _dict.reset();
+    _maxHotBytes = 0;
+    _source = source;
+    _count = count;
+    _seenPageIns = this->_getPageIns();
+    for ( size_t i = 0; i < count; i += BlockRecords )
+    {
+        auto block = winux::MakeShared( new Block() );
+        block->loaded = false;
+        block->indexed = false;
+        block->fromSource = true;
+        _blocks->push_back(block); // clear()之后列表不与快照共享
+    }
+}
+
+size_t LogStore::getLoadedBlocks() const
+{
+    size_t n = 0;
+    for ( auto && block : *_blocks.get() )
+    {
+        if ( block->loaded ) n++;
+    }
+    return n;
+}
+
+void LogStore::_load( size_t blockIndex ) const
+{
+    Block * block = (*_blocks.get())[ blockIndex - _firstBlock ].get();
+    std::lock_guard<std::mutex> lk(block->mtx);
+    if ( block->loaded ) return;
+
+    size_t first = blockIndex * BlockRecords;
+    size_t count = _count - first < BlockRecords ? _count - first : BlockRecords;
+    block->records.reserve(BlockRecords);
+    if ( block->coldSize != 0 ) // 从冷块文件换入，时间范围在换出时已保留
+    {
+        _cold->read( block->coldOffset, block->coldSize, &block->records );
+        _FillEmptyRecords( count, &block->records );
+        _cold->addPageIn();
+    }
+    else if ( block->templates ) // 解码换入
+    {
+        block->templates->decode( *_dict.get(), &block->records );
+        _FillEmptyRecords( count, &block->records );
+        _dict->addPageIn();
+    }
+    else // 从数据源解析，释放后再次载入时时间范围等信息已建立
+    {
+        _source->loadRecords( first, count, &block->records );
+        if ( block->isSourcePending() ) LogStore::_IndexSource( block, block->records );
+        block->bytes = 0;
+        for ( auto && tr : block->records ) block->bytes += _RecordBytes(tr);
+        _source->addPageIn();
+    }
+    block->loaded.store( true, std::memory_order_release );
+}
+
+void LogStore::_IndexSource( Block * block, std::vector<LogTextRecord> const & records )
+{
+    std::vector<eienlog::LogField> fields;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord const & tr = records[i];
+        block->addTime(tr.utcTimeMs);
+        block->meta->set( i, tr.meta );
+        if ( tr.flag.isFields() && LogFieldsFromText( tr.strContent, &fields ) ) block->fields->set( i, fields );
+    }
+    block->indexed.store( true, std::memory_order_release );
+}
+
+bool LogStore::setTiering( winux::String const & coldPath, winux::uint64 maxHotBytes )
+{
+    _cold.reset();
+    _maxHotBytes = 0;
+    if ( maxHotBytes == 0 ) return true;
+
+    winux::SharedPointer<LogColdFile> cold( new LogColdFile() );
+    if ( !cold->open(coldPath) ) return false;
+    _cold = cold;
+    _maxHotBytes = maxHotBytes;
+    _seenPageIns = this->_getPageIns();
+    this->trim();
+    return true;
+}
+
+bool LogStore::setTemplateDict( bool enable )
+{
+    if ( _count != 0 ) return false;
+    if ( enable )
+        _dict.attachNew( new LogTemplateDict() );
+    else
+        _dict.reset();
+    _seenPageIns = this->_getPageIns();
+    return true;
+}
+
+void LogStore::findByTemplate( winux::uint32 templateId, size_t begin, size_t end, std::vector<winux::uint32> * rows ) const
+{
+    if ( begin < this->getFirstRow() ) begin = this->getFirstRow();
+    if ( end > _count ) end = _count;
+    for ( size_t row = begin; row < end; )
+    {
+        size_t blockIndex = row / BlockRecords;
+        size_t blockEnd = ( blockIndex + 1 ) * BlockRecords < end ? ( blockIndex + 1 ) * BlockRecords : end;
+        LogTemplateBlock const * templates = (*_blocks.get())[ blockIndex - _firstBlock ]->templates.get();
+        if ( templates != nullptr )
+        {
+            for ( ; row < blockEnd; row++ )
+            {
+                if ( templates->getId( row % BlockRecords ) == templateId ) rows->push_back( (winux::uint32)row );
+            }
+        }
+        row = blockEnd;
+    }
+}
+
+void LogStore::trim()
+{
+    if ( !_cold && !_dict && !_source ) return;
+    _useTick++;
+
+    // 有块被换入（可能来自其他线程上的快照）时重新统计热数据
+    if ( this->_getPageIns() != _seenPageIns )
+    {
+        _seenPageIns = this->_getPageIns();
+        _hotBytes = 0;
+        for ( auto && block : *_blocks.get() )
+        {
+            if ( block->loaded ) _hotBytes += block->bytes;
+        }
+    }
+    winux::uint64 maxHotBytes = this->_getMaxHotBytes();
+    if ( _hotBytes <= maxHotBytes || _blocks->size() < 2 ) return;
+
+    // 按最近访问时刻从早到晚换出，留出1/8的余量，避免每追加一块都要重新排序。正在追加的最后一块不换出
+    std::vector< std::pair< winux::uint64, size_t > > lru;
+    for ( size_t i = 0; i + 1 < _blocks->size(); i++ )
+    {
+        Block * block = (*_blocks.get())[i].get();
+        if ( block->loaded ) lru.emplace_back( block->lastUse.load(std::memory_order_relaxed), _firstBlock + i );
+    }
+    std::sort( lru.begin(), lru.end() );
+    winux::uint64 target = maxHotBytes - maxHotBytes / 8;
+    for ( auto && item : lru )
+    {
+        if ( _hotBytes <= target ) break;
+        if ( !this->_pageOut(item.second) ) break;
+    }
+}
+
+bool LogStore::_pageOut( size_t blockIndex )
+{
+    Block * block = (*_blocks.get())[ blockIndex - _firstBlock ].get();
+    // 块写满后不再改变，只需写入或封存一次，之后换出只替换指针。数据源的块可以重新解析，直接释放
+    if ( block->templates )
+    {
+        if ( !block->templates->isSealed() )
+        {
+            block->templates->seal( block->records );
+            _templateBytes += block->templates->getBytes();
+        }
+    }
+    else if ( !block->fromSource && block->coldSize == 0 && ( !_cold || !_cold->write( block->records, &block->coldOffset, &block->coldSize ) ) )
+    {
+        return false;
+    }
+
+    auto cold = winux::MakeShared( new Block() );
+    cold->loaded = false;
+    cold->fromSource = block->fromSource;
+    cold->minTimeMs = block->minTimeMs;
+    cold->maxTimeMs = block->maxTimeMs;
+    cold->bytes = block->bytes;
+    cold->coldOffset = block->coldOffset;
+    cold->coldSize = block->coldSize;
+    cold->lastUse = block->lastUse.load(std::memory_order_relaxed);
+    cold->fields = block->fields;
+    cold->meta = block->meta;
+    cold->templates = block->templates;
+    _hotBytes -= block->bytes;
+    this->_mutableBlocks()[ blockIndex - _firstBlock ] = cold; // 快照仍持有的块在快照销毁时才释放
+    return true;
+}
+
+void LogStore::findByMeta( LogMetaQuery const & query, std::vector<winux::uint32> * rows ) const
+{
+    winux::uint64 timeEnd = query.timeEnd == 0 ? (winux::uint64)-1 : query.timeEnd;
+    Reader reader(*this); // 数据源的块和边界块在读取器内临时解析，不载入存储
+    BlockList const & blocks = *_blocks.get();
+    for ( size_t k = _firstBlock; k < _firstBlock + blocks.size(); k++ )
+    {
+        Block const * block = blocks[ k - _firstBlock ].get();
+        if ( block->isSourcePending() ) reader[ k * BlockRecords ]; // 数据源的块解析后位图才有效
+        if ( !block->meta->mayMatch( query.severityMask, query.categoryMask ) ) continue;
+        if ( block->maxTimeMs < query.timeBegin || block->minTimeMs >= timeEnd ) continue;
+        bool inTime = block->minTimeMs >= query.timeBegin && block->maxTimeMs < timeEnd;
+
+        // 最后一块可能正在追加，只取存储的行数以内的行
+        size_t first = k * BlockRecords;
+        size_t count = _count - first < BlockRecords ? _count - first : BlockRecords;
+        for ( size_t w = 0; w * 64 < count; w++ )
+        {
+            winux::uint64 bits = block->meta->getWord( query.severityMask, query.categoryMask, w );
+            if ( ( w + 1 ) * 64 > count ) bits &= ~( ~(winux::uint64)0 << ( count % 64 ) );
+            for ( ; bits != 0; bits &= bits - 1 )
+            {
+                size_t offset = w * 64 + _LowestBit(bits);
+                if ( !inTime )
+                {
+                    winux::uint64 t = reader[ first + offset ].utcTimeMs;
+                    if ( t < query.timeBegin || t >= timeEnd ) continue;
+                }
+                rows->push_back( (winux::uint32)( first + offset ) );
+            }
+        }
+    }
+}
+
+winux::uint64 LogStore::_getPageIns() const
+{
+    return ( _cold ? _cold->getPageIns() : 0 ) + ( _dict ? _dict->getPageIns() : 0 ) + ( _source ? _source->getPageIns() : 0 );
+}
+
+LogStore::BlockList & LogStore::_mutableBlocks()
+{
+    // 只有存储自己持有列表时引用计数为1，快照只能在持有存储时从存储拷贝，因此判断之后不会再被共享
+    if ( _blocks.getContext()->useCount() > 1 ) _blocks.attachNew( new BlockList( *_blocks.get() ) );
+    return *_blocks.get();
+}
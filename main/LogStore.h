@@ -0,0 +1,410 @@
+﻿#pragma once
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include "eienlog.hpp"
+#include "LogFields.h"
+#include "LogMetaIndex.h"
+#include "LogTemplateDict.h"
+
+/** \brief 日志文本记录 */
+struct LogTextRecord
+{
+    size_t contentSize;  //!< 日志内容大小
+    winux::Utf8String strContent;   //!< 字符串内容
+    winux::Utf8String strContentSlashes;    //!< 字符串转义内容
+    winux::Utf8String utcTime;  //!< UTC时间戳
+    winux::uint64 utcTimeMs;    //!< UTC时间戳（毫秒），用于按时间筛选
+    eienlog::LogFlag flag;  //!< 日志样式FLAG
+    eienlog::LogMeta meta;  //!< 级别和类别
+    winux::uint32 repeatCount = 1;  //!< 折叠的重复次数
+    winux::uint64 lastTimeMs = 0;   //!< 最后一次重复的UTC时间戳（毫秒），未折叠时为0
+    float textWidth = 0;    //!< 转义内容的显示宽度（以字号为单位），界面首次绘制时测量，0表示未测量，不持久化
+    winux::uint32 templateId = 0;   //!< 内容的模板编号，0表示未按模板编码，不持久化
+};
+
+/** \brief 日志颜色类别，有前景色时按前景色判断，否则按背景色判断 */
+enum LogColorClass
+{
+    lccNone,    //!< 无颜色
+    lccRed,     //!< 红色系
+    lccGreen,   //!< 绿色系
+    lccBlue,    //!< 蓝色系
+    lccOther,   //!< 其他颜色
+    lccCount
+};
+
+/** \brief 获取日志的颜色类别 */
+LogColorClass GetLogColorClass( eienlog::LogFlag flag );
+
+/** \brief 格式化UTC时间戳（毫秒），结果与DateTimeL::toString()相同
+ *
+ *  连续格式化时传入同一组缓存，同一秒内的时间只替换毫秒部分。 */
+void LogFormatTime( winux::uint64 utcTimeMs, winux::uint64 * cacheSec, winux::AnsiString * cache, winux::Utf8String * out );
+
+/** \brief 把日志记录转换成文本记录，文本按编码转成UTF-8，二进制数据转成十六进制
+ *
+ *  结构化字段记录渲染成LogFieldsToText()的文本，字段格式有误时按二进制数据显示。
+ *  \param fields 不为空时接受解析出的字段，非结构化记录或格式有误时为空 */
+void LogRecordToText( eienlog::LogRecord const & record, LogTextRecord * tr, std::vector<eienlog::LogField> * fields = nullptr );
+
+/** \brief 把文本记录还原成日志记录，文本以UTF-8编码保存，二进制数据从十六进制还原，结构化字段从文本重新编码 */
+void LogTextToRecord( LogTextRecord const & tr, eienlog::LogRecord * record );
+
+/** \brief 日志范围，按行或按时间指定要加载、导出的记录 */
+struct LogRange
+{
+    enum Type
+    {
+        lrAll,  //!< 全部记录
+        lrRows, //!< 行区间
+        lrTime  //!< 时间区间
+    };
+
+    Type type;
+    winux::uint64 begin; //!< 起始行号或起始时间（毫秒），含
+    winux::uint64 end;   //!< 结束行号或结束时间（毫秒），不含，0表示不限
+
+    LogRange() : type(lrAll), begin(0), end(0) { }
+    LogRange( Type type, winux::uint64 begin, winux::uint64 end ) : type(type), begin(begin), end(end) { }
+
+    /** \brief 从界面输入构造范围，行号为十进制数，时间为日期时间文本，空文本表示不限 */
+    static LogRange Parse( Type type, winux::Utf8String const & begin, winux::Utf8String const & end );
+};
+
+/** \brief 记录块数据源，按需提供记录 */
+class LogBlockSource
+{
+public:
+    LogBlockSource() : _pageIns(0) { }
+    virtual ~LogBlockSource() { }
+
+    /** \brief 载入从first行开始的count条记录，追加到records */
+    virtual void loadRecords( size_t first, size_t count, std::vector<LogTextRecord> * records ) = 0;
+
+    /** \brief 块载入存储的次数，LogStore据此判断是否需要重新统计热数据 */
+    winux::uint64 getPageIns() const { return _pageIns.load(std::memory_order_relaxed); }
+
+    /** \brief 记下一次载入 */
+    void addPageIn() const { _pageIns.fetch_add( 1, std::memory_order_relaxed ); }
+
+private:
+    mutable std::atomic<winux::uint64> _pageIns; // 块载入存储的次数
+};
+
+/** \brief 记录保留策略，超出任一上限时从最早的块开始整块淘汰，各项为0表示不限 */
+struct LogRetention
+{
+    size_t maxRecords;          //!< 最多保留的记录数
+    winux::uint64 maxBytes;     //!< 记录最多占用的字节数（按字符串容量估算）
+    winux::uint64 maxAgeMs;     //!< 最长保留时间（毫秒），以最新一条记录的时间为准
+
+    LogRetention() : maxRecords(0), maxBytes(0), maxAgeMs(0) { }
+
+    /** \brief 是否设有上限 */
+    bool isLimited() const { return maxRecords != 0 || maxBytes != 0 || maxAgeMs != 0; }
+};
+
+/** \brief 淘汰记录的接收者，可把被淘汰的记录转存到磁盘 */
+class LogEvictSink
+{
+public:
+    virtual ~LogEvictSink() { }
+
+    /** \brief 接收被淘汰的一块记录，firstRow为其第一行的行号 */
+    virtual void evictRecords( size_t firstRow, std::vector<LogTextRecord> const & records ) = 0;
+};
+
+class LogColdFile;
+
+/** \brief 日志记录存储，按块追加
+ *
+ *  记录分块存放，每块预留固定容量，追加时不会搬移已有记录，因此记录的地址在存储期间保持稳定。
+ *  存储也可以建立在数据源上，这时各块在首次访问时才从数据源载入。经由operator[]载入的块在trim()时按LRU释放，
+ *  需要时再从数据源解析；经由Reader访问的块只在读取器内临时解析，不载入存储，因此内存不随数据源的大小增长。
+ *  拷贝存储即取快照：块列表按引用计数共享，拷贝只复制列表指针和行数，是O(1)的，记录也是共享的，
+ *  可作为只读快照交给其他线程读取，不必在读取期间持有互斥量。存储之后追加的行不在快照的行数内；
+ *  存储要增删或替换块时，若列表仍被快照共享，先复制一份列表再修改（写时复制），快照看到的块列表不变。
+ *
+ *  设置保留策略后，超出上限时从头部整块淘汰记录，每次淘汰是O(1)的。行号保持不变，被淘汰的行不再可访问，
+ *  有效行为[getFirstRow(), size())。
+ *
+ *  设置分层存储后，热数据超出上限时按LRU把块压缩换出到冷块文件，只在内存中保留块的时间范围等信息。
+ *  通过operator[]访问换出的块时从冷块文件换入并缓存，扫描全部记录时应使用Reader，冷块只在读取器内临时解压。
+ *  换出只替换存储中的块指针，快照持有的块不受影响。
+ *
+ *  启用模板字典后，追加时按模板编码内容，块写满后在内存中只保留编码，按需解码，与冷块一样经由Reader临时解码、
+ *  经由operator[]换入并在trim()时换回编码。编码的块不再换出到冷块文件。 */
+class LogStore
+{
+public:
+    enum { BlockRecords = 4096 }; //!< 每块记录数
+    enum
+    {
+        DictHotBytes = 64 * 1024 * 1024,    //!< 只启用模板字典时换入的编码块的热数据上限
+        SourceHotBytes = 64 * 1024 * 1024   //!< 建立在数据源上时载入的块的热数据上限
+    };
+
+    /** \brief 记录块 */
+    struct Block
+    {
+        std::vector<LogTextRecord> records;
+        std::atomic<bool> loaded; // 记录是否已载入
+        std::atomic<bool> indexed; // 时间范围、级别类别位图和字段是否有效，只有尚未解析过的数据源块为false
+        bool fromSource; // 来自数据源，释放后可重新解析
+        std::mutex mtx; // 载入时的互斥量
+        winux::uint64 minTimeMs, maxTimeMs; // 块内记录的时间范围，换出后仍保留，数据源的块解析后才有效
+        winux::uint64 bytes; // 追加的记录估算占用的字节数，数据源的块为载入时估算的字节数
+        winux::uint64 coldOffset; // 在冷块文件中的偏移
+        winux::uint32 coldSize; // 在冷块文件中占用的字节数，0表示未写入
+        std::atomic<winux::uint64> lastUse; // 最近一次访问的时刻，用于LRU换出
+        winux::SharedPointer<LogFieldBlock> fields; // 结构化字段的列，换出时留在内存中，与冷块共享
+        winux::SharedPointer<LogMetaBlock> meta; // 级别和类别位图，换出时留在内存中，与冷块共享
+        winux::SharedPointer<LogTemplateBlock> templates; // 模板编码，启用模板字典时有效，编码的块换入后仍与之共享
+
+        Block() : loaded(true), indexed(true), fromSource(false), minTimeMs((winux::uint64)-1), maxTimeMs(0), bytes(0), coldOffset(0), coldSize(0), lastUse(0), fields( new LogFieldBlock(BlockRecords) ), meta( new LogMetaBlock(BlockRecords) ) { }
+
+        // 是否为尚未从数据源解析过的块
+        bool isSourcePending() const { return !indexed.load(std::memory_order_acquire); }
+
+        // 把一条记录的时间并入时间范围
+        void addTime( winux::uint64 utcTimeMs )
+        {
+            if ( utcTimeMs < minTimeMs ) minTimeMs = utcTimeMs;
+            if ( utcTimeMs > maxTimeMs ) maxTimeMs = utcTimeMs;
+        }
+    };
+
+    /** \brief 读取器，供扫描全部记录的线程使用，每个线程各用一个
+     *
+     *  已载入的块直接读取；换出的冷块、编码的块和未载入的数据源块在读取器内临时解压、解码或解析，不缓存到存储中，
+     *  因此扫描时内存不随冷块和数据源增长。返回的引用在读取下一个未载入的块之前有效。 */
+    class Reader
+    {
+    public:
+        explicit Reader( LogStore const & store ) : _store(store), _blockIndex((size_t)-1) { }
+
+        /** \brief 获取一条记录 */
+        LogTextRecord const & operator [] ( size_t row );
+
+        /** \brief 获取一条记录的结构化字段，冷块的字段留在内存中，不需要解压 */
+        LogFieldRow fields( size_t row ) const { return _store.getFields(row); }
+
+    private:
+        LogStore const & _store;
+        size_t _blockIndex; // 临时解压的块
+        std::vector<LogTextRecord> _records; // 临时解压的记录
+    };
+
+    LogStore();
+
+    /** \brief 记录数，即下一条追加记录的行号 */
+    size_t size() const { return _count; }
+    /** \brief 是否为空 */
+    bool empty() const { return _count == 0; }
+    /** \brief 第一条未被淘汰的记录的行号 */
+    size_t getFirstRow() const { return _firstBlock * BlockRecords; }
+    /** \brief 正在追加的最后一块的第一行。该块不会被换出，其中的记录可以原地修改 */
+    size_t getTailBlockRow() const { return _count == 0 ? 0 : ( _count - 1 ) / BlockRecords * BlockRecords; }
+    /** \brief 未被淘汰的记录估算占用的字节数，只统计追加的记录 */
+    winux::uint64 getBytes() const { return _bytes; }
+
+    /** \brief 获取一条记录 */
+    LogTextRecord & operator [] ( size_t row ) { return this->_records( row / BlockRecords )[ row % BlockRecords ]; }
+    /** \brief 获取一条记录 */
+    LogTextRecord const & operator [] ( size_t row ) const { return this->_records( row / BlockRecords )[ row % BlockRecords ]; }
+
+    /** \brief 获取一条记录的结构化字段 */
+    LogFieldRow getFields( size_t row ) const
+    {
+        size_t blockIndex = row / BlockRecords;
+        Block const * block = (*_blocks.get())[ blockIndex - _firstBlock ].get();
+        if ( block->isSourcePending() ) // 数据源的块解析时才建立字段
+        {
+            Reader reader(*this);
+            reader[row];
+        }
+        return LogFieldRow( block->fields.get(), row % BlockRecords );
+    }
+
+    /** \brief 追加一条记录，返回其行号。设有保留策略时可能淘汰最早的块
+     *
+     *  \param tr 记录
+     *  \param fields 结构化字段记录解析出的字段，为空时从记录的文本解析 */
+    size_t append( LogTextRecord && tr, std::vector<eienlog::LogField> const * fields = nullptr );
+
+    /** \brief 遍历[begin, end)行的结构化字段列
+     *
+     *  \param fn 回调`fn( LogFieldBlock const & block, size_t offsetBegin, size_t offsetEnd )`，偏移为块内偏移 */
+    template < typename _Fx >
+    void forEachFieldBlock( size_t begin, size_t end, _Fx fn ) const
+    {
+        if ( begin < this->getFirstRow() ) begin = this->getFirstRow();
+        if ( end > _count ) end = _count;
+        while ( begin < end )
+        {
+            size_t blockIndex = begin / BlockRecords;
+            size_t blockEnd = ( blockIndex + 1 ) * BlockRecords < end ? ( blockIndex + 1 ) * BlockRecords : end;
+            LogFieldRow row = this->getFields(begin);
+            fn( *row.block, row.offset, blockEnd - blockIndex * BlockRecords );
+            begin = blockEnd;
+        }
+    }
+
+    /** \brief 设置保留策略
+     *
+     *  \param retention 保留策略
+     *  \param sink 被淘汰记录的接收者，为空时直接丢弃 */
+    void setRetention( LogRetention const & retention, winux::SharedPointer<LogEvictSink> sink = winux::SharedPointer<LogEvictSink>() );
+
+    /** \brief 保留策略 */
+    LogRetention const & getRetention() const { return _retention; }
+
+    /** \brief 设置分层存储，应在追加记录之前设置
+     *
+     *  \param coldPath 冷块文件路径，文件在存储及其快照都销毁后删除
+     *  \param maxHotBytes 内存中保留的热数据上限（字节），为0时关闭分层存储
+     *  \return 冷块文件创建失败返回false */
+    bool setTiering( winux::String const & coldPath, winux::uint64 maxHotBytes );
+
+    /** \brief 热数据上限，0表示未分层 */
+    winux::uint64 getMaxHotBytes() const { return _maxHotBytes; }
+
+    /** \brief 内存中的块估算占用的字节数 */
+    winux::uint64 getHotBytes() const { return _hotBytes; }
+
+    /** \brief 启用或关闭模板字典，应在追加记录之前设置
+     *
+     *  未设置分层存储时，换入的编码块按DictHotBytes的上限换回编码。
+     *  \return 已有记录时返回false */
+    bool setTemplateDict( bool enable );
+
+    /** \brief 模板字典，未启用时为空 */
+    winux::SharedPointer<LogTemplateDict> const & getTemplateDict() const { return _dict; }
+
+    /** \brief 编码的块占用的字节数，不含模板字典 */
+    winux::uint64 getTemplateBytes() const { return _templateBytes; }
+
+    /** \brief 一条记录的模板编号，只读取编号列，不解码 */
+    winux::uint32 getTemplateId( size_t row ) const
+    {
+        Block const * block = (*_blocks.get())[ row / BlockRecords - _firstBlock ].get();
+        return block->templates ? block->templates->getId( row % BlockRecords ) : 0;
+    }
+
+    /** \brief 在[begin, end)行中查找模板编号为templateId的行，只读取编号列，不解码
+     *
+     *  \param rows 接受满足条件的行号，升序追加 */
+    void findByTemplate( winux::uint32 templateId, size_t begin, size_t end, std::vector<winux::uint32> * rows ) const;
+
+    /** \brief 按LRU把超出热数据上限的块换出。追加时自动调用，界面在访问记录后也应定期调用 */
+    void trim();
+
+    /** \brief 清空所有记录 */
+    void clear();
+
+    /** \brief 在数据源上建立存储，原有记录被清空
+     *
+     *  \param source 数据源，须可被多个线程同时调用
+     *  \param count 数据源的记录数 */
+    void attachSource( winux::SharedPointer<LogBlockSource> source, size_t count );
+
+    /** \brief 已载入内存的块数 */
+    size_t getLoadedBlocks() const;
+
+    /** \brief 按级别、类别和时间查找记录
+     *
+     *  用各块的级别、类别位图相与得到候选行，不含所选级别或类别的块、与时间区间不相交的块整块跳过，
+     *  只有跨越时间区间边界的块才读取记录的时间。
+     *  \param query 条件
+     *  \param rows 接受满足条件的行号，升序追加 */
+    void findByMeta( LogMetaQuery const & query, std::vector<winux::uint32> * rows ) const;
+
+    /** \brief 按时间区间遍历行区间
+     *
+     *  时间范围整块落在区间内的块作为整体，与区间不相交的块直接跳过，只逐行检查跨越区间边界的块。
+     *  \param timeBegin 起始时间（毫秒），含
+     *  \param timeEnd 结束时间（毫秒），不含，0表示不限
+     *  \param fn 回调`fn( size_t begin, size_t end )`，区间为[begin, end)，相邻的行合并成一个区间 */
+    template < typename _Fx >
+    void forEachTimeRange( winux::uint64 timeBegin, winux::uint64 timeEnd, _Fx fn ) const
+    {
+        if ( timeEnd == 0 ) timeEnd = (winux::uint64)-1;
+        size_t begin = 0, end = 0; // 待输出的区间
+        auto add = [&] ( size_t b, size_t e ) {
+            if ( b == end )
+            {
+                end = e;
+            }
+            else
+            {
+                if ( begin < end ) fn( begin, end );
+                begin = b;
+                end = e;
+            }
+        };
+        Reader reader(*this); // 边界块在读取器内临时解压，不换入存储
+        BlockList const & blocks = *_blocks.get();
+        for ( size_t k = _firstBlock; k < _firstBlock + blocks.size(); k++ )
+        {
+            Block const * block = blocks[ k - _firstBlock ].get();
+            size_t first = k * BlockRecords;
+            if ( block->isSourcePending() ) reader[first]; // 数据源的块解析后时间范围才有效
+            size_t count = _count - first < BlockRecords ? _count - first : BlockRecords;
+            if ( block->maxTimeMs < timeBegin || block->minTimeMs >= timeEnd ) continue;
+            if ( block->minTimeMs >= timeBegin && block->maxTimeMs < timeEnd )
+            {
+                add( first, first + count );
+                continue;
+            }
+            for ( size_t i = 0; i < count; i++ )
+            {
+                winux::uint64 t = reader[ first + i ].utcTimeMs;
+                if ( t >= timeBegin && t < timeEnd ) add( first + i, first + i + 1 );
+            }
+        }
+        if ( begin < end ) fn( begin, end );
+    }
+
+private:
+    // 获取一块的记录，未载入时先从数据源或冷块文件载入
+    std::vector<LogTextRecord> & _records( size_t blockIndex ) const
+    {
+        Block * block = (*_blocks.get())[ blockIndex - _firstBlock ].get();
+        if ( !block->loaded.load(std::memory_order_acquire) ) this->_load(blockIndex);
+        block->lastUse.store( _useTick, std::memory_order_relaxed );
+        return block->records;
+    }
+    typedef std::deque< winux::SharedPointer<Block> > BlockList;
+
+    // 取可修改的块列表，列表被快照共享时先复制一份
+    BlockList & _mutableBlocks();
+    // 从数据源或冷块文件载入一块
+    void _load( size_t blockIndex ) const;
+    // 把一块换出到冷块文件，编码的块只替换指针
+    bool _pageOut( size_t blockIndex );
+    // 热数据上限，未分层时按模板字典或数据源取固定的上限
+    winux::uint64 _getMaxHotBytes() const { return _cold ? _maxHotBytes : ( _dict ? DictHotBytes : SourceHotBytes ); }
+    // 首次解析数据源的块时建立时间范围、级别类别位图和字段，须持有块的互斥量
+    static void _IndexSource( Block * block, std::vector<LogTextRecord> const & records );
+    // 冷块文件、模板字典和数据源的换入次数之和
+    winux::uint64 _getPageIns() const;
+    // 按保留策略淘汰最早的块，始终保留正在追加的最后一块
+    void _enforceRetention();
+
+    winux::SharedPointer<BlockList> _blocks; // 未淘汰的记录块，与快照共享
+    size_t _firstBlock; // 已淘汰的块数
+    size_t _count; // 记录数
+    winux::uint64 _bytes; // 未淘汰的记录估算占用的字节数
+    winux::uint64 _newestTimeMs; // 最新一条记录的时间
+    winux::SharedPointer<LogBlockSource> _source; // 数据源
+    LogRetention _retention; // 保留策略
+    winux::SharedPointer<LogEvictSink> _evictSink; // 被淘汰记录的接收者
+    winux::SharedPointer<LogColdFile> _cold; // 冷块文件
+    winux::SharedPointer<LogTemplateDict> _dict; // 模板字典
+    winux::uint64 _templateBytes; // 编码的块占用的字节数
+    winux::uint64 _maxHotBytes; // 热数据上限
+    winux::uint64 _hotBytes; // 内存中的块估算占用的字节数
+    winux::uint64 _useTick; // 当前时刻，每次trim()递增
+    winux::uint64 _seenPageIns; // 上次统计热数据时冷块文件、模板字典和数据源的换入次数
+};
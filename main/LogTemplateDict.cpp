@@ -0,0 +1,261 @@
+﻿#include "LogTemplateDict.h"
+#include "LogStore.h"
+
+// 模板中的数字占位符，UTF-8文本中不会出现此字节
+#define LOG_TEMPLATE_PLACEHOLDER '\xFF'
+
+// class LogTemplateDict ----------------------------------------------------------------------
+LogTemplateDict::LogTemplateDict() : _count(0), _recent(RecentSlots), _bytes(0), _pageIns(0)
+{
+}
+
+winux::uint32 LogTemplateDict::encode( winux::Utf8String const & content, winux::AnsiString * params )
+{
+    if ( content.length() > MaxContentLength ) return 0;
+
+    // 屏蔽数字得到模板，同时按半字节收集参数
+    _key.clear();
+    _params.clear();
+    int high = -1; // 待写入的高半字节
+    auto put = [this, &high] ( int nibble ) {
+        if ( high < 0 )
+        {
+            high = nibble;
+        }
+        else
+        {
+            _params += (char)( high << 4 | nibble );
+            high = -1;
+        }
+    };
+    char const * s = content.c_str();
+    char const * end = s + content.length();
+    while ( s < end )
+    {
+        // 非数字的一段整体追加
+        char const * run = s;
+        while ( s < end && !( *s >= '0' && *s <= '9' ) && *s != LOG_TEMPLATE_PLACEHOLDER ) s++;
+        _key.append( run, s - run );
+        if ( s == end ) break;
+        if ( *s == LOG_TEMPLATE_PLACEHOLDER ) return 0;
+
+        _key += LOG_TEMPLATE_PLACEHOLDER;
+        for ( ; s < end && *s >= '0' && *s <= '9'; s++ ) put( *s - '0' );
+        put(0xF);
+    }
+    if ( high >= 0 ) put(0xF); // 补齐到字节
+
+    winux::uint32 id;
+    auto it = _index.find(_key);
+    if ( it != _index.end() )
+    {
+        id = it->second;
+    }
+    else
+    {
+        // 首次出现只记下散列值，再次出现才学习
+        size_t hash = std::hash<winux::AnsiString>()(_key);
+        size_t & slot = _recent[ hash % RecentSlots ];
+        if ( slot != hash )
+        {
+            slot = hash;
+            return 0;
+        }
+        size_t count = _count.load(std::memory_order_relaxed);
+        if ( count == MaxTemplates ) return 0;
+        if ( count % ChunkTemplates == 0 ) _chunks[ count / ChunkTemplates ].attachNew( new Chunk() );
+        _chunks[ count / ChunkTemplates ]->templates[ count % ChunkTemplates ] = _key;
+        id = (winux::uint32)( count + 1 );
+        _index.emplace( _key, id );
+        _bytes += _key.capacity() * 2 + 64;
+        _count.store( count + 1, std::memory_order_release ); // 模板写好之后再发布
+    }
+    params->append(_params);
+    return id;
+}
+
+bool LogTemplateDict::decode( winux::uint32 id, winux::byte const * & p, winux::byte const * end, winux::Utf8String * content ) const
+{
+    if ( id == 0 || id > this->getCount() ) return false;
+    winux::AnsiString const & tpl = this->_template(id);
+    content->clear();
+    content->reserve( tpl.length() + 16 );
+    size_t nibbles = 0; // 已读取的半字节数
+    size_t avail = ( end - p ) * 2;
+    char const * s = tpl.c_str();
+    char const * tplEnd = s + tpl.length();
+    while ( s < tplEnd )
+    {
+        // 占位符之间的一段整体追加
+        char const * holder = (char const *)memchr( s, LOG_TEMPLATE_PLACEHOLDER, tplEnd - s );
+        if ( holder == nullptr ) holder = tplEnd;
+        content->append( s, holder - s );
+        if ( holder == tplEnd ) break;
+        s = holder + 1;
+        for ( ;; )
+        {
+            if ( nibbles == avail ) return false;
+            int nibble = nibbles % 2 == 0 ? p[ nibbles / 2 ] >> 4 : p[ nibbles / 2 ] & 0xF;
+            nibbles++;
+            if ( nibble == 0xF ) break;
+            *content += (char)( '0' + nibble );
+        }
+    }
+    p += ( nibbles + 1 ) / 2;
+    return true;
+}
+
+winux::Utf8String LogTemplateDict::getTemplateText( winux::uint32 id ) const
+{
+    if ( id == 0 || id > this->getCount() ) return winux::Utf8String();
+    winux::Utf8String text = this->_template(id);
+    for ( char & ch : text )
+    {
+        if ( ch == LOG_TEMPLATE_PLACEHOLDER ) ch = '#';
+    }
+    return text;
+}
+
+// class LogTemplateBlock ---------------------------------------------------------------------
+LogTemplateBlock::LogTemplateBlock( size_t capacity ) : _ids(capacity), _rows(0), _sealed(false)
+{
+}
+
+winux::uint32 LogTemplateBlock::add( LogTemplateDict * dict, LogTextRecord const & tr )
+{
+    // 二进制数据的十六进制文本不编码
+    winux::uint32 id = !tr.flag.binary || tr.flag.isFields() ? dict->encode( tr.strContent, &_data ) : 0;
+    if ( id == 0 )
+    {
+        eienlog::PutVarint( &_data, tr.strContent.length() );
+        _data += tr.strContent;
+    }
+    _ids[_rows++].store( id, std::memory_order_relaxed );
+    return id;
+}
+
+void LogTemplateBlock::seal( std::vector<LogTextRecord> const & records )
+{
+    // 按列组织：内容大小、时间差、旗标（高位为元信息）、重复次数、最后重复时间差、附加字符串标志，然后是附加字符串
+    // 时间字符串由时间格式化得到、转义内容与内容相同或由内容转义得到时不保存
+    winux::AnsiString extras;
+    std::vector<winux::byte> extraFlags( records.size() );
+    winux::uint64 cacheSec = 0;
+    winux::AnsiString cache;
+    winux::Utf8String utcTime;
+    for ( size_t i = 0; i < records.size(); i++ )
+    {
+        LogTextRecord const & tr = records[i];
+        LogFormatTime( tr.utcTimeMs, &cacheSec, &cache, &utcTime );
+        if ( utcTime != tr.utcTime )
+        {
+            extraFlags[i] |= 1;
+            eienlog::PutVarint( &extras, tr.utcTime.length() );
+            extras += tr.utcTime;
+        }
+        if ( tr.strContentSlashes == tr.strContent )
+        {
+            extraFlags[i] |= 4;
+        }
+        else if ( tr.strContentSlashes != winux::AddCSlashes(tr.strContent) )
+        {
+            extraFlags[i] |= 2;
+            eienlog::PutVarint( &extras, tr.strContentSlashes.length() );
+            extras += tr.strContentSlashes;
+        }
+    }
+
+    _columns.clear();
+    for ( auto && tr : records ) eienlog::PutVarint( &_columns, tr.contentSize );
+    winux::uint64 prevTime = 0;
+    for ( auto && tr : records )
+    {
+        eienlog::PutVarint( &_columns, eienlog::ZigZag( (winux::int64)( tr.utcTimeMs - prevTime ) ) );
+        prevTime = tr.utcTimeMs;
+    }
+    for ( auto && tr : records ) eienlog::PutVarint( &_columns, tr.flag.value | (winux::uint64)tr.meta.value << 32 );
+    for ( auto && tr : records ) eienlog::PutVarint( &_columns, tr.repeatCount );
+    for ( auto && tr : records ) eienlog::PutVarint( &_columns, tr.lastTimeMs ? tr.lastTimeMs - tr.utcTimeMs + 1 : 0 );
+    _columns.append( (char const *)extraFlags.data(), extraFlags.size() );
+    _columns += extras;
+    _columns.shrink_to_fit();
+    _data.shrink_to_fit();
+    _sealed = true;
+}
+
+bool LogTemplateBlock::decode( LogTemplateDict const & dict, std::vector<LogTextRecord> * records ) const
+{
+    if ( !_sealed ) return false;
+    size_t rows = _rows;
+    std::vector<winux::uint64> columns( rows * 5 );
+    winux::byte const * p = (winux::byte const *)_columns.c_str();
+    winux::byte const * end = p + _columns.length();
+    for ( auto & v : columns )
+    {
+        if ( !eienlog::GetVarint( p, end, &v ) ) return false;
+    }
+    if ( (size_t)( end - p ) < rows ) return false;
+    winux::byte const * extraFlags = p;
+    p += rows;
+
+    winux::byte const * q = (winux::byte const *)_data.c_str();
+    winux::byte const * qEnd = q + _data.length();
+    winux::uint64 cacheSec = 0;
+    winux::AnsiString cache;
+    records->reserve( records->size() + rows );
+    winux::uint64 t = 0;
+    for ( size_t i = 0; i < rows; i++ )
+    {
+        LogTextRecord tr;
+        t += eienlog::UnZigZag( columns[ rows + i ] );
+        tr.contentSize = (size_t)columns[i];
+        tr.utcTimeMs = t;
+        tr.flag.value = (winux::uint32)columns[ rows * 2 + i ];
+        tr.meta.value = (winux::uint8)( columns[ rows * 2 + i ] >> 32 );
+        tr.repeatCount = (winux::uint32)columns[ rows * 3 + i ];
+        tr.lastTimeMs = columns[ rows * 4 + i ] ? t + columns[ rows * 4 + i ] - 1 : 0;
+        tr.templateId = this->getId(i);
+
+        // 内容
+        if ( tr.templateId != 0 )
+        {
+            if ( !dict.decode( tr.templateId, q, qEnd, &tr.strContent ) ) return false;
+        }
+        else
+        {
+            winux::uint64 len;
+            if ( !eienlog::GetVarint( q, qEnd, &len ) || len > (winux::uint64)( qEnd - q ) ) return false;
+            tr.strContent.assign( (char const *)q, (size_t)len );
+            q += len;
+        }
+
+        // 时间字符串和转义内容
+        winux::uint64 len;
+        if ( extraFlags[i] & 1 )
+        {
+            if ( !eienlog::GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+            tr.utcTime.assign( (char const *)p, (size_t)len );
+            p += len;
+        }
+        else
+        {
+            LogFormatTime( t, &cacheSec, &cache, &tr.utcTime );
+        }
+        if ( extraFlags[i] & 2 )
+        {
+            if ( !eienlog::GetVarint( p, end, &len ) || len > (winux::uint64)( end - p ) ) return false;
+            tr.strContentSlashes.assign( (char const *)p, (size_t)len );
+            p += len;
+        }
+        else if ( extraFlags[i] & 4 )
+        {
+            tr.strContentSlashes = tr.strContent;
+        }
+        else
+        {
+            tr.strContentSlashes = winux::AddCSlashes(tr.strContent);
+        }
+        records->push_back( std::move(tr) );
+    }
+    return true;
+}
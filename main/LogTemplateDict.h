@@ -0,0 +1,112 @@
+﻿#pragma once
+#include <atomic>
+#include <unordered_map>
+#include "eienlog.hpp"
+
+struct LogTextRecord;
+
+/** \brief 日志内容的模板字典
+ *
+ *  把内容中的每段连续数字屏蔽成占位符得到模板，相同模板只保存一次，记录只保存模板编号和数字参数。
+ *  内容完全相同的记录自然得到同一模板和相同的参数。参数按半字节保存数字，每段以0xF结束。
+ *  模板在最近出现过一次之后再次出现时才学习，只出现一次的内容不进入字典，首次出现的记录按原内容保存。
+ *  模板只追加不修改，由追加记录的线程学习，其他线程可以同时解码已发布的模板。 */
+class LogTemplateDict
+{
+public:
+    enum
+    {
+        MaxTemplates = 65536,       //!< 最多学习的模板数，学满后新模板的内容不编码
+        MaxContentLength = 4096,    //!< 超过此长度的内容不编码
+        RecentSlots = 4096          //!< 记录最近出现的模板的槽数
+    };
+
+    LogTemplateDict();
+
+    /** \brief 编码内容，只由追加记录的线程调用
+     *
+     *  \param content 内容
+     *  \param params 追加数字参数，按字节对齐
+     *  \return 模板编号，从1开始，0表示不编码（模板首次出现、内容过长、含占位字节或字典已满），这时params不变 */
+    winux::uint32 encode( winux::Utf8String const & content, winux::AnsiString * params );
+
+    /** \brief 按模板和参数还原内容
+     *
+     *  \param id 模板编号
+     *  \param p 参数的起始位置，返回时移到参数之后
+     *  \param end 参数的结束位置
+     *  \param content 接受还原的内容
+     *  \return 参数不足返回false */
+    bool decode( winux::uint32 id, winux::byte const * & p, winux::byte const * end, winux::Utf8String * content ) const;
+
+    /** \brief 模板文本，数字显示为# */
+    winux::Utf8String getTemplateText( winux::uint32 id ) const;
+
+    /** \brief 模板数 */
+    size_t getCount() const { return _count.load(std::memory_order_acquire); }
+
+    /** \brief 模板估算占用的字节数 */
+    winux::uint64 getBytes() const { return _bytes; }
+
+    /** \brief 解码换入的次数，LogStore据此判断是否需要重新统计热数据 */
+    winux::uint64 getPageIns() const { return _pageIns.load(std::memory_order_relaxed); }
+
+    /** \brief 记下一次解码换入 */
+    void addPageIn() const { _pageIns.fetch_add( 1, std::memory_order_relaxed ); }
+
+private:
+    enum { ChunkTemplates = 256 };
+    // 一组模板，整组分配，已发布的模板地址不变
+    struct Chunk
+    {
+        winux::AnsiString templates[ChunkTemplates];
+    };
+
+    // 取已发布的模板
+    winux::AnsiString const & _template( winux::uint32 id ) const { return _chunks[ ( id - 1 ) / ChunkTemplates ]->templates[ ( id - 1 ) % ChunkTemplates ]; }
+
+    winux::SimplePointer<Chunk> _chunks[ MaxTemplates / ChunkTemplates ];
+    std::atomic<size_t> _count; // 已发布的模板数
+    std::unordered_map< winux::AnsiString, winux::uint32 > _index; // 模板到编号，只由追加线程访问
+    std::vector<size_t> _recent; // 最近出现而未学习的模板的散列值，按散列值取槽
+    winux::AnsiString _key; // 复用的模板缓冲
+    winux::AnsiString _params; // 复用的参数缓冲
+    winux::uint64 _bytes; // 模板估算占用的字节数
+    mutable std::atomic<winux::uint64> _pageIns; // 解码换入的次数
+};
+
+/** \brief 一块记录的模板编码
+ *
+ *  追加时编码内容，得到每行的模板编号和参数，编号按列存放，可供其他线程同时读取。
+ *  块写满后封存：其余信息按列以变长整数保存，时间字符串和转义内容能由时间和内容推出时不保存，
+ *  之后存储只保留编码，需要时整块解码。 */
+class LogTemplateBlock
+{
+public:
+    explicit LogTemplateBlock( size_t capacity );
+
+    /** \brief 编码下一行的内容，只由追加记录的线程调用，返回模板编号，0表示未编码，这时保存原内容 */
+    winux::uint32 add( LogTemplateDict * dict, LogTextRecord const & tr );
+
+    /** \brief 块内第offset行的模板编号 */
+    winux::uint32 getId( size_t offset ) const { return _ids[offset].load(std::memory_order_relaxed); }
+
+    /** \brief 块写满后封存，保存记录的其余信息 */
+    void seal( std::vector<LogTextRecord> const & records );
+
+    /** \brief 是否已封存 */
+    bool isSealed() const { return _sealed; }
+
+    /** \brief 从封存的编码还原整块记录，追加到records */
+    bool decode( LogTemplateDict const & dict, std::vector<LogTextRecord> * records ) const;
+
+    /** \brief 估算占用的字节数 */
+    winux::uint64 getBytes() const { return sizeof(*this) + _ids.size() * sizeof(winux::uint32) + _data.capacity() + _columns.capacity(); }
+
+private:
+    std::vector< std::atomic<winux::uint32> > _ids; // 各行的模板编号
+    winux::AnsiString _data; // 各行的参数，未编码的行为变长整数长度加原内容
+    winux::AnsiString _columns; // 封存的其余信息
+    size_t _rows; // 已编码的行数
+    bool _sealed;
+};
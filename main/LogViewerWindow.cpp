@@ -1,50 +1,507 @@
-﻿#include "App.h"
+﻿#include "UiCommon.h"
 #include "LogViewerWindow.h"
-#include "MainWindow.h"
-#include "LogWindowsManager.h"
 
-LogViewerWindow::LogViewerWindow( LogWindowsManager * manager, winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile ) :
-    manager(manager), name(name), vScrollToBottom(vScrollToBottom), logFile(logFile)
+inline static winux::String _ToString( winux::Utf8String const & str )
+{
+#if defined(_UNICODE) || defined(UNICODE)
+    return winux::UnicodeConverter(str).toUnicode();
+#else
+    return LOCAL_FROM_UTF8(str);
+#endif
+}
+
+// 绘制单行文本，宽度测量一次后缓存在*widthEm里（以字号为单位），之后每帧直接绘制，省去测量整行文本
+inline static void _TextCachedWidth( char const * text, char const * textEnd, ImU32 color, float * widthEm )
+{
+    ImGuiWindow * window = ImGui::GetCurrentWindow();
+    float fontSize = ImGui::GetFontSize();
+    if ( *widthEm == 0 ) *widthEm = ImGui::CalcTextSize( text, textEnd ).x / fontSize;
+    ImVec2 pos = window->DC.CursorPos;
+    ImVec2 size( *widthEm * fontSize, fontSize );
+    ImGui::ItemSize( size, 0.0f );
+    if ( !ImGui::ItemAdd( ImRect( pos.x, pos.y, pos.x + size.x, pos.y + size.y ), 0 ) ) return;
+    // 长行只绘制到可见区域右边界（多留一个字的余量），超出部分不再逐字处理
+    float visibleWidth = window->ClipRect.Max.x - pos.x;
+    if ( size.x > visibleWidth )
+    {
+        ImGui::GetFont()->CalcTextSizeA( fontSize, visibleWidth + fontSize, 0.0f, text, textEnd, &textEnd );
+    }
+    window->DrawList->AddText( pos, color, text, textEnd );
+}
+
+LogViewerWindow::LogViewerWindow( LogViewerHost * host, winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile, LogRange const & range ) :
+    host(host), name(name), vScrollToBottom(vScrollToBottom), logFile(logFile), range(range), feed( new LogFeed() )
 {
     if ( !this->logFile.empty() )
     {
-        winux::String logFilePath = $L(this->logFile);
-        winux::CsvReader csv{ winux::FileGetString( logFilePath, winux::feUnspec ) };
-        for ( size_t i = 0; i < csv.getCount(); i++ )
-        {
-            auto && row = csv[(int)i];
-            LogTextRecord tr;
-            size_t columns = row.getCount();
-            if ( columns > 0 )
+        winux::String logFilePath = _ToString(this->logFile);
+        // 归档文件和csvlog都按需解析并只定位范围内的行，不支持的csvlog编码再整体读入
+        winux::SharedPointer<LogCsvFile> csvFile( new LogCsvFile() );
+        if ( LogArchiveFile::IsArchivePath(logFilePath) )
+        {
+            winux::SharedPointer<LogArchiveFile> archiveFile( new LogArchiveFile() );
+            if ( archiveFile->open( logFilePath, this->range ) ) this->feed->logs.attachSource( archiveFile, archiveFile->getRowCount() );
+        }
+        else if ( csvFile->open( logFilePath, this->range ) )
+        {
+            this->feed->logs.attachSource( csvFile, csvFile->getRowCount() );
+        }
+        else
+        {
+            winux::CsvReader csv{ winux::String() };
+            csv.read( winux::FileGetString( logFilePath, winux::feUnspec ), false, &this->host->scanPool );
+            for ( size_t i = 0; i < csv.getCount(); i++ )
+            {
+                if ( this->range.type == LogRange::lrRows && ( i < this->range.begin || ( this->range.end != 0 && i >= this->range.end ) ) ) continue;
+                auto && row = csv[(int)i];
+                LogTextRecord tr;
+                tr.contentSize = 0;
+                tr.utcTimeMs = 0;
+                size_t columns = row.getCount();
+                if ( columns > 0 )
+                {
+                    tr.contentSize = row[0];
+                }
+                if ( columns > 1 )
+                {
+                    tr.strContent = $u8(row[1].refUnicode());
+                    tr.strContentSlashes = winux::AddCSlashes(tr.strContent);
+                }
+                if ( columns > 2 )
+                {
+                    tr.utcTime = $u8(row[2].refUnicode());
+                    tr.utcTimeMs = winux::DateTimeL( _ToString(tr.utcTime) ).toUtcTimeMs();
+                }
+                if ( columns > 3 )
+                {
+                    tr.flag.value = row[3];
+                }
+                if ( this->range.type == LogRange::lrTime && ( tr.utcTimeMs < this->range.begin || ( this->range.end != 0 && tr.utcTimeMs >= this->range.end ) ) ) continue;
+                this->feed->addLog( std::move(tr) );
+            }
+        }
+    }
+}
+
+LogViewerWindow::LogViewerWindow( LogViewerHost * host, winux::Utf8String const & name, bool vScrollToBottom, winux::SharedPointer<LogFeed> feed ) :
+    host(host), name(name), vScrollToBottom(vScrollToBottom), feed(feed)
+{
+    std::lock_guard<std::mutex> lk(this->feed->mtx);
+    this->feedFirstRow = this->feed->logs.getFirstRow();
+    this->feedClearCount = this->feed->clearCount;
+}
+
+LogViewerWindow::~LogViewerWindow()
+{
+}
+
+void LogViewerWindow::clearLogs()
+{
+    this->feed->clear();
+    this->syncFeed();
+}
+
+void LogViewerWindow::syncFeed()
+{
+    if ( this->feed->clearCount != this->feedClearCount )
+    {
+        // 日志被清空过，丢弃本窗口的结果
+        this->feedClearCount = this->feed->clearCount;
+        this->feedFirstRow = 0;
+        this->sortIndex.reset();
+        this->sortTask.reset();
+        this->searchScan.reset();
+        this->searchFound = -1;
+        this->selected.clear();
+        this->clickRowPrev = -1;
+        for ( auto && view : this->filterViews )
+        {
+            view->reset();
+        }
+    }
+    size_t firstRow = this->feed->logs.getFirstRow();
+    if ( firstRow > this->feedFirstRow ) // 淘汰了最早的块
+    {
+        this->feedFirstRow = firstRow;
+        this->selected.selectRange( 0, firstRow - 1, false );
+        this->clickRowPrev = -1;
+    }
+    for ( auto && view : this->filterViews )
+    {
+        view->poll(this->feed->logs);
+        view->update(this->feed->logs);
+    }
+}
+
+void LogViewerWindow::searchLogs()
+{
+    winux::SharedPointer<LogFilter> filter;
+    {
+        LogCondFilter * textFilter = new LogCondFilter();
+        textFilter->text = this->searchText;
+        textFilter->textMode = this->searchToken ? LogSearchIndex::smToken : LogSearchIndex::smSubstring;
+        textFilter->textCaseSensitive = this->searchCaseSensitive;
+        filter.attachNew(textFilter);
+    }
+
+    std::lock_guard<std::mutex> lk(this->feed->mtx);
+    // 由索引得到候选行，再把候选行分块交给线程池并行校验
+    std::vector<winux::uint32> candidates;
+    bool useCandidates = this->feed->searchIndex.getRowCount() == this->feed->logs.size() && this->feed->searchIndex.getCandidates( this->searchText, &candidates );
+    this->searchScan.attachNew( new LogParallelScan( &this->host->scanPool, this->feed->logs, filter, useCandidates ? &candidates : nullptr ) );
+    this->searchScan->start();
+
+    this->selected.clear();
+    this->searchFound = 0;
+    this->clickRowPrev = -1;
+}
+
+void LogViewerWindow::pollScans()
+{
+    if ( this->searchScan )
+    {
+        bool done = this->searchScan->isDone();
+        std::vector<winux::uint32> rows;
+        this->searchScan->takeRows(&rows);
+        for ( winux::uint32 row : rows )
+        {
+            this->selected.select(row);
+        }
+        this->searchFound += (int)rows.size();
+        if ( done ) this->searchScan.reset();
+    }
+
+    // 后台排序完成后换入结果，排序期间追加的行在下一帧由update()并入
+    if ( this->sortTask && this->sortTask->isDone() )
+    {
+        this->sortTask->takeIndex(&this->sortIndex);
+        this->sortTask.reset();
+        this->sortUpdateTimeMs = 0;
+    }
+
+    std::lock_guard<std::mutex> lk(this->feed->mtx);
+    this->syncFeed();
+    this->feed->logs.trim(); // 换出浏览时换入的块
+}
+
+void LogViewerWindow::addFilterView( winux::SharedPointer<LogFilter> filter )
+{
+    winux::SharedPointer<LogFilterView> view( new LogFilterView(filter) );
+    {
+        std::lock_guard<std::mutex> lk(this->feed->mtx);
+        // 记录较多时首次扫描交给线程池并行执行，结果在pollScans()中逐步并入
+        if ( this->feed->logs.size() >= LogParallelScan::MorselRows * 4 )
+        {
+            view->updateParallel( &this->host->scanPool, this->feed->logs, &this->feed->searchIndex );
+        }
+        else
+        {
+            view->update( this->feed->logs, &this->feed->searchIndex );
+        }
+        this->filterViews.push_back(view);
+    }
+    this->activeFilterView = (int)this->filterViews.size() - 1;
+    this->clickRowPrev = -1;
+}
+
+void LogViewerWindow::renderFilterBar()
+{
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 6.0f, 0 ) );
+    ImGui::SetNextItemWidth( ImGui::GetFontSize() * 16.0f );
+    winux::Utf8String preview = this->activeFilterView == -1 ? u8"全部日志" : this->filterViews[this->activeFilterView]->getFilter().getDescription();
+    if ( ImGui::BeginCombo( "##filterViews", preview.c_str() ) )
+    {
+        if ( ImGui::Selectable( u8"全部日志", this->activeFilterView == -1 ) )
+        {
+            this->activeFilterView = -1;
+            this->clickRowPrev = -1;
+        }
+        for ( int i = 0; i < (int)this->filterViews.size(); i++ )
+        {
+            ImGui::PushID(i);
+            if ( ImGui::Selectable( this->filterViews[i]->getFilter().getDescription().c_str(), this->activeFilterView == i ) )
+            {
+                this->activeFilterView = i;
+                this->clickRowPrev = -1;
+            }
+            ImGui::PopID();
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    if ( ImGui::Button(u8"筛选...") )
+    {
+        ImGui::OpenPopup("filter_edit");
+    }
+    if ( this->activeFilterView != -1 )
+    {
+        std::lock_guard<std::mutex> lk(this->feed->mtx);
+        auto & view = this->filterViews[this->activeFilterView];
+        ImGui::SameLine();
+        if ( view->isScanning() )
+        {
+            ImGui::Text( u8"%u条（扫描中%d%%）", (winux::uint)view->size(), (int)( view->getProgress() * 100 ) );
+        }
+        else
+        {
+            ImGui::Text( u8"%u条", (winux::uint)view->size() );
+        }
+        ImGui::SameLine();
+        if ( ImGui::Button(u8"删除筛选") )
+        {
+            this->filterViews.erase( this->filterViews.begin() + this->activeFilterView );
+            this->activeFilterView = -1;
+            this->clickRowPrev = -1;
+        }
+    }
+    ImGui::PopStyleVar();
+
+    if ( ImGui::BeginPopup("filter_edit") )
+    {
+        static char const * colorClassNames[] = { u8"不限", u8"无颜色", u8"红色系", u8"绿色系", u8"蓝色系", u8"其他颜色" };
+        int colorItem = this->filterEdit.colorClass + 1;
+        if ( ImGui::Combo( u8"颜色", &colorItem, colorClassNames, IM_ARRAYSIZE(colorClassNames) ) )
+        {
+            this->filterEdit.colorClass = colorItem - 1;
+        }
+        static char const * severityNames[] = { u8"不限", u8"≥跟踪", u8"≥调试", u8"≥信息", u8"≥警告", u8"≥错误", u8"≥致命" };
+        int severityItem = 0;
+        for ( int i = 1; i < IM_ARRAYSIZE(severityNames); i++ )
+        {
+            if ( this->filterEdit.severityMask == LogMetaQuery::SeverityAtLeast(i) ) severityItem = i;
+        }
+        if ( ImGui::Combo( u8"级别", &severityItem, severityNames, IM_ARRAYSIZE(severityNames) ) )
+        {
+            this->filterEdit.severityMask = severityItem == 0 ? 0 : LogMetaQuery::SeverityAtLeast(severityItem);
+        }
+        ImGui::InputTextWithHint( u8"类别", u8"0-15，逗号分隔", &this->filterCategories );
+        int minSize = (int)this->filterEdit.minSize, maxSize = (int)this->filterEdit.maxSize;
+        if ( ImGui::InputInt( u8"最小长度", &minSize ) ) this->filterEdit.minSize = minSize > 0 ? minSize : 0;
+        if ( ImGui::InputInt( u8"最大长度(0不限)", &maxSize ) ) this->filterEdit.maxSize = maxSize > 0 ? maxSize : 0;
+        ImGui::InputTextWithHint( u8"起始时间", u8"2024-01-01T00:00:00.000", &this->filterTimeBegin );
+        ImGui::InputTextWithHint( u8"结束时间", u8"2024-01-01T00:00:00.000", &this->filterTimeEnd );
+        ImGui::InputText( u8"包含文本", &this->filterEdit.text );
+        ImGui::Checkbox( u8"区分大小写", &this->filterEdit.textCaseSensitive );
+        ImGui::SameLine();
+        bool textToken = this->filterEdit.textMode == LogSearchIndex::smToken;
+        if ( ImGui::Checkbox( u8"按词", &textToken ) ) this->filterEdit.textMode = textToken ? LogSearchIndex::smToken : LogSearchIndex::smSubstring;
+
+        if ( ImGui::Button(u8"确定") )
+        {
+            this->filterEdit.timeBegin = this->filterTimeBegin.empty() ? 0 : winux::DateTimeL( _ToString(this->filterTimeBegin) ).toUtcTimeMs();
+            this->filterEdit.timeEnd = this->filterTimeEnd.empty() ? 0 : winux::DateTimeL( _ToString(this->filterTimeEnd) ).toUtcTimeMs();
+            this->filterEdit.categoryMask = 0;
+            winux::AnsiStringArray categories;
+            winux::StrSplit( this->filterCategories, ",", &categories, false );
+            for ( auto && category : categories )
+            {
+                int i = atoi( category.c_str() );
+                if ( i >= 0 && i < LOG_CATEGORY_COUNT ) this->filterEdit.categoryMask |= 1 << i;
+            }
+            this->addFilterView( winux::SharedPointer<LogFilter>( new LogCondFilter(this->filterEdit) ) );
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        if ( ImGui::Button(u8"取消") )
+        {
+            ImGui::CloseCurrentPopup();
+        }
+
+        // 表达式筛选
+        ImGui::Separator();
+        ImGui::InputTextWithHint( u8"表达式", u8"size > 1000 && fg == red && contains(text, \"timeout\")", &this->filterExpr );
+        if ( ImGui::Button(u8"按表达式筛选") && !this->filterExpr.empty() )
+        {
+            try
             {
-                tr.contentSize = row[0];
+                this->addFilterView( winux::SharedPointer<LogFilter>( new LogExprFilter(this->filterExpr) ) );
+                this->filterExprError.clear();
+                ImGui::CloseCurrentPopup();
             }
-            if ( columns > 1 )
+            catch ( winux::Error const & e )
             {
-                tr.strContent = $u8(row[1].refUnicode());
-                tr.strContentSlashes = winux::AddCSlashes(tr.strContent);
+                this->filterExprError = e.what();
             }
-            if ( columns > 2 )
+        }
+        if ( !this->filterExprError.empty() )
+        {
+            ImGui::SameLine();
+            ImGui::TextColored( ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), "%s", this->filterExprError.c_str() );
+        }
+        ImGui::TextDisabled( u8"字段：size time text fg bg color fgcolor bgcolor binary encoding severity category template；颜色：none red green blue other；级别：trace debug info warning error fatal" );
+        ImGui::TextDisabled( u8"函数：contains icontains startswith endswith len；结构化字段：field(\"key\") has(\"key\")" );
+
+        // 结构化字段统计
+        ImGui::Separator();
+        ImGui::InputTextWithHint( u8"字段名", u8"latency", &this->fieldStatsKey );
+        ImGui::SameLine();
+        if ( ImGui::Button(u8"统计") && !this->fieldStatsKey.empty() )
+        {
+            this->statFields();
+        }
+        if ( this->fieldStatsValid )
+        {
+            if ( this->fieldStats.numCount > 0 )
             {
-                tr.utcTime = $u8(row[2].refUnicode());
+                ImGui::Text(
+                    u8"%zu行有此字段，合计%g，平均%g，最小%g，最大%g",
+                    this->fieldStats.count, this->fieldStats.sum, this->fieldStats.getAvg(), this->fieldStats.min, this->fieldStats.max
+                );
             }
-            if ( columns > 3 )
+            else
             {
-                tr.flag.value = row[3];
+                ImGui::Text( u8"%zu行有此字段", this->fieldStats.count );
             }
-            this->logs.push_back( std::move(tr) );
         }
+        ImGui::EndPopup();
     }
 }
 
-LogViewerWindow::~LogViewerWindow()
+void LogViewerWindow::statFields()
+{
+    // 只读字段列和位图，不读记录文本
+    this->fieldStats.clear();
+    std::lock_guard<std::mutex> lk(this->feed->mtx);
+    LogStore const & logs = this->feed->logs;
+    if ( this->activeFilterView == -1 )
+    {
+        logs.forEachFieldBlock( logs.getFirstRow(), logs.size(), [this] ( LogFieldBlock const & block, size_t begin, size_t end ) {
+            this->fieldStats.add( block, this->fieldStatsKey, begin, end );
+        } );
+    }
+    else
+    {
+        LogFilterView const & view = *this->filterViews[this->activeFilterView].get();
+        for ( size_t i = 0; i < view.size(); i++ )
+        {
+            this->fieldStats.add( logs.getFields( view[i] ), this->fieldStatsKey );
+        }
+    }
+    this->fieldStatsValid = true;
+}
+
+void LogViewerWindow::renderRatePlot()
+{
+    static char const * colorClassNames[] = { u8"无颜色", u8"红色系", u8"绿色系", u8"蓝色系", u8"其他颜色" };
+    static ImU32 const colorClassColors[] = { IM_COL32( 150, 150, 150, 255 ), IM_COL32( 220, 70, 70, 255 ), IM_COL32( 70, 180, 80, 255 ), IM_COL32( 80, 120, 230, 255 ), IM_COL32( 210, 170, 60, 255 ) };
+
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 6.0f, 0 ) );
+    ImGui::SetNextItemWidth( ImGui::GetFontSize() * 5.0f );
+    ImGui::Combo( "##rate_level", &this->rateLevel, u8"每秒\0每分钟\0每小时\0" );
+    ImGui::PopStyleVar();
+    ImGui::SameLine();
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
+    ImGui::RadioButton( u8"条数", &this->rateMetric, 0 );
+    ImGui::SameLine();
+    ImGui::RadioButton( u8"字节", &this->rateMetric, 1 );
+    ImGui::PopStyleVar();
+
+    // 一个桶画一根柱子，柱子按颜色类别分段堆叠，最右边是最新的桶
+    LogRateTimeline::Level level = (LogRateTimeline::Level)this->rateLevel;
+    winux::uint64 span = LogRateTimeline::GetSpanMs(level);
+    float barWidth = 4.0f;
+    ImVec2 size( ImGui::GetContentRegionAvail().x, ImGui::GetFontSize() * 6.0f );
+    size_t count = (size_t)( size.x / barWidth );
+    if ( count > LogRateTimeline::GetCapacity(level) ) count = LogRateTimeline::GetCapacity(level);
+    if ( count == 0 ) count = 1;
+    winux::uint64 lastIndex, firstIndex;
+    {
+        std::lock_guard<std::mutex> lk(this->feed->mtx);
+        lastIndex = this->feed->rates.getLastTimeMs() / span;
+        firstIndex = lastIndex + 1 > count ? lastIndex + 1 - count : 0;
+        this->feed->rates.getBuckets( level, firstIndex * span, count, &this->rateBuckets );
+    }
+
+    auto value = [this] ( LogRateTimeline::Bucket const & bucket, int colorClass ) -> winux::uint64 {
+        return this->rateMetric == 0 ? bucket.counts[colorClass] : bucket.bytes[colorClass];
+    };
+    winux::uint64 maxValue = 1;
+    for ( auto && bucket : this->rateBuckets )
+    {
+        winux::uint64 v = this->rateMetric == 0 ? bucket.getCount() : bucket.getBytes();
+        if ( v > maxValue ) maxValue = v;
+    }
+
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton( "##rate_plot", size );
+    bool hovered = ImGui::IsItemHovered();
+    ImDrawList * drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled( pos, ImVec2( pos.x + size.x, pos.y + size.y ), ImGui::GetColorU32(ImGuiCol_FrameBg) );
+    float right = pos.x + size.x, bottom = pos.y + size.y;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        auto & bucket = this->rateBuckets[i];
+        float x1 = right - ( count - i ) * barWidth, x2 = x1 + barWidth - 1.0f;
+        float y = bottom;
+        for ( int c = 0; c < lccCount; c++ )
+        {
+            winux::uint64 v = value( bucket, c );
+            if ( v == 0 ) continue;
+            float h = size.y * v / maxValue;
+            drawList->AddRectFilled( ImVec2( x1, y - h ), ImVec2( x2, y ), colorClassColors[c] );
+            y -= h;
+        }
+    }
+    ImGui::SetCursorScreenPos( ImVec2( pos.x + 2.0f, pos.y ) );
+    ImGui::TextDisabled( this->rateMetric == 0 ? u8"峰值 %llu 条" : u8"峰值 %llu 字节", (unsigned long long)maxValue );
+    ImGui::SetCursorScreenPos( ImVec2( pos.x, bottom + ImGui::GetStyle().ItemSpacing.y ) );
+
+    // 悬停的桶显示时间和各类别的数值
+    if ( hovered )
+    {
+        winux::int64 i = (winux::int64)count - 1 - (winux::int64)( ( right - ImGui::GetIO().MousePos.x ) / barWidth );
+        if ( i >= 0 && i < (winux::int64)count )
+        {
+            auto & bucket = this->rateBuckets[i];
+            ImGui::BeginTooltip();
+            ImGui::Text( "%s", winux::DateTimeL::FromMilliSec( ( firstIndex + i ) * span ).toString<char>().c_str() );
+            ImGui::Text( u8"合计：%llu条，%llu字节", (unsigned long long)bucket.getCount(), (unsigned long long)bucket.getBytes() );
+            for ( int c = 0; c < lccCount; c++ )
+            {
+                if ( bucket.counts[c] == 0 ) continue;
+                ImGui::TextColored( ImGui::ColorConvertU32ToFloat4(colorClassColors[c]), u8"%s：%u条，%llu字节", colorClassNames[c], bucket.counts[c], (unsigned long long)bucket.bytes[c] );
+            }
+            ImGui::EndTooltip();
+        }
+    }
+}
+
+void LogViewerWindow::sortLogs( ImGuiTableSortSpecs const * specs )
 {
+    std::vector<LogSortIndex::Key> keys;
+    for ( int i = 0; i < specs->SpecsCount; i++ )
+    {
+        ImGuiTableColumnSortSpecs const & spec = specs->Specs[i];
+        keys.push_back( { (LogSortIndex::Column)spec.ColumnUserID, spec.SortDirection == ImGuiSortDirection_Descending } );
+    }
+    this->sortIndex.setKeys(keys);
+    this->resortLogs();
+}
+
+void LogViewerWindow::resortLogs()
+{
+    this->sortedView = this->activeFilterView;
+    this->clickRowPrev = -1;
+    this->sortTask.reset(); // 取消之前的排序
+    if ( !this->sortIndex.isEnabled() ) return;
+
+    // 在后台对存储快照和视图的行排序，完成前按存储顺序显示，结果在pollScans()中换入
+    std::lock_guard<std::mutex> lk(this->feed->mtx);
+    std::vector<winux::uint32> rows;
+    if ( this->activeFilterView != -1 )
+    {
+        LogFilterView const & view = *this->filterViews[this->activeFilterView].get();
+        rows.resize( view.size() );
+        for ( size_t i = 0; i < rows.size(); i++ ) rows[i] = view[i];
+    }
+    this->sortTask.attachNew( new LogSortTask( &this->host->scanPool, this->feed->logs, this->sortIndex.getKeys(), this->activeFilterView != -1 ? &rows : nullptr ) );
+    this->sortTask->start();
 }
 
 void LogViewerWindow::render()
 {
     ImGui::Begin( this->name.c_str(), &this->show );
-    ImGui::SetWindowDock( ImGui::GetCurrentWindow(), manager->mainWindow->dockSpaceId, ImGuiCond_Once );
+    ImGui::SetWindowDock( ImGui::GetCurrentWindow(), this->host->dockSpaceId, ImGuiCond_Once );
 
     this->renderComponents();
 
@@ -53,6 +510,8 @@ void LogViewerWindow::render()
 
 void LogViewerWindow::renderComponents()
 {
+    this->pollScans();
+
     ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 6.0f, 0 ) );
     if ( ImGui::Button(u8"取消选择") )
     {
@@ -60,12 +519,17 @@ void LogViewerWindow::renderComponents()
         this->clickRowPrev = -1;
     }
     ImGui::SameLine();
+    if ( ImGui::Button(u8"反选") )
+    {
+        std::lock_guard<std::mutex> lk(this->feed->mtx);
+        this->selected.invert( this->feed->logs.size() );
+        if ( this->feed->logs.getFirstRow() > 0 ) this->selected.selectRange( 0, this->feed->logs.getFirstRow() - 1, false ); // 已淘汰的行不选
+    }
+    ImGui::SameLine();
     if ( ImGui::Button(u8"清空列表") )
     {
-        std::lock_guard<std::mutex> lk(this->mtx);
-        this->logs.clear();
-        this->selected.clear();
-        this->clickRowPrev = -1;
+        std::lock_guard<std::mutex> lk(this->feed->mtx);
+        this->clearLogs();
     }
     ImGui::PopStyleVar();
 
@@ -87,64 +551,156 @@ void LogViewerWindow::renderComponents()
     }
     ImGui::PopStyleVar();
 
+    ImGui::SameLine();
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
+    ImGui::Checkbox( u8"速率图", &this->showRates );
+    ImGui::PopStyleVar();
+
+    // 搜索
+    ImGui::SameLine();
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 6.0f, 0 ) );
+    ImGui::SetNextItemWidth( ImGui::GetFontSize() * 16.0f );
+    bool doSearch = ImGui::InputTextWithHint( "##search", u8"搜索日志内容", &this->searchText, ImGuiInputTextFlags_EnterReturnsTrue );
+    ImGui::SameLine();
+    doSearch = ImGui::Button(u8"搜索") || doSearch;
+    ImGui::PopStyleVar();
+    ImGui::SameLine();
+    ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
+    ImGui::Checkbox( u8"区分大小写", &this->searchCaseSensitive );
+    ImGui::SameLine();
+    ImGui::Checkbox( u8"按词", &this->searchToken );
+    ImGui::PopStyleVar();
+    if ( doSearch && !this->searchText.empty() )
+    {
+        this->searchLogs();
+    }
+    if ( this->searchFound != -1 )
+    {
+        ImGui::SameLine();
+        if ( this->searchScan )
+        {
+            ImGui::Text( u8"找到%d条（搜索中%d%%）", this->searchFound, (int)( this->searchScan->getProgress() * 100 ) );
+        }
+        else
+        {
+            ImGui::Text( u8"找到%d条", this->searchFound );
+        }
+    }
+    if ( this->sortTask )
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(u8"排序中...");
+    }
+
+    this->renderFilterBar();
+    if ( this->showRates ) this->renderRatePlot();
+
     int columns = 4; // 列数
-    bool logTableColumnResize = this->manager->mainWindow->app.appConfig.logTableColumnResize;
+    bool logTableColumnResize = this->host->logTableColumnResize;
     static ImGuiTableFlags flags = ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable | ( logTableColumnResize ? ImGuiTableFlags_Resizable : 0 ) |
+        ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti | ImGuiTableFlags_SortTristate |
         ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ContextMenuInBody;
 
     ImGui::PushStyleVar( ImGuiStyleVar_CellPadding, ImVec2(6.0f, 2.0f) );
     if (ImGui::BeginTable("table_logs", columns, flags))
     {
         ImGui::TableSetupScrollFreeze(0, 1); // 固定第一行（表格头）
-        ImGui::TableSetupColumn(u8"编号", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn(u8"时间", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn(u8"长度", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn(u8"日志内容", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn(u8"编号", ImGuiTableColumnFlags_WidthFixed, 0.0f, LogSortIndex::scRow);
+        ImGui::TableSetupColumn(u8"时间", ImGuiTableColumnFlags_WidthFixed, 0.0f, LogSortIndex::scTime);
+        ImGui::TableSetupColumn(u8"长度", ImGuiTableColumnFlags_WidthFixed, 0.0f, LogSortIndex::scSize);
+        ImGui::TableSetupColumn(u8"日志内容", ImGuiTableColumnFlags_WidthStretch, 0.0f, LogSortIndex::scContent);
 
         ImGui::TableHeadersRow();
 
+        // 点击表头改变排序或切换了筛选视图时重新排序
+        ImGuiTableSortSpecs * sortSpecs = ImGui::TableGetSortSpecs();
+        if ( sortSpecs && sortSpecs->SpecsDirty )
+        {
+            this->sortLogs(sortSpecs);
+            sortSpecs->SpecsDirty = false;
+        }
+        else if ( this->sortedView != this->activeFilterView )
+        {
+            this->resortLogs();
+        }
+
+        // 详情弹窗中要求按模板筛选时记下模板，addFilterView()要加锁，须在释放feed->mtx之后调用
+        winux::uint32 filterTemplateId = 0;
+        winux::Utf8String filterTemplateText;
         {
-            std::lock_guard<std::mutex> lk(this->mtx);
+            std::lock_guard<std::mutex> lk(this->feed->mtx);
 
+            // 有筛选视图时只显示视图中的行，displayRow为显示行号，row为存储行号
+            LogFilterView const * view = this->activeFilterView != -1 ? this->filterViews[this->activeFilterView].get() : nullptr;
             ImGuiListClipper clipper;
-            clipper.Begin( (int)this->logs.size() );
+            // 没有筛选视图时从第一条未淘汰的记录开始显示
+            int firstRow = (int)this->feed->logs.getFirstRow();
+            // 排序时按排序索引显示，新行定期并入，不必每帧归并
+            bool sorted = this->sortIndex.isEnabled() && !this->sortTask;
+            if ( sorted )
+            {
+                winux::uint64 nowMs = winux::GetUtcTimeMs();
+                if ( nowMs - this->sortUpdateTimeMs >= 200 )
+                {
+                    this->sortIndex.update( this->feed->logs, view );
+                    this->sortUpdateTimeMs = nowMs;
+                }
+            }
+            auto rowAt = [&] ( int displayRow ) -> int {
+                if ( sorted ) return (int)this->sortIndex[displayRow];
+                return view ? (int)(*view)[displayRow] : firstRow + displayRow;
+            };
+            // 每帧只取一次的状态：修饰键、颜色表
+            bool isCtrlDown = ImGui::GetIO().KeyCtrl;
+            bool isShiftDown = ImGui::GetIO().KeyShift;
+            LogColorTable const & colorTable = LogColorTable::Get();
+            ImU32 textColor = ImGui::GetColorU32(ImGuiCol_Text);
+            clipper.Begin( sorted ? (int)this->sortIndex.size() : ( view ? (int)view->size() : (int)this->feed->logs.size() - firstRow ) );
             while ( clipper.Step() )
             {
-                for ( int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++ )
+                for ( int displayRow = clipper.DisplayStart; displayRow < clipper.DisplayEnd; displayRow++ )
                 {
-                    auto & log = this->logs[row];
+                    int row = rowAt(displayRow);
+                    auto & log = this->feed->logs[row];
 
                     ImGui::TableNextRow();
                     ImGui::TableSetColumnIndex(0);
-                    char szNo[20] = { 0 };
-                    sprintf( szNo, u8"%u", row + 1 );
-                    bool isCtrlDown = ImGui::IsKeyDown(ImGuiKey_LeftCtrl) || ImGui::IsKeyDown(ImGuiKey_RightCtrl);
-                    bool isShiftDown = ImGui::IsKeyDown(ImGuiKey_LeftShift) || ImGui::IsKeyDown(ImGuiKey_RightShift);
-                    if ( ImGui::Selectable( szNo, this->selected.find(row) != this->selected.end() && this->selected[row], ImGuiSelectableFlags_SpanAllColumns ) )
+                    char bufNo[24];
+                    bufNo[23] = '\0';
+                    char const * szNo = _UIntToStr( row + 1, bufNo + 23 );
+                    if ( ImGui::Selectable( szNo, this->selected.isSelected(row), ImGuiSelectableFlags_SpanAllColumns ) )
                     {
                         if ( isCtrlDown )
                         {
-                            this->selected[row] = !this->selected[row];
+                            this->selected.toggle(row);
                         }
                         else
                         {
                             this->selected.clear();
-                            this->selected[row] = true;
+                            this->selected.select(row);
                         }
 
                         if ( isShiftDown )
                         {
                             if ( this->clickRowPrev != -1 )
                             {
-                                int a = clickRowPrev, b = row;
-                                for ( int i = a; ( ( clickRowPrev < row ) ? i <= b : i >= b ); ( ( clickRowPrev < row ) ? i++ : i-- ) )
+                                if ( view || sorted )
+                                {
+                                    // 筛选视图或排序后的行在存储中不连续，逐行选中
+                                    int a = clickRowPrev < displayRow ? clickRowPrev : displayRow, b = clickRowPrev < displayRow ? displayRow : clickRowPrev;
+                                    for ( int i = a; i <= b; i++ )
+                                    {
+                                        this->selected.select( rowAt(i) );
+                                    }
+                                }
+                                else
                                 {
-                                    this->selected[i] = true;
+                                    this->selected.selectRange( firstRow + clickRowPrev, firstRow + displayRow );
                                 }
                             }
                         }
 
-                        this->clickRowPrev = row;
+                        this->clickRowPrev = displayRow;
                     }
                     // 弹出详细显示框
                     ImGui::PushID(row * columns);
@@ -154,8 +710,8 @@ void LogViewerWindow::renderComponents()
                         {
                             this->selected.clear();
                         }
-                        this->selected[row] = true;
-                        this->clickRowPrev = row;
+                        this->selected.select(row);
+                        this->clickRowPrev = displayRow;
 
                         bool copyToClipboard = ImGui::Button(u8"复制");
                         ImGui::SameLine();
@@ -170,9 +726,7 @@ void LogViewerWindow::renderComponents()
                         ImGui::PushTextWrapPos(ImGui::GetFontSize() * 50.0f);
                         if (log.flag.fgColorUse)
                         {
-                            ImVec4 color;
-                            _GetImVec4ColorFromColorR5G5B5(log.flag.fgColor, &color);
-                            ImGui::PushStyleColor(ImGuiCol_Text, color);
+                            ImGui::PushStyleColor( ImGuiCol_Text, colorTable.fg[log.flag.fgColor] );
                         }
                         ImGui::TextUnformatted(log.strContent.c_str(), log.strContent.c_str() + log.strContent.length());
                         if (log.flag.fgColorUse)
@@ -192,6 +746,19 @@ void LogViewerWindow::renderComponents()
                             ImGui::CloseCurrentPopup();
                         ImGui::SameLine();
                         ImGui::Text(u8"时间：%s", log.utcTime.c_str());
+                        if ( log.repeatCount > 1 )
+                        {
+                            ImGui::SameLine();
+                            ImGui::Text( u8"重复%u次，最后：%s", log.repeatCount, winux::DateTimeL::FromMilliSec(log.lastTimeMs).toString<char>().c_str() );
+                        }
+                        // 按模板筛选，只比较模板编号
+                        auto & dict = this->feed->logs.getTemplateDict();
+                        if ( log.templateId != 0 && dict && ImGui::Button(u8"筛选同模板") )
+                        {
+                            filterTemplateId = log.templateId;
+                            filterTemplateText = dict->getTemplateText(log.templateId);
+                            ImGui::CloseCurrentPopup();
+                        }
                         ImGui::EndPopup();
                     }
                     ImGui::PopID();
@@ -201,32 +768,34 @@ void LogViewerWindow::renderComponents()
                     ImGui::TextEx(log.utcTime.c_str(), log.utcTime.c_str() + log.utcTime.length());
 
                     ImGui::TableSetColumnIndex(2);
-                    ImGui::Text( "%u", (winux::uint)log.contentSize );
+                    char bufSize[24];
+                    ImGui::TextUnformatted( _UIntToStr( log.contentSize, bufSize + 24 ), bufSize + 24 );
 
                     ImGui::TableSetColumnIndex(3);
                     if ( log.flag.bgColorUse )
                     {
-                        ImVec4 color;
-                        _GetImVec4ColorFromColorR4G4B4( log.flag.bgColor, &color );
-                        ImGui::TableSetBgColor( ImGuiTableBgTarget_CellBg, ImGui::GetColorU32(color) );
+                        ImGui::TableSetBgColor( ImGuiTableBgTarget_CellBg, colorTable.bg[log.flag.bgColor] );
                     }
-
-                    if ( log.flag.fgColorUse )
+                    // 折叠的重复行显示次数
+                    if ( log.repeatCount > 1 )
                     {
-                        ImVec4 color;
-                        _GetImVec4ColorFromColorR5G5B5( log.flag.fgColor, &color );
-
-                        ImGui::PushStyleColor(ImGuiCol_Text, color);
-                        ImGui::TextUnformatted( log.strContentSlashes.c_str(), log.strContentSlashes.c_str() + log.strContentSlashes.length() );
-                        ImGui::PopStyleColor();
-                    }
-                    else
-                    {
-                        ImGui::TextUnformatted( log.strContentSlashes.c_str(), log.strContentSlashes.c_str() + log.strContentSlashes.length() );
+                        ImGui::TextDisabled( u8"×%u", log.repeatCount );
+                        ImGui::SameLine();
                     }
+
+                    _TextCachedWidth(
+                        log.strContentSlashes.c_str(),
+                        log.strContentSlashes.c_str() + log.strContentSlashes.length(),
+                        log.flag.fgColorUse ? colorTable.fg[log.flag.fgColor] : textColor,
+                        &log.textWidth
+                    );
                 }
             }
         }
+        if ( filterTemplateId != 0 )
+        {
+            this->addFilterView( winux::SharedPointer<LogFilter>( new LogTemplateFilter( filterTemplateId, filterTemplateText ) ) );
+        }
 
         // 自动滚动到底部的操作代码
         float a = ImGui::GetScrollY();
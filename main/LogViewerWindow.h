@@ -1,35 +1,94 @@
 ﻿#pragma once
 #include <mutex>
+#include <thread>
+#include "imgui.h"
+#include "LogFeed.h"
+#include "LogFilter.h"
+#include "LogExprFilter.h"
+#include "LogParallelScan.h"
+#include "LogSelection.h"
+#include "LogCsvFile.h"
+#include "LogArchiveFile.h"
+#include "LogSort.h"
 
-struct LogWindowsManager;
-
-struct LogTextRecord
+// 日志查看窗口的运行环境，由窗口管理器提供，无界面后端时（如渲染基准测试）也可单独构造
+struct LogViewerHost
 {
-    size_t contentSize;  //!< 日志内容大小
-    winux::Utf8String strContent;   //!< 字符串内容
-    winux::Utf8String strContentSlashes;    //!< 字符串转义内容
-    winux::Utf8String utcTime;  //!< UTC时间戳
-    eienlog::LogFlag flag;  //!< 日志样式FLAG
+    LogViewerHost() : scanPool( std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 4 )
+    {
+    }
+
+    winux::ThreadPool scanPool; // 并行筛选、搜索用的线程池，须先于窗口构造、后于窗口析构
+    ImGuiID dockSpaceId = 0; // 窗口停靠的空间
+    bool logTableColumnResize = true; // 日志表格列自定义宽度
 };
 
 struct LogViewerWindow
 {
-    LogViewerWindow( LogWindowsManager * manager, winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile = u8"" );
+    LogViewerWindow( LogViewerHost * host, winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile = u8"", LogRange const & range = LogRange() );
+    // 显示共享的日志数据
+    LogViewerWindow( LogViewerHost * host, winux::Utf8String const & name, bool vScrollToBottom, winux::SharedPointer<LogFeed> feed );
     virtual ~LogViewerWindow();
 
     void render();
     virtual void renderComponents();
 
-    LogWindowsManager * manager;
+    // 清空日志及本窗口的视图、排序和选择，共享日志数据的其他窗口随后也会清空，调用者须持有feed->mtx
+    void clearLogs();
+    // 接续日志数据的变化：更新筛选视图，丢弃选择中已淘汰的行，其他窗口清空了日志时一并清空，调用者须持有feed->mtx
+    void syncFeed();
+    // 开始搜索日志，匹配行随并行扫描的进展逐步选中
+    void searchLogs();
+    // 并入并行搜索和筛选视图扫描的部分结果，接续日志数据的变化
+    void pollScans();
+    // 添加筛选视图并切换到它
+    void addFilterView( winux::SharedPointer<LogFilter> filter );
+    // 渲染筛选视图工具栏
+    void renderFilterBar();
+    // 按列统计当前显示的日志中fieldStatsKey字段的值
+    void statFields();
+    // 渲染日志速率图
+    void renderRatePlot();
+    // 按表格的排序设置重新排序当前显示的日志，排序时不持有mtx
+    void sortLogs( ImGuiTableSortSpecs const * specs );
+    // 按已设置的排序键重新排序当前显示的日志
+    void resortLogs();
+
+    LogViewerHost * host;
     winux::Utf8String name;
     bool vScrollToBottom;
     winux::Utf8String logFile;
-    std::vector<LogTextRecord> logs;
+    LogRange range; // 日志文件的加载范围
+    winux::SharedPointer<LogFeed> feed; // 日志数据，可由多个窗口共享
+    size_t feedFirstRow = 0; // 上次接续时存储的第一条未淘汰行
+    winux::uint64 feedClearCount = 0; // 上次接续时日志数据的清空次数
 
-    std::map< int, bool > selected; // 选中行
-    int clickRowPrev = -1;  // 上次点击行
+    LogSelection selected; // 选中行（存储行号）
+    int clickRowPrev = -1;  // 上次点击行（显示行号）
     bool bToggleVScrollToBottom = false; // 触发“自动滚动到底”复选框
     bool bToggleToTop = false; // 触发“到顶”
-    std::mutex mtx; // 数据同步互斥量
+    winux::Utf8String searchText; // 搜索文本
+    bool searchCaseSensitive = false; // 搜索区分大小写
+    bool searchToken = false; // 按词搜索
+    int searchFound = -1; // 上次搜索找到的行数，-1表示未搜索
+    winux::SimplePointer<LogParallelScan> searchScan; // 进行中的并行搜索
+    std::vector< winux::SharedPointer<LogFilterView> > filterViews; // 筛选视图
+    int activeFilterView = -1; // 当前显示的筛选视图，-1表示显示全部
+    LogCondFilter filterEdit; // 正在编辑的筛选条件
+    winux::Utf8String filterTimeBegin, filterTimeEnd; // 正在编辑的筛选时间范围
+    winux::Utf8String filterCategories; // 正在编辑的筛选类别，逗号分隔
+    winux::Utf8String filterExpr; // 正在编辑的筛选表达式
+    winux::Utf8String filterExprError; // 筛选表达式错误信息
+    winux::Utf8String fieldStatsKey; // 要统计的结构化字段名
+    LogFieldStats fieldStats; // 结构化字段的统计结果
+    bool fieldStatsValid = false; // 是否已统计
+    bool showRates = false; // 显示速率图
+    int rateLevel = LogRateTimeline::lvSecond; // 速率图的时间粒度
+    int rateMetric = 0; // 速率图显示的指标：0条数，1字节数
+    std::vector<LogRateTimeline::Bucket> rateBuckets; // 速率图的桶，每帧复用
+    LogSortIndex sortIndex; // 排序索引，不排序时为空
+    winux::SimplePointer<LogSortTask> sortTask; // 进行中的后台排序，完成前按存储顺序显示
+    int sortedView = -1; // 排序索引对应的筛选视图，-1表示全部日志
+    winux::uint64 sortUpdateTimeMs = 0; // 上次把新行并入排序索引的时间
     bool show = true;
 };
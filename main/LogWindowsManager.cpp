@@ -11,15 +11,19 @@ LogWindowsManager::LogWindowsManager( MainWindow * mainWindow ) : mainWindow(mai
 
 void LogWindowsManager::addWindow( App::ListenParams const & lparams )
 {
-    auto p = winux::MakeSimple( new LogListenWindow( this, lparams ) );
+    // 地址端口已在监听时，保留策略等设置以已有的日志接收为准，历史中也记下实际生效的设置
+    auto listener = this->subscribe(lparams);
+    App::ListenParams effective = lparams;
+    effective.assignShared(listener->lparams);
+    auto p = winux::MakeSimple( new LogListenWindow( this, effective, listener ) );
     this->wins.emplace_back(p);
 
-    this->mainWindow->app.setRecentListen(lparams);
+    this->mainWindow->app.setRecentListen(effective);
 }
 
-void LogWindowsManager::addWindow( winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile )
+void LogWindowsManager::addWindow( winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile, LogRange const & range )
 {
-    auto p = winux::MakeSimple( new LogViewerWindow( this, name, vScrollToBottom, logFile ) );
+    auto p = winux::MakeSimple( new LogViewerWindow( this, name, vScrollToBottom, logFile, range ) );
     this->wins.emplace_back(p);
 
     this->mainWindow->app.setRecentOpen(logFile);
@@ -27,6 +31,8 @@ void LogWindowsManager::addWindow( winux::Utf8String const & name, bool vScrollT
 
 void LogWindowsManager::render()
 {
+    this->dockSpaceId = this->mainWindow->dockSpaceId;
+    this->logTableColumnResize = this->mainWindow->app.appConfig.logTableColumnResize;
     for ( auto it = this->wins.begin(); it != this->wins.end(); )
     {
         if ( (*it)->show )
@@ -40,3 +46,26 @@ void LogWindowsManager::render()
         }
     }
 }
+
+LogListener * LogWindowsManager::findListener( winux::Utf8String const & addr, winux::ushort port ) const
+{
+    auto it = this->listeners.find( std::make_pair( addr, port ) );
+    return it != this->listeners.end() ? it->second.get() : nullptr;
+}
+
+winux::SharedPointer<LogListener> LogWindowsManager::subscribe( App::ListenParams const & lparams )
+{
+    auto & listener = this->listeners[ std::make_pair( lparams.addr, lparams.port ) ];
+    if ( !listener ) listener.attachNew( new LogListener(lparams) );
+    listener->subscribers++;
+    return listener;
+}
+
+void LogWindowsManager::unsubscribe( LogListener * listener )
+{
+    auto it = this->listeners.find( std::make_pair( listener->lparams.addr, listener->lparams.port ) );
+    if ( it != this->listeners.end() && it->second.get() == listener && --listener->subscribers == 0 )
+    {
+        this->listeners.erase(it);
+    }
+}
@@ -1,16 +1,26 @@
 ﻿#pragma once
+#include <map>
+#include "LogViewerWindow.h"
 
 struct MainWindow;
-struct LogViewerWindow;
+struct LogListener;
 
-struct LogWindowsManager
+struct LogWindowsManager : LogViewerHost
 {
     LogWindowsManager( MainWindow * mainWindow );
 
     void addWindow( App::ListenParams const & lparams );
-    void addWindow( winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile );
+    void addWindow( winux::Utf8String const & name, bool vScrollToBottom, winux::Utf8String const & logFile, LogRange const & range = LogRange() );
     void render();
 
+    // 地址端口上正在进行的日志接收，没有则返回nullptr
+    LogListener * findListener( winux::Utf8String const & addr, winux::ushort port ) const;
+    // 订阅地址端口上的日志接收，还没有时按lparams创建，已有时沿用它的共用设置
+    winux::SharedPointer<LogListener> subscribe( App::ListenParams const & lparams );
+    // 取消订阅，最后一个窗口取消时登记表不再持有它，读取线程随最后一个引用结束
+    void unsubscribe( LogListener * listener );
+
+    std::map< std::pair< winux::Utf8String, winux::ushort >, winux::SharedPointer<LogListener> > listeners; // 按地址端口登记的日志接收，须后于窗口析构
     std::vector< winux::SimplePointer<LogViewerWindow> > wins;
     MainWindow * mainWindow;
 };
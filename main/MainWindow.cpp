@@ -161,7 +161,7 @@ void MainWindow::renderDockSpaceMenuBar()
             if ( ImGui::MenuItem(u8"打开日志...", u8"Ctrl+O") )
             {
                 winplus::FileDialog dlg{app.wi.hWnd};
-                if ( dlg.doModal( L".", L"日志文件(*.csvlog)\0*.csvlog\0全部文件(*.*)\0*.*\0\0" ) )
+                if ( dlg.doModal( L".", L"日志文件(*.csvlog;*.eienlog)\0*.csvlog;*.eienlog\0全部文件(*.*)\0*.*\0\0" ) )
                 {
                     winux::String filepath = dlg.getFilePath();
                     winux::String filename;
@@ -170,6 +170,32 @@ void MainWindow::renderDockSpaceMenuBar()
                     this->logWinManager->addWindow( u8"日志[" + $u8( winux::FileTitle(filename) ) + winux::FormatA( u8"] %d", idLogWindow++ ), true, $u8(filepath) );
                 }
             }
+            if ( ImGui::BeginMenu(u8"按范围打开日志") )
+            {
+                // 只加载范围内的行，大文件不必整体扫描
+                static char const * rangeTypes[] = { u8"行范围", u8"时间范围" };
+                int rangeItem = this->openRangeType - LogRange::lrRows;
+                ImGui::PushItemWidth( ImGui::GetFontSize() * 12 );
+                if ( ImGui::Combo( u8"范围", &rangeItem, rangeTypes, IM_ARRAYSIZE(rangeTypes) ) ) this->openRangeType = LogRange::lrRows + rangeItem;
+                bool isTime = this->openRangeType == LogRange::lrTime;
+                ImGui::InputTextWithHint( u8"起始", isTime ? u8"2024-01-01T00:00:00.000" : u8"0", &this->openRangeBegin );
+                ImGui::InputTextWithHint( u8"结束(不含)", isTime ? u8"2024-01-01T00:05:00.000" : u8"不限", &this->openRangeEnd );
+                ImGui::PopItemWidth();
+                if ( ImGui::MenuItem(u8"选择文件...") )
+                {
+                    winplus::FileDialog dlg{app.wi.hWnd};
+                    if ( dlg.doModal( L".", L"日志文件(*.csvlog;*.eienlog)\0*.csvlog;*.eienlog\0全部文件(*.*)\0*.*\0\0" ) )
+                    {
+                        winux::String filepath = dlg.getFilePath();
+                        winux::String filename;
+                        winux::FilePath( filepath, &filename );
+
+                        LogRange range = LogRange::Parse( (LogRange::Type)this->openRangeType, this->openRangeBegin, this->openRangeEnd );
+                        this->logWinManager->addWindow( u8"日志[" + $u8( winux::FileTitle(filename) ) + u8" " + this->openRangeBegin + u8"~" + this->openRangeEnd + winux::FormatA( u8"] %d", idLogWindow++ ), true, $u8(filepath), range );
+                    }
+                }
+                ImGui::EndMenu();
+            }
             ImGui::Separator();
             if ( ImGui::BeginMenu(u8"最近开启监听") )
             {
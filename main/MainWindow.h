@@ -17,6 +17,8 @@ struct MainWindow
     bool showSettingsWindow = true;
     bool showDemoWindow = false;
     bool showAboutWindow = false;
+    int openRangeType = LogRange::lrTime; // 按范围打开日志的范围类型
+    winux::Utf8String openRangeBegin, openRangeEnd; // 按范围打开日志的起止行或时间
 
     // Dock space state
     ImGuiID dockSpaceId;
@@ -3,6 +3,7 @@
 #include "WindowModal.h"
 #include "NewLogListenWindowModal.h"
 #include "LogWindowsManager.h"
+#include "LogListenWindow.h"
 
 // struct NewLogListenWindowModal ---------------------------------------------------------------
 NewLogListenWindowModal::NewLogListenWindowModal( LogWindowsManager * manager, winux::Utf8String const & name ) : WindowModal(name), _manager(manager)
@@ -17,6 +18,29 @@ static winux::Utf8String __strWaitTimeout = u8"50";
 static winux::Utf8String __strUpdateTimeout = u8"300";
 static bool __vScrollToBottom = true;
 static bool __soundEffect = true;
+static winux::Utf8String __strMaxRecords = u8"0";
+static winux::Utf8String __strMaxMBytes = u8"0";
+static winux::Utf8String __strMaxAgeSec = u8"0";
+static winux::Utf8String __spillFile = u8"";
+static winux::Utf8String __strHotMBytes = u8"0";
+static winux::Utf8String __coldFile = u8"";
+static winux::Utf8String __strCollapseMs = u8"0";
+static bool __templateDict = false;
+
+// 地址端口已在监听时，共用的设置填成已有日志接收的设置
+static void __FillShared( App::ListenParams const & shared )
+{
+    __strWaitTimeout = winux::Mixed(shared.waitTimeout).toAnsi();
+    __strUpdateTimeout = winux::Mixed(shared.updateTimeout).toAnsi();
+    __strMaxRecords = winux::Mixed(shared.maxRecords).toAnsi();
+    __strMaxMBytes = winux::Mixed(shared.maxMBytes).toAnsi();
+    __strMaxAgeSec = winux::Mixed(shared.maxAgeSec).toAnsi();
+    __spillFile = shared.spillFile;
+    __strHotMBytes = winux::Mixed(shared.hotMBytes).toAnsi();
+    __coldFile = shared.coldFile;
+    __strCollapseMs = winux::Mixed(shared.collapseMs).toAnsi();
+    __templateDict = shared.templateDict;
+}
 
 void NewLogListenWindowModal::renderComponents()
 {
@@ -40,11 +64,20 @@ void NewLogListenWindowModal::renderComponents()
     ImGui::InputInt( u8"##port", &__port, 1 );
     ImGui::PopItemWidth();
 
+    // 同一地址端口的窗口共用一个日志接收，超时、保留策略、分层存储、折叠、模板字典只能沿用已有的设置
+    LogListener * live = this->_manager->findListener( __addr, (winux::ushort)__port );
+    if ( live )
+    {
+        __FillShared(live->lparams);
+        ImGui::TextColored( ImVec4( 1.0f, 0.8f, 0.3f, 1.0f ), u8"该地址端口已在监听，灰色的设置与已有窗口共用" );
+    }
+
     ImGui::AlignTextToFramePadding();
     ImGui::Text(u8"名称");
     ImGui::SameLine( 0.0f, 1.0f );
     ImGui::InputText( u8"##name", &__name );
 
+    ImGui::BeginDisabled( live != nullptr );
     ImGui::AlignTextToFramePadding();
     ImGui::Text(u8"等待超时");
     ImGui::SameLine( 0.0f, 1.0f );
@@ -58,12 +91,70 @@ void NewLogListenWindowModal::renderComponents()
     ImGui::PushItemWidth(80);
     ImGui::InputText( u8"##update_timeout", &__strUpdateTimeout );
     ImGui::PopItemWidth();
+    ImGui::EndDisabled();
 
     ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
     ImGui::Checkbox( u8"自动滚动到底部", &__vScrollToBottom );
     ImGui::SameLine();
     ImGui::Checkbox( u8"日志音效", &__soundEffect );
     ImGui::PopStyleVar();
+
+    // 保留策略：超出任一上限时整块淘汰最早的日志
+    ImGui::BeginDisabled( live != nullptr );
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"最多条数");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::PushItemWidth(80);
+    ImGui::InputText( u8"##max_records", &__strMaxRecords );
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"最多内存(MB)");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::PushItemWidth(80);
+    ImGui::InputText( u8"##max_mbytes", &__strMaxMBytes );
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"最长保留(秒)");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::PushItemWidth(80);
+    ImGui::InputText( u8"##max_age", &__strMaxAgeSec );
+    ImGui::PopItemWidth();
+
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"淘汰转存");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::InputTextWithHint( u8"##spill_file", u8"留空则丢弃，如 D:\\logs\\spill.eienlog", &__spillFile );
+
+    // 分层存储：热数据超出上限时把冷块压缩换出到文件，浏览、搜索时再换入
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"热数据(MB)");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::PushItemWidth(80);
+    ImGui::InputText( u8"##hot_mbytes", &__strHotMBytes );
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"冷块文件");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::InputTextWithHint( u8"##cold_file", u8"热数据为0时不分层，如 D:\\logs\\cold.tmp", &__coldFile );
+
+    // 重复日志折叠：时间窗口内内容相同的日志合并成一行并计数
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text(u8"折叠重复(毫秒)");
+    ImGui::SameLine( 0.0f, 1.0f );
+    ImGui::PushItemWidth(80);
+    ImGui::InputText( u8"##collapse_ms", &__strCollapseMs );
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    ImGui::TextDisabled(u8"0不折叠");
+
+    // 模板字典：内容只有数字不同的日志共用一个模板，写满的块只保留模板编号和数字
+    ImGui::Checkbox( u8"模板字典编码", &__templateDict );
+    ImGui::SameLine();
+    ImGui::TextDisabled(u8"大量重复格式的日志可减少内存占用");
+    ImGui::EndDisabled();
 }
 
 void NewLogListenWindowModal::onOk()
@@ -76,6 +167,14 @@ void NewLogListenWindowModal::onOk()
     lparams.updateTimeout = winux::Mixed(__strUpdateTimeout);
     lparams.vScrollToBottom = __vScrollToBottom;
     lparams.soundEffect = __soundEffect;
+    lparams.maxRecords = winux::Mixed(__strMaxRecords);
+    lparams.maxMBytes = winux::Mixed(__strMaxMBytes);
+    lparams.maxAgeSec = winux::Mixed(__strMaxAgeSec);
+    lparams.spillFile = __spillFile;
+    lparams.hotMBytes = winux::Mixed(__strHotMBytes);
+    lparams.coldFile = __coldFile;
+    lparams.collapseMs = winux::Mixed(__strCollapseMs);
+    lparams.templateDict = __templateDict;
 
     this->_manager->addWindow(lparams);
 
@@ -0,0 +1,78 @@
+﻿#pragma once
+// 界面公共部分，不依赖图形后端和Win32窗口，日志查看窗口和渲染基准测试共用
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "misc/cpp/imgui_stdlib.h"
+#include "winux.hpp"
+
+// 渲染Tooltip
+inline static void HelpMarker(const char* desc)
+{
+    ImGui::TextDisabled("(?)");
+    if ( ImGui::BeginItemTooltip() )
+    {
+        ImGui::PushTextWrapPos(ImGui::GetFontSize() * 50.0f);
+        ImGui::TextUnformatted(desc);
+        ImGui::PopTextWrapPos();
+        ImGui::EndTooltip();
+    }
+}
+
+// Foreground color: R5G5B5
+inline static void _GetImVec4ColorFromColorR5G5B5( winux::uint16 fgColor, ImVec4 * color )
+{
+    float r = ( fgColor & 31 ) / 31.0f, g = ( ( fgColor >> 5 ) & 31 ) / 31.0f, b = ( ( fgColor >> 10 ) & 31 ) / 31.0f;
+    color->x = r;
+    color->y = g;
+    color->z = b;
+    color->w = 1.0f;
+}
+
+// Background color: R4G4B4
+inline static void _GetImVec4ColorFromColorR4G4B4( winux::uint16 bgColor, ImVec4 * color )
+{
+    float r = ( bgColor & 15 ) / 15.0f, g = ( ( bgColor >> 4 ) & 15 ) / 15.0f, b = ( ( bgColor >> 8 ) & 15 ) / 15.0f;
+    color->x = r;
+    color->y = g;
+    color->z = b;
+    color->w = 1.0f;
+}
+
+// 日志颜色查找表，把R5G5B5前景色和R4G4B4背景色预先换算成ImU32，渲染时按位直接查表
+struct LogColorTable
+{
+    ImU32 fg[32768];
+    ImU32 bg[4096];
+
+    LogColorTable()
+    {
+        ImVec4 color;
+        for ( int i = 0; i < 32768; i++ )
+        {
+            _GetImVec4ColorFromColorR5G5B5( (winux::uint16)i, &color );
+            fg[i] = ImGui::ColorConvertFloat4ToU32(color);
+        }
+        for ( int i = 0; i < 4096; i++ )
+        {
+            _GetImVec4ColorFromColorR4G4B4( (winux::uint16)i, &color );
+            bg[i] = ImGui::ColorConvertFloat4ToU32(color);
+        }
+    }
+
+    static LogColorTable const & Get()
+    {
+        static LogColorTable table;
+        return table;
+    }
+};
+
+// 无符号整数转十进制文本，从end往前写，返回文本开头，缓冲区至少留20字节
+inline static char * _UIntToStr( winux::uint64 value, char * end )
+{
+    do
+    {
+        *--end = (char)( '0' + value % 10 );
+        value /= 10;
+    } while ( value );
+    return end;
+}
@@ -0,0 +1,143 @@
+﻿// 日志表格渲染基准测试：无界面后端，用假的显示尺寸驱动LogViewerWindow的渲染，统计每帧耗时、生成顶点数和内存分配次数
+// 用法：render-bench [日志行数=1000000] [帧数=600]
+// Linux下编译：g++ -std=c++17 -O2 -I../imgui -I../main -I<fastdo各组件include> main.cpp ../main/Log*.cpp <imgui源文件> <winux、eiennet、eienlog库> -lpthread -ldl
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "LogViewerWindow.h"
+
+static std::atomic<size_t> _allocCount(0);
+
+void * operator new( size_t size )
+{
+    ++_allocCount;
+    void * p = malloc( size ? size : 1 );
+    if ( !p ) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete( void * p ) noexcept
+{
+    free(p);
+}
+
+void operator delete( void * p, size_t ) noexcept
+{
+    free(p);
+}
+
+static void * _ImAlloc( size_t size, void * )
+{
+    ++_allocCount;
+    return malloc(size);
+}
+
+static void _ImFree( void * p, void * )
+{
+    free(p);
+}
+
+// 生成一条合成日志，部分带颜色，内容长短不一，每50行有一条超出窗口宽度的长行
+static LogTextRecord _MakeRecord( size_t i )
+{
+    static char const * words[] = { "connect", "recv", "send", "timeout", "retry", "user", "session", "query", "cache", "miss" };
+    LogTextRecord tr;
+    winux::Utf8String & s = tr.strContent;
+    s = winux::Format( "[%u] ", (unsigned)i );
+    for ( size_t w = 0, n = i % 50 == 0 ? 400 : 3 + i % 17; w < n; w++ )
+    {
+        s += words[( i * 7 + w ) % 10];
+        s += ( w % 5 == 4 ) ? '\t' : ' ';
+    }
+    tr.contentSize = s.size();
+    tr.strContentSlashes = winux::AddCSlashes(s);
+    winux::uint64 ms = 1700000000000ULL + i * 3;
+    tr.utcTime = winux::Format( "2023-11-14 22:13:%02u.%03u", (unsigned)( ms / 1000 % 60 ), (unsigned)( ms % 1000 ) );
+    tr.utcTimeMs = ms;
+    if ( i % 7 == 0 ) tr.flag = eienlog::LogFlag( true, 0x7C00, false, 0, eienlog::leUtf8, false ); // 红色前景
+    else if ( i % 11 == 0 ) tr.flag = eienlog::LogFlag( false, 0, true, 0x03E0, eienlog::leUtf8, false ); // 绿色背景
+    else tr.flag = eienlog::LogFlag(eienlog::leUtf8);
+    return tr;
+}
+
+int main( int argc, char * argv[] )
+{
+    size_t rows = argc > 1 ? strtoul( argv[1], nullptr, 10 ) : 1000000;
+    int frames = argc > 2 ? std::max( atoi(argv[2]), 1 ) : 600;
+
+    ImGui::SetAllocatorFunctions( _ImAlloc, _ImFree );
+    ImGui::CreateContext();
+    ImGuiIO & io = ImGui::GetIO();
+    io.DisplaySize = ImVec2( 1600, 900 );
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    io.Fonts->AddFontDefault();
+    unsigned char * pixels;
+    int texWidth, texHeight;
+    io.Fonts->GetTexDataAsRGBA32( &pixels, &texWidth, &texHeight );
+
+    LogViewerHost host;
+    LogViewerWindow viewer( &host, "bench", false );
+    {
+        std::lock_guard<std::mutex> lk(viewer.feed->mtx);
+        for ( size_t i = 0; i < rows; i++ ) viewer.feed->addLog( _MakeRecord(i) );
+    }
+    printf( "rows=%zu frames=%d\n", viewer.feed->logs.size(), frames );
+
+    // 预热几帧，让表格列宽和字体缓存稳定下来
+    auto frame = [&] ( float wheel ) {
+        io.AddMousePosEvent( 800, 450 );
+        if ( wheel != 0 ) io.AddMouseWheelEvent( 0, wheel );
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos( ImVec2( 0, 0 ) );
+        ImGui::SetNextWindowSize( io.DisplaySize );
+        viewer.render();
+        ImGui::Render();
+    };
+    for ( int i = 0; i < 10; i++ ) frame(0);
+
+    std::vector<double> times;
+    times.reserve(frames);
+    double vtxTotal = 0, idxTotal = 0;
+    size_t allocTotal = 0;
+    float wheel = -5.0f;
+    float scrollPrev = -1;
+    float visibleRows = 0;
+    for ( int i = 0; i < frames; i++ )
+    {
+        size_t alloc0 = _allocCount;
+        auto t0 = std::chrono::steady_clock::now();
+        frame(wheel);
+        auto t1 = std::chrono::steady_clock::now();
+        allocTotal += _allocCount - alloc0;
+        times.push_back( std::chrono::duration<double, std::micro>( t1 - t0 ).count() );
+        ImDrawData * dd = ImGui::GetDrawData();
+        vtxTotal += dd->TotalVtxCount;
+        idxTotal += dd->TotalIdxCount;
+
+        // 鼠标下是表格的滚动子窗口，滚到头就反向滚动
+        ImGuiWindow * tableWnd = ImGui::GetCurrentContext()->HoveredWindow;
+        float scroll = tableWnd ? tableWnd->Scroll.y : 0;
+        if ( tableWnd && rows > 0 ) visibleRows = tableWnd->InnerRect.GetHeight() / ( tableWnd->ContentSize.y / rows );
+        if ( scroll == scrollPrev ) wheel = -wheel;
+        scrollPrev = scroll;
+    }
+
+    std::vector<double> sorted = times;
+    std::sort( sorted.begin(), sorted.end() );
+    double sum = 0;
+    for ( double t : times ) sum += t;
+    printf( "frame us: avg=%.1f p50=%.1f p99=%.1f max=%.1f\n", sum / frames, sorted[frames / 2], sorted[frames * 99 / 100], sorted.back() );
+    printf( "per frame: vtx=%.0f idx=%.0f allocs=%.1f\n", vtxTotal / frames, idxTotal / frames, (double)allocTotal / frames );
+    printf( "final scroll y=%.0f, visible rows=%.0f\n", scrollPrev, visibleRows );
+
+    ImGui::DestroyContext();
+    return 0;
+}